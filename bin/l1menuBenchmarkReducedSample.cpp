@@ -0,0 +1,157 @@
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <sys/stat.h>
+#include "l1menu/ReducedSample.h"
+#include "l1menu/TriggerMenu.h"
+#include "l1menu/tools/CommandLineParser.h"
+#include "l1menu/tools/stringManipulation.h"
+
+void printUsage( const std::string& executableName, std::ostream& output=std::cout )
+{
+	output << "Usage:" << "\n"
+			<< "\t" << executableName << " [--threads <number of threads>] [--repeat <number of repeats>] [--scratch <filename>] <ReducedSample filename>" << "\n"
+			<< "\n"
+			<< "\t" << "\t" << "Saves and reloads the sample in each of the file formats and compression codecs, and prints" << "\n"
+			<< "\t" << "\t" << "the compression ratio and speed for each. Sizes and speeds are relative to the raw thresholds" << "\n"
+			<< "\t" << "\t" << "and weights as 4 byte floats. Each test is repeated (default 3 times) and the fastest kept." << "\n"
+			<< "\t" << "\t" << "The files are written to the scratch filename (default \"reducedSampleBenchmark.tmp\"), which" << "\n"
+			<< "\t" << "\t" << "is deleted afterwards. The number of threads defaults to one per core." << "\n"
+			<< "\n"
+			<< "\t" << executableName << " --help" << "\n"
+			<< "\t" << "\t" << "prints this help message" << "\n"
+			<< std::endl;
+}
+
+namespace
+{
+	/** @brief A file format and codec combination to test. */
+	struct Configuration
+	{
+		std::string name;
+		unsigned int fileFormatVersion;
+		l1menu::ReducedSample::Codec codec;
+	};
+
+	double secondsSince( const std::chrono::steady_clock::time_point& startTime )
+	{
+		return std::chrono::duration<double>( std::chrono::steady_clock::now()-startTime ).count();
+	}
+}
+
+int main( int argc, char* argv[] )
+{
+	l1menu::tools::CommandLineParser commandLineParser;
+	try
+	{
+		commandLineParser.addOption( "threads", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "repeat", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "scratch", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "help", l1menu::tools::CommandLineParser::NoArgument );
+		commandLineParser.parse( argc, argv );
+
+		if( commandLineParser.optionHasBeenSet( "help" ) )
+		{
+			printUsage( commandLineParser.executableName() );
+			return 0;
+		}
+
+		if( commandLineParser.nonOptionArguments().size()!=1 ) throw std::runtime_error( "Incorrect number of arguments" );
+
+		size_t numberOfThreads=0;
+		if( commandLineParser.optionHasBeenSet( "threads" ) ) numberOfThreads=l1menu::tools::convertStringToInt( commandLineParser.optionArguments("threads").back() );
+		int numberOfRepeats=3;
+		if( commandLineParser.optionHasBeenSet( "repeat" ) ) numberOfRepeats=l1menu::tools::convertStringToInt( commandLineParser.optionArguments("repeat").back() );
+		if( numberOfRepeats<1 ) throw std::runtime_error( "The number of repeats must be at least one" );
+		std::string scratchFilename="reducedSampleBenchmark.tmp";
+		if( commandLineParser.optionHasBeenSet( "scratch" ) ) scratchFilename=commandLineParser.optionArguments("scratch").back();
+
+		const std::string& inputFilename=commandLineParser.nonOptionArguments()[0];
+		if( inputFilename==scratchFilename ) throw std::runtime_error( "The scratch filename must be different to the input filename" );
+
+		std::cout << "Loading " << inputFilename << std::endl;
+		l1menu::ReducedSample sample( inputFilename, numberOfThreads );
+
+		// Work out how big the data is uncompressed, so that everything can be compared to that
+		const l1menu::TriggerMenu& menu=sample.getTriggerMenu();
+		size_t numberOfParameters=0;
+		for( size_t triggerNumber=0; triggerNumber<menu.numberOfTriggers(); ++triggerNumber )
+		{
+			numberOfParameters+=sample.getTriggerParameterIdentifiers( menu.getTrigger(triggerNumber) ).size();
+		}
+		const double rawMegabytes=static_cast<double>( sample.numberOfEvents()*(numberOfParameters+1)*sizeof(float) )/1048576.0;
+		std::cout << sample.numberOfEvents() << " events with " << numberOfParameters << " thresholds each, "
+				<< std::fixed << std::setprecision(1) << rawMegabytes << "MB uncompressed" << "\n" << std::endl;
+
+		const std::vector<Configuration> configurations={
+			{ "v1 gzip", 1, l1menu::ReducedSample::Codec::GZIP },
+			{ "v2 columnar", 2, l1menu::ReducedSample::Codec::GZIP }, // Codec is ignored for version 2
+			{ "v3 gzip", 3, l1menu::ReducedSample::Codec::GZIP },
+			{ "v3 zstd", 3, l1menu::ReducedSample::Codec::ZSTD },
+			{ "v3 lz4", 3, l1menu::ReducedSample::Codec::LZ4 },
+			{ "v3 none", 3, l1menu::ReducedSample::Codec::NONE },
+			{ "v4 packed", 4, l1menu::ReducedSample::Codec::GZIP } }; // Codec is ignored for version 4
+
+		std::cout << std::left << std::setw(14) << "Format" << std::right
+				<< std::setw(12) << "Size (MB)"
+				<< std::setw(8) << "Ratio"
+				<< std::setw(14) << "Save (MB/s)"
+				<< std::setw(14) << "Load (MB/s)" << std::endl;
+
+		for( const auto& configuration : configurations )
+		{
+			if( !l1menu::ReducedSample::codecIsAvailable( configuration.codec ) )
+			{
+				std::cout << std::left << std::setw(14) << configuration.name << std::right << "  not available in this build" << std::endl;
+				continue;
+			}
+
+			double bestSaveTime=0;
+			double bestLoadTime=0;
+			for( int repeat=0; repeat<numberOfRepeats; ++repeat )
+			{
+				std::chrono::steady_clock::time_point startTime=std::chrono::steady_clock::now();
+				sample.saveToFile( scratchFilename, configuration.fileFormatVersion, numberOfThreads, configuration.codec );
+				double saveTime=secondsSince( startTime );
+
+				// Version 2 and 4 files are memory mapped, so loading would be almost instant without
+				// also touching the data. Sum the weights so that every format pays for reading
+				// at least some of it.
+				startTime=std::chrono::steady_clock::now();
+				l1menu::ReducedSample loadedSample( scratchFilename, numberOfThreads );
+				double sumOfWeights=0;
+				for( size_t eventNumber=0; eventNumber<loadedSample.numberOfEvents(); ++eventNumber ) sumOfWeights+=loadedSample.getEvent(eventNumber).weight();
+				double loadTime=secondsSince( startTime );
+
+				if( loadedSample.numberOfEvents()!=sample.numberOfEvents() ) throw std::runtime_error( "The reloaded sample has a different number of events for "+configuration.name );
+				if( std::fabs(sumOfWeights-sample.sumOfWeights())>1e-4*std::fabs(sample.sumOfWeights()) ) throw std::runtime_error( "The reloaded sample has different weights for "+configuration.name );
+
+				if( repeat==0 || saveTime<bestSaveTime ) bestSaveTime=saveTime;
+				if( repeat==0 || loadTime<bestLoadTime ) bestLoadTime=loadTime;
+			}
+
+			struct stat fileStatus;
+			if( stat( scratchFilename.c_str(), &fileStatus )!=0 ) throw std::runtime_error( "Couldn't get the size of "+scratchFilename );
+			const double fileMegabytes=static_cast<double>( fileStatus.st_size )/1048576.0;
+
+			std::cout << std::left << std::setw(14) << configuration.name << std::right << std::fixed
+					<< std::setw(12) << std::setprecision(2) << fileMegabytes
+					<< std::setw(8) << std::setprecision(2) << rawMegabytes/fileMegabytes
+					<< std::setw(14) << std::setprecision(1) << rawMegabytes/bestSaveTime
+					<< std::setw(14) << std::setprecision(1) << rawMegabytes/bestLoadTime << std::endl;
+		}
+
+		std::remove( scratchFilename.c_str() );
+	}
+	catch( std::exception& error )
+	{
+		std::cerr << "Exception caught: " << error.what() << "\n\n";
+		printUsage( commandLineParser.executableName(), std::cerr );
+		return -1;
+	}
+
+	return 0;
+}
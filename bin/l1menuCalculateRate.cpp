@@ -4,6 +4,8 @@
 
 #include <TFile.h>
 #include "l1menu/ISample.h"
+#include "l1menu/FullSample.h"
+#include "l1menu/SubSample.h"
 #include "l1menu/IMenuRate.h"
 #include "l1menu/TriggerMenu.h"
 #include "l1menu/tools/CommandLineParser.h"
@@ -13,7 +15,13 @@
 void printUsage( const std::string& executableName, std::ostream& output=std::cout )
 {
 	output << "Usage:" << "\n"
-			<< "\t" << executableName << " --totalrate <total rate in kHz> [--output <output filename>] [--format <CSV | OLD | XML>] <sample filename> <menu filename>" << "\n"
+			<< "\t" << executableName << " --totalrate <total rate in kHz> [--output <output filename>] [--format <CSV | OLD | XML>] [--threads <number of threads>] [--fraction <fraction of events>] <sample filename> <menu filename>" << "\n"
+			<< "\t" << "\t" << "If the sample is made from L1 DPG ntuples, the ntuples are read with the number of threads" << "\n"
+			<< "\t" << "\t" << "given (default one, zero means one per core). Reading ROOT ntuples from several threads at" << "\n"
+			<< "\t" << "\t" << "once is experimental, so check the rates against a single threaded run." << "\n"
+			<< "\t" << "\t" << "The 'fraction' option only uses a randomly chosen fraction (e.g. 0.05) of the events, which" << "\n"
+			<< "\t" << "\t" << "is quicker but has larger statistical errors. The same events are chosen every time, and" << "\n"
+			<< "\t" << "\t" << "the errors given include the extra error. Multiple threads aren't used with this option." << "\n"
 			<< "\n"
 			<< "\t" << executableName << " --help" << "\n"
 			<< "\t" << "\t" << "prints this help message" << "\n"
@@ -27,6 +35,8 @@ int main( int argc, char* argv[] )
 	std::string outputFilename;
 	l1menu::tools::FileFormat fileFormat=l1menu::tools::FileFormat::XMLFORMAT;
 	float totalTriggerRatekHz; // The rate if every single event passed
+	size_t numberOfThreads=1; // Zero means one per core
+	float fractionOfEvents=1;
 
 	l1menu::tools::CommandLineParser commandLineParser;
 	try
@@ -34,6 +44,8 @@ int main( int argc, char* argv[] )
 		commandLineParser.addOption( "output", l1menu::tools::CommandLineParser::RequiredArgument );
 		commandLineParser.addOption( "totalrate", l1menu::tools::CommandLineParser::RequiredArgument );
 		commandLineParser.addOption( "format", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "threads", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "fraction", l1menu::tools::CommandLineParser::RequiredArgument );
 		commandLineParser.addOption( "help", l1menu::tools::CommandLineParser::NoArgument );
 		commandLineParser.parse( argc, argv );
 
@@ -53,6 +65,12 @@ int main( int argc, char* argv[] )
 			else if( formatString=="CSV" ) fileFormat=l1menu::tools::FileFormat::CSVFORMAT;
 			else throw std::runtime_error( "format must be one of 'XML', 'OLD', or 'CSV'" );
 		}
+		if( commandLineParser.optionHasBeenSet( "threads" ) ) numberOfThreads=l1menu::tools::convertStringToInt( commandLineParser.optionArguments("threads").back() );
+		if( commandLineParser.optionHasBeenSet( "fraction" ) )
+		{
+			fractionOfEvents=l1menu::tools::convertStringToFloat( commandLineParser.optionArguments("fraction").back() );
+			if( !(fractionOfEvents>0 && fractionOfEvents<=1) ) throw std::runtime_error( "fraction must be greater than zero and no more than one" );
+		}
 
 		//
 		// Code to work out what to scale to
@@ -89,16 +107,31 @@ int main( int argc, char* argv[] )
 
 	try
 	{
+		std::cout << "Loading menu from file " << menuFilename << std::endl;
+		std::unique_ptr<l1menu::TriggerMenu> pMenu=l1menu::tools::loadMenu( menuFilename );
+
 		std::cout << "Loading sample from the file " << sampleFilename << std::endl;
-		std::unique_ptr<l1menu::ISample> pSample=l1menu::tools::loadSample( sampleFilename );
+		// Only one sequential pass is made over the events, so there's no need to hold
+		// the whole sample in memory. Only the triggers in the menu are needed, so for
+		// the memory mapped formats only those columns are loaded.
+		std::unique_ptr<l1menu::ISample> pSample=l1menu::tools::loadSample( sampleFilename, *pMenu, true );
 		pSample->setEventRate( totalTriggerRatekHz );
+		l1menu::FullSample* pFullSample=dynamic_cast<l1menu::FullSample*>( pSample.get() );
+		if( pFullSample!=nullptr ) pFullSample->setNumberOfThreads( numberOfThreads );
 
-		std::cout << "Loading menu from file " << menuFilename << std::endl;
-		std::unique_ptr<l1menu::TriggerMenu> pMenu=l1menu::tools::loadMenu( menuFilename );
+		// Only use some of the events if asked to. The SubSample uses pSample so it has to stay in scope.
+		std::unique_ptr<l1menu::SubSample> pSubSample;
+		if( fractionOfEvents<1 )
+		{
+			pSubSample.reset( new l1menu::SubSample( *pSample, fractionOfEvents ) );
+			std::cout << "Using " << pSubSample->numberOfEvents() << " of the " << pSample->numberOfEvents() << " events. Statistical errors are about "
+					<< pSubSample->statisticalErrorScale() << " times larger than with every event." << std::endl;
+		}
+		const l1menu::ISample& sample=( pSubSample ? *pSubSample : *pSample );
 
 		std::cout << "Calculating rates..." << std::endl;
 
-		std::shared_ptr<const l1menu::IMenuRate> pRates=pSample->rate(*pMenu);
+		std::shared_ptr<const l1menu::IMenuRate> pRates=sample.rate(*pMenu);
 
 		if( !outputFilename.empty() )
 		{
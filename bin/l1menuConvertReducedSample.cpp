@@ -0,0 +1,83 @@
+#include <iostream>
+#include <stdexcept>
+#include "l1menu/ReducedSample.h"
+#include "l1menu/tools/CommandLineParser.h"
+#include "l1menu/tools/stringManipulation.h"
+
+void printUsage( const std::string& executableName, std::ostream& output=std::cout )
+{
+	output << "Usage:" << "\n"
+			<< "\t" << executableName << " [--version <file format version>] [--threads <number of threads>] [--codec <gzip | zstd | lz4 | none>] <input ReducedSample filename> <output filename>" << "\n"
+			<< "\n"
+			<< "\t" << "\t" << "Converts a ReducedSample between file formats. Version 1 is the gzipped protobuf" << "\n"
+			<< "\t" << "\t" << "format, version 2 (the default) is the columnar format that is memory mapped when loaded," << "\n"
+			<< "\t" << "\t" << "version 3 is the protobuf format compressed in chunks that can be read and written in" << "\n"
+			<< "\t" << "\t" << "parallel. The number of threads defaults to one per core. Version 3 files are" << "\n"
+			<< "\t" << "\t" << "compressed with the codec given (default gzip). Version 4 is the columnar format with" << "\n"
+			<< "\t" << "\t" << "each column packed into 16 bit indices where possible, so is about half the size." << "\n"
+			<< "\n"
+			<< "\t" << executableName << " --help" << "\n"
+			<< "\t" << "\t" << "prints this help message" << "\n"
+			<< std::endl;
+}
+
+int main( int argc, char* argv[] )
+{
+	l1menu::tools::CommandLineParser commandLineParser;
+	try
+	{
+		commandLineParser.addOption( "version", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "threads", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "codec", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "help", l1menu::tools::CommandLineParser::NoArgument );
+		commandLineParser.parse( argc, argv );
+
+		if( commandLineParser.optionHasBeenSet( "help" ) )
+		{
+			printUsage( commandLineParser.executableName() );
+			return 0;
+		}
+
+		if( commandLineParser.nonOptionArguments().size()!=2 ) throw std::runtime_error( "Incorrect number of arguments" );
+
+		unsigned int fileFormatVersion=2;
+		if( commandLineParser.optionHasBeenSet( "version" ) )
+		{
+			fileFormatVersion=l1menu::tools::convertStringToInt( commandLineParser.optionArguments("version").back() );
+		}
+
+		size_t numberOfThreads=0;
+		if( commandLineParser.optionHasBeenSet( "threads" ) )
+		{
+			numberOfThreads=l1menu::tools::convertStringToInt( commandLineParser.optionArguments("threads").back() );
+		}
+
+		l1menu::ReducedSample::Codec codec=l1menu::ReducedSample::Codec::GZIP;
+		if( commandLineParser.optionHasBeenSet( "codec" ) )
+		{
+			std::string codecString=commandLineParser.optionArguments("codec").back();
+			if( codecString=="gzip" ) codec=l1menu::ReducedSample::Codec::GZIP;
+			else if( codecString=="zstd" ) codec=l1menu::ReducedSample::Codec::ZSTD;
+			else if( codecString=="lz4" ) codec=l1menu::ReducedSample::Codec::LZ4;
+			else if( codecString=="none" ) codec=l1menu::ReducedSample::Codec::NONE;
+			else throw std::runtime_error( "codec must be one of 'gzip', 'zstd', 'lz4' or 'none'" );
+		}
+
+		const std::string& inputFilename=commandLineParser.nonOptionArguments()[0];
+		const std::string& outputFilename=commandLineParser.nonOptionArguments()[1];
+		if( inputFilename==outputFilename ) throw std::runtime_error( "The output filename must be different to the input filename" );
+
+		std::cout << "Loading " << inputFilename << std::endl;
+		l1menu::ReducedSample sample( inputFilename, numberOfThreads );
+		std::cout << "Saving " << sample.numberOfEvents() << " events to " << outputFilename << " in file format version " << fileFormatVersion << std::endl;
+		sample.saveToFile( outputFilename, fileFormatVersion, numberOfThreads, codec );
+	}
+	catch( std::exception& error )
+	{
+		std::cerr << "Exception caught: " << error.what() << "\n\n";
+		printUsage( commandLineParser.executableName(), std::cerr );
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <stdexcept>
+#include "l1menu/FullSample.h"
+#include "l1menu/ObjectCacheSample.h"
+#include "l1menu/tools/CommandLineParser.h"
+#include "l1menu/tools/fileIO.h"
+
+void printUsage( const std::string& executableName, std::ostream& output=std::cout )
+{
+	output << "Usage:" << "\n"
+			<< "\t" << executableName << " <input ntuple or list of ntuples> <output filename>" << "\n"
+			<< "\n"
+			<< "\t" << "\t" << "Reads all of the L1 objects from the ntuples once and saves them in a compact binary" << "\n"
+			<< "\t" << "\t" << "file. This can be given anywhere an ntuple can (e.g. to l1menuCreateReducedSample or" << "\n"
+			<< "\t" << "\t" << "l1menuCalculateRate) and gives exactly the same results, but is read without ROOT so is" << "\n"
+			<< "\t" << "\t" << "much quicker. The file has to be made again if the ntuples change." << "\n"
+			<< "\n"
+			<< "\t" << executableName << " --help" << "\n"
+			<< "\t" << "\t" << "prints this help message" << "\n"
+			<< std::endl;
+}
+
+int main( int argc, char* argv[] )
+{
+	l1menu::tools::CommandLineParser commandLineParser;
+	try
+	{
+		commandLineParser.addOption( "help", l1menu::tools::CommandLineParser::NoArgument );
+		commandLineParser.parse( argc, argv );
+
+		if( commandLineParser.optionHasBeenSet( "help" ) )
+		{
+			printUsage( commandLineParser.executableName() );
+			return 0;
+		}
+
+		if( commandLineParser.nonOptionArguments().size()!=2 ) throw std::runtime_error( "Incorrect number of arguments" );
+
+		const std::string& inputFilename=commandLineParser.nonOptionArguments()[0];
+		const std::string& outputFilename=commandLineParser.nonOptionArguments()[1];
+		if( inputFilename==outputFilename ) throw std::runtime_error( "The output filename must be different to the input filename" );
+
+		std::cout << "Loading " << inputFilename << std::endl;
+		std::unique_ptr<l1menu::ISample> pSample=l1menu::tools::loadSample( inputFilename );
+		const l1menu::FullSample* pFullSample=dynamic_cast<const l1menu::FullSample*>( pSample.get() );
+		if( pFullSample==nullptr ) throw std::runtime_error( "The input file must be an L1 DPG ntuple or a list of them" );
+
+		std::cout << "Saving " << pFullSample->numberOfEvents() << " events to " << outputFilename << std::endl;
+		l1menu::ObjectCacheSample::convert( *pFullSample, outputFilename );
+	}
+	catch( std::exception& error )
+	{
+		std::cerr << "Exception caught: " << error.what() << "\n\n";
+		printUsage( commandLineParser.executableName(), std::cerr );
+		return -1;
+	}
+
+	return 0;
+}
@@ -3,20 +3,25 @@
 
 #include <TFile.h>
 #include "l1menu/ISample.h"
+#include "l1menu/FullSample.h"
 #include "l1menu/MenuRatePlots.h"
 #include "l1menu/IMenuRate.h"
 #include "l1menu/TriggerMenu.h"
 #include "l1menu/tools/miscellaneous.h"
 #include "l1menu/tools/fileIO.h"
 #include "l1menu/tools/CommandLineParser.h"
+#include "l1menu/tools/stringManipulation.h"
 
 void printUsage( const std::string& executableName, std::ostream& output=std::cout )
 {
 	output << "Usage:" << "\n"
-			<< "\t" << executableName << " [--output <output filename>] [--original-binning] <sample filename> <menu filename>" << "\n"
+			<< "\t" << executableName << " [--output <output filename>] [--original-binning] [--threads <number of threads>] <sample filename> <menu filename>" << "\n"
 			<< "\t" << "\t" << "Creates trigger rate plots using the menu and sample provided. The \"output\" option allows" << "\n"
 			<< "\t" << "\t" << "you to specify the filename for the output (default is \"rateHistograms.root\"). The" << "\n"
 			<< "\t" << "\t" << "\"original-binning\" option will use the binning that was used in the L1Menu2015.C macro." << "\n"
+			<< "\t" << "\t" << "If the sample is made from L1 DPG ntuples, the ntuples are read with the number of threads" << "\n"
+			<< "\t" << "\t" << "given with \"threads\" (default one, zero means one per core). Reading ROOT ntuples from" << "\n"
+			<< "\t" << "\t" << "several threads at once is experimental, so check the plots against a single threaded run." << "\n"
 			<< "\n"
 			<< "\t" << executableName << " --help" << "\n"
 			<< "\t" << "\t" << "prints this help message"
@@ -30,6 +35,7 @@ int main( int argc, char* argv[] )
 	std::string sampleFilename;
 	std::string menuFilename;
 	std::string outputFilename="rateHistograms.root"; // default value if not specified on the command line
+	size_t numberOfThreads=1; // Zero means one per core
 
 	l1menu::tools::CommandLineParser commandLineParser;
 	try
@@ -37,6 +43,7 @@ int main( int argc, char* argv[] )
 		commandLineParser.addOption( "help", l1menu::tools::CommandLineParser::NoArgument );
 		commandLineParser.addOption( "output", l1menu::tools::CommandLineParser::RequiredArgument );
 		commandLineParser.addOption( "original-binning", l1menu::tools::CommandLineParser::NoArgument );
+		commandLineParser.addOption( "threads", l1menu::tools::CommandLineParser::RequiredArgument );
 		commandLineParser.parse( argc, argv );
 
 		if( commandLineParser.optionHasBeenSet( "help" ) )
@@ -47,6 +54,7 @@ int main( int argc, char* argv[] )
 
 		if( commandLineParser.optionHasBeenSet( "output" ) ) outputFilename=commandLineParser.optionArguments("output").back();
 		if( commandLineParser.optionHasBeenSet( "original-binning" ) ) l1menu::tools::setBinningToL1Menu2015Values();
+		if( commandLineParser.optionHasBeenSet( "threads" ) ) numberOfThreads=l1menu::tools::convertStringToInt( commandLineParser.optionArguments("threads").back() );
 		if( commandLineParser.nonOptionArguments().size()<2 ) throw std::runtime_error( "Not enough command line arguments" );
 
 		const std::vector<std::string>& arguments=commandLineParser.nonOptionArguments();
@@ -73,8 +81,12 @@ int main( int argc, char* argv[] )
 
 
 		std::cout << "Loading sample from the file " << sampleFilename << std::endl;
-		std::unique_ptr<l1menu::ISample> pSample=l1menu::tools::loadSample( sampleFilename );
+		// Only one sequential pass is made over the events, so there's no need to hold
+		// the whole sample in memory.
+		std::unique_ptr<l1menu::ISample> pSample=l1menu::tools::loadSample( sampleFilename, true );
 		pSample->setEventRate( orbitsPerSecond*numberOfBunches*scaleToKiloHz );
+		l1menu::FullSample* pFullSample=dynamic_cast<l1menu::FullSample*>( pSample.get() );
+		if( pFullSample!=nullptr ) pFullSample->setNumberOfThreads( numberOfThreads );
 
 		std::cout << "Loading menu from file " << menuFilename << std::endl;
 		std::unique_ptr<l1menu::TriggerMenu> pMenu=l1menu::tools::loadMenu( menuFilename );
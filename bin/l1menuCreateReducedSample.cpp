@@ -1,53 +1,625 @@
 #include "l1menu/FullSample.h"
+#include "l1menu/ObjectCacheSample.h"
 #include "l1menu/TriggerMenu.h"
+#include "l1menu/ITrigger.h"
 #include "l1menu/ReducedSample.h"
+#include "l1menu/tools/CommandLineParser.h"
+#include "l1menu/tools/stringManipulation.h"
+#include "l1menu/tools/threading.h"
+#include "l1menu/tools/Profiler.h"
+#include "l1menu/tools/shardManifest.h"
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include <stdexcept>
+#include <cstdio>
+#include <limits>
+#include <set>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
 
+void printUsage( const std::string& executableName, const std::string& outputFilename, std::ostream& output=std::cout )
+{
+	output << "Usage:" << "\n"
+			<< "\t" << executableName << " [--codec <gzip | zstd | lz4 | none>] [--threads <number of workers>] [--extend <existing ReducedSample>] [--profile] [--profile-json <filename>]" << "\n"
+			<< "\t" << "\t" << "[--shard <index>/<number of shards> | --events <first>:<last>] [--output <filename>]" << "\n"
+			<< "\t" << "\t" << "[--checkpoint <events per checkpoint>] <menu file> <input ntuple 1> [input ntuple 2 [...] ]" << "\n"
+			<< "\n"
+			<< "\t" << "\t" << "Creates an l1menu::ReducedSample in protobuf format from the input files specified on the" << "\n"
+			<< "\t" << "\t" << "command line. The output file is called \"" << outputFilename << "\". If a codec is given the" << "\n"
+			<< "\t" << "\t" << "sample is saved in the chunked format (version 3) compressed with that codec, otherwise" << "\n"
+			<< "\t" << "\t" << "it is saved in the original gzipped format (version 1). zstd and lz4 load much faster." << "\n"
+			<< "\t" << "\t" << "The events are processed by several worker processes at once (default one per core), each" << "\n"
+			<< "\t" << "\t" << "working on a different file or part of a file. The output is the same whatever the number" << "\n"
+			<< "\t" << "\t" << "of workers. Temporary files called \"" << outputFilename << ".part<n>\" are used along the way." << "\n"
+			<< "\t" << "\t" << "If --extend is given, the thresholds are only calculated for the triggers in the menu that" << "\n"
+			<< "\t" << "\t" << "aren't already in the existing sample, and added to it. The input ntuples must be the ones" << "\n"
+			<< "\t" << "\t" << "the existing sample was made from, in the same order, because events are matched by order." << "\n"
+			<< "\t" << "\t" << "If --profile is given a table of where the time went is printed at the end: events per" << "\n"
+			<< "\t" << "\t" << "second, time reading and converting the ntuple entries, apply() calls and time per trigger," << "\n"
+			<< "\t" << "\t" << "and how many iterations the bisections took. --profile-json also writes this to a file." << "\n"
+			<< "\t" << "\t" << "To split the work over separate jobs, give each one either --shard (e.g. \"--shard 3/10\" for" << "\n"
+			<< "\t" << "\t" << "the 4th of 10 equal parts, counting from 0) or --events. Events are numbered through all" << "\n"
+			<< "\t" << "\t" << "of the input files in order, and --events includes first but not last. Every job needs the" << "\n"
+			<< "\t" << "\t" << "same input files in the same order. Each job saves a partial sample and a manifest entry" << "\n"
+			<< "\t" << "\t" << "called \"<output>.manifest\", and the manifest entries can be checked and the partial samples" << "\n"
+			<< "\t" << "\t" << "put together with \"l1menuMergeReducedSamples --manifest\". The default output filename for a" << "\n"
+			<< "\t" << "\t" << "shard is \"reducedSample.shard<index>of<number>.proto\"." << "\n"
+			<< "\t" << "\t" << "With --checkpoint the events are processed in blocks of the size given, and each block is" << "\n"
+			<< "\t" << "\t" << "saved to disk (\"<output>.checkpoint<n>\") as soon as it's finished, with a record of the" << "\n"
+			<< "\t" << "\t" << "input file and events it covers in \"<output>.checkpoint\". If the job stops for any reason," << "\n"
+			<< "\t" << "\t" << "running exactly the same command again carries on from the blocks already saved. The output" << "\n"
+			<< "\t" << "\t" << "is identical to a job that was never interrupted, and the checkpoint files are removed at" << "\n"
+			<< "\t" << "\t" << "the end." << "\n"
+			<< "\t" << "\t" << "Any of the input ntuples can be replaced by an object cache made from it with" << "\n"
+			<< "\t" << "\t" << "l1menuCreateObjectCache, which gives the same sample without reading the ntuple again." << "\n"
+			<< "\n"
+			<< "\t" << executableName << " --help" << "\n"
+			<< "\t" << "\t" << "prints this help message" << "\n"
+			<< std::endl;
+}
+
+namespace
+{
+	/** @brief A range of events in one of the input files. The last event is not included. */
+	struct InputRange
+	{
+		std::string inputFilename;
+		size_t firstEventNumber;
+		size_t lastEventNumber; ///< @brief Anything past the end of the file means up to the end of the file
+	};
+
+	/** @brief A part of one of the input ranges, that one of the worker processes makes a ReducedSample from. */
+	struct WorkUnit
+	{
+		InputRange inputRange;
+		size_t partNumber;
+		size_t numberOfParts; ///< @brief How many parts the input range is split into
+		std::string partialFilename; ///< @brief Where the worker saves the ReducedSample for this part
+	};
+
+	/** @brief Does the work for addInputRange below, for either type of input sample. */
+	template<class T_Sample>
+	void addInputRange( l1menu::ReducedSample& outputSample, const T_Sample& inputSample, const InputRange& inputRange, size_t partNumber, size_t numberOfParts )
+	{
+		const size_t lastEventNumber=std::min( inputRange.lastEventNumber, inputSample.numberOfEvents() );
+		const size_t firstEventNumber=std::min( inputRange.firstEventNumber, lastEventNumber );
+		const size_t numberOfEvents=lastEventNumber-firstEventNumber;
+		outputSample.addSample( inputSample, firstEventNumber+numberOfEvents*partNumber/numberOfParts, firstEventNumber+numberOfEvents*(partNumber+1)/numberOfParts );
+	}
+
+	/** @brief Adds the events in the range to the sample, or the part of the range asked for if numberOfParts is more than one. */
+	void addInputRange( l1menu::ReducedSample& outputSample, const InputRange& inputRange, size_t partNumber=0, size_t numberOfParts=1 )
+	{
+		if( l1menu::ObjectCacheSample::isObjectCacheFile( inputRange.inputFilename ) )
+		{
+			const l1menu::ObjectCacheSample inputSample( inputRange.inputFilename );
+			addInputRange( outputSample, inputSample, inputRange, partNumber, numberOfParts );
+		}
+		else
+		{
+			l1menu::FullSample inputSample;
+			inputSample.loadFile( inputRange.inputFilename );
+			addInputRange( outputSample, inputSample, inputRange, partNumber, numberOfParts );
+		}
+	}
+
+	/** @brief Makes the ReducedSample for the unit's range of events and saves it to the unit's partial file. */
+	void processWorkUnit( const WorkUnit& unit, const l1menu::TriggerMenu& menu )
+	{
+		l1menu::ReducedSample partialSample( menu );
+		addInputRange( partialSample, unit.inputRange, unit.partNumber, unit.numberOfParts );
+		// These files are only temporary, so there's no point spending time compressing them. Save
+		// under a different name and rename once it's complete, so that if the partial file exists
+		// it's always complete, even if the job is killed part way through saving.
+		const std::string temporaryFilename=unit.partialFilename+".tmp";
+		partialSample.saveToFile( temporaryFilename, 3, 1, l1menu::ReducedSample::Codec::NONE );
+		if( std::rename( temporaryFilename.c_str(), unit.partialFilename.c_str() )!=0 ) throw std::runtime_error( "Couldn't rename "+temporaryFilename+" to "+unit.partialFilename );
+	}
+
+	/** @brief One line for each trigger in the menu with its name, version and every parameter value.
+	 *
+	 * The values are written with enough digits to tell any two floats apart, so that a menu that has
+	 * been edited gives a different description even if the filename is the same.
+	 */
+	std::string describeMenu( const l1menu::TriggerMenu& menu )
+	{
+		std::ostringstream description;
+		description << std::setprecision( std::numeric_limits<float>::max_digits10 );
+		for( size_t triggerNumber=0; triggerNumber<menu.numberOfTriggers(); ++triggerNumber )
+		{
+			const l1menu::ITrigger& trigger=menu.getTrigger(triggerNumber);
+			description << "trigger " << trigger.name() << " v" << trigger.version();
+			for( const auto& parameterName : trigger.parameterNames() ) description << " " << parameterName << "=" << trigger.parameter(parameterName);
+			description << "\n";
+		}
+		return description.str();
+	}
+
+	/** @brief Records which work units have been finished, so that a job that stops can carry on where it left off.
+	 *
+	 * The file starts with a description of the job (the contents of the menu, the input files, the number
+	 * of events per checkpoint, and the input file and range of events for every work unit), and then has a line appended each time a unit is finished. If the file already
+	 * exists it has to be for exactly the same job, otherwise an exception is thrown rather than risk
+	 * mixing the results of two different jobs. Appends are done with a single write to a file opened with
+	 * O_APPEND, so several worker processes can mark units as finished at the same time.
+	 */
+	class CheckpointLog
+	{
+	public:
+		CheckpointLog( const std::string& filename, const std::string& jobDescription ) : filename_(filename)
+		{
+			std::ifstream existingFile( filename_ );
+			if( existingFile.is_open() )
+			{
+				std::string existingDescription;
+				std::string line;
+				while( std::getline( existingFile, line ) )
+				{
+					if( line.compare( 0, 5, "done " )==0 ) finishedUnits_.insert( l1menu::tools::convertStringToInt( l1menu::tools::splitByWhitespace( line )[1] ) );
+					else existingDescription+=line+"\n";
+				}
+				if( existingDescription!=jobDescription ) throw std::runtime_error( "The checkpoint file "+filename_+" is for a different job (a different menu, input files or --checkpoint). Delete it and the \""+filename_+"<n>\" files to start again." );
+			}
+			else
+			{
+				std::ofstream newFile( filename_ );
+				if( !newFile.is_open() ) throw std::runtime_error( "Couldn't create the checkpoint file "+filename_ );
+				newFile << jobDescription;
+				if( !newFile.good() ) throw std::runtime_error( "Couldn't write to the checkpoint file "+filename_ );
+			}
+		}
+
+		bool isFinished( size_t unitNumber ) const { return finishedUnits_.count( unitNumber )!=0; }
+
+		/** @brief Records that the unit is finished, with the input file and events it covers so the file is human readable. */
+		void markFinished( size_t unitNumber, const WorkUnit& unit ) const
+		{
+			const std::string line="done "+std::to_string(unitNumber)+" "+std::to_string(unit.inputRange.firstEventNumber)+" "+std::to_string(unit.inputRange.lastEventNumber)+" "+unit.inputRange.inputFilename+"\n";
+			int fileDescriptor=open( filename_.c_str(), O_WRONLY | O_APPEND );
+			if( fileDescriptor<0 ) throw std::runtime_error( "Couldn't open the checkpoint file "+filename_ );
+			const bool writeSucceeded=( write( fileDescriptor, line.data(), line.size() )==static_cast<ssize_t>(line.size()) );
+			close( fileDescriptor );
+			if( !writeSucceeded ) throw std::runtime_error( "Couldn't write to the checkpoint file "+filename_ );
+		}
+
+		const std::string& filename() const { return filename_; }
+	private:
+		std::string filename_;
+		std::set<size_t> finishedUnits_;
+	};
+
+	/** @brief Runs processWorkUnit for each of the units in unitNumbers, using several worker processes.
+	 *
+	 * ROOT can't be used to read from several threads at once, and FullSample only has one current event,
+	 * so each worker is a separate process with its own FullSample. If there's only one worker, the units
+	 * are processed in this process instead. If pCheckpointLog isn't null each unit is marked as finished
+	 * as soon as it has been saved.
+	 *
+	 * @return  Whether all of the units were processed successfully.
+	 */
+	bool runWorkUnits( const std::vector<WorkUnit>& workUnits, const std::vector<size_t>& unitNumbers, const l1menu::TriggerMenu& menu,
+			size_t numberOfWorkers, const std::string& outputFilename, const CheckpointLog* pCheckpointLog )
+	{
+		auto processUnits=[&]( size_t firstIndex, size_t step )
+		{
+			for( size_t index=firstIndex; index<unitNumbers.size(); index+=step )
+			{
+				processWorkUnit( workUnits[unitNumbers[index]], menu );
+				if( pCheckpointLog ) pCheckpointLog->markFinished( unitNumbers[index], workUnits[unitNumbers[index]] );
+			}
+		};
+
+		if( numberOfWorkers>unitNumbers.size() ) numberOfWorkers=unitNumbers.size();
+		if( numberOfWorkers<=1 )
+		{
+			processUnits( 0, 1 );
+			return true;
+		}
+
+		// Make sure anything buffered isn't output by the children as well
+		std::cout.flush();
+		std::cerr.flush();
+
+		std::vector<pid_t> workerProcessIDs;
+		for( size_t workerNumber=0; workerNumber<numberOfWorkers; ++workerNumber )
+		{
+			pid_t processID=fork();
+			if( processID<0 ) throw std::runtime_error( "Couldn't start a worker process" );
+			else if( processID==0 )
+			{
+				// This is the worker process. Use _exit so that nothing belonging to the parent
+				// (buffers, static objects) is cleaned up here as well.
+				int exitCode=0;
+				try
+				{
+					processUnits( workerNumber, numberOfWorkers );
+
+					if( l1menu::tools::Profiler::instance().isEnabled() )
+					{
+						std::ofstream profileFile( outputFilename+".profile"+std::to_string(workerNumber) );
+						l1menu::tools::Profiler::instance().saveCounters( profileFile );
+					}
+				}
+				catch( std::exception& error )
+				{
+					std::cerr << "Exception caught in worker " << workerNumber << ": " << error.what() << std::endl;
+					exitCode=1;
+				}
+				std::cout.flush();
+				_exit( exitCode );
+			}
+			workerProcessIDs.push_back( processID );
+		}
+
+		bool allWorkersSucceeded=true;
+		for( const auto& processID : workerProcessIDs )
+		{
+			int status;
+			if( waitpid( processID, &status, 0 )!=processID || !WIFEXITED(status) || WEXITSTATUS(status)!=0 ) allWorkersSucceeded=false;
+		}
+
+		// Each worker has its own profiler, so add up what they recorded
+		l1menu::tools::Profiler& profiler=l1menu::tools::Profiler::instance();
+		for( size_t workerNumber=0; workerNumber<numberOfWorkers && profiler.isEnabled(); ++workerNumber )
+		{
+			const std::string profileFilename=outputFilename+".profile"+std::to_string(workerNumber);
+			std::ifstream profileFile( profileFilename );
+			if( profileFile.is_open() ) profiler.mergeCounters( profileFile );
+			std::remove( profileFilename.c_str() );
+		}
+
+		return allWorkersSucceeded;
+	}
+
+	/** @brief Adds the partial samples saved by all of the units to the output, in order. */
+	void addWorkUnits( l1menu::ReducedSample& outputSample, const std::vector<WorkUnit>& workUnits )
+	{
+		for( const auto& workUnit : workUnits )
+		{
+			l1menu::ReducedSample partialSample( workUnit.partialFilename );
+			outputSample.addSample( partialSample );
+		}
+	}
+
+	/** @brief Opens each of the input files to find how many events are in it. */
+	std::vector<size_t> countEvents( const std::vector<std::string>& inputFilenames )
+	{
+		std::vector<size_t> numberOfEventsInEachFile;
+		for( const auto& inputFilename : inputFilenames )
+		{
+			if( l1menu::ObjectCacheSample::isObjectCacheFile( inputFilename ) )
+			{
+				numberOfEventsInEachFile.push_back( l1menu::ObjectCacheSample( inputFilename ).numberOfEvents() );
+				continue;
+			}
+			l1menu::FullSample inputSample;
+			inputSample.loadFile( inputFilename );
+			numberOfEventsInEachFile.push_back( inputSample.numberOfEvents() );
+		}
+		return numberOfEventsInEachFile;
+	}
+
+	/** @brief Converts a range of event numbers counted through all of the input files into ranges in each file.
+	 *
+	 * Files with no events in the range are left out.
+	 */
+	std::vector<InputRange> findInputRanges( const std::vector<std::string>& inputFilenames, const std::vector<size_t>& numberOfEventsInEachFile, size_t firstEventNumber, size_t lastEventNumber )
+	{
+		std::vector<InputRange> inputRanges;
+		size_t fileStartEventNumber=0;
+		for( size_t fileNumber=0; fileNumber<inputFilenames.size(); ++fileNumber )
+		{
+			const size_t fileEndEventNumber=fileStartEventNumber+numberOfEventsInEachFile[fileNumber];
+			const size_t first=std::max( firstEventNumber, fileStartEventNumber );
+			const size_t last=std::min( lastEventNumber, fileEndEventNumber );
+			if( first<last ) inputRanges.push_back( InputRange{ inputFilenames[fileNumber], first-fileStartEventNumber, last-fileStartEventNumber } );
+			fileStartEventNumber=fileEndEventNumber;
+		}
+		return inputRanges;
+	}
+
+	/** @brief Makes a ReducedSample from the input files using several worker processes, and puts the results together in order.
+	 *
+	 * The work is split up by input range (normally a whole file), and if there are fewer ranges than
+	 * workers each one is split into smaller ranges of events. Every worker saves what it makes to a
+	 * temporary file, and once they've all finished the results are added to the sample in the original
+	 * order. The events, and so the output file, are the same whatever the number of workers.
+	 */
+	void addSampleInParallel( l1menu::ReducedSample& outputSample, const l1menu::TriggerMenu& menu, const std::vector<InputRange>& inputRanges, const std::string& outputFilename, size_t numberOfWorkers )
+	{
+		std::vector<WorkUnit> workUnits;
+		std::vector<size_t> unitNumbers;
+		const size_t partsPerRange=(numberOfWorkers+inputRanges.size()-1)/inputRanges.size();
+		for( const auto& inputRange : inputRanges )
+		{
+			for( size_t partNumber=0; partNumber<partsPerRange; ++partNumber )
+			{
+				unitNumbers.push_back( workUnits.size() );
+				workUnits.push_back( WorkUnit{ inputRange, partNumber, partsPerRange, outputFilename+".part"+std::to_string(workUnits.size()) } );
+			}
+		}
+
+		const bool allWorkersSucceeded=runWorkUnits( workUnits, unitNumbers, menu, numberOfWorkers, outputFilename, nullptr );
+
+		if( allWorkersSucceeded ) addWorkUnits( outputSample, workUnits );
+		for( const auto& workUnit : workUnits ) std::remove( workUnit.partialFilename.c_str() );
+		if( !allWorkersSucceeded ) throw std::runtime_error( "At least one of the worker processes failed" );
+	}
+
+	/** @brief Splits the input ranges into units of at most numberOfEventsPerCheckpoint events, each saved to its own checkpoint file.
+	 *
+	 * The input ranges must all have their real last event number, i.e. not "up to the end of the file".
+	 */
+	std::vector<WorkUnit> createCheckpointUnits( const std::vector<InputRange>& inputRanges, size_t numberOfEventsPerCheckpoint, const std::string& checkpointFilename )
+	{
+		std::vector<WorkUnit> workUnits;
+		for( const auto& inputRange : inputRanges )
+		{
+			for( size_t firstEventNumber=inputRange.firstEventNumber; firstEventNumber<inputRange.lastEventNumber; firstEventNumber+=numberOfEventsPerCheckpoint )
+			{
+				const size_t lastEventNumber=std::min( firstEventNumber+numberOfEventsPerCheckpoint, inputRange.lastEventNumber );
+				workUnits.push_back( WorkUnit{ InputRange{ inputRange.inputFilename, firstEventNumber, lastEventNumber }, 0, 1, checkpointFilename+std::to_string(workUnits.size()) } );
+			}
+		}
+		return workUnits;
+	}
+
+}
 
 int main( int argc, char* argv[] )
 {
 	std::string outputFilename="reducedSample.proto";
 
-	if( argc<3 )
+	l1menu::tools::CommandLineParser commandLineParser;
+	try
+	{
+		commandLineParser.addOption( "codec", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "extend", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "threads", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "shard", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "events", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "output", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "checkpoint", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "profile", l1menu::tools::CommandLineParser::NoArgument );
+		commandLineParser.addOption( "profile-json", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "help", l1menu::tools::CommandLineParser::NoArgument );
+		commandLineParser.parse( argc, argv );
+
+		if( commandLineParser.optionHasBeenSet( "help" ) )
+		{
+			printUsage( commandLineParser.executableName(), outputFilename );
+			return 0;
+		}
+
+		if( commandLineParser.nonOptionArguments().size()<2 ) throw std::runtime_error( "Incorrect number of arguments" );
+		if( commandLineParser.optionHasBeenSet( "shard" ) && commandLineParser.optionHasBeenSet( "events" ) ) throw std::runtime_error( "Only one of --shard and --events can be given" );
+		if( commandLineParser.optionHasBeenSet( "extend" ) && (commandLineParser.optionHasBeenSet( "shard" ) || commandLineParser.optionHasBeenSet( "events" )) ) throw std::runtime_error( "--extend can't be used with --shard or --events" );
+		if( commandLineParser.optionHasBeenSet( "extend" ) && commandLineParser.optionHasBeenSet( "checkpoint" ) ) throw std::runtime_error( "--extend can't be used with --checkpoint" );
+	}
+	catch( std::exception& error )
 	{
-		std::string executableName=argv[0];
-		size_t lastSlashPosition=executableName.find_last_of('/');
-		if( lastSlashPosition!=std::string::npos ) executableName=executableName.substr( lastSlashPosition+1, std::string::npos );
-		std::cerr << "   Usage: " << executableName << " <menu file> <input ntuple 1> [input ntuple 2 [...] ]" << "\n"
-				<< " Creates an l1menu::ReducedSample in protobuf format from the input files specified on the "
-				<< "command line. The output file is called \"" << outputFilename << "\"." << std::endl;
+		std::cerr << "Exception caught: " << error.what() << "\n\n";
+		printUsage( commandLineParser.executableName(), outputFilename, std::cerr );
 		return -1;
 	}
 
-	std::string menuFilename=argv[1];
+	std::string menuFilename=commandLineParser.nonOptionArguments()[0];
 
-	std::vector<std::string> inputFilenames;
-	for( int index=2; index<argc; ++index ) inputFilenames.push_back( argv[index] );
+	std::vector<std::string> inputFilenames( commandLineParser.nonOptionArguments().begin()+1, commandLineParser.nonOptionArguments().end() );
 
 
 	try
 	{
+		unsigned int fileFormatVersion=1;
+		l1menu::ReducedSample::Codec codec=l1menu::ReducedSample::Codec::GZIP;
+		if( commandLineParser.optionHasBeenSet( "codec" ) )
+		{
+			fileFormatVersion=3;
+			std::string codecString=commandLineParser.optionArguments("codec").back();
+			if( codecString=="gzip" ) codec=l1menu::ReducedSample::Codec::GZIP;
+			else if( codecString=="zstd" ) codec=l1menu::ReducedSample::Codec::ZSTD;
+			else if( codecString=="lz4" ) codec=l1menu::ReducedSample::Codec::LZ4;
+			else if( codecString=="none" ) codec=l1menu::ReducedSample::Codec::NONE;
+			else throw std::runtime_error( "codec must be one of 'gzip', 'zstd', 'lz4' or 'none'" );
+		}
+
+		size_t numberOfWorkers=l1menu::tools::defaultNumberOfThreads();
+		if( commandLineParser.optionHasBeenSet( "threads" ) )
+		{
+			numberOfWorkers=l1menu::tools::convertStringToInt( commandLineParser.optionArguments("threads").back() );
+			if( numberOfWorkers==0 ) numberOfWorkers=l1menu::tools::defaultNumberOfThreads();
+		}
+
+		// See if only some of the events should be processed, i.e. this is one shard of a bigger job.
+		// Event numbers count through all of the input files as if they were one.
+		const bool isShard=commandLineParser.optionHasBeenSet( "shard" ) || commandLineParser.optionHasBeenSet( "events" );
+		size_t firstEventNumber=0;
+		size_t lastEventNumber=std::numeric_limits<size_t>::max();
+		size_t shardNumber=0, numberOfShards=1;
+		if( commandLineParser.optionHasBeenSet( "shard" ) )
+		{
+			const std::vector<std::string> splitArgument=l1menu::tools::splitByDelimeters( commandLineParser.optionArguments("shard").back(), "/" );
+			if( splitArgument.size()!=2 ) throw std::runtime_error( "--shard must be given as <index>/<number of shards>" );
+			const int index=l1menu::tools::convertStringToInt( splitArgument[0] );
+			const int number=l1menu::tools::convertStringToInt( splitArgument[1] );
+			if( number<=0 || index<0 || index>=number ) throw std::runtime_error( "--shard index must be from 0 to one less than the number of shards" );
+			shardNumber=index;
+			numberOfShards=number;
+			outputFilename="reducedSample.shard"+std::to_string(shardNumber)+"of"+std::to_string(numberOfShards)+".proto";
+		}
+		else if( commandLineParser.optionHasBeenSet( "events" ) )
+		{
+			const std::vector<std::string> splitArgument=l1menu::tools::splitByDelimeters( commandLineParser.optionArguments("events").back(), ":" );
+			if( splitArgument.size()!=2 ) throw std::runtime_error( "--events must be given as <first>:<last>" );
+			const int first=l1menu::tools::convertStringToInt( splitArgument[0] );
+			const int last=l1menu::tools::convertStringToInt( splitArgument[1] );
+			if( first<0 || last<first ) throw std::runtime_error( "--events must have 0 <= first <= last" );
+			firstEventNumber=first;
+			lastEventNumber=last;
+			outputFilename="reducedSample.events"+std::to_string(firstEventNumber)+"to"+std::to_string(lastEventNumber)+".proto";
+		}
+		if( commandLineParser.optionHasBeenSet( "output" ) ) outputFilename=commandLineParser.optionArguments("output").back();
+
+		size_t numberOfEventsPerCheckpoint=0;
+		if( commandLineParser.optionHasBeenSet( "checkpoint" ) )
+		{
+			const int number=l1menu::tools::convertStringToInt( commandLineParser.optionArguments("checkpoint").back() );
+			if( number<=0 ) throw std::runtime_error( "--checkpoint must be given a positive number of events" );
+			numberOfEventsPerCheckpoint=number;
+		}
+
+		l1menu::tools::Profiler& profiler=l1menu::tools::Profiler::instance();
+		if( commandLineParser.optionHasBeenSet( "profile" ) || commandLineParser.optionHasBeenSet( "profile-json" ) ) profiler.enable();
+
 		std::cout << "Loading menu from file " << menuFilename << std::endl;
 		std::unique_ptr<l1menu::TriggerMenu> pMyMenu=l1menu::tools::loadMenu( menuFilename );
 
-		l1menu::ReducedSample outputReducedSample( *pMyMenu );
-
-		for( const auto& filename : inputFilenames )
+		if( commandLineParser.optionHasBeenSet( "extend" ) )
 		{
-			l1menu::FullSample inputSample;
-			inputSample.loadFile(filename);
-			outputReducedSample.addSample( inputSample );
+			const std::string existingFilename=commandLineParser.optionArguments("extend").back();
+			std::cout << "Loading existing sample from file " << existingFilename << std::endl;
+			l1menu::ReducedSample outputReducedSample( existingFilename );
+
+			// Only the triggers that aren't in the sample already need to be calculated
+			l1menu::TriggerMenu newTriggers;
+			for( size_t triggerNumber=0; triggerNumber<pMyMenu->numberOfTriggers(); ++triggerNumber )
+			{
+				const l1menu::ITrigger& trigger=pMyMenu->getTrigger(triggerNumber);
+				if( !outputReducedSample.containsTrigger( trigger ) ) newTriggers.addTrigger( trigger );
+			}
+			std::cout << newTriggers.numberOfTriggers() << " of the " << pMyMenu->numberOfTriggers() << " triggers in the menu are not in the existing sample" << std::endl;
+			if( newTriggers.numberOfTriggers()==0 ) return 0;
+
+			size_t eventNumber=0;
+			for( const auto& filename : inputFilenames )
+			{
+				if( l1menu::ObjectCacheSample::isObjectCacheFile( filename ) )
+				{
+					const l1menu::ObjectCacheSample inputSample( filename );
+					outputReducedSample.addTriggerColumns( inputSample, newTriggers, eventNumber );
+					eventNumber+=inputSample.numberOfEvents();
+					continue;
+				}
+				l1menu::FullSample inputSample;
+				inputSample.loadFile(filename);
+				outputReducedSample.addTriggerColumns( inputSample, newTriggers, eventNumber );
+				eventNumber+=inputSample.numberOfEvents();
+			}
+			if( eventNumber!=outputReducedSample.numberOfEvents() ) throw std::runtime_error( "The input ntuples have fewer events than the existing sample" );
+
+			outputReducedSample.saveToFile( outputFilename, fileFormatVersion, 0, codec );
 		}
+		else
+		{
+			std::vector<InputRange> inputRanges;
+			size_t totalNumberOfEvents=0;
+			if( isShard || numberOfEventsPerCheckpoint>0 )
+			{
+				const std::vector<size_t> numberOfEventsInEachFile=countEvents( inputFilenames );
+				for( const auto& numberOfEvents : numberOfEventsInEachFile ) totalNumberOfEvents+=numberOfEvents;
+
+				if( commandLineParser.optionHasBeenSet( "shard" ) )
+				{
+					firstEventNumber=totalNumberOfEvents*shardNumber/numberOfShards;
+					lastEventNumber=totalNumberOfEvents*(shardNumber+1)/numberOfShards;
+				}
+				else if( lastEventNumber>totalNumberOfEvents ) throw std::runtime_error( "The range given with --events goes past the "+std::to_string(totalNumberOfEvents)+" events in the input files" );
+
+				inputRanges=findInputRanges( inputFilenames, numberOfEventsInEachFile, firstEventNumber, lastEventNumber );
+				if( isShard ) std::cout << "Processing events " << firstEventNumber << " to " << lastEventNumber << " of the " << totalNumberOfEvents << " in the input files" << std::endl;
+			}
+			else
+			{
+				for( const auto& filename : inputFilenames ) inputRanges.push_back( InputRange{ filename, 0, std::numeric_limits<size_t>::max() } );
+			}
+
+			l1menu::ReducedSample outputReducedSample( *pMyMenu );
+
+			if( numberOfEventsPerCheckpoint>0 )
+			{
+				// Everything that defines the work units goes in the description, so that a restarted job
+				// can't pick up checkpoints that were made with different settings.
+				const std::string checkpointFilename=outputFilename+".checkpoint";
+				const std::vector<WorkUnit> workUnits=createCheckpointUnits( inputRanges, numberOfEventsPerCheckpoint, checkpointFilename );
+				std::string jobDescription="# l1menuCreateReducedSample checkpoints\nmenu "+menuFilename+"\n"+describeMenu( *pMyMenu );
+				for( const auto& filename : inputFilenames ) jobDescription+="input "+filename+"\n";
+				jobDescription+="checkpoint "+std::to_string(numberOfEventsPerCheckpoint)+"\n";
+				for( size_t unitNumber=0; unitNumber<workUnits.size(); ++unitNumber )
+				{
+					const InputRange& inputRange=workUnits[unitNumber].inputRange;
+					jobDescription+="unit "+std::to_string(unitNumber)+" "+std::to_string(inputRange.firstEventNumber)+" "+std::to_string(inputRange.lastEventNumber)+" "+inputRange.inputFilename+"\n";
+				}
+				const CheckpointLog checkpointLog( checkpointFilename, jobDescription );
+
+				// Only the units that haven't been finished by a previous attempt need doing
+				std::vector<size_t> unitNumbers;
+				for( size_t unitNumber=0; unitNumber<workUnits.size(); ++unitNumber )
+				{
+					if( !checkpointLog.isFinished(unitNumber) || access( workUnits[unitNumber].partialFilename.c_str(), F_OK )!=0 ) unitNumbers.push_back( unitNumber );
+				}
+				if( unitNumbers.size()<workUnits.size() ) std::cout << "Resuming from " << checkpointFilename << ", " << workUnits.size()-unitNumbers.size() << " of the " << workUnits.size() << " blocks of events are already done" << std::endl;
+
+				if( !runWorkUnits( workUnits, unitNumbers, *pMyMenu, numberOfWorkers, outputFilename, &checkpointLog ) )
+				{
+					throw std::runtime_error( "At least one of the worker processes failed. Run the same command again to carry on from the last checkpoint." );
+				}
+
+				addWorkUnits( outputReducedSample, workUnits );
+				outputReducedSample.saveToFile( outputFilename, fileFormatVersion, 0, codec );
 
-		outputReducedSample.saveToFile( outputFilename );
+				// Only remove the checkpoints once the output has definitely been saved
+				for( const auto& workUnit : workUnits ) std::remove( workUnit.partialFilename.c_str() );
+				std::remove( checkpointFilename.c_str() );
+			}
+			else
+			{
+				if( numberOfWorkers>1 && !inputRanges.empty() ) addSampleInParallel( outputReducedSample, *pMyMenu, inputRanges, outputFilename, numberOfWorkers );
+				else
+				{
+					for( const auto& inputRange : inputRanges ) addInputRange( outputReducedSample, inputRange );
+				}
+
+				outputReducedSample.saveToFile( outputFilename, fileFormatVersion, 0, codec );
+			}
+
+			if( isShard )
+			{
+				// The manifest entry is always saved next to the sample, so only the filename is needed
+				const size_t slashPosition=outputFilename.rfind('/');
+				const std::string sampleFilename=( slashPosition==std::string::npos ? outputFilename : outputFilename.substr(slashPosition+1) );
+				l1menu::tools::ShardManifestEntry manifestEntry{ sampleFilename, inputFilenames, totalNumberOfEvents, firstEventNumber, lastEventNumber,
+					outputReducedSample.numberOfEvents(), outputReducedSample.sumOfWeights() };
+
+				std::ofstream manifestFile( outputFilename+".manifest" );
+				if( !manifestFile.is_open() ) throw std::runtime_error( "Couldn't open the file "+outputFilename+".manifest to save the manifest entry to" );
+				l1menu::tools::saveShardManifestEntry( manifestEntry, manifestFile );
+				std::cout << "Manifest entry saved to " << outputFilename << ".manifest" << std::endl;
+			}
+		}
 		std::cout << "Reduced sample saved to " << outputFilename << std::endl;
+
+		if( profiler.isEnabled() )
+		{
+			profiler.printSummary( std::cout );
+			if( commandLineParser.optionHasBeenSet( "profile-json" ) )
+			{
+				const std::string jsonFilename=commandLineParser.optionArguments("profile-json").back();
+				std::ofstream jsonFile( jsonFilename );
+				if( !jsonFile.is_open() ) throw std::runtime_error( "Couldn't open the file "+jsonFilename+" to write the profile to" );
+				profiler.writeJSON( jsonFile );
+				std::cout << "Profile written to " << jsonFilename << std::endl;
+			}
+		}
 	}
 	catch( std::exception& error )
 	{
 		std::cerr << "Exception caught: " << error.what() << std::endl;
+		// Make sure a batch system or script running shards can tell that this one failed
+		return -1;
 	}
 
 	return 0;
@@ -4,6 +4,7 @@
 #include <fstream>
 
 #include "l1menu/ISample.h"
+#include "l1menu/SubSample.h"
 #include "l1menu/IMenuRate.h"
 #include "l1menu/MenuFitter.h"
 #include "l1menu/TriggerTable.h"
@@ -22,7 +23,7 @@
 void printUsage( const std::string& executableName, std::ostream& output=std::cout )
 {
 	output << "Usage:" << "\n"
-			<< "\t" << executableName << " --totalrate <total rate in kHz> [--rateplots <rateplot filename>] [--output <output filename>] [--format <CSV | OLD | XML>] <sample filename> <menu filename> <totalRate1> [totalRate2 [totalRate3 [...] ] ]" << "\n"
+			<< "\t" << executableName << " --totalrate <total rate in kHz> [--rateplots <rateplot filename>] [--output <output filename>] [--format <CSV | OLD | XML>] [--fraction <fraction of events>] <sample filename> <menu filename> <totalRate1> [totalRate2 [totalRate3 [...] ] ]" << "\n"
 			<< "\t" << "\t" << "Tries to fit the supplied menu using the sample provided. The optional \"rateplots\" option" << "\n"
 			<< "\t" << "\t" << "allows you to reuse a valid file created by l1menuCreateRatePlots which will significantly" << "\n"
 			<< "\t" << "\t" << "speed up execution. If the option \"outputprefix\" is supplied the results will be saved to" << "\n"
@@ -30,6 +31,10 @@ void printUsage( const std::string& executableName, std::ostream& output=std::co
 			<< "\t" << "\t" << "standard output." << "\n"
 			<< "\t" << "\t" << "The 'format' option allows you specify what format the output will be in. XML (the default)" << "\n"
 			<< "\t" << "\t" << "is required to do the scaling with l1menuScaleMenuRates." << "\n"
+			<< "\t" << "\t" << "The 'fraction' option only uses a randomly chosen fraction (e.g. 0.05) of the events, which" << "\n"
+			<< "\t" << "\t" << "makes the fit much quicker but gives larger statistical errors. This is useful for early" << "\n"
+			<< "\t" << "\t" << "iterations of a menu. The same events are chosen every time, and the errors on the rates" << "\n"
+			<< "\t" << "\t" << "include the extra error. Rate plots given with 'rateplots' are used as they are." << "\n"
 			<< "\n"
 			<< "\t" << executableName << " --help" << "\n"
 			<< "\t" << "\t" << "prints this help message"
@@ -46,6 +51,7 @@ int main( int argc, char* argv[] )
 	l1menu::IL1MenuFile::FileFormat fileFormat=l1menu::IL1MenuFile::FileFormat::XML;
 	float totalTriggerRatekHz; // The rate if every single event passed
 	std::vector<float> totalRates;
+	float fractionOfEvents=1;
 
 	l1menu::tools::CommandLineParser commandLineParser;
 	try
@@ -55,6 +61,7 @@ int main( int argc, char* argv[] )
 		commandLineParser.addOption( "rateplots", l1menu::tools::CommandLineParser::RequiredArgument );
 		commandLineParser.addOption( "output", l1menu::tools::CommandLineParser::RequiredArgument );
 		commandLineParser.addOption( "format", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "fraction", l1menu::tools::CommandLineParser::RequiredArgument );
 		commandLineParser.parse( argc, argv );
 
 		if( commandLineParser.optionHasBeenSet( "help" ) )
@@ -65,6 +72,11 @@ int main( int argc, char* argv[] )
 
 		if( commandLineParser.nonOptionArguments().size()<3 ) throw std::runtime_error( "Not enough command line arguments" );
 		if( commandLineParser.optionHasBeenSet( "rateplots" ) ) ratePlotsFilename=commandLineParser.optionArguments("rateplots").back();
+		if( commandLineParser.optionHasBeenSet( "fraction" ) )
+		{
+			fractionOfEvents=l1menu::tools::convertStringToFloat( commandLineParser.optionArguments("fraction").back() );
+			if( !(fractionOfEvents>0 && fractionOfEvents<=1) ) throw std::runtime_error( "fraction must be greater than zero and no more than one" );
+		}
 		if( commandLineParser.optionHasBeenSet( "format" ) )
 		{
 			std::string formatString=commandLineParser.optionArguments("format").back();
@@ -133,12 +145,26 @@ int main( int argc, char* argv[] )
 
 	try
 	{
+		// Load the menu first so that only the triggers it uses are loaded from the sample.
+		// The MenuFitter loads its own copy later.
+		std::unique_ptr<l1menu::TriggerMenu> pMenu=l1menu::tools::loadMenu( menuFilename );
+
 		std::cout << "Loading sample from the file " << sampleFilename << std::endl;
-		std::unique_ptr<l1menu::ISample> pSample=l1menu::tools::loadSample( sampleFilename );
+		std::unique_ptr<l1menu::ISample> pSample=l1menu::tools::loadSample( sampleFilename, *pMenu );
 		pSample->setEventRate( totalTriggerRatekHz );
 
+		// Only use some of the events if asked to. The SubSample uses pSample so it has to stay in scope.
+		std::unique_ptr<l1menu::SubSample> pSubSample;
+		if( fractionOfEvents<1 )
+		{
+			pSubSample.reset( new l1menu::SubSample( *pSample, fractionOfEvents ) );
+			std::cout << "Using " << pSubSample->numberOfEvents() << " of the " << pSample->numberOfEvents() << " events. Statistical errors are about "
+					<< pSubSample->statisticalErrorScale() << " times larger than with every event." << std::endl;
+		}
+		const l1menu::ISample& sample=( pSubSample ? *pSubSample : *pSample );
+
 		std::unique_ptr<l1menu::MenuFitter> pMenuFitter;
-		if( ratePlotsFilename.empty() ) pMenuFitter.reset( new l1menu::MenuFitter(*pSample) );
+		if( ratePlotsFilename.empty() ) pMenuFitter.reset( new l1menu::MenuFitter(sample) );
 		else
 		{
 			// If the user has specified a rateplots file on the command line try and
@@ -147,7 +173,7 @@ int main( int argc, char* argv[] )
 			std::unique_ptr<TFile> pRatePlotsRootFile( TFile::Open( ratePlotsFilename.c_str() ) );
 			l1menu::MenuRatePlots ratePlots( pRatePlotsRootFile.get() );
 
-			pMenuFitter.reset( new l1menu::MenuFitter( *pSample, ratePlots ) );
+			pMenuFitter.reset( new l1menu::MenuFitter( sample, ratePlots ) );
 		}
 
 		std::cout << "Loading menu from file " << menuFilename << std::endl;
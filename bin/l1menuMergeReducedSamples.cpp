@@ -0,0 +1,97 @@
+#include <iostream>
+#include <stdexcept>
+#include "l1menu/ReducedSample.h"
+#include "l1menu/tools/CommandLineParser.h"
+#include "l1menu/tools/stringManipulation.h"
+#include "l1menu/tools/shardManifest.h"
+
+void printUsage( const std::string& executableName, std::ostream& output=std::cout )
+{
+	output << "Usage:" << "\n"
+			<< "\t" << executableName << " [--threads <number of threads>] [--codec <gzip | zstd | lz4 | none>] <output filename> <input ReducedSample 1> [input ReducedSample 2 [...] ]" << "\n"
+			<< "\n"
+			<< "\t" << "\t" << "Merges ReducedSamples that were made with the same menu into one file, in the chunked" << "\n"
+			<< "\t" << "\t" << "format (version 3) compressed with the codec given (default gzip). Inputs that are already" << "\n"
+			<< "\t" << "\t" << "version 3 with the same codec are copied across without being decompressed, so are merged" << "\n"
+			<< "\t" << "\t" << "as fast as the disk allows. Any other inputs have to be decompressed and compressed again," << "\n"
+			<< "\t" << "\t" << "using the number of threads given (default one per core)." << "\n"
+			<< "\n"
+			<< "\t" << executableName << " --manifest [--threads <number of threads>] [--codec <gzip | zstd | lz4 | none>] <output filename> <manifest entry 1> [manifest entry 2 [...] ]" << "\n"
+			<< "\n"
+			<< "\t" << "\t" << "Puts together the shards made with \"l1menuCreateReducedSample --shard\" (or --events)," << "\n"
+			<< "\t" << "\t" << "given the \".manifest\" files they saved. First it checks that the shards were all made" << "\n"
+			<< "\t" << "\t" << "from the same input files, that every event is in exactly one shard, and that each partial" << "\n"
+			<< "\t" << "\t" << "sample has the number of events and sum of weights its manifest entry says. The shards are" << "\n"
+			<< "\t" << "\t" << "merged in event order, whatever order the manifest entries are given in." << "\n"
+			<< "\n"
+			<< "\t" << executableName << " --help" << "\n"
+			<< "\t" << "\t" << "prints this help message" << "\n"
+			<< std::endl;
+}
+
+int main( int argc, char* argv[] )
+{
+	l1menu::tools::CommandLineParser commandLineParser;
+	try
+	{
+		commandLineParser.addOption( "threads", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "codec", l1menu::tools::CommandLineParser::RequiredArgument );
+		commandLineParser.addOption( "manifest", l1menu::tools::CommandLineParser::NoArgument );
+		commandLineParser.addOption( "help", l1menu::tools::CommandLineParser::NoArgument );
+		commandLineParser.parse( argc, argv );
+
+		if( commandLineParser.optionHasBeenSet( "help" ) )
+		{
+			printUsage( commandLineParser.executableName() );
+			return 0;
+		}
+
+		if( commandLineParser.nonOptionArguments().size()<2 ) throw std::runtime_error( "Incorrect number of arguments" );
+
+		size_t numberOfThreads=0;
+		if( commandLineParser.optionHasBeenSet( "threads" ) )
+		{
+			numberOfThreads=l1menu::tools::convertStringToInt( commandLineParser.optionArguments("threads").back() );
+		}
+
+		l1menu::ReducedSample::Codec codec=l1menu::ReducedSample::Codec::GZIP;
+		if( commandLineParser.optionHasBeenSet( "codec" ) )
+		{
+			std::string codecString=commandLineParser.optionArguments("codec").back();
+			if( codecString=="gzip" ) codec=l1menu::ReducedSample::Codec::GZIP;
+			else if( codecString=="zstd" ) codec=l1menu::ReducedSample::Codec::ZSTD;
+			else if( codecString=="lz4" ) codec=l1menu::ReducedSample::Codec::LZ4;
+			else if( codecString=="none" ) codec=l1menu::ReducedSample::Codec::NONE;
+			else throw std::runtime_error( "codec must be one of 'gzip', 'zstd', 'lz4' or 'none'" );
+		}
+
+		const std::string& outputFilename=commandLineParser.nonOptionArguments()[0];
+		std::vector<std::string> inputFilenames( commandLineParser.nonOptionArguments().begin()+1, commandLineParser.nonOptionArguments().end() );
+
+		if( commandLineParser.optionHasBeenSet( "manifest" ) )
+		{
+			std::vector<l1menu::tools::ShardManifestEntry> manifest;
+			for( const auto& manifestFilename : inputFilenames ) manifest.push_back( l1menu::tools::loadShardManifestEntry( manifestFilename ) );
+
+			l1menu::tools::checkShardManifest( manifest );
+			for( const auto& entry : manifest ) l1menu::tools::checkShardSample( entry );
+			std::cout << "The manifest covers all " << manifest.front().totalNumberOfEvents << " events in " << manifest.front().inputFilenames.size() << " input files" << std::endl;
+
+			// checkShardManifest sorted the entries into event order
+			inputFilenames.clear();
+			for( const auto& entry : manifest ) inputFilenames.push_back( entry.sampleFilename );
+		}
+
+		std::cout << "Merging " << inputFilenames.size() << " files into " << outputFilename << std::endl;
+		l1menu::ReducedSample::mergeFiles( inputFilenames, outputFilename, codec, numberOfThreads );
+		std::cout << "Merged sample saved to " << outputFilename << std::endl;
+	}
+	catch( std::exception& error )
+	{
+		std::cerr << "Exception caught: " << error.what() << "\n\n";
+		printUsage( commandLineParser.executableName(), std::cerr );
+		return -1;
+	}
+
+	return 0;
+}
@@ -133,12 +133,31 @@ public:
 	virtual Int_t GetEntry( Long64_t entry );
 	virtual Long64_t LoadTree( Long64_t entry );
 	virtual void Init();
+	/** @brief Turns off every branch that FullSample doesn't need for the given input source, and sets up a TTreeCache for the rest.
+	 *
+	 * Only selectDataInput 22 (the Stage 2 quantities in L1ExtraUpgradeTree) is supported, since that's
+	 * the only one FullSample can decode. Needs to be called after Open or OpenWithList. Returns false
+	 * if the input source isn't supported, in which case nothing is changed.
+	 */
+	bool ActivateOnlyRequiredBranches( int selectDataInput, Long64_t cacheSize=defaultCacheSize );
 	//virtual void     Loop();
 	// Don't need these for now
 	//void Test();
 	//void Test2();
 	Long64_t GetEntries();
-
+	/** @brief The files in the chain, in the order they were added. */
+	const std::vector<std::string>& GetNtupleFilenames() const;
+	/** @brief The entry number in the whole chain of the first entry in the given file.
+	 *
+	 * Passing the number of files gives the total number of entries. Returns -1 if some of the files
+	 * couldn't be added to the chain, since then the file numbers don't match up.
+	 */
+	Long64_t GetFirstEntryOfFile( size_t fileNumber );
+	/** @brief Adds up the event weights (puWeight) for a range of entries, only reading the Event branch. */
+	Double_t SumOfEventWeights( Long64_t firstEntry, Long64_t lastEntry );
+
+	/// @brief The TTreeCache size in bytes for each of the trees read by ActivateOnlyRequiredBranches
+	static const Long64_t defaultCacheSize=16*1024*1024;
 private:
 	bool CheckFirstFile();
 	bool OpenWithoutInit();
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <memory>
+#include <functional>
 #include "l1menu/ISample.h"
 
 // Forward declarations
@@ -38,8 +39,49 @@ namespace l1menu
 		void loadFilesFromList( const std::string& filenameOfList );
 		const l1menu::L1TriggerDPGEvent& getFullEvent( size_t eventNumber ) const;
 
+		/** @brief Calls the function for each event in the range in order, decoding the following events in a background thread.
+		 *
+		 * Reading and decoding the ntuple happens in one extra thread that keeps a small ring buffer of
+		 * decoded events filled, so it overlaps with whatever the function does instead of adding to it.
+		 * ROOT can't read from several threads at once, so the function mustn't read from any ROOT files
+		 * (including calling getFullEvent). Any exception from decoding or from the function is rethrown
+		 * here once the background thread has stopped.
+		 *
+		 * @param[in] firstEventNumber  The first event to process.
+		 * @param[in] lastEventNumber   One past the last event to process.
+		 * @param[in] function          What to call with each event. The event is only valid during the call.
+		 */
+		void forEachFullEvent( size_t firstEventNumber, size_t lastEventNumber, const std::function<void(const l1menu::L1TriggerDPGEvent&)>& function ) const;
+
+		/** @brief Sets how many threads forEachFullEventInParallel uses. Zero means one per core.
+		 *
+		 * The default is one, which reads the ntuples with forEachFullEvent. ROOT doesn't guarantee that
+		 * reading TTrees from several threads is safe, even with TThread::Initialize(), because the
+		 * streamer info and gDirectory are shared. So more than one is opt-in and experimental; check the
+		 * results against a single threaded run before relying on them.
+		 */
+		void setNumberOfThreads( size_t numberOfThreads );
+		/** @brief The number of threads forEachFullEventInParallel uses, with zero already changed to the number of cores. */
+		size_t numberOfThreads() const;
+		/** @brief Calls the function for every event, with the input files split between several threads.
+		 *
+		 * Each thread opens its own copy of the ntuple files it's been given and has its own event, so the
+		 * threads don't wait for each other. The events come in no particular order, and the function is
+		 * called from several threads at once, so it should only change things that belong to the thread
+		 * number it's given, e.g. an accumulator for each thread that are all added together afterwards.
+		 * The threads take whole input files in turn, unless there are fewer files than threads in which
+		 * case each file is split into ranges of entries. Like forEachFullEvent, the function mustn't read
+		 * from any ROOT files. With one thread, the default, this just calls forEachFullEvent.
+		 *
+		 * @param[in] function  Called with the number of the thread, which is always less than numberOfThreads(),
+		 *                      and the event. The event is only valid during the call.
+		 * @throw               Rethrows the first exception from any of the threads, once they have all stopped.
+		 */
+		void forEachFullEventInParallel( const std::function<void(size_t threadNumber,const l1menu::L1TriggerDPGEvent& event)>& function ) const;
+
 		virtual size_t numberOfEvents() const;
 		virtual const l1menu::IEvent& getEvent( size_t eventNumber ) const;
+		virtual void forEachEvent( size_t firstEventNumber, size_t lastEventNumber, const std::function<void(const l1menu::IEvent&)>& function ) const;
 		virtual std::unique_ptr<l1menu::ICachedTrigger> createCachedTrigger( const l1menu::ITrigger& trigger ) const;
 		virtual float eventRate() const;
 		virtual void setEventRate( float rate );
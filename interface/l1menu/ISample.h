@@ -2,6 +2,8 @@
 #define l1menu_ISample_h
 
 #include <memory>
+#include <functional>
+#include <stddef.h> // required for size_t
 
 //
 // Forward declarations
@@ -31,6 +33,17 @@ namespace l1menu
 		virtual size_t numberOfEvents() const = 0;
 		virtual const l1menu::IEvent& getEvent( size_t eventNumber ) const = 0;
 
+		/** @brief Calls the function for every event from firstEventNumber up to, but not including, lastEventNumber, in order.
+		 *
+		 * Use this rather than getEvent when going through the events in order, because some implementations
+		 * can do it quicker, e.g. FullSample decodes the next events in a background thread while the function
+		 * runs. The default just calls getEvent for each event. The event is only valid during the call.
+		 */
+		virtual void forEachEvent( size_t firstEventNumber, size_t lastEventNumber, const std::function<void(const l1menu::IEvent&)>& function ) const
+		{
+			for( size_t eventNumber=firstEventNumber; eventNumber<lastEventNumber; ++eventNumber ) function( getEvent(eventNumber) );
+		}
+
 		virtual std::unique_ptr<l1menu::ICachedTrigger> createCachedTrigger( const l1menu::ITrigger& trigger ) const = 0;
 		/** @brief The rate at which events are occurring. I.e. the trigger rate if every event passed. */
 		virtual float eventRate() const = 0;
@@ -56,6 +56,38 @@ namespace l1menu
 		/** @brief A version of the method from ITriggerEvent that allows the parameter to be changed. */
 		virtual float& parameter( const std::string& parameterName ) = 0;
 
+		/** @brief Works out the tightest thresholds that still pass the event straight from the event contents.
+		 *
+		 * This is an optional, much quicker, alternative to finding the thresholds by bisection with
+		 * repeated calls to apply() (see l1menu::tools::setTriggerThresholdsAsTightAsPossible). The
+		 * default implementation does nothing and returns false, in which case the caller should fall
+		 * back to the bisection.
+		 *
+		 * The thresholds are written in the order given by l1menu::tools::getThresholdNames. Each one is
+		 * the highest value that still passes the event when all of the other thresholds are zero. If the
+		 * thresholds are correlated, only the first one is worked out in that way and the others are
+		 * scaled with it, keeping the ratios they currently have. Any parameters that aren't thresholds
+		 * (e.g. eta cuts) are used as they currently are. If the event can't pass with any thresholds at
+		 * or above zero, -1 is written for all of them.
+		 *
+		 * Unlike the bisection the values are exact, and not limited to the suggested binning range.
+		 *
+		 * @param[in]  event        The event to work out the thresholds for.
+		 * @param[out] pThresholds  Where to write the thresholds. Must have room for all of them.
+		 * @return                  True if the thresholds were written, false if this trigger can't do it.
+		 */
+		virtual bool calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const { return false; }
+
+		/** @brief Gives exactly the same result as apply(), but using L1TriggerDPGEvent::derivedQuantities where it can.
+		 *
+		 * Those quantities are shared by all of the triggers applied to the event and are only worked
+		 * out once, so this is quicker when lots of triggers (or the same trigger with lots of different
+		 * thresholds) are applied to each event. It's what the ICachedTrigger from FullSample uses. The
+		 * default implementation just calls apply(). Because the quantities change as they're asked for,
+		 * the event shouldn't be used by any other thread at the same time.
+		 */
+		virtual bool applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const { return apply( event ); }
+
 		//
 		// These are the methods from ITriggerDescription that any subclass
 		// needs to implement.
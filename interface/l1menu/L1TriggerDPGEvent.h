@@ -9,6 +9,14 @@ namespace L1Analysis
 {
 	class L1AnalysisDataFormat;
 }
+namespace l1menu
+{
+	namespace implementation
+	{
+		class TriggerObjects;
+		class DerivedQuantities;
+	}
+}
 
 
 namespace l1menu
@@ -35,8 +43,29 @@ namespace l1menu
 		L1TriggerDPGEvent& operator=( L1TriggerDPGEvent&& otherEvent ) noexcept;
 		virtual ~L1TriggerDPGEvent();
 
+		/** @brief Access to change the event. Anything changed has to be done before the next call to triggerObjects(). */
 		virtual L1Analysis::L1AnalysisDataFormat& rawEvent();
 		virtual const L1Analysis::L1AnalysisDataFormat& rawEvent() const;
+		/** @brief The in-time objects sorted by Et, which is what the built in triggers use.
+		 *
+		 * These are worked out from rawEvent() the first time they're asked for after the non-const
+		 * version of rawEvent() was called, so they're only worked out once for all of the triggers
+		 * applied to the event.
+		 *
+		 * This isn't thread safe even though it's const, because the first call fills a cache, and so
+		 * is passesTrigger (which calls it). To use an event from another thread, call this once in the
+		 * thread that filled the event before handing it over, e.g. FullSample::forEachFullEvent does
+		 * that in its decoding thread. After that it only reads, so several threads can use it at once.
+		 */
+		virtual const l1menu::implementation::TriggerObjects& triggerObjects() const;
+		/** @brief Quantities worked out from triggerObjects() that several triggers use, e.g. the highest Et in an eta range.
+		 *
+		 * Each one is only worked out the first time it's asked for, and remembered until the objects
+		 * change. This is what ITrigger::applyUsingDerivedQuantities uses. Every call can change what's
+		 * remembered, so unlike triggerObjects() an event shouldn't be used from more than one thread at
+		 * a time with this, even after the first call.
+		 */
+		virtual l1menu::implementation::DerivedQuantities& derivedQuantities() const;
 		virtual bool* physicsBits(); ///< @brief A 128 element array of the physics bits
 		virtual const bool* physicsBits() const; ///< @brief Const access to the 128 element array of the physics bits.
 
@@ -0,0 +1,81 @@
+#ifndef l1menu_ObjectCacheSample_h
+#define l1menu_ObjectCacheSample_h
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include "l1menu/ISample.h"
+
+// Forward declarations
+namespace l1menu
+{
+	class FullSample;
+	class L1TriggerDPGEvent;
+}
+
+
+namespace l1menu
+{
+	/** @brief An ISample that reads the L1 objects from a compact binary copy of a FullSample, so that ROOT isn't needed.
+	 *
+	 * Every pass over a FullSample has to read the ntuples with ROOT and convert them in fillDataStructure,
+	 * which is most of the time taken by anything that runs on one. The conversion only depends on the
+	 * ntuples, so convert() does it once and saves the result. This class memory maps that file and fills
+	 * an L1TriggerDPGEvent straight from it, which gives exactly the same events as the FullSample did.
+	 * Unlike a ReducedSample the triggers are still applied to the events, so any menu can be used.
+	 *
+	 * The file is "l1menuL1ObjectCache" and a version byte, then a header and a set of columns (structure
+	 * of arrays). There is one entry per event in the event columns (run, weight, energy sums, physics bits
+	 * etc.) and one entry per object in the EG, jet and muon columns (Et, eta, phi, bx and flags), with a
+	 * column of offsets for each that says where each event's objects start. Taus are kept in the jet
+	 * columns with a flag, the same as they are in L1AnalysisDataFormat, so that the order is unchanged.
+	 * Values are stored with the byte order of the machine that wrote them, and the file is refused if
+	 * that's different.
+	 */
+	class ObjectCacheSample : public l1menu::ISample
+	{
+	public:
+		/** @brief Reads every event in the FullSample and saves them in the file format this class reads.
+		 *
+		 * The columns are written to temporary files next to the output while the events are read, so
+		 * the sample doesn't have to fit in memory.
+		 * @throw std::runtime_error If any of the files can't be written.
+		 */
+		static void convert( const l1menu::FullSample& originalSample, const std::string& filename );
+		/** @brief Saves events that have been made some other way, e.g. for tests. The sum of weights is the sum of the event weights. */
+		static void convert( const std::vector<l1menu::L1TriggerDPGEvent>& events, const std::string& filename );
+
+		/** @brief Checks whether the file starts with the magic number of this format. */
+		static bool isObjectCacheFile( const std::string& filename );
+
+	public:
+		/** @brief Memory maps the file written by convert().
+		 * @throw std::runtime_error If the file can't be opened or isn't in the right format.
+		 */
+		ObjectCacheSample( const std::string& filename );
+		virtual ~ObjectCacheSample();
+
+		/** @brief Fills the current event from the file and returns it. It's only valid until the next call. */
+		const l1menu::L1TriggerDPGEvent& getFullEvent( size_t eventNumber ) const;
+		/** @brief Calls the function for each event in the range in order. Has the same signature as FullSample::forEachFullEvent. */
+		void forEachFullEvent( size_t firstEventNumber, size_t lastEventNumber, const std::function<void(const l1menu::L1TriggerDPGEvent&)>& function ) const;
+
+		//
+		// Implementations required for the ISample interface
+		//
+		virtual size_t numberOfEvents() const;
+		virtual const l1menu::IEvent& getEvent( size_t eventNumber ) const;
+		virtual void forEachEvent( size_t firstEventNumber, size_t lastEventNumber, const std::function<void(const l1menu::IEvent&)>& function ) const;
+		virtual std::unique_ptr<l1menu::ICachedTrigger> createCachedTrigger( const l1menu::ITrigger& trigger ) const;
+		virtual float eventRate() const;
+		virtual void setEventRate( float rate );
+		virtual float sumOfWeights() const;
+		virtual std::shared_ptr<const l1menu::IMenuRate> rate( const l1menu::TriggerMenu& menu ) const;
+	private:
+		std::unique_ptr<class ObjectCacheSamplePrivateMembers> pImple_;
+	}; // end of class ObjectCacheSample
+
+} // end of namespace l1menu
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "l1menu/IEvent.h"
 #include <stddef.h> // required for size_t
+#include <stdint.h> // required for uint16_t
 
 //
 // Forward declarations
@@ -11,16 +12,18 @@ namespace l1menu
 {
 	class ITrigger;
 	class ReducedSample;
-}
-namespace l1menuprotobuf
-{
-	class Event;
+	class ReducedSamplePrivateMembers;
 }
 
 
 namespace l1menu
 {
 	/** @brief Interface for a simplified event format. The event just has the minimum threshold to pass for each trigger recorded.
+	 *
+	 * The data is owned by the ReducedSample, which stores it as one column per parameter. This
+	 * class is just an index into those columns, so the ReducedSample can reuse the same instance
+	 * for every event. Columns can either be plain floats, or packed as uint16 indices into a sorted
+	 * table of the values that occur in that column.
 	 *
 	 * @author Mark Grimes (mark.grimes@bristol.ac.uk)
 	 * @date 28/May/2013
@@ -28,6 +31,7 @@ namespace l1menu
 	class ReducedEvent : public l1menu::IEvent
 	{
 		friend class l1menu::ReducedSample;
+		friend class l1menu::ReducedSamplePrivateMembers;
 	public:
 		typedef size_t ParameterID;
 	public:
@@ -41,8 +45,17 @@ namespace l1menu
 		virtual bool passesTrigger( const l1menu::ITrigger& trigger ) const;
 		virtual float weight() const;
 		virtual const l1menu::ISample& sample() const;
+
+		/** @brief The position of this event in the columns of the sample. */
+		size_t index() const { return eventIndex_; }
 	private:
-		l1menuprotobuf::Event* pProtobufEvent_;
+		const float* const* pColumns_; ///< @brief The threshold columns of the sample, one per ParameterID. Null for packed columns.
+		const float* pWeights_; ///< @brief The weight column of the sample. Null if the weights are packed.
+		const uint16_t* const* pPackedColumns_; ///< @brief The packed threshold columns, one per ParameterID. Null for float columns.
+		const float* const* pValueTables_; ///< @brief The value of each code in the packed columns
+		const uint16_t* pPackedWeights_; ///< @brief The packed weight column, or null if the weights are floats
+		const float* pWeightValueTable_; ///< @brief The value of each code in the packed weight column
+		size_t eventIndex_; ///< @brief The index of this event in the columns
 		const l1menu::ReducedSample& sample_; ///< @brief The sample that this event is from
 	};
 
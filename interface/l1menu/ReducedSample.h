@@ -4,6 +4,7 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <vector>
 
 #include "l1menu/ReducedEvent.h"
 #include "l1menu/ISample.h"
@@ -12,6 +13,7 @@
 namespace l1menu
 {
 	class FullSample;
+	class ObjectCacheSample;
 	class TriggerMenu;
 	class ITrigger;
 }
@@ -27,16 +29,128 @@ namespace l1menu
 	class ReducedSample : public l1menu::ISample
 	{
 	public:
-		/** @brief Load from a file in protobuf format. */
-		ReducedSample( const std::string& filename );
+		/** @brief How each frame of a chunked (version 3) file is compressed. The value is what gets written in the file. */
+		enum class Codec : char { GZIP=0, NONE=1, ZSTD=2, LZ4=3 };
+
+		/** @brief Whether files with this codec can be read and written. zstd and lz4 are only available if
+		 * they were enabled when this package was built (see README.md), otherwise using them throws. */
+		static bool codecIsAvailable( Codec codec );
+
+	public:
+		/** @brief Load from a file in protobuf format, or memory map a file in one of the columnar formats.
+		 *
+		 * @param numberOfThreads  The number of threads used to decompress files in the chunked format
+		 *                         (version 3). Zero means one per core. Ignored for the other formats.
+		 */
+		ReducedSample( const std::string& filename, size_t numberOfThreads=0 );
+		/** @brief Load from a file, but only keep the thresholds for the triggers in the projection menu.
+		 *
+		 * Useful when the menu being evaluated only uses some of the triggers in the sample. Only the
+		 * columns for those triggers are kept in memory, and for the memory mapped formats (versions 2
+		 * and 4) the other columns are never read from disk at all. The protobuf formats still have to
+		 * decode every event, but the unused thresholds are thrown away straight away. getTriggerMenu()
+		 * only returns the triggers that were kept. The thresholds in the projection are ignored, only
+		 * the trigger names, versions and other parameters are used to find the columns.
+		 *
+		 * @throw std::runtime_error If one of the triggers in the projection is not in the file.
+		 */
+		ReducedSample( const std::string& filename, const l1menu::TriggerMenu& projection, size_t numberOfThreads=0 );
 		ReducedSample( const l1menu::FullSample& originalSample, const l1menu::TriggerMenu& triggerMenu );
+		/** @brief Makes the sample from a cache of the L1 objects, which gives the same result as the FullSample it was made from. */
+		ReducedSample( const l1menu::ObjectCacheSample& originalSample, const l1menu::TriggerMenu& triggerMenu );
 		ReducedSample( const l1menu::TriggerMenu& triggerMenu );
 		virtual ~ReducedSample();
 
 		void addSample( const l1menu::FullSample& originalSample );
+		/** @brief Only adds the events from firstEventNumber up to, but not including, lastEventNumber.
+		 *
+		 * FullSample can only be used from one thread, so to make a sample in parallel each worker should
+		 * open its own FullSample, add a different range of events to its own ReducedSample, and then the
+		 * results can be put back together in order with addSample(const ReducedSample&).
+		 *
+		 * If this sample was loaded from a file made before exact thresholds were recorded, the new events
+		 * are done by bisection like the ones already there.
+		 */
+		void addSample( const l1menu::FullSample& originalSample, size_t firstEventNumber, size_t lastEventNumber );
+		/** @brief The same as the FullSample versions, but without having to read the ntuples with ROOT. */
+		void addSample( const l1menu::ObjectCacheSample& originalSample );
+		void addSample( const l1menu::ObjectCacheSample& originalSample, size_t firstEventNumber, size_t lastEventNumber );
+		/** @brief Calculates the thresholds for triggers that weren't in the menu the sample was made with, and adds them as new columns.
+		 *
+		 * Much quicker than making the sample again from scratch when a few triggers are added to a large menu,
+		 * since only the new triggers are calculated. Any trigger in the menu that isn't already in the sample
+		 * (checked with containsTrigger) is added, with thresholds of -1 (never passes) for every event, and
+		 * then calculated for the events in originalSample. Triggers that were already in the sample are skipped.
+		 *
+		 * Events are matched by order, i.e. event i of originalSample is taken to be event firstEventNumber+i
+		 * of this sample. The ReducedSample files don't record run, lumi section or event numbers so there's
+		 * no other way of matching them. This means the ntuples have to be given in the same order that they
+		 * were when the sample was made, but each ntuple can be given in a separate call so they don't have
+		 * to be loaded all at once. The calls have to be in order, each starting where the last one finished
+		 * and with the same triggers, until every event has been done. Until then saveToFile and addSample
+		 * throw, so a sample with the new triggers missing for some events can't be used by mistake.
+		 *
+		 * As a check that the events match, the weight of every event has to be the same, and the thresholds
+		 * of the first two triggers already in the sample are recalculated and have to be the same as the
+		 * ones recorded. The weights alone prove nothing when they're all one.
+		 *
+		 * @param triggers          The triggers to calculate. Any that are already in the sample are skipped.
+		 * @param firstEventNumber  The event in this sample that the first event of originalSample corresponds to.
+		 *                          Has to be the number of events done by the earlier calls.
+		 * @throw std::runtime_error If originalSample has too many events, the calls aren't in order, or the
+		 *                           weights or recalculated thresholds don't match.
+		 */
+		void addTriggerColumns( const l1menu::FullSample& originalSample, const l1menu::TriggerMenu& triggers, size_t firstEventNumber=0 );
+		void addTriggerColumns( const l1menu::ObjectCacheSample& originalSample, const l1menu::TriggerMenu& triggers, size_t firstEventNumber=0 );
+		/** @brief Appends all of the events in another ReducedSample, which must have been made with exactly the same menu.
+		 *
+		 * The sums of weights are added. The event rate is left as it is for this sample.
+		 * @throw std::runtime_error If the triggers in the two samples don't match, or the thresholds were found
+		 *                           differently (exactly, or by bisection in samples made before that was recorded).
+		 */
+		void addSample( const l1menu::ReducedSample& otherSample );
+
+		/** @brief Merges ReducedSample files made with the same menu into one chunked (version 3) file.
+		 *
+		 * Intended for combining samples that were made separately from different ntuples. Inputs that
+		 * are already in the chunked format with the same codec have their compressed Runs copied straight
+		 * into the output without being decoded, so merging those is limited by the disk speed. Any other
+		 * input has to be loaded and compressed again. The numbers of events and sums of weights are added
+		 * up in the footer of the output file. Event rates aren't stored in the files, so they have to be
+		 * set when the merged file is used, as with any other file.
+		 *
+		 * @param numberOfThreads  The number of threads used to decompress and compress inputs that can't
+		 *                         be copied across directly. Zero means one per core.
+		 * @throw std::runtime_error If the triggers in the headers of the input files don't all match, including
+		 *                           how their thresholds were found, or if the codec isn't available (see codecIsAvailable).
+		 */
+		static void mergeFiles( const std::vector<std::string>& inputFilenames, const std::string& outputFilename, Codec codec=Codec::GZIP, size_t numberOfThreads=0 );
 
-		/** @brief Save to a file in protobuf format (protobuf in src/protobuf/l1menu.proto). */
-		void saveToFile( const std::string& filename ) const;
+		/** @brief Save to a file in either the protobuf, columnar, chunked or packed columnar format.
+		 *
+		 * Version 1 is the original gzipped protobuf format (protobuf in src/protobuf/l1menu.proto).
+		 * Version 2 stores each threshold, and the weights, as an uncompressed column of floats
+		 * aligned to page boundaries, so that it can be memory mapped when loaded. The files are
+		 * larger but loading is practically instant and only the columns actually used are read
+		 * from disk. Version 3 has the same protobuf messages as version 1, but compresses each one
+		 * separately and adds an index so that they can be compressed and decompressed in parallel.
+		 * Version 4 is like version 2, but where possible each column is stored as uint16 indices into
+		 * a sorted table of the values in that column. Nothing is lost, and rates are calculated
+		 * straight from the indices, so it uses about half of the disk space and memory bandwidth
+		 * of version 2. Columns with too many different values to pack are stored as floats.
+		 * All versions can be loaded with the filename constructor.
+		 *
+		 * @param numberOfThreads  The number of threads used to compress version 3 files or pack version 4
+		 *                         files. Zero means one per core. The file is the same whatever the number
+		 *                         of threads.
+		 * @param codec            How version 3 files are compressed. zstd and lz4 are much quicker to
+		 *                         decompress than gzip, lz4 especially, at the cost of slightly larger
+		 *                         files. The codec is recorded in the file so loading works it out.
+		 *                         The other versions are always gzip (version 1) or uncompressed
+		 *                         (versions 2 and 4), so asking for anything else throws an exception, as
+		 *                         does a codec that isn't available (see codecIsAvailable).
+		 */
+		void saveToFile( const std::string& filename, unsigned int fileFormatVersion=1, size_t numberOfThreads=0, Codec codec=Codec::GZIP ) const;
 
 		const l1menu::TriggerMenu& getTriggerMenu() const;
 		bool containsTrigger( const l1menu::ITrigger& trigger, bool allowOlderVersion=false ) const;
@@ -0,0 +1,59 @@
+#ifndef l1menu_StreamingReducedSample_h
+#define l1menu_StreamingReducedSample_h
+
+#include <string>
+#include <memory>
+#include <map>
+
+#include "l1menu/ISample.h"
+
+// Forward declarations
+namespace l1menu
+{
+	class TriggerMenu;
+	class ITrigger;
+}
+
+
+namespace l1menu
+{
+	/** @brief Reads a ReducedSample file one protobuf Run at a time, so that samples bigger than the available memory can be used.
+	 *
+	 * Only the Run containing the current event is held in memory. Events are meant to be requested
+	 * in order, as MenuRateImplementation and TriggerRatePlot do. Asking for an event later in the
+	 * file decodes and throws away the Runs in between, and asking for an event before the current
+	 * Run starts a new pass from the beginning of the file. So several sequential passes are fine
+	 * but random access is very slow.
+	 *
+	 * Only works on the gzipped protobuf file formats (versions 1 and 3). The number of events and sum
+	 * of weights are taken from the footer if there is one, otherwise the constructor has to make a
+	 * complete pass through the file to count them. Version 3 files have an index of where each Run
+	 * is, so Runs that are skipped over don't have to be decompressed.
+	 */
+	class StreamingReducedSample : public l1menu::ISample
+	{
+	public:
+		StreamingReducedSample( const std::string& filename );
+		virtual ~StreamingReducedSample();
+
+		const l1menu::TriggerMenu& getTriggerMenu() const;
+		const std::map<std::string,size_t> getTriggerParameterIdentifiers( const l1menu::ITrigger& trigger, bool allowOlderVersion=false ) const;
+
+		//
+		// Implementations required for the ISample interface
+		//
+		virtual size_t numberOfEvents() const;
+		virtual const l1menu::IEvent& getEvent( size_t eventNumber ) const;
+		virtual std::unique_ptr<l1menu::ICachedTrigger> createCachedTrigger( const l1menu::ITrigger& trigger ) const;
+		virtual float eventRate() const;
+		virtual void setEventRate( float rate );
+		virtual float sumOfWeights() const;
+		virtual std::shared_ptr<const l1menu::IMenuRate> rate( const l1menu::TriggerMenu& menu ) const;
+
+	private:
+		std::unique_ptr<class StreamingReducedSamplePrivateMembers> pImple_;
+	}; // end of class StreamingReducedSample
+
+} // end of namespace l1menu
+
+#endif
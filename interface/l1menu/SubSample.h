@@ -0,0 +1,70 @@
+#ifndef l1menu_SubSample_h
+#define l1menu_SubSample_h
+
+#include <memory>
+#include <functional>
+#include "l1menu/ISample.h"
+
+
+namespace l1menu
+{
+	/** @brief An ISample that only uses a fraction of the events of another sample, for quick approximate rates.
+	 *
+	 * The events are either every 1/fraction'th event (STRIDE), or each event is kept with a probability
+	 * of fraction using a random number generator with the seed given (RANDOM), so the same seed always
+	 * gives the same events. The weights of the events that are kept are all scaled by the same factor so
+	 * that sumOfWeights() is the same as the original sample's, which means the rates come out about the
+	 * same without any other changes. MenuRateImplementation and TriggerRatePlot already calculate the
+	 * errors from the weights, so the errors they give include the extra statistical error from only using
+	 * some of the events.
+	 *
+	 * The events are taken from the original sample with getEvent, so the original sample has to stay in
+	 * scope for as long as this one is used. The indices of the events kept are worked out once in the
+	 * constructor, and are always in increasing order.
+	 */
+	class SubSample : public l1menu::ISample
+	{
+	public:
+		enum class Method : char { STRIDE, RANDOM };
+
+	public:
+		/** @brief Selects the events and sums their weights, which is one pass over the selected events.
+		 * @throw std::runtime_error If the fraction is not in the range (0,1] or none of the events are selected.
+		 */
+		SubSample( const l1menu::ISample& originalSample, float fraction, l1menu::SubSample::Method method=l1menu::SubSample::Method::RANDOM, unsigned int seed=0 );
+		virtual ~SubSample();
+
+		const l1menu::ISample& originalSample() const;
+		/** @brief The event number in the original sample of one of the events in this sample. */
+		size_t originalEventNumber( size_t eventNumber ) const;
+		/** @brief The fraction of events actually kept, which will differ slightly from what was asked for. */
+		float fractionOfEvents() const;
+		/** @brief The factor every event weight is multiplied by. */
+		float weightScale() const;
+		/** @brief Roughly how much larger the statistical errors are than they would be with the whole original sample.
+		 *
+		 * This is the square root of weightScale(). Errors on the rates are roughly proportional to the square
+		 * root of the sum of the weights squared, and scaling a fraction f of the weights by 1/f multiplies the
+		 * sum of squares by 1/f. Which means the extra error from subsampling is about rateError*sqrt(1-f)
+		 * for a rate error given by this sample.
+		 */
+		float statisticalErrorScale() const;
+
+		//
+		// Implementations required for the ISample interface
+		//
+		virtual size_t numberOfEvents() const;
+		virtual const l1menu::IEvent& getEvent( size_t eventNumber ) const;
+		virtual void forEachEvent( size_t firstEventNumber, size_t lastEventNumber, const std::function<void(const l1menu::IEvent&)>& function ) const;
+		virtual std::unique_ptr<l1menu::ICachedTrigger> createCachedTrigger( const l1menu::ITrigger& trigger ) const;
+		virtual float eventRate() const;
+		virtual void setEventRate( float rate );
+		virtual float sumOfWeights() const;
+		virtual std::shared_ptr<const l1menu::IMenuRate> rate( const l1menu::TriggerMenu& menu ) const;
+	private:
+		std::unique_ptr<class SubSamplePrivateMembers> pImple_;
+	}; // end of class SubSample
+
+} // end of namespace l1menu
+
+#endif
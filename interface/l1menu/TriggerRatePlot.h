@@ -125,7 +125,9 @@ namespace l1menu
 		 * This is purely for performance reasons, because there's some logic in here that can be considerably
 		 * faster than looping over the provided vector and calling addSample() on each one. FullSample needs
 		 * to do a lot of work to read a new event, so reading each event for each TriggerRatePlot is much
-		 * slower than reading the event once and passing it to each TriggerRatePlot.
+		 * slower than reading the event once and passing it to each TriggerRatePlot. For a FullSample the
+		 * events are read with several threads (see FullSample::setNumberOfThreads), each filling its own
+		 * copies of the plots, and the copies are added to the plots provided at the end.
 		 */
 		static void addSample( const l1menu::ISample& sample, std::vector<TriggerRatePlot>& ratePlots );
 	protected:
@@ -0,0 +1,95 @@
+#ifndef l1menu_tools_Profiler_h
+#define l1menu_tools_Profiler_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <iosfwd>
+#include <stddef.h> // required for size_t
+
+namespace l1menu
+{
+	namespace tools
+	{
+		/** @brief Opt in timing of the different stages of making a ReducedSample, to see where the time goes.
+		 *
+		 * Records the time spent reading entries from the ntuple (L1UpgradeNtuple::GetEntry), the time spent
+		 * converting them in FullSamplePrivateMembers::fillDataStructure, and for each trigger how many times
+		 * apply() is called and how long it takes to work out the thresholds. How many iterations each
+		 * bisection takes is also recorded, since that's the slowest way of finding a threshold.
+		 *
+		 * Nothing is recorded unless enable() has been called, so normally the only cost is a check of a
+		 * flag. Uses the Meyer's singleton pattern like TriggerTable, and isn't thread safe. The worker
+		 * processes of l1menuCreateReducedSample each have their own copy, so they save their counters
+		 * with saveCounters and the parent process adds them up with mergeCounters.
+		 */
+		class Profiler
+		{
+		public:
+			typedef std::chrono::steady_clock Clock;
+
+			/** @brief The counters for one trigger. */
+			struct TriggerStatistics
+			{
+				unsigned long long numberOfEvents; ///< @brief How many events the thresholds have been worked out for
+				unsigned long long numberOfApplyCalls;
+				unsigned long long nanoseconds; ///< @brief Total time working out the thresholds, which includes all of the apply() calls
+			};
+
+			/** @brief Adds the time from construction to destruction onto a counter, if the pointer isn't null. */
+			class ScopedTimer
+			{
+			public:
+				explicit ScopedTimer( unsigned long long* pNanoseconds ) : pNanoseconds_(pNanoseconds) { if( pNanoseconds_ ) startTime_=Clock::now(); }
+				~ScopedTimer() { if( pNanoseconds_ ) *pNanoseconds_+=std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now()-startTime_ ).count(); }
+			private:
+				unsigned long long* pNanoseconds_;
+				Clock::time_point startTime_;
+			};
+		public:
+			/** @brief The only way to get an instance of the profiler. */
+			static Profiler& instance();
+
+			/** @brief Starts recording. The wall time for the events per second is measured from here. */
+			void enable();
+			bool isEnabled() const { return enabled_; }
+
+			/** @brief The counters to pass to a ScopedTimer. These return null if profiling isn't enabled. */
+			unsigned long long* getEntryNanoseconds();
+			unsigned long long* fillDataStructureNanoseconds();
+
+			/** @brief The counters for the named trigger, or null if profiling isn't enabled. The pointer stays valid. */
+			TriggerStatistics* triggerStatistics( const std::string& triggerName );
+
+			void addProcessedEvents( size_t numberOfEvents );
+			void addBisection( size_t numberOfIterations );
+
+			/** @brief Prints a table of everything recorded so far. */
+			void printSummary( std::ostream& output ) const;
+			/** @brief Writes the same information as printSummary as a JSON object. */
+			void writeJSON( std::ostream& output ) const;
+
+			/** @brief Writes the raw counters so that another process can add them to its own with mergeCounters. */
+			void saveCounters( std::ostream& output ) const;
+			void mergeCounters( std::istream& input );
+		private:
+			Profiler();
+			Profiler( const Profiler& otherProfiler ) = delete;
+			Profiler& operator=( const Profiler& otherProfiler ) = delete;
+
+			double wallTime() const; ///< @brief Seconds since enable() was called
+
+			bool enabled_;
+			Clock::time_point startTime_;
+			unsigned long long numberOfProcessedEvents_;
+			unsigned long long getEntryNanoseconds_;
+			unsigned long long fillDataStructureNanoseconds_;
+			std::map<std::string,TriggerStatistics> triggerStatistics_;
+			/// @brief The number of bisections that took each number of iterations, indexed by the number of iterations
+			std::vector<unsigned long long> bisectionIterations_;
+		};
+
+	} // end of the tools namespace
+} // end of the l1menu namespace
+#endif
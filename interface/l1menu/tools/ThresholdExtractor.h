@@ -0,0 +1,105 @@
+#ifndef l1menu_tools_ThresholdExtractor_h
+#define l1menu_tools_ThresholdExtractor_h
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <stddef.h> // required for size_t
+#include "l1menu/tools/Profiler.h"
+
+// Forward declarations
+namespace l1menu
+{
+	class ITrigger;
+	class L1TriggerDPGEvent;
+}
+
+namespace l1menu
+{
+	namespace tools
+	{
+		/** @brief Finds the tightest thresholds of a trigger that still pass an event, for lots of events.
+		 *
+		 * If the trigger implements ITrigger::calculateTightestThresholds that is used. Otherwise each
+		 * threshold is searched for in the Et values of the objects in the event with
+		 * l1menu::tools::findTightestThresholdFromCandidates, which gives exact values. If the turn on isn't
+		 * at one of those, this does the same bisection as l1menu::tools::setTriggerThresholdsAsTightAsPossible
+		 * and gives the same results as calling that on a fresh copy of the trigger. Everything that doesn't
+		 * depend on the event (the copy of the trigger, the threshold names, references to the threshold
+		 * parameters, the scalings for correlated thresholds and the search ranges) is worked out once in
+		 * the constructor. The per event call then doesn't throw, or allocate any memory once it has seen a
+		 * few events, which makes it a lot quicker when creating a ReducedSample.
+		 *
+		 * Samples made before this existed found every threshold by bisection. To add to those consistently,
+		 * Method::BISECTION can be given to the constructor to always use the bisection.
+		 *
+		 * If the Profiler has been enabled before the instance is created, the time taken and the number of
+		 * apply() calls are recorded there under the trigger's name.
+		 *
+		 * An instance keeps its own copy of the trigger and changes it for each event, so the same
+		 * instance shouldn't be used from several threads at once.
+		 */
+		class ThresholdExtractor
+		{
+		public:
+			enum class Status { OK, NO_THRESHOLDS_FOUND };
+			/** @brief EXACT uses the quickest exact method available for the trigger, BISECTION only ever bisects. */
+			enum class Method { EXACT, BISECTION };
+
+			/** @brief Prepares to find thresholds for a copy of the trigger.
+			 *
+			 * Parameters that aren't thresholds (e.g. eta cuts) are kept at the values in the trigger. If the
+			 * thresholds are correlated, they're scaled together keeping the ratios they have in the trigger.
+			 *
+			 * @param[in] trigger    The trigger to find thresholds for. A copy is taken, so this isn't modified.
+			 * @param[in] tolerance  If bisection has to be used, the thresholds found are within this tolerance of thresholds that would fail the event.
+			 * @param[in] method     Whether to find exact thresholds where possible, or always use bisection.
+			 */
+			ThresholdExtractor( const l1menu::ITrigger& trigger, float tolerance=0.01, Method method=Method::EXACT );
+			ThresholdExtractor( ThresholdExtractor&& otherExtractor ) noexcept; ///< Move constructor. The references to the parameters stay valid because the trigger copy doesn't move.
+			~ThresholdExtractor();
+
+			/** @brief The names of the thresholds, in the order they're written by extract. */
+			const std::vector<std::string>& thresholdNames() const;
+			size_t numberOfThresholds() const;
+			/** @brief The highest value the bisection tries for the threshold. Turn ons above this are never found by bisection.
+			 *
+			 * The bisection can't tell an event that passes with thresholds all the way up to this from one that
+			 * never passes, so it gives -1 for both. For correlated thresholds the scaled limit is given for the
+			 * ones that aren't searched for.
+			 */
+			float searchLimit( size_t thresholdNumber ) const;
+			/** @brief How far above the turn on a threshold found by bisection can be. Scaled the same way as searchLimit. */
+			float bisectionTolerance( size_t thresholdNumber ) const;
+
+			/** @brief Works out the tightest thresholds that pass the event, and writes them into pThresholds.
+			 *
+			 * @param[in]  event        The event to test the trigger on.
+			 * @param[out] pThresholds  Where to write the thresholds. Must have room for numberOfThresholds() floats.
+			 *                          If no thresholds can be found that pass the event, -1 is written for all of them.
+			 * @return                  Status::OK, or Status::NO_THRESHOLDS_FOUND if the event can't pass.
+			 */
+			Status extract( const l1menu::L1TriggerDPGEvent& event, float* pThresholds );
+		private:
+			std::unique_ptr<l1menu::ITrigger> pTrigger_;
+			float tolerance_;
+			Method method_;
+			std::vector<std::string> thresholdNames_;
+			/// @brief References to each of the parameters in thresholdNames_ in pTrigger_
+			std::vector<float*> thresholds_;
+			/// @brief How many of thresholds_ are searched for. Just the first if they're correlated, otherwise all of them.
+			size_t numberOfVariedThresholds_;
+			/// @brief "first" is a pointer to the parameter, "second" is the amount to scale it. Only filled if thresholds are correlated.
+			std::vector< std::pair<float*,float> > otherParameterScalings_;
+			/// @brief The range to search for each of the varied thresholds.
+			std::vector< std::pair<float,float> > searchRanges_;
+			/// @brief Values from the current event the thresholds could turn on at. Kept so that the memory is reused.
+			std::vector<float> candidates_;
+			/// @brief Where to record the time taken and apply() calls. Null unless profiling is enabled.
+			l1menu::tools::Profiler::TriggerStatistics* pStatistics_;
+		};
+
+	} // end of the tools namespace
+} // end of the l1menu namespace
+#endif
@@ -78,12 +78,28 @@ namespace l1menu
 		 *
 		 * @param[in]  filename     The filename of the file to open. If the file doesn't exist a std::runtime_error
 		 *                          is thrown.
+		 * @param[in]  streamIfPossible  If true and the file is a ReducedSample in one of the protobuf formats, a
+		 *                          StreamingReducedSample is returned instead of a ReducedSample. This only holds
+		 *                          part of the file in memory at a time, but is only efficient if the events are
+		 *                          accessed sequentially.
 		 * @return                  A pointer to the ISample created.
 		 *
 		 * @author Mark Grimes (mark.grimes@bristol.ac.uk)
 		 * @date 07/Jul/2013
 		 */
-		std::unique_ptr<l1menu::ISample> loadSample( const std::string& filename );
+		std::unique_ptr<l1menu::ISample> loadSample( const std::string& filename, bool streamIfPossible=false );
+
+		/** @brief As loadSample above, but if a ReducedSample is loaded it only keeps the triggers in the projection menu.
+		 *
+		 * The columns of thresholds for any triggers not in the projection are not kept in memory, and for
+		 * the memory mapped file formats are not even read from disk. See the ReducedSample constructor for
+		 * details. If the StreamingReducedSample is used then it only holds part of the file in memory anyway,
+		 * so the projection is ignored. A FullSample or ObjectCacheSample always calculates the triggers on
+		 * the fly, so the projection is ignored for those too.
+		 *
+		 * @throw std::runtime_error If one of the triggers in the projection is not in the ReducedSample.
+		 */
+		std::unique_ptr<l1menu::ISample> loadSample( const std::string& filename, const l1menu::TriggerMenu& projection, bool streamIfPossible=false );
 
 		/** @brief Loads the menu from a file on disk.
 		 *
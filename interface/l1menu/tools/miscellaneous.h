@@ -73,6 +73,45 @@ namespace l1menu
 		 */
 		void setTriggerThresholdsAsTightAsPossible( const l1menu::L1TriggerDPGEvent& event, l1menu::ITrigger& trigger, float tolerance=0.01 );
 
+		/** @brief Collects the values in the event that a threshold could turn on at, i.e. the Et or pt of all of
+		 * the objects and the energy sums.
+		 *
+		 * If a threshold is scaled against the one being searched for, it turns on when the threshold searched
+		 * for is the value divided by the scaling. So for each of the scalings supplied, all of the values divided
+		 * by the scaling are added as well. The candidates are sorted and any duplicates removed.
+		 *
+		 * @param[in]  event                   The event to take the values from.
+		 * @param[in]  otherParameterScalings  Any scaled parameters, where "first" is a pointer to the parameter and
+		 *                                     "second" is the amount it's scaled by. Only "second" is used here.
+		 * @param[out] candidates              Cleared and then filled with the values. Passing in the same vector
+		 *                                     each time avoids allocating any memory once it's large enough.
+		 */
+		void getCandidateThresholds( const l1menu::L1TriggerDPGEvent& event, const std::vector< std::pair<float*,float> >& otherParameterScalings, std::vector<float>& candidates );
+
+		/** @brief Finds the tightest threshold that passes the event by binary searching the candidate values.
+		 *
+		 * For triggers that use "value>=threshold" the turn on is always exactly at one of the values from
+		 * getCandidateThresholds, so this needs about log2 of the number of candidates calls to apply(),
+		 * rather than the ~20 that bisection needs. The result is exact rather than within a tolerance.
+		 *
+		 * It's checked that the trigger passes the event at the result and fails just above it. If that's not
+		 * true, e.g. the trigger uses ">" or nothing passes, false is returned and something else (like
+		 * bisection) should be used. Other thresholds are left as they are, so set them beforehand.
+		 *
+		 * @param[in]  event                   The event to test the trigger on.
+		 * @param[in]  trigger                 The trigger to test.
+		 * @param[out] threshold               Reference to the threshold parameter in the trigger to search for. Its
+		 *                                     value afterwards is not defined.
+		 * @param[in]  otherParameterScalings  Parameters to scale along with the threshold, as in getCandidateThresholds.
+		 * @param[in]  candidates              Sorted candidate values, from getCandidateThresholds.
+		 * @param[in]  lowerLimit              Candidates below this aren't considered.
+		 * @param[out] result                  The tightest threshold, only set if true is returned.
+		 * @param[out] pNumberOfApplyCalls     If not null, this is incremented by the number of times apply() was called.
+		 * @return                             Whether the tightest threshold was found.
+		 */
+		bool findTightestThresholdFromCandidates( const l1menu::L1TriggerDPGEvent& event, const l1menu::ITrigger& trigger, float& threshold,
+				const std::vector< std::pair<float*,float> >& otherParameterScalings, const std::vector<float>& candidates, float lowerLimit, float& result, unsigned long long* pNumberOfApplyCalls=nullptr );
+
 		/** @brief Gives the eta bounds of the requested calorimeter region.
 		 *
 		 * @param[in]  calorimeterRegion   The calorimeter region. Must be between 0 and 21 inclusive or a
@@ -0,0 +1,67 @@
+#ifndef l1menu_tools_shardManifest_h
+#define l1menu_tools_shardManifest_h
+
+/** @file
+ * Describing the pieces of a ReducedSample made in several separate jobs (shards), so that they
+ * can be checked and put back together.
+ */
+
+#include <vector>
+#include <string>
+#include <iosfwd>
+#include <stddef.h> // required for size_t
+
+namespace l1menu
+{
+	namespace tools
+	{
+		/** @brief What one shard of a sharded l1menuCreateReducedSample job made.
+		 *
+		 * Event numbers count through all of the input files in order, as if they were one long file.
+		 * Each shard saves one of these next to its partial ReducedSample, and the merge uses them to
+		 * check that every event is in exactly one shard before putting the shards together.
+		 */
+		struct ShardManifestEntry
+		{
+			std::string sampleFilename; ///< @brief The partial ReducedSample, relative to the directory of the manifest entry
+			std::vector<std::string> inputFilenames; ///< @brief All of the input files of the whole job, in order
+			size_t totalNumberOfEvents; ///< @brief The number of events in all of the input files
+			size_t firstEventNumber;
+			size_t lastEventNumber; ///< @brief One past the last event in the shard
+			size_t numberOfEvents;
+			double sumOfWeights;
+		};
+
+		/** @brief Writes the entry in a simple "key value" text format, one per line. */
+		void saveShardManifestEntry( const l1menu::tools::ShardManifestEntry& entry, std::ostream& output );
+
+		/** @brief Reads a file written by saveShardManifestEntry.
+		 *
+		 * The sampleFilename is changed to be relative to the current directory rather than the directory
+		 * the manifest entry is in, so that it can be opened directly.
+		 *
+		 * @throw std::runtime_error  If the file can't be read or anything is missing.
+		 */
+		l1menu::tools::ShardManifestEntry loadShardManifestEntry( const std::string& filename );
+
+		/** @brief Sorts the entries by event number and checks that together they cover every event exactly once.
+		 *
+		 * Also checks that all of the entries were made from the same input files, and that the number of
+		 * events in each is consistent with its event range.
+		 *
+		 * @throw std::runtime_error  Describing the first problem found, e.g. a missing or duplicated range of events.
+		 */
+		void checkShardManifest( std::vector<l1menu::tools::ShardManifestEntry>& entries );
+
+		/** @brief Checks that the sample a manifest entry points to has the number of events and sum of weights the entry says.
+		 *
+		 * Only the event weights are loaded, so this is quick even for large samples.
+		 *
+		 * @throw std::runtime_error  If the sample can't be loaded or doesn't match.
+		 */
+		void checkShardSample( const l1menu::tools::ShardManifestEntry& entry );
+
+	} // end of namespace tools
+} // end of namespace l1menu
+
+#endif
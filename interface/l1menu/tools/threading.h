@@ -0,0 +1,38 @@
+#ifndef l1menu_tools_threading_h
+#define l1menu_tools_threading_h
+
+/** @file
+ * Simple helpers for spreading work across threads.
+ */
+
+#include <functional>
+#include <stddef.h> // required for size_t
+
+namespace l1menu
+{
+	namespace tools
+	{
+		/** @brief The number of threads to use if the user hasn't asked for a particular number.
+		 *
+		 * @return  The number of cores on the machine, or 1 if that can't be determined.
+		 */
+		size_t defaultNumberOfThreads();
+
+		/** @brief Calls function(index) for every index from 0 to numberOfItems-1, spread over several threads.
+		 *
+		 * The items are handed out in order as threads become free, so the function can be called in any
+		 * order and concurrently. It should only write to things that no other index touches, e.g. its own
+		 * element of a pre-sized vector. If any call throws, no new items are started and the first exception
+		 * is rethrown in the calling thread once all of the threads have finished.
+		 *
+		 * @param[in] numberOfItems    The number of times to call the function.
+		 * @param[in] numberOfThreads  The number of threads to use. Zero means defaultNumberOfThreads(). If
+		 *                             one, everything happens in the calling thread without starting any others.
+		 * @param[in] function         The function to call for each item.
+		 */
+		void parallelFor( size_t numberOfItems, size_t numberOfThreads, const std::function<void(size_t)>& function );
+
+	} // end of namespace tools
+} // end of namespace l1menu
+
+#endif
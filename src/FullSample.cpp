@@ -2,13 +2,33 @@
 
 #include <stdexcept>
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <atomic>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <TSystem.h>
+#include <TThread.h>
 #include "FWCore/FWLite/interface/AutoLibraryLoader.h"
 
 #include "l1menu/L1TriggerDPGEvent.h"
 #include "l1menu/ICachedTrigger.h"
+#include "l1menu/ITrigger.h"
 #include "l1menu/IMenuRate.h"
+#include "l1menu/tools/Profiler.h"
+#include "l1menu/tools/threading.h"
 #include "./implementation/MenuRateImplementation.h"
 #include "L1UpgradeNtuple.h"
 #include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
@@ -19,11 +39,13 @@
 
 namespace // Use the unnamed namespace for things only used in this file
 {
-	/** @brief A required implementation that just acts as a proxy.
+	/** @brief Applies the trigger using the quantities shared by every trigger for the event.
 	 *
-	 * For some implementations of ISample, this class can speed up execution significantly. This
-	 * implementation has no improvement. An implementation is required however, so this just acts
-	 * as a proxy to the full routines.
+	 * Uses ITrigger::applyUsingDerivedQuantities, so things like the highest Et in a region or the
+	 * n'th highest jet are only worked out once per event and looked up by every other cached trigger,
+	 * and every step of a TriggerRatePlot bisection. The quantities are held by the event, and
+	 * getFullEvent doesn't read the event again if the same event number is asked for, so they're
+	 * worked out once per event number. The event shouldn't be used by two threads at once.
 	 *
 	 * @author Mark Grimes (mark.grimes@bristol.ac.uk)
 	 * @date 02/Jul/2013
@@ -32,10 +54,145 @@ namespace // Use the unnamed namespace for things only used in this file
 	{
 	public:
 		CachedTriggerImplementation( const l1menu::ITrigger& trigger ) : trigger_(trigger) {}
-		virtual bool apply( const l1menu::IEvent& event ) { return event.passesTrigger( trigger_ ); }
+		virtual bool apply( const l1menu::IEvent& event )
+		{
+			// All of the events from FullSample are L1TriggerDPGEvents, and this is called far too often for a dynamic_cast
+			return trigger_.applyUsingDerivedQuantities( static_cast<const l1menu::L1TriggerDPGEvent&>(event) );
+		}
 	protected:
 		const l1menu::ITrigger& trigger_;
 	}; // end of class CachedTriggerImplementation
+
+	/// @brief Whatever type cos() and sin() of a float give, so that lookup tables give exactly the same results as calling them
+	typedef decltype( cos( 0.f ) ) TrigResult;
+
+	/** @brief Finds objects that have exactly the same values as an earlier one, without comparing every pair.
+	 *
+	 * A hash table of up to four values per object, using open addressing so that it keeps its memory
+	 * between events and doesn't allocate once it has seen a few. Values are compared with == so the
+	 * result is the same as comparing every pair, e.g. NaN never matches anything.
+	 */
+	class ObjectMatcher
+	{
+	public:
+		/** @brief Empties the table, ready for at most maximumNumberOfObjects objects. */
+		void clear( size_t maximumNumberOfObjects )
+		{
+			size_t tableSize=4;
+			while( tableSize<2*maximumNumberOfObjects ) tableSize*=2;
+			table_.assign( tableSize, -1 );
+			objects_.clear();
+		}
+		/** @brief Adds the object unless one with the same values has already been added. Returns true if it was added. */
+		bool insert( double value0, double value1, double value2=0, double value3=0 )
+		{
+			const Object object={ { value0, value1, value2, value3 } };
+			int& slot=findSlot( object );
+			if( slot!=-1 ) return false;
+			slot=objects_.size();
+			objects_.push_back( object );
+			return true;
+		}
+		bool contains( double value0, double value1, double value2=0, double value3=0 )
+		{
+			const Object object={ { value0, value1, value2, value3 } };
+			return findSlot( object )!=-1;
+		}
+	private:
+		struct Object
+		{
+			double values[4];
+			bool operator==( const Object& other ) const { return values[0]==other.values[0] && values[1]==other.values[1] && values[2]==other.values[2] && values[3]==other.values[3]; }
+		};
+		/** @brief The slot with an equal object in, or the empty slot where it would go if there isn't one. */
+		int& findSlot( const Object& object )
+		{
+			// std::hash gives equal hashes for equal values (e.g. 0.0 and -0.0), which is all that's needed
+			std::hash<double> hashFunction;
+			size_t hash=0;
+			for( size_t index=0; index<4; ++index ) hash=hash*1000003+hashFunction( object.values[index] );
+			const size_t mask=table_.size()-1;
+			for( size_t slotNumber=hash&mask; ; slotNumber=(slotNumber+1)&mask )
+			{
+				int& slot=table_[slotNumber];
+				if( slot==-1 || objects_[slot]==object ) return slot;
+			}
+		}
+		std::vector<int> table_; ///< @brief Indices into objects_, or -1 for an empty slot. Always at least half empty.
+		std::vector<Object> objects_;
+	};
+
+	/** @brief The sum of the event weights in one input file, as saved in the sidecar file. */
+	struct FileWeights
+	{
+		long long modificationTime;
+		long long numberOfEntries;
+		double sumOfWeights;
+	};
+
+	/** @brief Reads the sidecar file written by saveFileWeights. If it doesn't exist the map is just empty. */
+	std::map<std::string,FileWeights> loadFileWeights( const std::string& filename )
+	{
+		std::map<std::string,FileWeights> fileWeights;
+		std::ifstream inputFile( filename );
+		std::string line;
+		while( std::getline( inputFile, line ) )
+		{
+			if( line.empty() || line[0]=='#' ) continue;
+			std::istringstream lineStream( line );
+			FileWeights weights;
+			std::string inputFilename;
+			// The filename is last so that it can have spaces in
+			if( !(lineStream >> weights.modificationTime >> weights.numberOfEntries >> weights.sumOfWeights >> std::ws) ) continue;
+			std::getline( lineStream, inputFilename );
+			if( !inputFilename.empty() ) fileWeights[inputFilename]=weights;
+		}
+		return fileWeights;
+	}
+
+	/** @brief Saves the sums of weights so that later jobs don't need to read the files. Failures are ignored since it's only a cache. */
+	void saveFileWeights( const std::string& filename, const std::map<std::string,FileWeights>& fileWeights )
+	{
+		// Write to a temporary file and rename, so that jobs running at the same time never read half a file
+		const std::string temporaryFilename=filename+".tmp"+std::to_string( ::getpid() );
+		{
+			std::ofstream outputFile( temporaryFilename );
+			if( !outputFile.is_open() ) return;
+			outputFile << "# modificationTime entries sumOfWeights filename" << "\n" << std::setprecision( std::numeric_limits<double>::digits10+2 );
+			for( const auto& filenameWeightsPair : fileWeights )
+			{
+				const FileWeights& weights=filenameWeightsPair.second;
+				outputFile << weights.modificationTime << " " << weights.numberOfEntries << " " << weights.sumOfWeights << " " << filenameWeightsPair.first << "\n";
+			}
+			outputFile.flush();
+			if( !outputFile.good() )
+			{
+				outputFile.close();
+				std::remove( temporaryFilename.c_str() );
+				return;
+			}
+		}
+		if( std::rename( temporaryFilename.c_str(), filename.c_str() )!=0 ) std::remove( temporaryFilename.c_str() );
+	}
+
+	/** @brief A range of entries in one of the input files, that one thread of forEachFullEventInParallel reads. */
+	struct InputBlock
+	{
+		size_t fileNumber;
+		long long firstEntry; ///< @brief Counting from the start of the file, not the chain
+		long long lastEntry; ///< @brief One past the last entry, or -1 for the rest of the file
+	};
+
+	/** @brief Held while opening or closing ntuples, which touches ROOT's global lists. Reading separate files at once is fine. */
+	std::mutex rootFileMutex;
+
+	/** @brief The modification time of the file, or -1 if it isn't a local file (e.g. it's opened over xrootd). */
+	long long modificationTime( const std::string& filename )
+	{
+		struct stat fileStatus;
+		if( ::stat( filename.c_str(), &fileStatus )!=0 ) return -1;
+		return fileStatus.st_mtime;
+	}
 } // end of the unnamed namespace
 
 namespace l1menu
@@ -47,6 +204,9 @@ namespace l1menu
 		static const double PHIBIN[];
 		static const size_t ETABINS;
 		static const double ETABIN[];
+		static TrigResult cosineOfPhiBin[18]; ///< @brief cos() of the angle calculateHTM uses for each of the phi bins
+		static TrigResult sineOfPhiBin[18];
+		static bool trigTablesFilled;
 
 		static bool libraryLoaderInitiated; ///< @brief Flag to say if libFWCoreFWLite.so has been loaded and the AutoLibraryLoader enabled
 
@@ -56,13 +216,24 @@ namespace l1menu
 		double calculateHTT( const L1Analysis::L1AnalysisDataFormat& event );
 		double calculateHTM( const L1Analysis::L1AnalysisDataFormat& event );
 	public:
-		FullSamplePrivateMembers( FullSample* pThisObject );
-		void fillDataStructure( int selectDataInput );
-		void fillL1Bits();
+		FullSamplePrivateMembers( const FullSample* pThisObject );
+		void fillDataStructure( l1menu::L1TriggerDPGEvent& event, int selectDataInput );
+		void fillL1Bits( l1menu::L1TriggerDPGEvent& event );
+		/** @brief Reads the entry from the ntuple and converts it into the event. */
+		void readEvent( size_t eventNumber, l1menu::L1TriggerDPGEvent& event );
+		/** @brief Adds up the weights of all events, using the sums saved in weightsCacheFilename for any input files that haven't changed. */
+		double calculateSumOfWeights();
 		L1UpgradeNtuple inputNtuple;
+		ObjectMatcher duplicateMatcher; ///< @brief Only kept here so that the memory is reused for each event
+		ObjectMatcher isolationMatcher;
 		l1menu::L1TriggerDPGEvent currentEvent;
+		size_t currentEventNumber; ///< @brief The event number in currentEvent, or noEventNumber if it hasn't been read
+		static const size_t noEventNumber;
 		float sumOfWeights;
 		float eventRate;
+		size_t numberOfThreads; ///< @brief For forEachFullEventInParallel. One (the default) means it isn't parallel, zero means one per core.
+		std::string weightsCacheFilename; ///< @brief Sidecar file with the sum of weights for each input file, keyed by filename and modification time
+
 	};
 }
 
@@ -71,9 +242,13 @@ const double l1menu::FullSamplePrivateMembers::PHIBIN[]={10,30,50,70,90,110,130,
 const size_t l1menu::FullSamplePrivateMembers::ETABINS=23;
 const double l1menu::FullSamplePrivateMembers::ETABIN[]={-5.,-4.5,-4.,-3.5,-3.,-2.172,-1.74,-1.392,-1.044,-0.696,-0.348,0,0.348,0.696,1.044,1.392,1.74,2.172,3.,3.5,4.,4.5,5.};
 bool l1menu::FullSamplePrivateMembers::libraryLoaderInitiated=false;
+const size_t l1menu::FullSamplePrivateMembers::noEventNumber=std::numeric_limits<size_t>::max();
+TrigResult l1menu::FullSamplePrivateMembers::cosineOfPhiBin[18];
+TrigResult l1menu::FullSamplePrivateMembers::sineOfPhiBin[18];
+bool l1menu::FullSamplePrivateMembers::trigTablesFilled=false;
 
-l1menu::FullSamplePrivateMembers::FullSamplePrivateMembers( FullSample* pThisObject )
-	: currentEvent(*pThisObject), sumOfWeights(-1), eventRate(1)
+l1menu::FullSamplePrivateMembers::FullSamplePrivateMembers( const FullSample* pThisObject )
+	: currentEvent(*pThisObject), currentEventNumber(noEventNumber), sumOfWeights(-1), eventRate(1), numberOfThreads(1)
 {
 	if( !libraryLoaderInitiated )
 	{
@@ -81,6 +256,18 @@ l1menu::FullSamplePrivateMembers::FullSamplePrivateMembers( FullSample* pThisObj
 		AutoLibraryLoader::enable();
 		libraryLoaderInitiated=true;
 	}
+
+	if( !trigTablesFilled )
+	{
+		// Exactly the same calculation as calculateHTM used to do for every jet, so that the results don't change
+		for( int phiBin=0; phiBin<18; ++phiBin )
+		{
+			float phi=2*M_PI*(phiBin/18.);
+			cosineOfPhiBin[phiBin]=cos( phi );
+			sineOfPhiBin[phiBin]=sin( phi );
+		}
+		trigTablesFilled=true;
+	}
 }
 
 double l1menu::FullSamplePrivateMembers::degree( double radian )
@@ -91,26 +278,19 @@ double l1menu::FullSamplePrivateMembers::degree( double radian )
 
 int l1menu::FullSamplePrivateMembers::phiINjetCoord( double phi )
 {
-	size_t phiIdx=0;
+	// The last bin wraps around past zero, and is numbered 0. The others are numbered from 1,
+	// so the bin number is the number of bin edges at or below the angle.
 	double phidegree=degree( phi );
-	for( size_t idx=0; idx<PHIBINS; idx++ )
-	{
-		if( phidegree>=PHIBIN[idx] and phidegree<PHIBIN[idx+1] ) phiIdx=idx;
-		else if( phidegree>=PHIBIN[PHIBINS-1] || phidegree<=PHIBIN[0] ) phiIdx=idx;
-	}
-	phiIdx=phiIdx+1;
-	if( phiIdx==18 ) phiIdx=0;
-	return int( phiIdx );
+	if( phidegree>=PHIBIN[PHIBINS-1] || phidegree<=PHIBIN[0] ) return 0;
+	else if( phidegree!=phidegree ) return 1; // NaN isn't in any bin, but has always ended up in bin 1
+	return std::upper_bound( PHIBIN, PHIBIN+PHIBINS, phidegree )-PHIBIN;
 }
 
 int l1menu::FullSamplePrivateMembers::etaINjetCoord( double eta )
 {
-	size_t etaIdx=0.;
-	for( size_t idx=0; idx<ETABINS; idx++ )
-	{
-		if( eta>=ETABIN[idx] and eta<ETABIN[idx+1] ) etaIdx=idx;
-	}
-	return int( etaIdx );
+	// Anything outside the bins goes in bin 0
+	if( !(eta>=ETABIN[0] && eta<ETABIN[ETABINS-1]) ) return 0;
+	return std::upper_bound( ETABIN, ETABIN+ETABINS, eta )-ETABIN-1;
 }
 
 double l1menu::FullSamplePrivateMembers::calculateHTT( const L1Analysis::L1AnalysisDataFormat& event )
@@ -147,9 +327,18 @@ double l1menu::FullSamplePrivateMembers::calculateHTM( const L1Analysis::L1Analy
 			{
 
 				//  Get the phi angle  towers are 0-17 (this is probably not real mapping but OK for just magnitude of HTM
-				float phi=2*M_PI*(event.Phijet.at( i )/18.);
-				htmValueX+=cos( phi )*event.Etjet.at( i );
-				htmValueY+=sin( phi )*event.Etjet.at( i );
+				const int phiBin=static_cast<int>( event.Phijet.at( i ) );
+				if( phiBin>=0 && phiBin<18 && phiBin==event.Phijet.at( i ) )
+				{
+					htmValueX+=cosineOfPhiBin[phiBin]*event.Etjet.at( i );
+					htmValueY+=sineOfPhiBin[phiBin]*event.Etjet.at( i );
+				}
+				else
+				{
+					float phi=2*M_PI*(event.Phijet.at( i )/18.);
+					htmValueX+=cos( phi )*event.Etjet.at( i );
+					htmValueY+=sin( phi )*event.Etjet.at( i );
+				}
 
 			} //in proper eta range
 		} //correct beam crossing
@@ -160,15 +349,15 @@ double l1menu::FullSamplePrivateMembers::calculateHTM( const L1Analysis::L1Analy
 	return htmValue;
 }
 
-void l1menu::FullSamplePrivateMembers::fillDataStructure( int selectDataInput )
+void l1menu::FullSamplePrivateMembers::fillDataStructure( l1menu::L1TriggerDPGEvent& event, int selectDataInput )
 {
 	// Use a reference for ease of use
-	L1Analysis::L1AnalysisDataFormat& analysisDataFormat=currentEvent.rawEvent();
+	L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
 
 	analysisDataFormat.Reset();
 
 	// Grab standard event information
-	currentEvent.setWeight( inputNtuple.event_->puWeight );
+	event.setWeight( inputNtuple.event_->puWeight );
 	analysisDataFormat.Run=inputNtuple.event_->run;
 	analysisDataFormat.LS=inputNtuple.event_->lumi;
 	analysisDataFormat.Event=inputNtuple.event_->event;
@@ -191,80 +380,77 @@ void l1menu::FullSamplePrivateMembers::fillDataStructure( int selectDataInput )
 	switch( selectDataInput )
 	{
 		case 22:  //Select from L1ExtraUpgradeTree (Stage 2)
+		{
+			const L1Analysis::L1AnalysisL1ExtraUpgradeDataFormat& upgrade=*inputNtuple.l1upgrade_;
+
+			// Reset() doesn't free the memory, so once these are big enough for the busiest
+			// event there's no more allocation.
+			analysisDataFormat.Bxel.reserve( upgrade.nEG );
+			analysisDataFormat.Etel.reserve( upgrade.nEG );
+			analysisDataFormat.Phiel.reserve( upgrade.nEG );
+			analysisDataFormat.Etael.reserve( upgrade.nEG );
+			analysisDataFormat.Isoel.reserve( upgrade.nEG );
+			const size_t maximumNumberOfJets=upgrade.nJets+upgrade.nFwdJets+upgrade.nTau;
+			analysisDataFormat.Bxjet.reserve( maximumNumberOfJets );
+			analysisDataFormat.Etjet.reserve( maximumNumberOfJets );
+			analysisDataFormat.Phijet.reserve( maximumNumberOfJets );
+			analysisDataFormat.Etajet.reserve( maximumNumberOfJets );
+			analysisDataFormat.Taujet.reserve( maximumNumberOfJets );
+			analysisDataFormat.isoTaujet.reserve( maximumNumberOfJets );
+			analysisDataFormat.Fwdjet.reserve( maximumNumberOfJets );
 
 			// NOTES:  Stage 1 has EG Relaxed and EG Isolated.  The isolated EG are a subset of the Relaxed.
 			//         so sort through the relaxed list and flag those that also appear in the isolated list.
-			for( unsigned int i=0; i<inputNtuple.l1upgrade_->nEG; i++ )
+			isolationMatcher.clear( upgrade.nIsoEG );
+			for( unsigned int isoEG=0; isoEG<upgrade.nIsoEG; isoEG++ ) isolationMatcher.insert( upgrade.isoEGPhi.at( isoEG ), upgrade.isoEGEta.at( isoEG ) );
+
+			for( unsigned int i=0; i<upgrade.nEG; i++ )
 			{
 
-				analysisDataFormat.Bxel.push_back( inputNtuple.l1upgrade_->egBx.at( i ) );
-				analysisDataFormat.Etel.push_back( inputNtuple.l1upgrade_->egEt.at( i ) );
-				analysisDataFormat.Phiel.push_back( phiINjetCoord( inputNtuple.l1upgrade_->egPhi.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with phiINjetCoord
-				analysisDataFormat.Etael.push_back( etaINjetCoord( inputNtuple.l1upgrade_->egEta.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with etaINjetCoord
+				analysisDataFormat.Bxel.push_back( upgrade.egBx.at( i ) );
+				analysisDataFormat.Etel.push_back( upgrade.egEt.at( i ) );
+				analysisDataFormat.Phiel.push_back( phiINjetCoord( upgrade.egPhi.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with phiINjetCoord
+				analysisDataFormat.Etael.push_back( etaINjetCoord( upgrade.egEta.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with etaINjetCoord
 
 				// Check whether this EG is located in the isolation list
-				bool isolated=false;
-				bool fnd=false;
-				unsigned int isoEG=0;
-				while( !fnd && isoEG < inputNtuple.l1upgrade_->nIsoEG )
-				{
-					if( inputNtuple.l1upgrade_->isoEGPhi.at( isoEG )==inputNtuple.l1upgrade_->egPhi.at( i )
-							&& inputNtuple.l1upgrade_->isoEGEta.at( isoEG )==inputNtuple.l1upgrade_->egEta.at( i ) )
-					{
-						isolated=true;
-						fnd=true;
-					}
-					isoEG++;
-				}
-				analysisDataFormat.Isoel.push_back( isolated );
+				analysisDataFormat.Isoel.push_back( isolationMatcher.contains( upgrade.egPhi.at( i ), upgrade.egEta.at( i ) ) );
 				analysisDataFormat.Nele++;
 			}
 
 			// Note:  Taus are in the jet list.  Decide what to do with them. For now
 			//  leave them the there as jets (not even flagged..)
-			for( unsigned int i=0; i<inputNtuple.l1upgrade_->nJets; i++ )
+			duplicateMatcher.clear( upgrade.nJets );
+			for( unsigned int i=0; i<upgrade.nJets; i++ )
 			{
 
 				// For each jet look for a possible duplicate if so remove it.
-				bool duplicate=false;
-				for( unsigned int j=0; j<i; j++ )
-				{
-					if( inputNtuple.l1upgrade_->jetBx.at( i )==inputNtuple.l1upgrade_->jetBx.at( j )
-							&& inputNtuple.l1upgrade_->jetEt.at( i )==inputNtuple.l1upgrade_->jetEt.at( j )
-							&& inputNtuple.l1upgrade_->jetEta.at( i )==inputNtuple.l1upgrade_->jetEta.at( j )
-							&& inputNtuple.l1upgrade_->jetPhi.at( i )==inputNtuple.l1upgrade_->jetPhi.at( j ) )
-					{
-						duplicate=true;
-						//printf("Duplicate jet found and removed \n");
-					}
-				}
+				const bool duplicate=!duplicateMatcher.insert( upgrade.jetBx.at( i ), upgrade.jetEt.at( i ), upgrade.jetEta.at( i ), upgrade.jetPhi.at( i ) );
 
 				if( !duplicate )
 				{
-					analysisDataFormat.Bxjet.push_back( inputNtuple.l1upgrade_->jetBx.at( i ) );
-					analysisDataFormat.Etjet.push_back( inputNtuple.l1upgrade_->jetEt.at( i ) );
-					analysisDataFormat.Phijet.push_back( phiINjetCoord( inputNtuple.l1upgrade_->jetPhi.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with phiINjetCoord
-					analysisDataFormat.Etajet.push_back( etaINjetCoord( inputNtuple.l1upgrade_->jetEta.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with etaINjetCoord
+					analysisDataFormat.Bxjet.push_back( upgrade.jetBx.at( i ) );
+					analysisDataFormat.Etjet.push_back( upgrade.jetEt.at( i ) );
+					analysisDataFormat.Phijet.push_back( phiINjetCoord( upgrade.jetPhi.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with phiINjetCoord
+					analysisDataFormat.Etajet.push_back( etaINjetCoord( upgrade.jetEta.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with etaINjetCoord
 					analysisDataFormat.Taujet.push_back( false );
 					analysisDataFormat.isoTaujet.push_back( false );
 					//analysisDataFormat.Fwdjet.push_back(false); //COMMENT OUT IF JET ETA FIX
 
-					//if(fabs(inputNtuple.l1upgrade_->jetEta.at(i))>=3.0) printf("Et %f  Eta  %f  iEta  %f Phi %f  iPhi  %f \n",analysisDataFormat.Etjet.at(analysisDataFormat.Njet),inputNtuple.l1upgrade_->jetEta.at(i),analysisDataFormat.Etajet.at(analysisDataFormat.Njet),inputNtuple.l1upgrade_->jetPhi.at(i),analysisDataFormat.Phijet.at(analysisDataFormat.Njet));
 					//  Eta Jet Fix.  Some Jets with eta>3 has appeared in central jet list.  Move them by hand
 					//  This is a problem in Stage 2 Jet code.
-					(fabs( inputNtuple.l1upgrade_->jetEta.at( i ) )>=3.0) ? analysisDataFormat.Fwdjet.push_back( true ) : analysisDataFormat.Fwdjet.push_back( false );
+					(fabs( upgrade.jetEta.at( i ) )>=3.0) ? analysisDataFormat.Fwdjet.push_back( true ) : analysisDataFormat.Fwdjet.push_back( false );
 
 					analysisDataFormat.Njet++;
 				}
 			}
 
-			for( unsigned int i=0; i<inputNtuple.l1upgrade_->nFwdJets; i++ )
+			for( unsigned int i=0; i<upgrade.nFwdJets; i++ )
 			{
 
-				analysisDataFormat.Bxjet.push_back( inputNtuple.l1upgrade_->fwdJetBx.at( i ) );
-				analysisDataFormat.Etjet.push_back( inputNtuple.l1upgrade_->fwdJetEt.at( i ) );
-				analysisDataFormat.Phijet.push_back( phiINjetCoord( inputNtuple.l1upgrade_->fwdJetPhi.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with phiINjetCoord
-				analysisDataFormat.Etajet.push_back( etaINjetCoord( inputNtuple.l1upgrade_->fwdJetEta.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with etaINjetCoord
+				analysisDataFormat.Bxjet.push_back( upgrade.fwdJetBx.at( i ) );
+				analysisDataFormat.Etjet.push_back( upgrade.fwdJetEt.at( i ) );
+				analysisDataFormat.Phijet.push_back( phiINjetCoord( upgrade.fwdJetPhi.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with phiINjetCoord
+				analysisDataFormat.Etajet.push_back( etaINjetCoord( upgrade.fwdJetEta.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with etaINjetCoord
 				analysisDataFormat.Taujet.push_back( false );
 				analysisDataFormat.isoTaujet.push_back( false );
 				analysisDataFormat.Fwdjet.push_back( true );
@@ -274,66 +460,44 @@ void l1menu::FullSamplePrivateMembers::fillDataStructure( int selectDataInput )
 
 			// NOTES:  Stage 1 has Tau Relaxed and TauIsolated.  The isolated Tau are a subset of the Relaxed.
 			//         so sort through the relaxed list and flag those that also appear in the isolated list.
+			isolationMatcher.clear( upgrade.nIsoTau );
+			for( unsigned int isoTau=0; isoTau<upgrade.nIsoTau; isoTau++ ) isolationMatcher.insert( upgrade.isoTauPhi.at( isoTau ), upgrade.isoTauEta.at( isoTau ) );
 
-			for( unsigned int i=0; i<inputNtuple.l1upgrade_->nTau; i++ )
+			duplicateMatcher.clear( upgrade.nTau );
+			for( unsigned int i=0; i<upgrade.nTau; i++ )
 			{
 
 				// remove duplicates
-				bool duplicate=false;
-				for( unsigned int j=0; j<i; j++ )
-				{
-					if( inputNtuple.l1upgrade_->tauBx.at( i )==inputNtuple.l1upgrade_->tauBx.at( j )
-							&& inputNtuple.l1upgrade_->tauEt.at( i )==inputNtuple.l1upgrade_->tauEt.at( j )
-							&& inputNtuple.l1upgrade_->tauEta.at( i )==inputNtuple.l1upgrade_->tauEta.at( j )
-							&& inputNtuple.l1upgrade_->tauPhi.at( i )==inputNtuple.l1upgrade_->tauPhi.at( j ) )
-					{
-						duplicate=true;
-						//printf("Duplicate jet found and removed \n");
-					}
-				}
+				const bool duplicate=!duplicateMatcher.insert( upgrade.tauBx.at( i ), upgrade.tauEt.at( i ), upgrade.tauEta.at( i ), upgrade.tauPhi.at( i ) );
 
 				if( !duplicate )
 				{
-					analysisDataFormat.Bxjet.push_back( inputNtuple.l1upgrade_->tauBx.at( i ) );
-					analysisDataFormat.Etjet.push_back( inputNtuple.l1upgrade_->tauEt.at( i ) );
-					analysisDataFormat.Phijet.push_back( phiINjetCoord( inputNtuple.l1upgrade_->tauPhi.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with phiINjetCoord
-					analysisDataFormat.Etajet.push_back( etaINjetCoord( inputNtuple.l1upgrade_->tauEta.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with etaINjetCoord
+					analysisDataFormat.Bxjet.push_back( upgrade.tauBx.at( i ) );
+					analysisDataFormat.Etjet.push_back( upgrade.tauEt.at( i ) );
+					analysisDataFormat.Phijet.push_back( phiINjetCoord( upgrade.tauPhi.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with phiINjetCoord
+					analysisDataFormat.Etajet.push_back( etaINjetCoord( upgrade.tauEta.at( i ) ) ); //PROBLEM: real value, trigger wants bin convert with etaINjetCoord
 					analysisDataFormat.Taujet.push_back( true );
 					analysisDataFormat.Fwdjet.push_back( false );
-
-					bool isolated=false;
-					bool fnd=false;
-					unsigned int isoTau=0;
-					while( !fnd && isoTau < inputNtuple.l1upgrade_->nIsoTau )
-					{
-						if( inputNtuple.l1upgrade_->isoTauPhi.at( isoTau )==inputNtuple.l1upgrade_->tauPhi.at( i )
-								&& inputNtuple.l1upgrade_->isoTauEta.at( isoTau )==inputNtuple.l1upgrade_->tauEta.at( i ) )
-						{
-							isolated=true;
-							fnd=true;
-						}
-						isoTau++;
-					}
-					analysisDataFormat.isoTaujet.push_back( isolated );
+					analysisDataFormat.isoTaujet.push_back( isolationMatcher.contains( upgrade.tauPhi.at( i ), upgrade.tauEta.at( i ) ) );
 
 					analysisDataFormat.Njet++;
 				} // duplicate check
 			}
 
 			// Fill energy sums  (Are overflow flags accessible in l1extra?)
-			for( unsigned int i=0; i<inputNtuple.l1upgrade_->nMet; i++ )
+			for( unsigned int i=0; i<upgrade.nMet; i++ )
 			{
 				//if(inputNtuple.l1upgrade_->metBx.at(i)==0) {
-				analysisDataFormat.ETT=inputNtuple.l1upgrade_->et.at( i );
-				analysisDataFormat.ETM=inputNtuple.l1upgrade_->met.at( i );
-				analysisDataFormat.PhiETM=inputNtuple.l1upgrade_->metPhi.at( i );
+				analysisDataFormat.ETT=upgrade.et.at( i );
+				analysisDataFormat.ETM=upgrade.met.at( i );
+				analysisDataFormat.PhiETM=upgrade.metPhi.at( i );
 			}
 			analysisDataFormat.OvETT=0; //not available in l1extra
 			analysisDataFormat.OvETM=0; //not available in l1extra
 
-			for( unsigned int i=0; i<inputNtuple.l1upgrade_->nMht; i++ )
+			for( unsigned int i=0; i<upgrade.nMht; i++ )
 			{
-				if( inputNtuple.l1upgrade_->mhtBx.at( i )==0 )
+				if( upgrade.mhtBx.at( i )==0 )
 				{
 					analysisDataFormat.HTT=calculateHTT( analysisDataFormat ); //inputNtuple.l1upgrade_->ht.at(i) ;
 					analysisDataFormat.HTM=calculateHTM( analysisDataFormat ); //inputNtuple.l1upgrade_->mht.at(i) ;
@@ -344,6 +508,12 @@ void l1menu::FullSamplePrivateMembers::fillDataStructure( int selectDataInput )
 			analysisDataFormat.OvHTT=0; //not available in l1extra
 
 			// Get the muon information  from reEmul GMT
+			analysisDataFormat.Bxmu.reserve( inputNtuple.gmtEmu_->N );
+			analysisDataFormat.Ptmu.reserve( inputNtuple.gmtEmu_->N );
+			analysisDataFormat.Phimu.reserve( inputNtuple.gmtEmu_->N );
+			analysisDataFormat.Etamu.reserve( inputNtuple.gmtEmu_->N );
+			analysisDataFormat.Qualmu.reserve( inputNtuple.gmtEmu_->N );
+			analysisDataFormat.Isomu.reserve( inputNtuple.gmtEmu_->N );
 			for( int i=0; i<inputNtuple.gmtEmu_->N; i++ )
 			{
 
@@ -355,7 +525,7 @@ void l1menu::FullSamplePrivateMembers::fillDataStructure( int selectDataInput )
 				analysisDataFormat.Isomu.push_back( false );
 				analysisDataFormat.Nmu++;
 			}
-
+		}
 		break;
 
 		default:
@@ -367,9 +537,9 @@ void l1menu::FullSamplePrivateMembers::fillDataStructure( int selectDataInput )
 	return;
 }
 
-void l1menu::FullSamplePrivateMembers::fillL1Bits()
+void l1menu::FullSamplePrivateMembers::fillL1Bits( l1menu::L1TriggerDPGEvent& event )
 {
-	bool* PhysicsBits=currentEvent.physicsBits();
+	bool* PhysicsBits=event.physicsBits();
 
 	// I really don't think this if statement is correct. Surely it
 	// should be "if( inputNtuple.gt_ )"? - M. Grimes.
@@ -394,6 +564,61 @@ void l1menu::FullSamplePrivateMembers::fillL1Bits()
 	}
 }
 
+void l1menu::FullSamplePrivateMembers::readEvent( size_t eventNumber, l1menu::L1TriggerDPGEvent& event )
+{
+	l1menu::tools::Profiler& profiler=l1menu::tools::Profiler::instance();
+	{
+		l1menu::tools::Profiler::ScopedTimer timer( profiler.getEntryNanoseconds() );
+		// GetEntry loads the right tree in the chain itself, so there's no need to call LoadTree first
+		inputNtuple.GetEntry(eventNumber);
+	}
+	{
+		l1menu::tools::Profiler::ScopedTimer timer( profiler.fillDataStructureNanoseconds() );
+		// This next call fills the event with the information in inputNtuple
+		fillDataStructure( event, 22 );
+		fillL1Bits( event );
+	}
+}
+
+double l1menu::FullSamplePrivateMembers::calculateSumOfWeights()
+{
+	// If some of the files couldn't be added to the chain then the entries can't be matched
+	// up to the files, so there's no choice but to add everything up.
+	if( weightsCacheFilename.empty() || inputNtuple.GetFirstEntryOfFile(0)<0 ) return inputNtuple.SumOfEventWeights( 0, inputNtuple.GetEntries() );
+
+	const std::vector<std::string>& filenames=inputNtuple.GetNtupleFilenames();
+	std::map<std::string,FileWeights> fileWeights=loadFileWeights( weightsCacheFilename );
+	bool cacheChanged=false;
+	double sum=0;
+
+	for( size_t fileNumber=0; fileNumber<filenames.size(); ++fileNumber )
+	{
+		const long long firstEntry=inputNtuple.GetFirstEntryOfFile( fileNumber );
+		const long long numberOfEntries=inputNtuple.GetFirstEntryOfFile( fileNumber+1 )-firstEntry;
+		const long long fileModificationTime=modificationTime( filenames[fileNumber] );
+
+		const auto iFindResult=fileWeights.find( filenames[fileNumber] );
+		if( fileModificationTime>=0 && iFindResult!=fileWeights.end()
+				&& iFindResult->second.modificationTime==fileModificationTime && iFindResult->second.numberOfEntries==numberOfEntries )
+		{
+			sum+=iFindResult->second.sumOfWeights;
+		}
+		else
+		{
+			const double fileSumOfWeights=inputNtuple.SumOfEventWeights( firstEntry, firstEntry+numberOfEntries );
+			sum+=fileSumOfWeights;
+			// Files without a modification time can't be checked for changes later, so don't get cached
+			if( fileModificationTime>=0 )
+			{
+				fileWeights[filenames[fileNumber]]=FileWeights{ fileModificationTime, numberOfEntries, fileSumOfWeights };
+				cacheChanged=true;
+			}
+		}
+	}
+
+	if( cacheChanged ) saveFileWeights( weightsCacheFilename, fileWeights );
+	return sum;
+}
 
 l1menu::FullSample::FullSample()
 	: pImple_( new FullSamplePrivateMembers( this ) )
@@ -434,13 +659,21 @@ l1menu::FullSample& l1menu::FullSample::operator=( l1menu::FullSample&& otherFul
 void l1menu::FullSample::loadFile( const std::string& filename )
 {
 	pImple_->sumOfWeights=-1;
+	pImple_->weightsCacheFilename=filename+".sumOfWeights";
+	pImple_->currentEventNumber=l1menu::FullSamplePrivateMembers::noEventNumber;
 	pImple_->inputNtuple.Open( filename );
+	// Only 22 (Stage 2 quantities from L1ExtraUpgradeTree) is used in fillDataStructure, so there's no point reading anything else
+	pImple_->inputNtuple.ActivateOnlyRequiredBranches( 22 );
 }
 
 void l1menu::FullSample::loadFilesFromList( const std::string& filenameOfList )
 {
 	pImple_->sumOfWeights=-1;
+	pImple_->weightsCacheFilename=filenameOfList+".sumOfWeights";
+	pImple_->currentEventNumber=l1menu::FullSamplePrivateMembers::noEventNumber;
 	pImple_->inputNtuple.OpenWithList( filenameOfList );
+	// Only 22 (Stage 2 quantities from L1ExtraUpgradeTree) is used in fillDataStructure, so there's no point reading anything else
+	pImple_->inputNtuple.ActivateOnlyRequiredBranches( 22 );
 }
 
 const l1menu::L1TriggerDPGEvent& l1menu::FullSample::getFullEvent( size_t eventNumber ) const
@@ -449,15 +682,189 @@ const l1menu::L1TriggerDPGEvent& l1menu::FullSample::getFullEvent( size_t eventN
 	// of the "comparison between signed and unsigned" compiler warning.
 	if( eventNumber>static_cast<size_t>(pImple_->inputNtuple.GetEntries()) ) throw std::runtime_error( "Requested event number is out of range" );
 
-	pImple_->inputNtuple.LoadTree(eventNumber);
-	pImple_->inputNtuple.GetEntry(eventNumber);
-	// This next call fills pImple_->currentEvent with the information in pImple_->inputNtuple
-	pImple_->fillDataStructure( 22 );
-	pImple_->fillL1Bits();
+	// Don't read the same event again if it's asked for several times in a row, so that neither the
+	// conversion nor its triggerObjects() are redone.
+	if( eventNumber!=pImple_->currentEventNumber )
+	{
+		pImple_->currentEventNumber=l1menu::FullSamplePrivateMembers::noEventNumber; // In case readEvent throws
+		pImple_->readEvent( eventNumber, pImple_->currentEvent );
+		pImple_->currentEventNumber=eventNumber;
+	}
 
 	return pImple_->currentEvent;
 }
 
+void l1menu::FullSample::forEachFullEvent( size_t firstEventNumber, size_t lastEventNumber, const std::function<void(const l1menu::L1TriggerDPGEvent&)>& function ) const
+{
+	if( lastEventNumber>numberOfEvents() || firstEventNumber>lastEventNumber ) throw std::runtime_error( "FullSample::forEachFullEvent - the range of events requested is not in the sample" );
+	if( firstEventNumber==lastEventNumber ) return;
+
+	// The ring buffer. The background thread fills events in order and the calling thread uses them
+	// in order. Event number N always goes in slot N%bufferSize, and the background thread only fills
+	// a slot once the calling thread has finished with the event that was in it before.
+	const size_t bufferSize=16;
+	std::vector<l1menu::L1TriggerDPGEvent> buffer( bufferSize, pImple_->currentEvent );
+	size_t nextEventToFill=firstEventNumber;
+	size_t nextEventToUse=firstEventNumber;
+	bool stopFilling=false;
+	std::exception_ptr pFillException;
+	std::mutex mutex;
+	std::condition_variable eventFilled;
+	std::condition_variable eventUsed;
+
+	std::thread fillThread( [&]()
+	{
+		try
+		{
+			for( size_t eventNumber=firstEventNumber; eventNumber<lastEventNumber; ++eventNumber )
+			{
+				{
+					std::unique_lock<std::mutex> lock( mutex );
+					eventUsed.wait( lock, [&]{ return stopFilling || eventNumber<nextEventToUse+bufferSize; } );
+					if( stopFilling ) return;
+				}
+				// No lock needed while decoding, because the calling thread won't touch this slot until nextEventToFill changes
+				pImple_->readEvent( eventNumber, buffer[eventNumber%bufferSize] );
+				// Sort the objects for the triggers here as well, rather than in the calling thread
+				buffer[eventNumber%bufferSize].triggerObjects();
+				{
+					std::lock_guard<std::mutex> lock( mutex );
+					nextEventToFill=eventNumber+1;
+				}
+				eventFilled.notify_one();
+			}
+		}
+		catch( ... )
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			pFillException=std::current_exception();
+			eventFilled.notify_one();
+		}
+	} );
+
+	// Make sure the background thread is always stopped and joined, even if the function throws
+	auto stopThread=[&]()
+	{
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			stopFilling=true;
+		}
+		eventUsed.notify_one();
+		fillThread.join();
+	};
+
+	try
+	{
+		for( size_t eventNumber=firstEventNumber; eventNumber<lastEventNumber; ++eventNumber )
+		{
+			{
+				std::unique_lock<std::mutex> lock( mutex );
+				eventFilled.wait( lock, [&]{ return pFillException || eventNumber<nextEventToFill; } );
+				if( eventNumber>=nextEventToFill ) break; // Decoding failed, so there are no more events
+			}
+			function( buffer[eventNumber%bufferSize] );
+			{
+				std::lock_guard<std::mutex> lock( mutex );
+				nextEventToUse=eventNumber+1;
+			}
+			eventUsed.notify_one();
+		}
+	}
+	catch( ... )
+	{
+		stopThread();
+		throw;
+	}
+	stopThread();
+
+	if( pFillException ) std::rethrow_exception( pFillException );
+}
+
+void l1menu::FullSample::setNumberOfThreads( size_t numberOfThreads )
+{
+	pImple_->numberOfThreads=numberOfThreads;
+}
+
+size_t l1menu::FullSample::numberOfThreads() const
+{
+	if( pImple_->numberOfThreads==0 ) return l1menu::tools::defaultNumberOfThreads();
+	else return pImple_->numberOfThreads;
+}
+
+void l1menu::FullSample::forEachFullEventInParallel( const std::function<void(size_t,const l1menu::L1TriggerDPGEvent&)>& function ) const
+{
+	const size_t numberOfWorkers=numberOfThreads();
+	const std::vector<std::string>& filenames=pImple_->inputNtuple.GetNtupleFilenames();
+
+	if( numberOfWorkers<=1 || filenames.empty() )
+	{
+		forEachFullEvent( 0, numberOfEvents(), [&]( const l1menu::L1TriggerDPGEvent& event ){ function( 0, event ); } );
+		return;
+	}
+
+	// Split the events into blocks that are each in a single file, which the threads take in turn.
+	// If there are fewer files than threads the files are split up too, so that every thread has
+	// something to do. If the number of entries in each file isn't known each file is one block.
+	std::vector<InputBlock> blocks;
+	const long long partsPerFile=( numberOfWorkers+filenames.size()-1 )/filenames.size();
+	for( size_t fileNumber=0; fileNumber<filenames.size(); ++fileNumber )
+	{
+		const long long firstEntry=pImple_->inputNtuple.GetFirstEntryOfFile( fileNumber );
+		const long long numberOfEntries=pImple_->inputNtuple.GetFirstEntryOfFile( fileNumber+1 )-firstEntry;
+		if( firstEntry<0 ) blocks.push_back( InputBlock{ fileNumber, 0, -1 } );
+		else
+		{
+			for( long long part=0; part<partsPerFile; ++part ) blocks.push_back( InputBlock{ fileNumber, numberOfEntries*part/partsPerFile, numberOfEntries*(part+1)/partsPerFile } );
+		}
+	}
+
+	// Makes ROOT lock its global state, so that several files can be read at once
+	TThread::Initialize();
+
+	std::atomic<size_t> nextBlock(0);
+	std::atomic<bool> failed(false);
+	l1menu::tools::parallelFor( numberOfWorkers, numberOfWorkers, [&]( size_t threadNumber )
+	{
+		try
+		{
+			for( size_t blockNumber=nextBlock++; blockNumber<blocks.size() && !failed; blockNumber=nextBlock++ )
+			{
+				const InputBlock& block=blocks[blockNumber];
+
+				// Each block gets its own copy of the ntuple and its own event. These aren't shared
+				// with pImple_, so the thread can read without locking anything.
+				std::unique_ptr<FullSamplePrivateMembers,std::function<void(FullSamplePrivateMembers*)>> pReader( nullptr, []( FullSamplePrivateMembers* pReaderToDelete )
+				{
+					std::lock_guard<std::mutex> lock( rootFileMutex );
+					delete pReaderToDelete;
+				} );
+				{
+					std::lock_guard<std::mutex> lock( rootFileMutex );
+					pReader.reset( new FullSamplePrivateMembers( this ) );
+					pReader->inputNtuple.Open( filenames[block.fileNumber] );
+					pReader->inputNtuple.ActivateOnlyRequiredBranches( 22 );
+				}
+
+				const long long lastEntry=( block.lastEntry<0 ? pReader->inputNtuple.GetEntries() : block.lastEntry );
+				for( long long entry=block.firstEntry; entry<lastEntry && !failed; ++entry )
+				{
+					// Not readEvent, because the Profiler isn't thread safe
+					pReader->inputNtuple.GetEntry( entry );
+					pReader->fillDataStructure( pReader->currentEvent, 22 );
+					pReader->fillL1Bits( pReader->currentEvent );
+					function( threadNumber, pReader->currentEvent );
+				}
+			}
+		}
+		catch( ... )
+		{
+			// Stop the other threads early. parallelFor rethrows the exception once they've finished.
+			failed=true;
+			throw;
+		}
+	} );
+}
+
 size_t l1menu::FullSample::numberOfEvents() const
 {
 	return static_cast<size_t>( pImple_->inputNtuple.GetEntries() );
@@ -469,6 +876,11 @@ const l1menu::IEvent& l1menu::FullSample::getEvent( size_t eventNumber ) const
 	return getFullEvent( eventNumber );
 }
 
+void l1menu::FullSample::forEachEvent( size_t firstEventNumber, size_t lastEventNumber, const std::function<void(const l1menu::IEvent&)>& function ) const
+{
+	forEachFullEvent( firstEventNumber, lastEventNumber, function );
+}
+
 std::unique_ptr<l1menu::ICachedTrigger> l1menu::FullSample::createCachedTrigger( const l1menu::ITrigger& trigger ) const
 {
 	return std::unique_ptr<l1menu::ICachedTrigger>( new CachedTriggerImplementation(trigger) );
@@ -486,16 +898,7 @@ void l1menu::FullSample::setEventRate( float rate )
 
 float l1menu::FullSample::sumOfWeights() const
 {
-	if( pImple_->sumOfWeights==-1 )
-	{
-		pImple_->sumOfWeights=0;
-		for( int eventNumber=0; eventNumber<pImple_->inputNtuple.GetEntries(); ++eventNumber )
-		{
-			pImple_->inputNtuple.LoadTree(eventNumber);
-			pImple_->inputNtuple.GetEntry(eventNumber);
-			pImple_->sumOfWeights+=pImple_->inputNtuple.event_->puWeight;
-		}
-	}
+	if( pImple_->sumOfWeights==-1 ) pImple_->sumOfWeights=pImple_->calculateSumOfWeights();
 
 	return pImple_->sumOfWeights;
 }
@@ -1,6 +1,9 @@
 #include "l1menu/L1TriggerDPGEvent.h"
 
+#include <algorithm>
 #include "l1menu/ITrigger.h"
+#include "./implementation/TriggerObjects.h"
+#include "./implementation/DerivedQuantities.h"
 #include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
 
 namespace l1menu
@@ -8,8 +11,17 @@ namespace l1menu
 	class L1TriggerDPGEventPrivateMembers
 	{
 	public:
-		L1TriggerDPGEventPrivateMembers( const l1menu::ISample* pParentSample ) : pParentSample_(pParentSample) {}
+		L1TriggerDPGEventPrivateMembers( const l1menu::ISample* pParentSample ) : triggerObjectsAreValid(false), derivedQuantities(triggerObjects), pParentSample_(pParentSample) {}
+		L1TriggerDPGEventPrivateMembers( const L1TriggerDPGEventPrivateMembers& other )
+			: rawEvent(other.rawEvent), triggerObjects(other.triggerObjects), triggerObjectsAreValid(other.triggerObjectsAreValid),
+			  derivedQuantities(triggerObjects), weight(other.weight), pParentSample_(other.pParentSample_)
+		{
+			std::copy( other.physicsBits, other.physicsBits+128, physicsBits );
+		}
 		L1Analysis::L1AnalysisDataFormat rawEvent;
+		l1menu::implementation::TriggerObjects triggerObjects;
+		bool triggerObjectsAreValid; ///< @brief Set to false whenever rawEvent might have been changed
+		l1menu::implementation::DerivedQuantities derivedQuantities; ///< @brief Cleared whenever triggerObjects is filled, and never copied
 		bool physicsBits[128];
 		float weight;
 		const l1menu::ISample* pParentSample_;
@@ -51,6 +63,7 @@ l1menu::L1TriggerDPGEvent::~L1TriggerDPGEvent()
 
 L1Analysis::L1AnalysisDataFormat& l1menu::L1TriggerDPGEvent::rawEvent()
 {
+	pImple_->triggerObjectsAreValid=false;
 	return pImple_->rawEvent;
 }
 
@@ -59,6 +72,29 @@ const L1Analysis::L1AnalysisDataFormat& l1menu::L1TriggerDPGEvent::rawEvent() co
 	return pImple_->rawEvent;
 }
 
+const l1menu::implementation::TriggerObjects& l1menu::L1TriggerDPGEvent::triggerObjects() const
+{
+	if( !pImple_->triggerObjectsAreValid )
+	{
+		pImple_->triggerObjects.fill( pImple_->rawEvent );
+		pImple_->derivedQuantities.clear();
+		pImple_->triggerObjectsAreValid=true;
+	}
+	return pImple_->triggerObjects;
+}
+
+l1menu::implementation::DerivedQuantities& l1menu::L1TriggerDPGEvent::derivedQuantities() const
+{
+	// Same as triggerObjects(), without going through the virtual call since this is used so often
+	if( !pImple_->triggerObjectsAreValid )
+	{
+		pImple_->triggerObjects.fill( pImple_->rawEvent );
+		pImple_->derivedQuantities.clear();
+		pImple_->triggerObjectsAreValid=true;
+	}
+	return pImple_->derivedQuantities;
+}
+
 bool* l1menu::L1TriggerDPGEvent::physicsBits()
 {
 	return pImple_->physicsBits;
@@ -0,0 +1,478 @@
+#include "l1menu/ObjectCacheSample.h"
+
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "l1menu/FullSample.h"
+#include "l1menu/L1TriggerDPGEvent.h"
+#include "l1menu/ITrigger.h"
+#include "l1menu/ICachedTrigger.h"
+#include "l1menu/IMenuRate.h"
+#include "./implementation/MenuRateImplementation.h"
+#include "./implementation/ReducedSampleFileFormat.h"
+#include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
+
+namespace // unnamed namespace
+{
+	const std::string OBJECT_CACHE_MAGIC_NUMBER="l1menuL1ObjectCache";
+	const char OBJECT_CACHE_FILE_FORMAT_VERSION=1;
+	/// @brief Written in the header so that a file written on a machine with a different byte order is spotted
+	const uint32_t BYTE_ORDER_MARK=0x01020304;
+	/// @brief The magic number and version are padded to this size so that everything after is aligned
+	const size_t PREAMBLE_SIZE=24;
+
+	// The object values are stored as floats and ints, so L1AnalysisDataFormat has to use the same types
+	// or the events wouldn't come back exactly as the FullSample made them.
+	typedef L1Analysis::L1AnalysisDataFormat DataFormat;
+	static_assert( std::is_same<decltype(DataFormat::Etel)::value_type,float>::value && std::is_same<decltype(DataFormat::Etael)::value_type,float>::value
+			&& std::is_same<decltype(DataFormat::Phiel)::value_type,float>::value && std::is_same<decltype(DataFormat::Bxel)::value_type,int>::value
+			&& std::is_same<decltype(DataFormat::Etjet)::value_type,float>::value && std::is_same<decltype(DataFormat::Etajet)::value_type,float>::value
+			&& std::is_same<decltype(DataFormat::Phijet)::value_type,float>::value && std::is_same<decltype(DataFormat::Bxjet)::value_type,int>::value
+			&& std::is_same<decltype(DataFormat::Ptmu)::value_type,float>::value && std::is_same<decltype(DataFormat::Etamu)::value_type,float>::value
+			&& std::is_same<decltype(DataFormat::Phimu)::value_type,float>::value && std::is_same<decltype(DataFormat::Bxmu)::value_type,int>::value
+			&& std::is_same<decltype(DataFormat::Qualmu)::value_type,int>::value
+			&& std::is_same<decltype(DataFormat::ETT),float>::value && std::is_same<decltype(DataFormat::ETM),float>::value
+			&& std::is_same<decltype(DataFormat::HTT),float>::value && std::is_same<decltype(DataFormat::HTM),float>::value
+			&& std::is_same<decltype(DataFormat::PhiETM),float>::value && std::is_same<decltype(DataFormat::PhiHTM),float>::value,
+			"ObjectCacheSample needs updating for the types in L1AnalysisDataFormat" );
+
+	/** @brief The columns in the file, in the order they're written. */
+	enum Column
+	{
+		RUN, LUMI_SECTION, EVENT, WEIGHT, // One entry per event
+		ETT, ETM, PHI_ETM, HTT, HTM, PHI_HTM, SUM_FLAGS, // One entry per event
+		PHYSICS_BITS, // Two 64 bit words per event
+		EG_OFFSET, JET_OFFSET, MUON_OFFSET, // One entry per event, plus one at the end for the total
+		EG_ET, EG_ETA, EG_PHI, EG_BX, EG_FLAGS, // One entry per object
+		JET_ET, JET_ETA, JET_PHI, JET_BX, JET_FLAGS,
+		MUON_PT, MUON_ETA, MUON_PHI, MUON_BX, MUON_QUALITY, MUON_FLAGS,
+		NUMBER_OF_COLUMNS
+	};
+
+	/** @brief Bits in the SUM_FLAGS column. */
+	enum SumFlags { OVERFLOW_ETT=1, OVERFLOW_ETM=2, OVERFLOW_HTT=4, OVERFLOW_HTM=8 };
+	/** @brief Bits in the EG, jet and muon flags columns. */
+	enum ObjectFlags { ISOLATED=1, TAU=2, ISOLATED_TAU=4, FORWARD=8 };
+
+	/** @brief What follows the magic number and version. Written and read as raw memory. */
+	struct FileHeader
+	{
+		uint32_t byteOrderMark;
+		uint32_t numberOfColumns;
+		uint64_t numberOfEvents;
+		uint64_t numberOfEGs;
+		uint64_t numberOfJets;
+		uint64_t numberOfMuons;
+		double sumOfWeights;
+	};
+
+	/** @brief Where each column is, which follows the FileHeader in the file. */
+	struct ColumnLocation
+	{
+		uint64_t offset; ///< @brief From the start of the file. Always a multiple of 8.
+		uint64_t size; ///< @brief In bytes, not including the padding.
+	};
+
+	/** @brief The size in bytes a column should be for the numbers of events and objects in the header. */
+	uint64_t expectedColumnSize( size_t column, const FileHeader& header )
+	{
+		if( column<=WEIGHT ) return header.numberOfEvents*( column==WEIGHT ? sizeof(float) : sizeof(int64_t) );
+		else if( column<SUM_FLAGS ) return header.numberOfEvents*sizeof(float);
+		else if( column==SUM_FLAGS ) return header.numberOfEvents*sizeof(uint8_t);
+		else if( column==PHYSICS_BITS ) return header.numberOfEvents*2*sizeof(uint64_t);
+		else if( column<=MUON_OFFSET ) return (header.numberOfEvents+1)*sizeof(uint64_t);
+
+		uint64_t numberOfObjects;
+		if( column<JET_ET ) numberOfObjects=header.numberOfEGs;
+		else if( column<MUON_PT ) numberOfObjects=header.numberOfJets;
+		else numberOfObjects=header.numberOfMuons;
+
+		if( column==EG_FLAGS || column==JET_FLAGS || column==MUON_FLAGS ) return numberOfObjects*sizeof(uint8_t);
+		else if( column==EG_BX || column==JET_BX || column==MUON_BX || column==MUON_QUALITY ) return numberOfObjects*sizeof(int32_t);
+		else return numberOfObjects*sizeof(float);
+	}
+
+	/** @brief Writes one column to its own temporary file, so that all the columns can be written in one pass.
+	 *
+	 * The temporary file is deleted when this goes out of scope.
+	 */
+	class ColumnWriter
+	{
+	public:
+		ColumnWriter( const std::string& temporaryFilename ) : temporaryFilename_(temporaryFilename), output_(temporaryFilename,std::ios_base::binary), size_(0)
+		{
+			if( !output_.is_open() ) throw std::runtime_error( "ObjectCacheSample - couldn't open the temporary file "+temporaryFilename );
+		}
+		~ColumnWriter() { output_.close(); std::remove( temporaryFilename_.c_str() ); }
+		template<class T> void write( const T value )
+		{
+			output_.write( reinterpret_cast<const char*>(&value), sizeof(T) );
+			size_+=sizeof(T);
+		}
+		uint64_t size() const { return size_; }
+		/** @brief Copies everything written so far onto the end of the output. */
+		void copyTo( std::ostream& output )
+		{
+			output_.close();
+			if( !output_ ) throw std::runtime_error( "ObjectCacheSample - couldn't write the temporary file "+temporaryFilename_ );
+			std::ifstream input( temporaryFilename_, std::ios_base::binary );
+			if( size_>0 ) output << input.rdbuf();
+		}
+	private:
+		std::string temporaryFilename_;
+		std::ofstream output_;
+		uint64_t size_;
+	};
+
+	/** @brief Applies the trigger using the quantities shared by every trigger for the event, the same as the one for FullSample.
+	 */
+	class CachedTriggerImplementation : public l1menu::ICachedTrigger
+	{
+	public:
+		CachedTriggerImplementation( const l1menu::ITrigger& trigger ) : trigger_(trigger) {}
+		virtual bool apply( const l1menu::IEvent& event ) { return trigger_.applyUsingDerivedQuantities( static_cast<const l1menu::L1TriggerDPGEvent&>(event) ); }
+	protected:
+		const l1menu::ITrigger& trigger_;
+	}; // end of class CachedTriggerImplementation
+
+	/** @brief Does the work for both convert overloads.
+	 *
+	 * @param forEachEvent  Called with a function that has to be called for each event to save, in order.
+	 */
+	void writeObjectCache( const std::function<void(const std::function<void(const l1menu::L1TriggerDPGEvent&)>&)>& forEachEvent, double sumOfWeights, const std::string& filename )
+	{
+		std::vector<std::unique_ptr<ColumnWriter> > columns;
+		for( size_t columnNumber=0; columnNumber<NUMBER_OF_COLUMNS; ++columnNumber )
+		{
+			columns.push_back( std::unique_ptr<ColumnWriter>( new ColumnWriter( filename+".column"+std::to_string(columnNumber)+".tmp" ) ) );
+		}
+
+		FileHeader header={ BYTE_ORDER_MARK, NUMBER_OF_COLUMNS, 0, 0, 0, 0, sumOfWeights };
+		columns[EG_OFFSET]->write<uint64_t>( 0 );
+		columns[JET_OFFSET]->write<uint64_t>( 0 );
+		columns[MUON_OFFSET]->write<uint64_t>( 0 );
+
+		forEachEvent( [&]( const l1menu::L1TriggerDPGEvent& event )
+		{
+			const L1Analysis::L1AnalysisDataFormat& rawEvent=event.rawEvent();
+
+			columns[RUN]->write<int64_t>( rawEvent.Run );
+			columns[LUMI_SECTION]->write<int64_t>( rawEvent.LS );
+			columns[EVENT]->write<int64_t>( rawEvent.Event );
+			columns[WEIGHT]->write<float>( event.weight() );
+
+			columns[ETT]->write<float>( rawEvent.ETT );
+			columns[ETM]->write<float>( rawEvent.ETM );
+			columns[PHI_ETM]->write<float>( rawEvent.PhiETM );
+			columns[HTT]->write<float>( rawEvent.HTT );
+			columns[HTM]->write<float>( rawEvent.HTM );
+			columns[PHI_HTM]->write<float>( rawEvent.PhiHTM );
+			columns[SUM_FLAGS]->write<uint8_t>( (rawEvent.OvETT ? OVERFLOW_ETT : 0) | (rawEvent.OvETM ? OVERFLOW_ETM : 0) | (rawEvent.OvHTT ? OVERFLOW_HTT : 0) | (rawEvent.OvHTM ? OVERFLOW_HTM : 0) );
+
+			uint64_t physicsWords[2]={ 0, 0 };
+			for( size_t bit=0; bit<128; ++bit )
+			{
+				if( event.physicsBits()[bit] ) physicsWords[bit/64]|=( static_cast<uint64_t>(1)<<(bit%64) );
+			}
+			columns[PHYSICS_BITS]->write<uint64_t>( physicsWords[0] );
+			columns[PHYSICS_BITS]->write<uint64_t>( physicsWords[1] );
+
+			for( int index=0; index<rawEvent.Nele; ++index )
+			{
+				columns[EG_ET]->write<float>( rawEvent.Etel[index] );
+				columns[EG_ETA]->write<float>( rawEvent.Etael[index] );
+				columns[EG_PHI]->write<float>( rawEvent.Phiel[index] );
+				columns[EG_BX]->write<int32_t>( rawEvent.Bxel[index] );
+				columns[EG_FLAGS]->write<uint8_t>( rawEvent.Isoel[index] ? ISOLATED : 0 );
+			}
+			header.numberOfEGs+=rawEvent.Nele;
+			columns[EG_OFFSET]->write<uint64_t>( header.numberOfEGs );
+
+			for( int index=0; index<rawEvent.Njet; ++index )
+			{
+				columns[JET_ET]->write<float>( rawEvent.Etjet[index] );
+				columns[JET_ETA]->write<float>( rawEvent.Etajet[index] );
+				columns[JET_PHI]->write<float>( rawEvent.Phijet[index] );
+				columns[JET_BX]->write<int32_t>( rawEvent.Bxjet[index] );
+				columns[JET_FLAGS]->write<uint8_t>( (rawEvent.Taujet[index] ? TAU : 0) | (rawEvent.isoTaujet[index] ? ISOLATED_TAU : 0) | (rawEvent.Fwdjet[index] ? FORWARD : 0) );
+			}
+			header.numberOfJets+=rawEvent.Njet;
+			columns[JET_OFFSET]->write<uint64_t>( header.numberOfJets );
+
+			for( int index=0; index<rawEvent.Nmu; ++index )
+			{
+				columns[MUON_PT]->write<float>( rawEvent.Ptmu[index] );
+				columns[MUON_ETA]->write<float>( rawEvent.Etamu[index] );
+				columns[MUON_PHI]->write<float>( rawEvent.Phimu[index] );
+				columns[MUON_BX]->write<int32_t>( rawEvent.Bxmu[index] );
+				columns[MUON_QUALITY]->write<int32_t>( rawEvent.Qualmu[index] );
+				columns[MUON_FLAGS]->write<uint8_t>( rawEvent.Isomu[index] ? ISOLATED : 0 );
+			}
+			header.numberOfMuons+=rawEvent.Nmu;
+			columns[MUON_OFFSET]->write<uint64_t>( header.numberOfMuons );
+
+			++header.numberOfEvents;
+		} );
+
+		// Now that all the sizes are known, put the columns together into the final file
+		std::vector<ColumnLocation> columnLocations;
+		uint64_t nextOffset=PREAMBLE_SIZE+sizeof(FileHeader)+NUMBER_OF_COLUMNS*sizeof(ColumnLocation);
+		for( const auto& pColumn : columns )
+		{
+			columnLocations.push_back( ColumnLocation{ nextOffset, pColumn->size() } );
+			nextOffset+=( pColumn->size()+7 )/8*8;
+		}
+
+		std::ofstream outputFile( filename, std::ios_base::binary );
+		if( !outputFile.is_open() ) throw std::runtime_error( "ObjectCacheSample::convert - couldn't open the output file "+filename );
+
+		const char padding[8]={ 0 };
+		outputFile.write( OBJECT_CACHE_MAGIC_NUMBER.data(), OBJECT_CACHE_MAGIC_NUMBER.size() );
+		outputFile.put( OBJECT_CACHE_FILE_FORMAT_VERSION );
+		outputFile.write( padding, PREAMBLE_SIZE-OBJECT_CACHE_MAGIC_NUMBER.size()-1 );
+		outputFile.write( reinterpret_cast<const char*>(&header), sizeof(FileHeader) );
+		outputFile.write( reinterpret_cast<const char*>(columnLocations.data()), columnLocations.size()*sizeof(ColumnLocation) );
+		for( auto& pColumn : columns )
+		{
+			pColumn->copyTo( outputFile );
+			outputFile.write( padding, ( 8-pColumn->size()%8 )%8 );
+		}
+
+		outputFile.close();
+		if( !outputFile ) throw std::runtime_error( "ObjectCacheSample::convert - couldn't write the output file "+filename );
+	}
+
+} // end of the unnamed namespace
+
+namespace l1menu
+{
+	/** @brief Private members for the ObjectCacheSample class
+	 */
+	class ObjectCacheSamplePrivateMembers
+	{
+	public:
+		ObjectCacheSamplePrivateMembers( const l1menu::ObjectCacheSample& thisObject, const std::string& filename );
+		/** @brief Where the column starts in the memory mapped file. */
+		template<class T> const T* column( Column columnNumber ) const { return reinterpret_cast<const T*>( pMappedFile->data()+columnLocations[columnNumber].offset ); }
+		/** @brief Fills the event with everything stored for the given event number. */
+		void fillEvent( size_t eventNumber, l1menu::L1TriggerDPGEvent& event ) const;
+
+		std::unique_ptr<l1menu::implementation::MemoryMappedFile> pMappedFile;
+		FileHeader header;
+		std::vector<ColumnLocation> columnLocations;
+		l1menu::L1TriggerDPGEvent currentEvent;
+		float eventRate;
+	};
+}
+
+l1menu::ObjectCacheSamplePrivateMembers::ObjectCacheSamplePrivateMembers( const l1menu::ObjectCacheSample& thisObject, const std::string& filename )
+	: currentEvent(thisObject), eventRate(1)
+{
+	int fileDescriptor=open( filename.c_str(), O_RDONLY );
+	if( fileDescriptor==-1 ) throw std::runtime_error( "ObjectCacheSample - couldn't open the file "+filename );
+	l1menu::implementation::UnixFileSentry fileSentry( fileDescriptor );
+	pMappedFile.reset( new l1menu::implementation::MemoryMappedFile( fileDescriptor ) );
+
+	const char* pData=pMappedFile->data();
+	const size_t fileSize=pMappedFile->size();
+	if( fileSize<PREAMBLE_SIZE+sizeof(FileHeader) || std::memcmp( pData, OBJECT_CACHE_MAGIC_NUMBER.data(), OBJECT_CACHE_MAGIC_NUMBER.size() )!=0 )
+	{
+		throw std::runtime_error( "ObjectCacheSample - the file "+filename+" is not an ObjectCacheSample" );
+	}
+	if( pData[OBJECT_CACHE_MAGIC_NUMBER.size()]!=OBJECT_CACHE_FILE_FORMAT_VERSION ) throw std::runtime_error( "ObjectCacheSample - the file "+filename+" has an unknown file format version" );
+
+	std::memcpy( &header, pData+PREAMBLE_SIZE, sizeof(FileHeader) );
+	if( header.byteOrderMark!=BYTE_ORDER_MARK ) throw std::runtime_error( "ObjectCacheSample - the file "+filename+" was written on a machine with a different byte order" );
+	if( header.numberOfColumns!=NUMBER_OF_COLUMNS || fileSize<PREAMBLE_SIZE+sizeof(FileHeader)+NUMBER_OF_COLUMNS*sizeof(ColumnLocation) )
+	{
+		throw std::runtime_error( "ObjectCacheSample - the file "+filename+" has the wrong number of columns" );
+	}
+
+	columnLocations.resize( NUMBER_OF_COLUMNS );
+	std::memcpy( columnLocations.data(), pData+PREAMBLE_SIZE+sizeof(FileHeader), NUMBER_OF_COLUMNS*sizeof(ColumnLocation) );
+	for( size_t columnNumber=0; columnNumber<NUMBER_OF_COLUMNS; ++columnNumber )
+	{
+		const ColumnLocation& location=columnLocations[columnNumber];
+		if( location.offset%8!=0 || location.offset>fileSize || location.size>fileSize-location.offset || location.size!=expectedColumnSize( columnNumber, header ) )
+		{
+			throw std::runtime_error( "ObjectCacheSample - the file "+filename+" is corrupt or has been truncated" );
+		}
+	}
+
+	// Check the offsets now, so that fillEvent can't read outside the object columns however bad the file is
+	const Column offsetColumns[]={ EG_OFFSET, JET_OFFSET, MUON_OFFSET };
+	const uint64_t numberOfObjects[]={ header.numberOfEGs, header.numberOfJets, header.numberOfMuons };
+	for( size_t index=0; index<3; ++index )
+	{
+		const uint64_t* pOffsets=column<uint64_t>( offsetColumns[index] );
+		bool offsetsOK=( pOffsets[0]==0 && pOffsets[header.numberOfEvents]==numberOfObjects[index] );
+		for( size_t eventNumber=0; eventNumber<header.numberOfEvents && offsetsOK; ++eventNumber ) offsetsOK=( pOffsets[eventNumber]<=pOffsets[eventNumber+1] );
+		if( !offsetsOK ) throw std::runtime_error( "ObjectCacheSample - the file "+filename+" is corrupt" );
+	}
+}
+
+void l1menu::ObjectCacheSamplePrivateMembers::fillEvent( size_t eventNumber, l1menu::L1TriggerDPGEvent& event ) const
+{
+	L1Analysis::L1AnalysisDataFormat& rawEvent=event.rawEvent();
+	rawEvent.Reset();
+
+	event.setWeight( column<float>(WEIGHT)[eventNumber] );
+	rawEvent.Run=column<int64_t>(RUN)[eventNumber];
+	rawEvent.LS=column<int64_t>(LUMI_SECTION)[eventNumber];
+	rawEvent.Event=column<int64_t>(EVENT)[eventNumber];
+
+	rawEvent.ETT=column<float>(ETT)[eventNumber];
+	rawEvent.ETM=column<float>(ETM)[eventNumber];
+	rawEvent.PhiETM=column<float>(PHI_ETM)[eventNumber];
+	rawEvent.HTT=column<float>(HTT)[eventNumber];
+	rawEvent.HTM=column<float>(HTM)[eventNumber];
+	rawEvent.PhiHTM=column<float>(PHI_HTM)[eventNumber];
+	const uint8_t sumFlags=column<uint8_t>(SUM_FLAGS)[eventNumber];
+	rawEvent.OvETT=( (sumFlags & OVERFLOW_ETT)!=0 );
+	rawEvent.OvETM=( (sumFlags & OVERFLOW_ETM)!=0 );
+	rawEvent.OvHTT=( (sumFlags & OVERFLOW_HTT)!=0 );
+	rawEvent.OvHTM=( (sumFlags & OVERFLOW_HTM)!=0 );
+
+	const uint64_t* pPhysicsWords=column<uint64_t>(PHYSICS_BITS)+2*eventNumber;
+	bool* physicsBits=event.physicsBits();
+	for( size_t bit=0; bit<128; ++bit ) physicsBits[bit]=( (pPhysicsWords[bit/64]>>(bit%64)) & 1 );
+
+	// The objects for this event are a contiguous range in each of the object columns, so whole
+	// ranges can be copied at once.
+	const uint64_t firstEG=column<uint64_t>(EG_OFFSET)[eventNumber];
+	const uint64_t lastEG=column<uint64_t>(EG_OFFSET)[eventNumber+1];
+	rawEvent.Nele=lastEG-firstEG;
+	rawEvent.Bxel.assign( column<int32_t>(EG_BX)+firstEG, column<int32_t>(EG_BX)+lastEG );
+	rawEvent.Etel.assign( column<float>(EG_ET)+firstEG, column<float>(EG_ET)+lastEG );
+	rawEvent.Phiel.assign( column<float>(EG_PHI)+firstEG, column<float>(EG_PHI)+lastEG );
+	rawEvent.Etael.assign( column<float>(EG_ETA)+firstEG, column<float>(EG_ETA)+lastEG );
+	const uint8_t* pEGFlags=column<uint8_t>(EG_FLAGS);
+	for( uint64_t index=firstEG; index<lastEG; ++index ) rawEvent.Isoel.push_back( (pEGFlags[index] & ISOLATED)!=0 );
+
+	const uint64_t firstJet=column<uint64_t>(JET_OFFSET)[eventNumber];
+	const uint64_t lastJet=column<uint64_t>(JET_OFFSET)[eventNumber+1];
+	rawEvent.Njet=lastJet-firstJet;
+	rawEvent.Bxjet.assign( column<int32_t>(JET_BX)+firstJet, column<int32_t>(JET_BX)+lastJet );
+	rawEvent.Etjet.assign( column<float>(JET_ET)+firstJet, column<float>(JET_ET)+lastJet );
+	rawEvent.Phijet.assign( column<float>(JET_PHI)+firstJet, column<float>(JET_PHI)+lastJet );
+	rawEvent.Etajet.assign( column<float>(JET_ETA)+firstJet, column<float>(JET_ETA)+lastJet );
+	const uint8_t* pJetFlags=column<uint8_t>(JET_FLAGS);
+	for( uint64_t index=firstJet; index<lastJet; ++index )
+	{
+		rawEvent.Taujet.push_back( (pJetFlags[index] & TAU)!=0 );
+		rawEvent.isoTaujet.push_back( (pJetFlags[index] & ISOLATED_TAU)!=0 );
+		rawEvent.Fwdjet.push_back( (pJetFlags[index] & FORWARD)!=0 );
+	}
+
+	const uint64_t firstMuon=column<uint64_t>(MUON_OFFSET)[eventNumber];
+	const uint64_t lastMuon=column<uint64_t>(MUON_OFFSET)[eventNumber+1];
+	rawEvent.Nmu=lastMuon-firstMuon;
+	rawEvent.Bxmu.assign( column<int32_t>(MUON_BX)+firstMuon, column<int32_t>(MUON_BX)+lastMuon );
+	rawEvent.Ptmu.assign( column<float>(MUON_PT)+firstMuon, column<float>(MUON_PT)+lastMuon );
+	rawEvent.Phimu.assign( column<float>(MUON_PHI)+firstMuon, column<float>(MUON_PHI)+lastMuon );
+	rawEvent.Etamu.assign( column<float>(MUON_ETA)+firstMuon, column<float>(MUON_ETA)+lastMuon );
+	rawEvent.Qualmu.assign( column<int32_t>(MUON_QUALITY)+firstMuon, column<int32_t>(MUON_QUALITY)+lastMuon );
+	const uint8_t* pMuonFlags=column<uint8_t>(MUON_FLAGS);
+	for( uint64_t index=firstMuon; index<lastMuon; ++index ) rawEvent.Isomu.push_back( (pMuonFlags[index] & ISOLATED)!=0 );
+}
+
+void l1menu::ObjectCacheSample::convert( const l1menu::FullSample& originalSample, const std::string& filename )
+{
+	// Use the FullSample's own sum of weights, so that rates come out exactly the same
+	writeObjectCache( [&]( const std::function<void(const l1menu::L1TriggerDPGEvent&)>& function ){ originalSample.forEachFullEvent( 0, originalSample.numberOfEvents(), function ); },
+			originalSample.sumOfWeights(), filename );
+}
+
+void l1menu::ObjectCacheSample::convert( const std::vector<l1menu::L1TriggerDPGEvent>& events, const std::string& filename )
+{
+	double sumOfWeights=0;
+	for( const auto& event : events ) sumOfWeights+=event.weight();
+	writeObjectCache( [&]( const std::function<void(const l1menu::L1TriggerDPGEvent&)>& function ){ for( const auto& event : events ) function( event ); },
+			sumOfWeights, filename );
+}
+
+bool l1menu::ObjectCacheSample::isObjectCacheFile( const std::string& filename )
+{
+	std::ifstream inputFile( filename, std::ios_base::binary );
+	std::string buffer( OBJECT_CACHE_MAGIC_NUMBER.size(), ' ' );
+	inputFile.read( &buffer[0], buffer.size() );
+	return inputFile && buffer==OBJECT_CACHE_MAGIC_NUMBER;
+}
+
+l1menu::ObjectCacheSample::ObjectCacheSample( const std::string& filename )
+	: pImple_( new l1menu::ObjectCacheSamplePrivateMembers( *this, filename ) )
+{
+	// No operation besides the initialiser list
+}
+
+l1menu::ObjectCacheSample::~ObjectCacheSample()
+{
+	// No operation. Just need one defined otherwise the default one messes up
+	// the unique_ptr deletion because ObjectCacheSamplePrivateMembers isn't
+	// defined elsewhere.
+}
+
+const l1menu::L1TriggerDPGEvent& l1menu::ObjectCacheSample::getFullEvent( size_t eventNumber ) const
+{
+	if( eventNumber>=pImple_->header.numberOfEvents ) throw std::runtime_error( "ObjectCacheSample::getFullEvent - requested event number is out of range" );
+
+	pImple_->fillEvent( eventNumber, pImple_->currentEvent );
+	return pImple_->currentEvent;
+}
+
+void l1menu::ObjectCacheSample::forEachFullEvent( size_t firstEventNumber, size_t lastEventNumber, const std::function<void(const l1menu::L1TriggerDPGEvent&)>& function ) const
+{
+	if( lastEventNumber>numberOfEvents() || firstEventNumber>lastEventNumber ) throw std::runtime_error( "ObjectCacheSample::forEachFullEvent - the range of events requested is not in the sample" );
+
+	for( size_t eventNumber=firstEventNumber; eventNumber<lastEventNumber; ++eventNumber )
+	{
+		pImple_->fillEvent( eventNumber, pImple_->currentEvent );
+		function( pImple_->currentEvent );
+	}
+}
+
+size_t l1menu::ObjectCacheSample::numberOfEvents() const
+{
+	return pImple_->header.numberOfEvents;
+}
+
+const l1menu::IEvent& l1menu::ObjectCacheSample::getEvent( size_t eventNumber ) const
+{
+	return getFullEvent( eventNumber );
+}
+
+void l1menu::ObjectCacheSample::forEachEvent( size_t firstEventNumber, size_t lastEventNumber, const std::function<void(const l1menu::IEvent&)>& function ) const
+{
+	forEachFullEvent( firstEventNumber, lastEventNumber, function );
+}
+
+std::unique_ptr<l1menu::ICachedTrigger> l1menu::ObjectCacheSample::createCachedTrigger( const l1menu::ITrigger& trigger ) const
+{
+	return std::unique_ptr<l1menu::ICachedTrigger>( new CachedTriggerImplementation(trigger) );
+}
+
+float l1menu::ObjectCacheSample::eventRate() const
+{
+	return pImple_->eventRate;
+}
+
+void l1menu::ObjectCacheSample::setEventRate( float rate )
+{
+	pImple_->eventRate=rate;
+}
+
+float l1menu::ObjectCacheSample::sumOfWeights() const
+{
+	return pImple_->header.sumOfWeights;
+}
+
+std::shared_ptr<const l1menu::IMenuRate> l1menu::ObjectCacheSample::rate( const l1menu::TriggerMenu& menu ) const
+{
+	return std::shared_ptr<const l1menu::IMenuRate>( new l1menu::implementation::MenuRateImplementation( menu, *this ) );
+}
@@ -2,10 +2,10 @@
 
 #include "l1menu/ITrigger.h"
 #include "l1menu/ReducedSample.h"
-#include "protobuf/l1menu.pb.h"
 
 l1menu::ReducedEvent::ReducedEvent( const l1menu::ReducedSample& sample )
-	: sample_(sample)
+	: pColumns_(nullptr), pWeights_(nullptr), pPackedColumns_(nullptr), pValueTables_(nullptr),
+	  pPackedWeights_(nullptr), pWeightValueTable_(nullptr), eventIndex_(0), sample_(sample)
 {
 	// No operation
 }
@@ -17,7 +17,9 @@ l1menu::ReducedEvent::~ReducedEvent()
 
 float l1menu::ReducedEvent::parameterValue( ParameterID parameterNumber ) const
 {
-	return pProtobufEvent_->threshold(parameterNumber);
+	const uint16_t* pCodes=pPackedColumns_[parameterNumber];
+	if( pCodes!=nullptr ) return pValueTables_[parameterNumber][pCodes[eventIndex_]];
+	else return pColumns_[parameterNumber][eventIndex_];
 }
 
 bool l1menu::ReducedEvent::passesTrigger( const l1menu::ITrigger& trigger ) const
@@ -35,8 +37,8 @@ bool l1menu::ReducedEvent::passesTrigger( const l1menu::ITrigger& trigger ) cons
 
 float l1menu::ReducedEvent::weight() const
 {
-	if( pProtobufEvent_->has_weight() ) return pProtobufEvent_->weight();
-	else return 1;
+	if( pPackedWeights_!=nullptr ) return pWeightValueTable_[pPackedWeights_[eventIndex_]];
+	else return pWeights_[eventIndex_];
 }
 
 const l1menu::ISample& l1menu::ReducedEvent::sample() const
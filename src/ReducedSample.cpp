@@ -3,11 +3,19 @@
 #include <vector>
 #include <stdexcept>
 #include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <cmath>
+#include <limits>
 #include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <functional>
 #include "l1menu/ReducedEvent.h"
 #include "l1menu/FullSample.h"
+#include "l1menu/ObjectCacheSample.h"
 #include "l1menu/TriggerMenu.h"
 #include "l1menu/ITrigger.h"
 #include "l1menu/ICachedTrigger.h"
@@ -16,27 +24,205 @@
 #include "l1menu/IMenuRate.h"
 #include "l1menu/ITriggerRate.h"
 #include "l1menu/tools/miscellaneous.h"
+#include "l1menu/tools/ThresholdExtractor.h"
+#include "l1menu/tools/Profiler.h"
+#include "l1menu/tools/threading.h"
 #include "./implementation/MenuRateImplementation.h"
+#include "./implementation/ReducedSampleFileFormat.h"
+#include "./implementation/CompressionCodecs.h"
 #include "protobuf/l1menu.pb.h"
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/io/gzip_stream.h>
 
 namespace // unnamed namespace
 {
-	/** @brief Sentry that closes a Unix file descriptor when it goes out of scope.
+	/** @brief Writes the value of every code in the packed column into pOutput.
+	 *
+	 * Kept as a simple loop with no branches so that the compiler can vectorise it.
+	 */
+	void decodeColumn( const uint16_t* pCodes, const float* pValueTable, size_t numberOfEvents, float* pOutput )
+	{
+		for( size_t eventNumber=0; eventNumber<numberOfEvents; ++eventNumber ) pOutput[eventNumber]=pValueTable[pCodes[eventNumber]];
+	}
+
+	/** @brief Tries to pack a column of floats into uint16 indices into a sorted table of the values in the column.
+	 *
+	 * Because the table is sorted, comparing codes gives the same answer as comparing the values
+	 * so nothing is lost. Thresholds that could never be passed are recorded as -1, so if
+	 * reserveNeverPasses is set the first entry of the table is always -1, i.e. code 0 always
+	 * means "never passes".
+	 *
+	 * @return False if the column can't be packed, either because it has more than 65536
+	 *         different values, or because it has NaNs or values below -1 (for threshold
+	 *         columns), which should never happen. The column then has to be stored as floats.
+	 */
+	bool packColumn( const float* pColumn, size_t numberOfEvents, bool reserveNeverPasses, std::vector<float>& valueTable, std::vector<uint16_t>& codes )
+	{
+		valueTable.assign( pColumn, pColumn+numberOfEvents );
+		if( reserveNeverPasses ) valueTable.push_back( -1 );
+		for( const auto& value : valueTable )
+		{
+			if( value!=value ) return false; // NaN
+		}
+		std::sort( valueTable.begin(), valueTable.end() );
+		valueTable.erase( std::unique( valueTable.begin(), valueTable.end() ), valueTable.end() );
+		if( valueTable.size()>65536 ) return false;
+		if( reserveNeverPasses && valueTable.front()!=-1 ) return false;
+
+		codes.resize( numberOfEvents );
+		for( size_t eventNumber=0; eventNumber<numberOfEvents; ++eventNumber )
+		{
+			codes[eventNumber]=std::lower_bound( valueTable.begin(), valueTable.end(), pColumn[eventNumber] )-valueTable.begin();
+		}
+		return true;
+	}
+
+	/** @brief Whether a threshold worked out again by addTriggerColumns agrees with the one recorded in the sample.
+	 *
+	 * Exact thresholds have to be identical. Samples made by older versions bisected, which gives a value
+	 * anywhere up to the tolerance above the turn on, and kept the trigger between events so that correlated
+	 * thresholds could be rounded slightly differently. Those only have to agree within the tolerance, with
+	 * a few floating point steps of slack for the rounding. The bisection also gives -1 if the event still
+	 * passes at the top of its search range, which has to match anything from there up.
+	 */
+	bool thresholdsAgree( float recordedThreshold, float threshold, bool bisected, float tolerance, float searchLimit )
+	{
+		if( recordedThreshold==threshold ) return true;
+		if( recordedThreshold!=recordedThreshold && threshold!=threshold ) return true; // NaN is never equal to itself, but both NaN is a match
+		if( !bisected ) return false;
+
+		if( recordedThreshold==-1 ) return threshold>=searchLimit;
+		if( threshold==-1 ) return recordedThreshold>=searchLimit;
+		const float slack=4*std::numeric_limits<float>::epsilon()*std::max( std::fabs(recordedThreshold), std::fabs(threshold) );
+		return std::fabs( recordedThreshold-threshold )<=tolerance+slack;
+	}
+
+}
+
+namespace l1menu
+{
+	/** @brief Private members for the ReducedSample class
+	 *
 	 * @author Mark Grimes (mark.grimes@bristol.ac.uk)
-	 * @date 07/Jun/2013
+	 * @date 28/May/2013
 	 */
-	class UnixFileSentry
+	class ReducedSamplePrivateMembers
 	{
-	public:
-		UnixFileSentry( int fileDescriptor ) : fileDescriptor_(fileDescriptor) {}
-		~UnixFileSentry() { close(fileDescriptor_); }
 	private:
-		int fileDescriptor_;
+		l1menu::TriggerMenu mutableTriggerMenu_;
+	public:
+		ReducedSamplePrivateMembers( const l1menu::ReducedSample& thisObject, const l1menu::TriggerMenu& newTriggerMenu );
+		/** @param pProjection  If not null, only the triggers in this menu are loaded. */
+		ReducedSamplePrivateMembers( const l1menu::ReducedSample& thisObject, const std::string& filename, const l1menu::TriggerMenu* pProjection, size_t numberOfThreads );
+		//void copyMenuToProtobufSample();
+		/** @brief Reads the gzipped protobuf messages that make up the rest of a version 1 file.
+		 * @param expectedNumberOfEvents  Only used to reserve memory, so zero is fine if it's not known. */
+		void loadProtobufFormat( google::protobuf::io::ZeroCopyInputStream& fileInput, size_t expectedNumberOfEvents, const l1menu::TriggerMenu* pProjection );
+		/** @brief Memory maps a version 2 file and points the columns at the mapped memory. */
+		void loadColumnarFormat( int fileDescriptor, const l1menu::TriggerMenu* pProjection );
+		/** @brief Memory maps a version 4 file and points the packed columns at the mapped memory. */
+		void loadPackedColumnarFormat( int fileDescriptor, const l1menu::TriggerMenu* pProjection );
+		/** @brief Decompresses the frames of a version 3 file in parallel, straight into the owned columns. */
+		void loadChunkedFormat( int fileDescriptor, l1menu::ReducedSample::Codec codec, size_t numberOfThreads, const l1menu::TriggerMenu* pProjection );
+		/** @brief Removes the triggers that aren't in pProjection from protobufSampleHeader, and fills fileColumnNumbers.
+		 *
+		 * Has to be called after the header has been read from a file but before any of the columns.
+		 * If pProjection is null nothing is removed.
+		 * @throw std::runtime_error If a trigger in pProjection isn't in the sample.
+		 */
+		void projectHeader( const l1menu::TriggerMenu* pProjection );
+		void saveProtobufFormat( google::protobuf::io::ZeroCopyOutputStream& fileOutput ) const;
+		void saveColumnarFormat( google::protobuf::io::ZeroCopyOutputStream& fileOutput ) const;
+		void saveChunkedFormat( google::protobuf::io::ZeroCopyOutputStream& fileOutput, l1menu::ReducedSample::Codec codec, size_t numberOfThreads ) const;
+		/** @brief Compresses the events as separate Runs, and passes each compressed frame and the number of events in it to writeFrame in order.
+		 *
+		 * The Runs are compressed in parallel in batches, so only a few are held in memory at once. The frames
+		 * are the same whatever the number of threads.
+		 */
+		void compressRuns( l1menu::ReducedSample::Codec codec, size_t numberOfThreads, const std::function<void(const std::string&,size_t)>& writeFrame ) const;
+		void savePackedColumnarFormat( google::protobuf::io::ZeroCopyOutputStream& fileOutput, size_t numberOfThreads ) const;
+		/** @brief Fills the protobuf run with the events in the range [firstEvent,lastEvent) from the columns. */
+		void fillRunFromColumns( l1menuprotobuf::Run& run, size_t firstEvent, size_t lastEvent ) const;
+		/** @brief Appends all of the events in the protobuf run to the end of the owned columns. */
+		void appendRun( const l1menuprotobuf::Run& run );
+		/** @brief Copies the events in the run into the owned columns starting at firstEvent, which must already be big enough.
+		 * @return The sum of the weights of the events in the run. */
+		double copyRunToColumns( const l1menuprotobuf::Run& run, size_t firstEvent );
+		/** @brief Copies the columns into ownedColumns and ownedWeights if they are memory mapped, so that events can be added. */
+		void makeColumnsWritable();
+		/** @brief Points columns, pWeights and the event at the owned storage. Needs calling whenever that storage could have moved. */
+		void refreshColumnPointers();
+		/** @brief Points the event at columns, pWeights, packedColumns and valueTables. */
+		void refreshEventPointers();
+		/** @brief The value of a threshold for an event, whether the column is packed or not. */
+		float parameterValue( size_t parameterNumber, size_t eventNumber ) const;
+		/** @brief The weight of an event, whether the weights are packed or not. */
+		float weight( size_t eventNumber ) const;
+		/** @brief Returns the threshold column (or the weights if columnNumber is numberOfParameters()) as floats.
+		 * If the column is packed it is decoded into buffer, otherwise the column is returned directly. */
+		const float* floatColumn( size_t columnNumber, std::vector<float>& buffer ) const;
+		/** @brief The number of thresholds recorded for each event, i.e. the number of columns excluding the weights. */
+		size_t numberOfParameters() const;
+		/** @brief Adds the details of the trigger to the end of protobufSampleHeader. Doesn't touch the columns.
+		 * The header records that the thresholds are found by ThresholdExtractor's exact method. */
+		void addTriggerToHeader( const l1menu::ITrigger& trigger );
+		/** @brief How the thresholds of the trigger were found, according to the header. Samples from before this was recorded always used bisection. */
+		l1menu::tools::ThresholdExtractor::Method thresholdMethod( size_t triggerNumber ) const;
+		/** @brief Adds the trigger to the end of the menu and header, with new columns set to -1 (never passes) for every event.
+		 * The columns have to be writable first. */
+		void addEmptyTrigger( const l1menu::ITrigger& trigger );
+		/** @brief Does the work for the addSample overloads. The FullSample and ObjectCacheSample give exactly the same events, so both use this. */
+		template<class T_Sample> void addEvents( const T_Sample& originalSample, size_t firstEventNumber, size_t lastEventNumber );
+		/** @brief Does the work for the addTriggerColumns overloads, for either a FullSample or an ObjectCacheSample. */
+		template<class T_Sample> void addTriggerColumns( const l1menu::ReducedSample& thisObject, const T_Sample& originalSample, const l1menu::TriggerMenu& triggers, size_t firstEventNumber );
+		/** @brief Throws if addTriggerColumns has added triggers that haven't been calculated for every event yet. */
+		void checkNewTriggersAreComplete( const std::string& functionName ) const;
+		l1menu::ReducedEvent event;
+		const l1menu::TriggerMenu& triggerMenu; // External const access to mutableTriggerMenu_
+		float eventRate;
+		float sumOfWeights;
+		l1menuprotobuf::SampleHeader protobufSampleHeader;
+		// The thresholds are held as a structure of arrays, i.e. one column of floats for each
+		// parameter with an entry for every event, plus one column for the weights. If the sample
+		// was loaded from a version 2 file these point into the memory mapped file, otherwise they
+		// point into ownedColumns and ownedWeights.
+		std::vector<const float*> columns;
+		const float* pWeights;
+		size_t numberOfEvents;
+		std::vector< std::vector<float> > ownedColumns;
+		std::vector<float> ownedWeights;
+		std::unique_ptr<l1menu::implementation::MemoryMappedFile> pMappedFile;
+		// If the sample was loaded from a version 4 file some of the columns can be packed, in which
+		// case the entry in columns (or pWeights) is null and these point into the memory mapped file
+		// instead. There is one more entry than there are parameters, for the weights. Entries for
+		// columns that aren't packed are null.
+		std::vector<const uint16_t*> packedColumns;
+		std::vector<const float*> valueTables;
+		std::vector<size_t> valueTableSizes;
+		// If the sample was loaded with a projection, only some of the columns in the file are
+		// kept. This is the position in the file of each column that is kept, and the number
+		// of columns in the file. Without a projection it's just 0,1,2...
+		std::vector<size_t> fileColumnNumbers;
+		size_t numberOfFileColumns;
+		// The triggers (positions in triggerMenu) that addTriggerColumns has added but not calculated for every
+		// event yet, and how many events they have been calculated for. Events are always done in order.
+		std::vector<size_t> incompleteTriggerNumbers;
+		size_t numberOfEventsWithNewTriggers;
+		const static int EVENTS_PER_RUN;
+		const static size_t COLUMN_ALIGNMENT;
 	};
 
+	const int ReducedSamplePrivateMembers::EVENTS_PER_RUN=20000;
+	const size_t ReducedSamplePrivateMembers::COLUMN_ALIGNMENT=4096;
+}
+
+namespace // unnamed namespace
+{
 	/** @brief An object that stores pointers to trigger parameters to avoid costly string comparisons.
+	 *
+	 * For packed columns the threshold is converted to the code of the first value in the table
+	 * that passes it, so that events can be tested by comparing the codes without decoding them.
+	 * The conversion is only redone when the threshold changes.
 	 *
 	 * @author Mark Grimes (mark.grimes@bristol.ac.uk)
 	 * @date 26/Jun/2013
@@ -44,13 +230,22 @@ namespace // unnamed namespace
 	class CachedTriggerImplementation : public l1menu::ICachedTrigger
 	{
 	public:
-		CachedTriggerImplementation( const l1menu::ReducedSample& sample, const l1menu::ITrigger& trigger )
+		CachedTriggerImplementation( const l1menu::ReducedSamplePrivateMembers& sample, const l1menu::ITrigger& trigger )
 		{
-			const auto& parameterIdentifiers=sample.getTriggerParameterIdentifiers(trigger);
+			const auto& parameterIdentifiers=l1menu::implementation::getTriggerParameterIdentifiers( sample.triggerMenu, trigger, false );
 
 			for( const auto& identifier : parameterIdentifiers )
 			{
-				identifiers_.push_back( std::make_pair( identifier.second, &trigger.parameter(identifier.first) ) );
+				CachedThreshold threshold;
+				threshold.parameterNumber=identifier.second;
+				threshold.pThreshold=&trigger.parameter(identifier.first);
+				threshold.pCodes=sample.packedColumns[identifier.second];
+				threshold.pValueTable=sample.valueTables[identifier.second];
+				threshold.valueTableSize=sample.valueTableSizes[identifier.second];
+				threshold.lastThreshold=0;
+				threshold.passingCode=0;
+				updatePassingCode( threshold );
+				thresholds_.push_back( threshold );
 			}
 		}
 		virtual bool apply( const l1menu::IEvent& event )
@@ -61,9 +256,14 @@ namespace // unnamed namespace
 			// event that wasn't created with the same sample that this proxy was created
 			// with.
 			const l1menu::ReducedEvent* pEvent=static_cast<const l1menu::ReducedEvent*>(&event);
-			for( const auto& identifier : identifiers_ )
+			for( auto& threshold : thresholds_ )
 			{
-				if( pEvent->parameterValue(identifier.first) < *identifier.second ) return false;
+				if( threshold.pCodes!=nullptr )
+				{
+					if( *threshold.pThreshold!=threshold.lastThreshold ) updatePassingCode( threshold );
+					if( threshold.pCodes[pEvent->index()] < threshold.passingCode ) return false;
+				}
+				else if( pEvent->parameterValue(threshold.parameterNumber) < *threshold.pThreshold ) return false;
 			}
 
 			// If control got this far then all of the thresholds passed, and
@@ -71,55 +271,30 @@ namespace // unnamed namespace
 			return true;
 		}
 	protected:
-		std::vector< std::pair<l1menu::ReducedEvent::ParameterID,const float*> > identifiers_;
-	}; // end of class ReducedSampleCachedTrigger
-
-	float sumWeights( const l1menuprotobuf::Run& run )
-	{
-		float returnValue=0;
-		for( const auto& event : run.event() )
+		struct CachedThreshold
+		{
+			l1menu::ReducedEvent::ParameterID parameterNumber;
+			const float* pThreshold;
+			const uint16_t* pCodes; ///< @brief Null if the column is not packed
+			const float* pValueTable;
+			size_t valueTableSize;
+			float lastThreshold; ///< @brief The threshold passingCode was calculated for
+			size_t passingCode; ///< @brief Events with codes lower than this fail. Can be one past the last code.
+		};
+		static void updatePassingCode( CachedThreshold& threshold )
 		{
-			if( event.has_weight() ) returnValue+=event.weight();
-			else returnValue+=1;
+			if( threshold.pCodes==nullptr ) return;
+			threshold.lastThreshold=*threshold.pThreshold;
+			threshold.passingCode=std::lower_bound( threshold.pValueTable, threshold.pValueTable+threshold.valueTableSize, threshold.lastThreshold )-threshold.pValueTable;
 		}
-		return returnValue;
-	}
-}
-
-namespace l1menu
-{
-	/** @brief Private members for the ReducedSample class
-	 *
-	 * @author Mark Grimes (mark.grimes@bristol.ac.uk)
-	 * @date 28/May/2013
-	 */
-	class ReducedSamplePrivateMembers
-	{
-	private:
-		l1menu::TriggerMenu mutableTriggerMenu_;
-	public:
-		ReducedSamplePrivateMembers( const l1menu::ReducedSample& thisObject, const l1menu::TriggerMenu& newTriggerMenu );
-		ReducedSamplePrivateMembers( const l1menu::ReducedSample& thisObject, const std::string& filename );
-		//void copyMenuToProtobufSample();
-		l1menu::ReducedEvent event;
-		const l1menu::TriggerMenu& triggerMenu; // External const access to mutableTriggerMenu_
-		float eventRate;
-		float sumOfWeights;
-		l1menuprotobuf::SampleHeader protobufSampleHeader;
-		// Protobuf doesn't implement move semantics so I'll use pointers
-		std::vector<std::unique_ptr<l1menuprotobuf::Run> > protobufRuns;
-		const static int EVENTS_PER_RUN;
-		const static char PROTOBUF_MESSAGE_DELIMETER;
-		const static std::string FILE_FORMAT_MAGIC_NUMBER;
-	};
+		std::vector<CachedThreshold> thresholds_;
+	}; // end of class ReducedSampleCachedTrigger
 
-	const int ReducedSamplePrivateMembers::EVENTS_PER_RUN=20000;
-	const char ReducedSamplePrivateMembers::PROTOBUF_MESSAGE_DELIMETER='\n';
-	const std::string ReducedSamplePrivateMembers::FILE_FORMAT_MAGIC_NUMBER="l1menuReducedSample";
 }
 
 l1menu::ReducedSamplePrivateMembers::ReducedSamplePrivateMembers( const l1menu::ReducedSample& thisObject, const l1menu::TriggerMenu& newTriggerMenu )
-	: mutableTriggerMenu_( newTriggerMenu ), event(thisObject), triggerMenu( mutableTriggerMenu_ ), eventRate(1), sumOfWeights(0)
+	: mutableTriggerMenu_( newTriggerMenu ), event(thisObject), triggerMenu( mutableTriggerMenu_ ), eventRate(1), sumOfWeights(0),
+	  pWeights(nullptr), numberOfEvents(0), numberOfFileColumns(0), numberOfEventsWithNewTriggers(0)
 {
 	GOOGLE_PROTOBUF_VERIFY_VERSION;
 
@@ -128,140 +303,904 @@ l1menu::ReducedSamplePrivateMembers::ReducedSamplePrivateMembers( const l1menu::
 	// protobuf file, so I might as well do it now.
 	for( size_t triggerNumber=0; triggerNumber<triggerMenu.numberOfTriggers(); ++triggerNumber )
 	{
-		const l1menu::ITrigger& trigger=triggerMenu.getTrigger(triggerNumber);
-
-		l1menuprotobuf::Trigger* pProtobufTrigger=protobufSampleHeader.add_trigger();
-		pProtobufTrigger->set_name( trigger.name() );
-		pProtobufTrigger->set_version( trigger.version() );
-
-		// Record all of the parameters. It's not strictly necessary to record the values
-		// of the parameters that are recorded for each event, but I might as well so that
-		// the trigger menu is loaded exactly as it was saved.
-		const auto parameterNames=trigger.parameterNames();
-		for( const auto& parameterName : parameterNames )
-		{
-			l1menuprotobuf::Trigger_TriggerParameter* pProtobufParameter=pProtobufTrigger->add_parameter();
-			pProtobufParameter->set_name(parameterName);
-			pProtobufParameter->set_value( trigger.parameter(parameterName) );
-		}
-
-		// Make a note of the names of the parameters that are recorded for each event. For this
-		// I'm just recording the parameters that refer to the thresholds.
-		const auto thresholdNames=l1menu::tools::getThresholdNames(trigger);
-		for( const auto& thresholdName : thresholdNames ) pProtobufTrigger->add_varying_parameter(thresholdName);
-
+		addTriggerToHeader( triggerMenu.getTrigger(triggerNumber) );
 	} // end of loop over triggers
 
-	// Always make sure there is at least one Run ready to be added to
-	std::unique_ptr<l1menuprotobuf::Run> pNewRun( new l1menuprotobuf::Run );
-	protobufRuns.push_back( std::move( pNewRun ) );
-
+	projectHeader( nullptr );
+	ownedColumns.resize( numberOfParameters() );
+	refreshColumnPointers();
 }
 
-l1menu::ReducedSamplePrivateMembers::ReducedSamplePrivateMembers( const l1menu::ReducedSample& thisObject, const std::string& filename )
-	: event(thisObject), triggerMenu(mutableTriggerMenu_), eventRate(1), sumOfWeights(0)
+l1menu::ReducedSamplePrivateMembers::ReducedSamplePrivateMembers( const l1menu::ReducedSample& thisObject, const std::string& filename, const l1menu::TriggerMenu* pProjection, size_t numberOfThreads )
+	: event(thisObject), triggerMenu(mutableTriggerMenu_), eventRate(1), sumOfWeights(0), pWeights(nullptr), numberOfEvents(0), numberOfFileColumns(0),
+	  numberOfEventsWithNewTriggers(0)
 {
 	GOOGLE_PROTOBUF_VERIFY_VERSION;
 
 	// Open the file with read ability
 	int fileDescriptor = open( filename.c_str(), O_RDONLY );
-	if( fileDescriptor==0 ) throw std::runtime_error( "ReducedSample initialise from file - couldn't open file" );
-	::UnixFileSentry fileSentry( fileDescriptor ); // Use this as an exception safe way of closing the input file
+	if( fileDescriptor<0 ) throw std::runtime_error( "ReducedSample initialise from file - couldn't open file" );
+	l1menu::implementation::UnixFileSentry fileSentry( fileDescriptor ); // Use this as an exception safe way of closing the input file
 	google::protobuf::io::FileInputStream fileInput( fileDescriptor );
 
 	// First read the magic number at the start of the file and make sure it
 	// matches what I expect. This is uncompressed so I'll wrap it in a block
 	// to make sure the CodedInputStream is destructed before creating a new
 	// one with gzip input.
+	google::protobuf::uint32 fileformatVersion;
+	l1menu::ReducedSample::Codec codec=l1menu::ReducedSample::Codec::GZIP;
 	{
 		google::protobuf::io::CodedInputStream codedInput( &fileInput );
 
 		// As a read buffer, I'll create a string the correct size (filled with an arbitrary
 		// character) and read straight into that.
 		std::string readMagicNumber;
-		if( !codedInput.ReadString( &readMagicNumber, FILE_FORMAT_MAGIC_NUMBER.size() ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading magic number" );
-		if( readMagicNumber!=FILE_FORMAT_MAGIC_NUMBER ) throw std::runtime_error( "ReducedSample - tried to initialise with a file that is not the correct format" );
+		if( !codedInput.ReadString( &readMagicNumber, l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER.size() ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading magic number" );
+		if( readMagicNumber!=l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER ) throw std::runtime_error( "ReducedSample - tried to initialise with a file that is not the correct format" );
 
-		google::protobuf::uint32 fileformatVersion;
 		if( !codedInput.ReadVarint32( &fileformatVersion ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading file format version" );
-		// So far I only have (and ever expect to have) one version of the file
-		// format, imaginatively versioned "1". You never know though...
-		if( fileformatVersion>1 ) std::cerr << "Warning: Attempting to read a ReducedSample with version " << fileformatVersion << " with code that only knows up to version 1." << std::endl;
+		if( fileformatVersion>4 ) std::cerr << "Warning: Attempting to read a ReducedSample with version " << fileformatVersion << " with code that only knows up to version 4." << std::endl;
+		if( fileformatVersion==3 ) codec=l1menu::implementation::readCodecTag( codedInput );
 	}
 
+	// Version 2 and 4 files are read through a memory map, which doesn't need the stream
+	// at all. Anything else is assumed to be the original gzipped protobuf format.
+	if( fileformatVersion==2 ) loadColumnarFormat( fileDescriptor, pProjection );
+	else if( fileformatVersion==4 ) loadPackedColumnarFormat( fileDescriptor, pProjection );
+	else if( fileformatVersion==3 ) loadChunkedFormat( fileDescriptor, codec, numberOfThreads, pProjection );
+	else
+	{
+		// Newer files have a footer after the compressed data. If there is one I need
+		// to make sure the gzip stream stops before it.
+		l1menu::implementation::ReducedSampleFooter footer;
+		if( footer.read( fileDescriptor ) )
+		{
+			google::protobuf::io::LimitingInputStream payloadInput( &fileInput, footer.payloadSize );
+			loadProtobufFormat( payloadInput, footer.numberOfEvents, pProjection );
+		}
+		else loadProtobufFormat( fileInput, 0, pProjection );
+	}
+
+	// I have all of the information in the protobuf members, but I also need the trigger information
+	// in the form of l1menu::TriggerMenu. Copy out the required information.
+	l1menu::implementation::copyHeaderToTriggerMenu( protobufSampleHeader, mutableTriggerMenu_ );
+}
+
+void l1menu::ReducedSamplePrivateMembers::loadProtobufFormat( google::protobuf::io::ZeroCopyInputStream& fileInput, size_t expectedNumberOfEvents, const l1menu::TriggerMenu* pProjection )
+{
 	google::protobuf::io::GzipInputStream gzipInput( &fileInput );
-	google::protobuf::io::CodedInputStream codedInput( &gzipInput );
 
-	// Disable warnings on this input stream (second parameter, -1). The
-	// first parameter is the default. I'll change this if necessary in
-	// the loop later.
-	size_t totalBytesLimit=67108864;
-	codedInput.SetTotalBytesLimit( totalBytesLimit, -1 );
+	if( !l1menu::implementation::readDelimitedMessage( gzipInput, protobufSampleHeader ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading header" );
+	projectHeader( pProjection );
+
+	ownedColumns.resize( numberOfParameters() );
+	for( auto& column : ownedColumns ) column.reserve( expectedNumberOfEvents );
+	ownedWeights.reserve( expectedNumberOfEvents );
+
+	// Keep looping until there is nothing more to be read from the file.
+	l1menuprotobuf::Run run;
+	while( l1menu::implementation::readDelimitedMessage( gzipInput, run ) )
+	{
+		appendRun( run );
+	}
+
+	refreshColumnPointers();
+}
+
+void l1menu::ReducedSamplePrivateMembers::loadColumnarFormat( int fileDescriptor, const l1menu::TriggerMenu* pProjection )
+{
+	//
+	// The version 2 layout is:
+	//     magic number, varint32 file format version (2),
+	//     little endian uint64 number of events,
+	//     little endian uint64 number of parameters (i.e. threshold columns),
+	//     little endian uint64 sum of weights (bit pattern of a double),
+	//     little endian uint64 size of the SampleHeader message,
+	//     little endian uint64 file offset of each threshold column, then of the weight column,
+	//     the uncompressed SampleHeader message,
+	//     then each column as a raw array of floats, starting on a COLUMN_ALIGNMENT boundary.
+	// The floats are in the native byte order so that they can be used straight from the
+	// memory map. All of the platforms this is used on are little endian.
+	//
+	pMappedFile.reset( new l1menu::implementation::MemoryMappedFile( fileDescriptor ) );
+	const google::protobuf::uint8* pFileStart=reinterpret_cast<const google::protobuf::uint8*>( pMappedFile->data() );
+	const size_t fileSize=pMappedFile->size();
+
+	// The CodedInputStream only takes an int for the size, but the preamble is always
+	// small so there's no need to give it the whole file.
+	google::protobuf::io::CodedInputStream codedInput( pFileStart, static_cast<int>( std::min<size_t>( fileSize, 1<<30 ) ) );
+
+	// Skip past the magic number and version, which have already been checked
+	google::protobuf::uint32 fileformatVersion;
+	if( !codedInput.Skip( l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER.size() ) || !codedInput.ReadVarint32( &fileformatVersion ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading file preamble" );
+
+	google::protobuf::uint64 storedNumberOfEvents, numberOfColumns, sumOfWeightsBits, headerSize;
+	if( !codedInput.ReadLittleEndian64( &storedNumberOfEvents ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading number of events" );
+	if( !codedInput.ReadLittleEndian64( &numberOfColumns ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading number of columns" );
+	if( !codedInput.ReadLittleEndian64( &sumOfWeightsBits ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading sum of weights" );
+	if( !codedInput.ReadLittleEndian64( &headerSize ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading header size" );
+
+	std::vector<google::protobuf::uint64> columnOffsets( numberOfColumns+1 );
+	for( auto& columnOffset : columnOffsets )
+	{
+		if( !codedInput.ReadLittleEndian64( &columnOffset ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading column offsets" );
+		if( columnOffset+storedNumberOfEvents*sizeof(float) > fileSize ) throw std::runtime_error( "ReducedSample initialise from file - column extends past the end of the file" );
+	}
+
+	google::protobuf::io::CodedInputStream::Limit readLimit=codedInput.PushLimit(headerSize);
+	if( !protobufSampleHeader.ParseFromCodedStream( &codedInput ) ) throw std::runtime_error( "ReducedSample initialise from file - some unknown error while reading header" );
+	codedInput.PopLimit(readLimit);
+
+	if( numberOfColumns!=numberOfParameters() ) throw std::runtime_error( "ReducedSample initialise from file - the number of columns doesn't match the header" );
+	projectHeader( pProjection );
+
+	// Columns that aren't in the projection are never touched, so never get read from disk
+	numberOfEvents=storedNumberOfEvents;
+	for( const auto& fileColumnNumber : fileColumnNumbers )
+	{
+		columns.push_back( reinterpret_cast<const float*>( pMappedFile->data()+columnOffsets[fileColumnNumber] ) );
+	}
+	pWeights=reinterpret_cast<const float*>( pMappedFile->data()+columnOffsets.back() );
+	packedColumns.assign( columns.size()+1, nullptr );
+	valueTables.assign( columns.size()+1, nullptr );
+	valueTableSizes.assign( columns.size()+1, 0 );
+	refreshEventPointers();
+
+	double storedSumOfWeights;
+	std::memcpy( &storedSumOfWeights, &sumOfWeightsBits, sizeof(storedSumOfWeights) );
+	sumOfWeights=storedSumOfWeights;
+}
 
-	google::protobuf::uint64 messageSize;
+void l1menu::ReducedSamplePrivateMembers::loadPackedColumnarFormat( int fileDescriptor, const l1menu::TriggerMenu* pProjection )
+{
+	//
+	// The version 4 layout is the same idea as version 2, except that columns can be packed:
+	//     magic number, varint32 file format version (4),
+	//     little endian uint64 number of events,
+	//     little endian uint64 number of parameters (i.e. threshold columns),
+	//     little endian uint64 sum of weights (bit pattern of a double),
+	//     little endian uint64 size of the SampleHeader message,
+	//     for each threshold column and then the weight column, little endian uint64s of
+	//         the file offset of the column, the file offset of the value table and the
+	//         number of entries in the value table,
+	//     the uncompressed SampleHeader message,
+	//     the value tables as raw arrays of floats, each starting on a 4 byte boundary,
+	//     then each column starting on a COLUMN_ALIGNMENT boundary.
+	// A column with a zero size value table is a raw array of floats, the same as version 2.
+	// Otherwise it is an array of uint16 indices into the value table, which is sorted so that
+	// comparing the indices is the same as comparing the values. For the threshold columns the
+	// first entry in the value table is always -1, i.e. an index of 0 means the trigger can't
+	// be passed. See packColumn. Everything is in native byte order, which is little endian on
+	// all of the platforms this is used on.
+	//
+	pMappedFile.reset( new l1menu::implementation::MemoryMappedFile( fileDescriptor ) );
+	const google::protobuf::uint8* pFileStart=reinterpret_cast<const google::protobuf::uint8*>( pMappedFile->data() );
+	const size_t fileSize=pMappedFile->size();
+
+	google::protobuf::io::CodedInputStream codedInput( pFileStart, static_cast<int>( std::min<size_t>( fileSize, 1<<30 ) ) );
+
+	// Skip past the magic number and version, which have already been checked
+	google::protobuf::uint32 fileformatVersion;
+	if( !codedInput.Skip( l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER.size() ) || !codedInput.ReadVarint32( &fileformatVersion ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading file preamble" );
+
+	google::protobuf::uint64 storedNumberOfEvents, numberOfColumns, sumOfWeightsBits, headerSize;
+	if( !codedInput.ReadLittleEndian64( &storedNumberOfEvents ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading number of events" );
+	if( !codedInput.ReadLittleEndian64( &numberOfColumns ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading number of columns" );
+	if( !codedInput.ReadLittleEndian64( &sumOfWeightsBits ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading sum of weights" );
+	if( !codedInput.ReadLittleEndian64( &headerSize ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading header size" );
+
+	// Read the pointers for every column in the file first, then pick out the ones in the
+	// projection once the header has been read.
+	std::vector<const float*> fileColumns( numberOfColumns+1, nullptr );
+	std::vector<const uint16_t*> filePackedColumns( numberOfColumns+1, nullptr );
+	std::vector<const float*> fileValueTables( numberOfColumns+1, nullptr );
+	std::vector<size_t> fileValueTableSizes( numberOfColumns+1, 0 );
+	for( size_t columnNumber=0; columnNumber<=numberOfColumns; ++columnNumber )
+	{
+		google::protobuf::uint64 columnOffset, valueTableOffset, valueTableSize;
+		if( !codedInput.ReadLittleEndian64( &columnOffset ) || !codedInput.ReadLittleEndian64( &valueTableOffset )
+				|| !codedInput.ReadLittleEndian64( &valueTableSize ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading column offsets" );
 
-	// Read the size of the header message
-	if( !codedInput.ReadVarint64( &messageSize ) ) throw std::runtime_error( "ReducedSample initialise from file - error reading message size for header" );
-	google::protobuf::io::CodedInputStream::Limit readLimit=codedInput.PushLimit(messageSize);
+		if( valueTableSize==0 )
+		{
+			if( columnOffset+storedNumberOfEvents*sizeof(float) > fileSize ) throw std::runtime_error( "ReducedSample initialise from file - column extends past the end of the file" );
+			fileColumns[columnNumber]=reinterpret_cast<const float*>( pMappedFile->data()+columnOffset );
+		}
+		else
+		{
+			if( columnOffset+storedNumberOfEvents*sizeof(uint16_t) > fileSize || valueTableOffset+valueTableSize*sizeof(float) > fileSize ) throw std::runtime_error( "ReducedSample initialise from file - column extends past the end of the file" );
+			if( valueTableSize>65536 || valueTableOffset%sizeof(float)!=0 || columnOffset%sizeof(uint16_t)!=0 ) throw std::runtime_error( "ReducedSample initialise from file - a packed column is not valid" );
+			filePackedColumns[columnNumber]=reinterpret_cast<const uint16_t*>( pMappedFile->data()+columnOffset );
+			fileValueTables[columnNumber]=reinterpret_cast<const float*>( pMappedFile->data()+valueTableOffset );
+			fileValueTableSizes[columnNumber]=valueTableSize;
+		}
+	}
+
+	google::protobuf::io::CodedInputStream::Limit readLimit=codedInput.PushLimit(headerSize);
 	if( !protobufSampleHeader.ParseFromCodedStream( &codedInput ) ) throw std::runtime_error( "ReducedSample initialise from file - some unknown error while reading header" );
 	codedInput.PopLimit(readLimit);
 
-	// Keep looping until there is nothing more to be read from the file.
-	while( codedInput.ReadVarint64( &messageSize ) )
+	if( numberOfColumns!=numberOfParameters() ) throw std::runtime_error( "ReducedSample initialise from file - the number of columns doesn't match the header" );
+	projectHeader( pProjection );
+
+	// The weights are always kept, as the last column
+	std::vector<size_t> keptFileColumns( fileColumnNumbers );
+	keptFileColumns.push_back( numberOfColumns );
+	columns.clear();
+	packedColumns.clear();
+	valueTables.clear();
+	valueTableSizes.clear();
+	for( const auto& fileColumnNumber : keptFileColumns )
 	{
-		readLimit=codedInput.PushLimit(messageSize);
+		if( fileColumnNumber<numberOfColumns ) columns.push_back( fileColumns[fileColumnNumber] );
+		else pWeights=fileColumns[fileColumnNumber];
+		packedColumns.push_back( filePackedColumns[fileColumnNumber] );
+		valueTables.push_back( fileValueTables[fileColumnNumber] );
+		valueTableSizes.push_back( fileValueTableSizes[fileColumnNumber] );
+	}
 
-		// Make sure the CodedInputStream doesn't refuse to read the message because it's
-		// read too much already. I'll also add an arbitrary 50 on to always make sure
-		// I can read the next messageSize if there is one.
-		if( gzipInput.ByteCount()+messageSize+50 > totalBytesLimit )
+	numberOfEvents=storedNumberOfEvents;
+	refreshEventPointers();
+
+	double storedSumOfWeights;
+	std::memcpy( &storedSumOfWeights, &sumOfWeightsBits, sizeof(storedSumOfWeights) );
+	sumOfWeights=storedSumOfWeights;
+}
+
+void l1menu::ReducedSamplePrivateMembers::loadChunkedFormat( int fileDescriptor, l1menu::ReducedSample::Codec codec, size_t numberOfThreads, const l1menu::TriggerMenu* pProjection )
+{
+	//
+	// The version 3 layout is the magic number, varint32 file format version (3) and varint32
+	// codec tag, followed by the header and then each Run as separately compressed frames,
+	// followed by a footer with the index of where each frame is. See
+	// l1menu::implementation::ReducedSampleFooter.
+	//
+	l1menu::implementation::ReducedSampleFooter footer;
+	if( !footer.read( fileDescriptor ) || footer.frames.empty() ) throw std::runtime_error( "ReducedSample initialise from file - the file doesn't have a frame index" );
+
+	l1menu::implementation::readFrame( fileDescriptor, footer.frames.front(), codec, protobufSampleHeader );
+	projectHeader( pProjection );
+
+	// Work out where each Run goes in the columns from the index, so that they can
+	// be decompressed in any order.
+	std::vector<size_t> firstEventOfFrame( footer.frames.size() );
+	size_t totalNumberOfEvents=0;
+	for( size_t frameNumber=1; frameNumber<footer.frames.size(); ++frameNumber )
+	{
+		firstEventOfFrame[frameNumber]=totalNumberOfEvents;
+		totalNumberOfEvents+=footer.frames[frameNumber].numberOfEvents;
+	}
+	if( totalNumberOfEvents!=footer.numberOfEvents ) throw std::runtime_error( "ReducedSample initialise from file - the frame index doesn't match the number of events" );
+
+	ownedColumns.resize( numberOfParameters() );
+	for( auto& column : ownedColumns ) column.resize( totalNumberOfEvents );
+	ownedWeights.resize( totalNumberOfEvents );
+
+	l1menu::tools::parallelFor( footer.frames.size()-1, numberOfThreads, [&]( size_t index )
+	{
+		const size_t frameNumber=index+1; // Skip the header frame
+		l1menuprotobuf::Run run;
+		l1menu::implementation::readFrame( fileDescriptor, footer.frames[frameNumber], codec, run );
+		if( static_cast<size_t>(run.event_size())!=footer.frames[frameNumber].numberOfEvents ) throw std::runtime_error( "ReducedSample initialise from file - a Run doesn't have the number of events in the index" );
+		copyRunToColumns( run, firstEventOfFrame[frameNumber] );
+	} );
+
+	numberOfEvents=totalNumberOfEvents;
+	sumOfWeights=footer.sumOfWeights;
+	refreshColumnPointers();
+}
+
+void l1menu::ReducedSamplePrivateMembers::projectHeader( const l1menu::TriggerMenu* pProjection )
+{
+	numberOfFileColumns=numberOfParameters();
+	fileColumnNumbers.clear();
+	if( pProjection==nullptr )
+	{
+		for( size_t columnNumber=0; columnNumber<numberOfFileColumns; ++columnNumber ) fileColumnNumbers.push_back( columnNumber );
+		return;
+	}
+
+	// Find out where the columns for each trigger in the file start
+	std::vector<size_t> firstColumnOfTrigger;
+	size_t columnNumber=0;
+	for( const auto& trigger : protobufSampleHeader.trigger() )
+	{
+		firstColumnOfTrigger.push_back( columnNumber );
+		columnNumber+=trigger.varying_parameter_size();
+	}
+
+	// Use the same matching as getTriggerParameterIdentifiers, so that any trigger the
+	// projection will be used with is definitely kept. This throws if one isn't there.
+	l1menu::TriggerMenu fileMenu;
+	l1menu::implementation::copyHeaderToTriggerMenu( protobufSampleHeader, fileMenu );
+	std::vector<bool> keepTrigger( protobufSampleHeader.trigger_size(), false );
+	for( size_t triggerNumber=0; triggerNumber<pProjection->numberOfTriggers(); ++triggerNumber )
+	{
+		const auto parameterIdentifiers=l1menu::implementation::getTriggerParameterIdentifiers( fileMenu, pProjection->getTrigger(triggerNumber), false );
+		if( parameterIdentifiers.empty() ) continue; // Nothing stored for this trigger so no columns to keep
+
+		size_t firstColumn=numberOfFileColumns;
+		for( const auto& identifier : parameterIdentifiers ) firstColumn=std::min( firstColumn, identifier.second );
+		for( size_t fileTriggerNumber=0; fileTriggerNumber<firstColumnOfTrigger.size(); ++fileTriggerNumber )
 		{
-			totalBytesLimit+=messageSize*5; // Might as well set it a little higher than necessary while I'm at it.
-			codedInput.SetTotalBytesLimit( totalBytesLimit, -1 );
+			if( firstColumnOfTrigger[fileTriggerNumber]==firstColumn && protobufSampleHeader.trigger(fileTriggerNumber).varying_parameter_size()>0 ) keepTrigger[fileTriggerNumber]=true;
 		}
-		std::unique_ptr<l1menuprotobuf::Run> pNewRun( new l1menuprotobuf::Run );
-		if( !pNewRun->ParseFromCodedStream( &codedInput ) ) throw std::runtime_error( "ReducedSample initialise from file - some unknown error while reading run" );
-		protobufRuns.push_back( std::move( pNewRun ) );
+	}
+
+	// Keep the triggers in the same order they were in the file
+	l1menuprotobuf::SampleHeader projectedHeader;
+	for( size_t fileTriggerNumber=0; fileTriggerNumber<keepTrigger.size(); ++fileTriggerNumber )
+	{
+		if( !keepTrigger[fileTriggerNumber] ) continue;
+
+		const l1menuprotobuf::Trigger& trigger=protobufSampleHeader.trigger(fileTriggerNumber);
+		*projectedHeader.add_trigger()=trigger;
+		for( int index=0; index<trigger.varying_parameter_size(); ++index ) fileColumnNumbers.push_back( firstColumnOfTrigger[fileTriggerNumber]+index );
+	}
+	protobufSampleHeader=projectedHeader;
+}
+
+void l1menu::ReducedSamplePrivateMembers::addTriggerToHeader( const l1menu::ITrigger& trigger )
+{
+	l1menuprotobuf::Trigger* pProtobufTrigger=protobufSampleHeader.add_trigger();
+	pProtobufTrigger->set_name( trigger.name() );
+	pProtobufTrigger->set_version( trigger.version() );
+	pProtobufTrigger->set_exact_thresholds( true );
+
+	// Record all of the parameters. It's not strictly necessary to record the values
+	// of the parameters that are recorded for each event, but I might as well so that
+	// the trigger menu is loaded exactly as it was saved.
+	const auto parameterNames=trigger.parameterNames();
+	for( const auto& parameterName : parameterNames )
+	{
+		l1menuprotobuf::Trigger_TriggerParameter* pProtobufParameter=pProtobufTrigger->add_parameter();
+		pProtobufParameter->set_name(parameterName);
+		pProtobufParameter->set_value( trigger.parameter(parameterName) );
+	}
+
+	// Make a note of the names of the parameters that are recorded for each event. For this
+	// I'm just recording the parameters that refer to the thresholds.
+	const auto thresholdNames=l1menu::tools::getThresholdNames(trigger);
+	for( const auto& thresholdName : thresholdNames ) pProtobufTrigger->add_varying_parameter(thresholdName);
+}
 
-		codedInput.PopLimit(readLimit);
+l1menu::tools::ThresholdExtractor::Method l1menu::ReducedSamplePrivateMembers::thresholdMethod( size_t triggerNumber ) const
+{
+	if( protobufSampleHeader.trigger(triggerNumber).exact_thresholds() ) return l1menu::tools::ThresholdExtractor::Method::EXACT;
+	else return l1menu::tools::ThresholdExtractor::Method::BISECTION;
+}
+
+void l1menu::ReducedSamplePrivateMembers::addEmptyTrigger( const l1menu::ITrigger& trigger )
+{
+	addTriggerToHeader( trigger );
+	mutableTriggerMenu_.addTrigger( trigger );
+	projectHeader( nullptr );
+
+	const size_t numberOfNewColumns=l1menu::tools::getThresholdNames( trigger ).size();
+	ownedColumns.resize( ownedColumns.size()+numberOfNewColumns, std::vector<float>( numberOfEvents, -1 ) );
+	refreshColumnPointers();
+}
+
+size_t l1menu::ReducedSamplePrivateMembers::numberOfParameters() const
+{
+	size_t returnValue=0;
+	for( const auto& trigger : protobufSampleHeader.trigger() ) returnValue+=trigger.varying_parameter_size();
+	return returnValue;
+}
+
+void l1menu::ReducedSamplePrivateMembers::fillRunFromColumns( l1menuprotobuf::Run& run, size_t firstEvent, size_t lastEvent ) const
+{
+	for( size_t eventNumber=firstEvent; eventNumber<lastEvent; ++eventNumber )
+	{
+		l1menuprotobuf::Event* pProtobufEvent=run.add_event();
+		for( size_t parameterNumber=0; parameterNumber<columns.size(); ++parameterNumber ) pProtobufEvent->add_threshold( parameterValue( parameterNumber, eventNumber ) );
+		const float eventWeight=weight( eventNumber );
+		if( eventWeight!=1 ) pProtobufEvent->set_weight( eventWeight );
 	}
+}
 
+void l1menu::ReducedSamplePrivateMembers::appendRun( const l1menuprotobuf::Run& run )
+{
+	const size_t firstEvent=ownedWeights.size();
+	for( auto& column : ownedColumns ) column.resize( firstEvent+run.event_size() );
+	ownedWeights.resize( firstEvent+run.event_size() );
+
+	sumOfWeights+=copyRunToColumns( run, firstEvent );
+	numberOfEvents=ownedWeights.size();
+}
 
-	// Always make sure there is at least one Run ready to be added to. Later
-	// code assumes there is already a run there.
-	if( protobufRuns.empty() )
+double l1menu::ReducedSamplePrivateMembers::copyRunToColumns( const l1menuprotobuf::Run& run, size_t firstEvent )
+{
+	double sumOfRunWeights=0;
+	size_t eventNumber=firstEvent;
+	for( const auto& protobufEvent : run.event() )
 	{
-		std::unique_ptr<l1menuprotobuf::Run> pNewRun( new l1menuprotobuf::Run );
-		protobufRuns.push_back( std::move( pNewRun ) );
+		if( static_cast<size_t>(protobufEvent.threshold_size())!=numberOfFileColumns ) throw std::runtime_error( "ReducedSample - an event has the wrong number of thresholds" );
+		for( size_t parameterNumber=0; parameterNumber<ownedColumns.size(); ++parameterNumber )
+		{
+			ownedColumns[parameterNumber][eventNumber]=protobufEvent.threshold( fileColumnNumbers[parameterNumber] );
+		}
+
+		float weight=1;
+		if( protobufEvent.has_weight() ) weight=protobufEvent.weight();
+		ownedWeights[eventNumber]=weight;
+		sumOfRunWeights+=weight;
+		++eventNumber;
 	}
+	return sumOfRunWeights;
+}
+
+void l1menu::ReducedSamplePrivateMembers::makeColumnsWritable()
+{
+	if( !pMappedFile ) return;
 
-	// Count up the sum of the weights of all events
-	for( const auto& pRun : protobufRuns )
+	ownedColumns.resize( columns.size() );
+	for( size_t parameterNumber=0; parameterNumber<columns.size(); ++parameterNumber )
 	{
-		sumOfWeights+=sumWeights( *pRun );
+		const float* pColumn=floatColumn( parameterNumber, ownedColumns[parameterNumber] );
+		if( pColumn!=ownedColumns[parameterNumber].data() ) ownedColumns[parameterNumber].assign( pColumn, pColumn+numberOfEvents );
 	}
+	const float* pWeightColumn=floatColumn( columns.size(), ownedWeights );
+	if( pWeightColumn!=ownedWeights.data() ) ownedWeights.assign( pWeightColumn, pWeightColumn+numberOfEvents );
 
-	// I have all of the information in the protobuf members, but I also need the trigger information
-	// in the form of l1menu::TriggerMenu. Copy out the required information.
-	for( int triggerNumber=0; triggerNumber<protobufSampleHeader.trigger_size(); ++triggerNumber )
+	refreshColumnPointers();
+	pMappedFile.reset();
+}
+
+void l1menu::ReducedSamplePrivateMembers::refreshColumnPointers()
+{
+	columns.resize( ownedColumns.size() );
+	for( size_t parameterNumber=0; parameterNumber<ownedColumns.size(); ++parameterNumber )
 	{
-		const l1menuprotobuf::Trigger& inputTrigger=protobufSampleHeader.trigger(triggerNumber);
+		columns[parameterNumber]=ownedColumns[parameterNumber].data();
+	}
+	pWeights=ownedWeights.data();
+
+	packedColumns.assign( ownedColumns.size()+1, nullptr );
+	valueTables.assign( ownedColumns.size()+1, nullptr );
+	valueTableSizes.assign( ownedColumns.size()+1, 0 );
+	refreshEventPointers();
+}
+
+void l1menu::ReducedSamplePrivateMembers::refreshEventPointers()
+{
+	event.pColumns_=columns.data();
+	event.pWeights_=pWeights;
+	event.pPackedColumns_=packedColumns.data();
+	event.pValueTables_=valueTables.data();
+	event.pPackedWeights_=packedColumns.back();
+	event.pWeightValueTable_=valueTables.back();
+}
+
+float l1menu::ReducedSamplePrivateMembers::parameterValue( size_t parameterNumber, size_t eventNumber ) const
+{
+	if( packedColumns[parameterNumber]!=nullptr ) return valueTables[parameterNumber][packedColumns[parameterNumber][eventNumber]];
+	else return columns[parameterNumber][eventNumber];
+}
+
+float l1menu::ReducedSamplePrivateMembers::weight( size_t eventNumber ) const
+{
+	if( packedColumns.back()!=nullptr ) return valueTables.back()[packedColumns.back()[eventNumber]];
+	else return pWeights[eventNumber];
+}
 
-		mutableTriggerMenu_.addTrigger( inputTrigger.name(), inputTrigger.version() );
-		// Get a reference to the trigger I just created
-		l1menu::ITrigger& trigger=mutableTriggerMenu_.getTrigger(triggerNumber);
+const float* l1menu::ReducedSamplePrivateMembers::floatColumn( size_t columnNumber, std::vector<float>& buffer ) const
+{
+	if( packedColumns[columnNumber]!=nullptr )
+	{
+		buffer.resize( numberOfEvents );
+		::decodeColumn( packedColumns[columnNumber], valueTables[columnNumber], numberOfEvents, buffer.data() );
+		return buffer.data();
+	}
+	else if( columnNumber<columns.size() ) return columns[columnNumber];
+	else return pWeights;
+}
 
-		// Run through all of the parameters and set them to what they were
-		// when the sample was made.
-		for( int parameterNumber=0; parameterNumber<inputTrigger.parameter_size(); ++parameterNumber )
+void l1menu::ReducedSamplePrivateMembers::saveProtobufFormat( google::protobuf::io::ZeroCopyOutputStream& fileOutput ) const
+{
+	const google::protobuf::int64 payloadStart=fileOutput.ByteCount();
+	{ // Block to make sure the gzip stream is finished before the footer is written
+		google::protobuf::io::GzipOutputStream gzipOutput( &fileOutput );
+		google::protobuf::io::CodedOutputStream codedOutput( &gzipOutput );
+
+		// Write the size of the header message into the file...
+		codedOutput.WriteVarint64( protobufSampleHeader.ByteSize() );
+		// ...and then write the header
+		protobufSampleHeader.SerializeToCodedStream( &codedOutput );
+
+		// Now split the events up into Runs of an arbitrary size, to get around a protobuf
+		// aversion to long messages, and write those the same way.
+		for( size_t firstEvent=0; firstEvent<numberOfEvents; firstEvent+=EVENTS_PER_RUN )
 		{
-			const auto& inputParameter=inputTrigger.parameter(parameterNumber);
-			trigger.parameter(inputParameter.name())=inputParameter.value();
+			l1menuprotobuf::Run run;
+			fillRunFromColumns( run, firstEvent, std::min<size_t>( firstEvent+EVENTS_PER_RUN, numberOfEvents ) );
+			codedOutput.WriteVarint64( run.ByteSize() );
+			run.SerializeToCodedStream( &codedOutput );
 		}
+	} // end of the gzip block
+
+	// Finally write a footer so that the number of events and sum of weights are
+	// available without decompressing the whole file.
+	l1menu::implementation::ReducedSampleFooter footer;
+	footer.numberOfEvents=numberOfEvents;
+	footer.sumOfWeights=sumOfWeights;
+	footer.payloadSize=fileOutput.ByteCount()-payloadStart;
+	footer.write( fileOutput );
+}
 
-		// I should probably check the threshold names exist. I'll do it another time.
+void l1menu::ReducedSamplePrivateMembers::saveColumnarFormat( google::protobuf::io::ZeroCopyOutputStream& fileOutput ) const
+{
+	// See loadColumnarFormat for a description of the layout.
+	google::protobuf::io::CodedOutputStream codedOutput( &fileOutput );
+
+	const size_t numberOfColumns=numberOfParameters();
+	const size_t headerSize=protobufSampleHeader.ByteSize();
+
+	// Work out where everything will go before writing anything, so that the
+	// column offsets can be written up front.
+	size_t preambleSize=l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER.size()+google::protobuf::io::CodedOutputStream::VarintSize32(2);
+	preambleSize+=sizeof(google::protobuf::uint64)*( 4+numberOfColumns+1 )+headerSize;
+	const size_t firstColumnOffset=( (preambleSize+COLUMN_ALIGNMENT-1)/COLUMN_ALIGNMENT )*COLUMN_ALIGNMENT;
+	const size_t columnSize=( (numberOfEvents*sizeof(float)+COLUMN_ALIGNMENT-1)/COLUMN_ALIGNMENT )*COLUMN_ALIGNMENT;
+
+	double sumOfWeightsAsDouble=sumOfWeights;
+	google::protobuf::uint64 sumOfWeightsBits;
+	std::memcpy( &sumOfWeightsBits, &sumOfWeightsAsDouble, sizeof(sumOfWeightsBits) );
+
+	codedOutput.WriteString( l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER );
+	codedOutput.WriteVarint32( 2 );
+	codedOutput.WriteLittleEndian64( numberOfEvents );
+	codedOutput.WriteLittleEndian64( numberOfColumns );
+	codedOutput.WriteLittleEndian64( sumOfWeightsBits );
+	codedOutput.WriteLittleEndian64( headerSize );
+	for( size_t columnNumber=0; columnNumber<=numberOfColumns; ++columnNumber )
+	{
+		codedOutput.WriteLittleEndian64( firstColumnOffset+columnNumber*columnSize );
 	}
+	protobufSampleHeader.SerializeToCodedStream( &codedOutput );
+
+	const std::vector<char> padding( COLUMN_ALIGNMENT, 0 );
+	codedOutput.WriteRaw( padding.data(), firstColumnOffset-preambleSize );
 
+	// Write each of the threshold columns, then the weights as the last column. The
+	// memory layout is already the same as the file layout so they can be written
+	// straight out.
+	std::vector<float> decodeBuffer; // Only used if the sample was loaded from a packed file
+	for( size_t columnNumber=0; columnNumber<=numberOfColumns; ++columnNumber )
+	{
+		const float* pColumn=floatColumn( columnNumber, decodeBuffer );
+
+		codedOutput.WriteRaw( pColumn, numberOfEvents*sizeof(float) );
+		codedOutput.WriteRaw( padding.data(), columnSize-numberOfEvents*sizeof(float) );
+	}
+}
+
+void l1menu::ReducedSamplePrivateMembers::saveChunkedFormat( google::protobuf::io::ZeroCopyOutputStream& fileOutput, l1menu::ReducedSample::Codec codec, size_t numberOfThreads ) const
+{
+	// See loadChunkedFormat for a description of the layout.
+	l1menu::implementation::ReducedSampleFooter footer;
+	footer.numberOfEvents=numberOfEvents;
+	footer.sumOfWeights=sumOfWeights;
+
+	{ // Block to make sure codedOutput is destructed before anything else is written
+		google::protobuf::io::CodedOutputStream codedOutput( &fileOutput );
+		codedOutput.WriteString( l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER );
+		codedOutput.WriteVarint32( 3 );
+		codedOutput.WriteVarint32( static_cast<google::protobuf::uint32>(codec) );
+	}
+	const google::protobuf::int64 payloadStart=fileOutput.ByteCount();
+
+	// Writes the compressed frame to the file and records where it went in the index
+	auto writeToFile=[&]( const std::string& compressedFrame, size_t numberOfEventsInFrame )
+	{
+		l1menu::implementation::ReducedSampleFooter::Frame frame;
+		frame.offset=fileOutput.ByteCount();
+		frame.size=compressedFrame.size();
+		frame.numberOfEvents=numberOfEventsInFrame;
+		footer.frames.push_back( frame );
+
+		google::protobuf::io::CodedOutputStream codedOutput( &fileOutput );
+		codedOutput.WriteRaw( compressedFrame.data(), compressedFrame.size() );
+	};
+
+	std::string compressedHeader;
+	l1menu::implementation::writeFrame( protobufSampleHeader, codec, compressedHeader );
+	writeToFile( compressedHeader, 0 );
+
+	compressRuns( codec, numberOfThreads, writeToFile );
+
+	footer.payloadSize=fileOutput.ByteCount()-payloadStart;
+	footer.write( fileOutput );
+}
+
+void l1menu::ReducedSamplePrivateMembers::compressRuns( l1menu::ReducedSample::Codec codec, size_t numberOfThreads, const std::function<void(const std::string&,size_t)>& writeFrame ) const
+{
+	if( numberOfThreads==0 ) numberOfThreads=l1menu::tools::defaultNumberOfThreads();
+
+	// Compress the Runs in batches, so that only a few compressed Runs per thread are
+	// held in memory. Each Run is compressed independently and written in order, so the
+	// output is the same whatever the number of threads.
+	const size_t numberOfRuns=(numberOfEvents+EVENTS_PER_RUN-1)/EVENTS_PER_RUN;
+	const size_t runsPerBatch=numberOfThreads*4;
+	std::vector<std::string> compressedRuns( runsPerBatch );
+	for( size_t firstRunOfBatch=0; firstRunOfBatch<numberOfRuns; firstRunOfBatch+=runsPerBatch )
+	{
+		const size_t runsInThisBatch=std::min( runsPerBatch, numberOfRuns-firstRunOfBatch );
+
+		l1menu::tools::parallelFor( runsInThisBatch, numberOfThreads, [&]( size_t index )
+		{
+			const size_t firstEvent=(firstRunOfBatch+index)*EVENTS_PER_RUN;
+			l1menuprotobuf::Run run;
+			fillRunFromColumns( run, firstEvent, std::min<size_t>( firstEvent+EVENTS_PER_RUN, numberOfEvents ) );
+			compressedRuns[index].clear();
+			l1menu::implementation::writeFrame( run, codec, compressedRuns[index] );
+		} );
+
+		for( size_t index=0; index<runsInThisBatch; ++index )
+		{
+			const size_t firstEvent=(firstRunOfBatch+index)*EVENTS_PER_RUN;
+			writeFrame( compressedRuns[index], std::min<size_t>( EVENTS_PER_RUN, numberOfEvents-firstEvent ) );
+		}
+	}
+}
+
+void l1menu::ReducedSamplePrivateMembers::savePackedColumnarFormat( google::protobuf::io::ZeroCopyOutputStream& fileOutput, size_t numberOfThreads ) const
+{
+	// See loadPackedColumnarFormat for a description of the layout.
+	const size_t numberOfColumns=numberOfParameters();
+	const size_t headerSize=protobufSampleHeader.ByteSize();
+
+	// Pack every column first, since the size of the value tables is needed to work out where
+	// everything goes. Columns that are already packed are used as they are. Columns that can't
+	// be packed are left empty and written as floats.
+	std::vector< std::vector<float> > newValueTables( numberOfColumns+1 );
+	std::vector< std::vector<uint16_t> > newPackedColumns( numberOfColumns+1 );
+	std::vector<const uint16_t*> codesToWrite( packedColumns );
+	std::vector<const float*> valueTablesToWrite( valueTables );
+	std::vector<size_t> valueTableSizesToWrite( valueTableSizes );
+	l1menu::tools::parallelFor( numberOfColumns+1, numberOfThreads, [&]( size_t columnNumber )
+	{
+		if( packedColumns[columnNumber]!=nullptr || numberOfEvents==0 ) return;
+
+		const float* pColumn=( columnNumber<numberOfColumns ? columns[columnNumber] : pWeights );
+		const bool isThresholdColumn=( columnNumber<numberOfColumns );
+		if( ::packColumn( pColumn, numberOfEvents, isThresholdColumn, newValueTables[columnNumber], newPackedColumns[columnNumber] ) )
+		{
+			codesToWrite[columnNumber]=newPackedColumns[columnNumber].data();
+			valueTablesToWrite[columnNumber]=newValueTables[columnNumber].data();
+			valueTableSizesToWrite[columnNumber]=newValueTables[columnNumber].size();
+		}
+	} );
+
+	// Now work out where everything will go
+	size_t preambleSize=l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER.size()+google::protobuf::io::CodedOutputStream::VarintSize32(4);
+	preambleSize+=sizeof(google::protobuf::uint64)*( 4+3*(numberOfColumns+1) )+headerSize;
+	const size_t firstValueTableOffset=( (preambleSize+sizeof(float)-1)/sizeof(float) )*sizeof(float);
+	std::vector<size_t> valueTableOffsets( numberOfColumns+1 );
+	size_t nextOffset=firstValueTableOffset;
+	for( size_t columnNumber=0; columnNumber<=numberOfColumns; ++columnNumber )
+	{
+		valueTableOffsets[columnNumber]=nextOffset;
+		nextOffset+=valueTableSizesToWrite[columnNumber]*sizeof(float);
+	}
+	const size_t valueTablesEnd=nextOffset;
+	std::vector<size_t> columnOffsets( numberOfColumns+1 );
+	nextOffset=( (nextOffset+COLUMN_ALIGNMENT-1)/COLUMN_ALIGNMENT )*COLUMN_ALIGNMENT;
+	for( size_t columnNumber=0; columnNumber<=numberOfColumns; ++columnNumber )
+	{
+		columnOffsets[columnNumber]=nextOffset;
+		const size_t bytesPerEvent=( codesToWrite[columnNumber]!=nullptr ? sizeof(uint16_t) : sizeof(float) );
+		nextOffset+=( (numberOfEvents*bytesPerEvent+COLUMN_ALIGNMENT-1)/COLUMN_ALIGNMENT )*COLUMN_ALIGNMENT;
+	}
+
+	double sumOfWeightsAsDouble=sumOfWeights;
+	google::protobuf::uint64 sumOfWeightsBits;
+	std::memcpy( &sumOfWeightsBits, &sumOfWeightsAsDouble, sizeof(sumOfWeightsBits) );
+
+	google::protobuf::io::CodedOutputStream codedOutput( &fileOutput );
+	codedOutput.WriteString( l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER );
+	codedOutput.WriteVarint32( 4 );
+	codedOutput.WriteLittleEndian64( numberOfEvents );
+	codedOutput.WriteLittleEndian64( numberOfColumns );
+	codedOutput.WriteLittleEndian64( sumOfWeightsBits );
+	codedOutput.WriteLittleEndian64( headerSize );
+	for( size_t columnNumber=0; columnNumber<=numberOfColumns; ++columnNumber )
+	{
+		codedOutput.WriteLittleEndian64( columnOffsets[columnNumber] );
+		codedOutput.WriteLittleEndian64( valueTableOffsets[columnNumber] );
+		codedOutput.WriteLittleEndian64( valueTableSizesToWrite[columnNumber] );
+	}
+	protobufSampleHeader.SerializeToCodedStream( &codedOutput );
+
+	const std::vector<char> padding( COLUMN_ALIGNMENT, 0 );
+	codedOutput.WriteRaw( padding.data(), firstValueTableOffset-preambleSize );
+	for( size_t columnNumber=0; columnNumber<=numberOfColumns; ++columnNumber )
+	{
+		codedOutput.WriteRaw( valueTablesToWrite[columnNumber], valueTableSizesToWrite[columnNumber]*sizeof(float) );
+	}
+	codedOutput.WriteRaw( padding.data(), columnOffsets.front()-valueTablesEnd );
+
+	std::vector<float> decodeBuffer;
+	for( size_t columnNumber=0; columnNumber<=numberOfColumns; ++columnNumber )
+	{
+		size_t columnSize;
+		if( codesToWrite[columnNumber]!=nullptr )
+		{
+			columnSize=numberOfEvents*sizeof(uint16_t);
+			codedOutput.WriteRaw( codesToWrite[columnNumber], columnSize );
+		}
+		else
+		{
+			columnSize=numberOfEvents*sizeof(float);
+			codedOutput.WriteRaw( floatColumn( columnNumber, decodeBuffer ), columnSize );
+		}
+		const size_t nextColumnOffset=( columnNumber<numberOfColumns ? columnOffsets[columnNumber+1] : nextOffset );
+		codedOutput.WriteRaw( padding.data(), nextColumnOffset-columnOffsets[columnNumber]-columnSize );
+	}
+}
+
+template<class T_Sample> void l1menu::ReducedSamplePrivateMembers::addEvents( const T_Sample& originalSample, size_t firstEventNumber, size_t lastEventNumber )
+{
+	checkNewTriggersAreComplete( "addSample" );
+
+	// If the sample is memory mapped it can't be changed, so copy it into memory first
+	makeColumnsWritable();
+
+	const size_t numberOfNewEvents=lastEventNumber-firstEventNumber;
+	for( auto& column : ownedColumns ) column.reserve( column.size()+numberOfNewEvents );
+	ownedWeights.reserve( ownedWeights.size()+numberOfNewEvents );
+
+	// Everything that doesn't depend on the event is worked out once here. If the sample was made before
+	// exact thresholds were used, the new events use the same bisection as the ones already there.
+	std::vector<l1menu::tools::ThresholdExtractor> extractors;
+	for( size_t triggerNumber=0; triggerNumber<triggerMenu.numberOfTriggers(); ++triggerNumber )
+	{
+		extractors.push_back( l1menu::tools::ThresholdExtractor( triggerMenu.getTrigger(triggerNumber), 0.001, thresholdMethod(triggerNumber) ) );
+	}
+
+	std::vector<float> thresholds( ownedColumns.size() );
+
+	// The FullSample reads and decodes the next events in the background while the thresholds are worked out,
+	// the ObjectCacheSample just fills each event from the memory mapped file
+	originalSample.forEachFullEvent( firstEventNumber, lastEventNumber, [&]( const l1menu::L1TriggerDPGEvent& event )
+	{
+		ownedWeights.push_back( event.weight() );
+
+		// The index of the column that the next threshold should be written to
+		size_t parameterNumber=0;
+
+		// Loop over all of the triggers. If an event can't pass a trigger the extractor
+		// records -1 for all of its thresholds, so the status isn't needed here.
+		for( auto& extractor : extractors )
+		{
+			extractor.extract( event, thresholds.data()+parameterNumber );
+			parameterNumber+=extractor.numberOfThresholds();
+		} // end of loop over triggers
+
+		for( size_t columnNumber=0; columnNumber<ownedColumns.size(); ++columnNumber ) ownedColumns[columnNumber].push_back( thresholds[columnNumber] );
+
+		sumOfWeights+=event.weight();
+	} ); // end of loop over events
+
+	l1menu::tools::Profiler::instance().addProcessedEvents( numberOfNewEvents );
+	numberOfEvents=ownedWeights.size();
+	refreshColumnPointers();
+}
+
+template<class T_Sample> void l1menu::ReducedSamplePrivateMembers::addTriggerColumns( const l1menu::ReducedSample& thisObject, const T_Sample& originalSample, const l1menu::TriggerMenu& triggers, size_t firstEventNumber )
+{
+	const size_t numberOfOriginalEvents=originalSample.numberOfEvents();
+	if( firstEventNumber+numberOfOriginalEvents>numberOfEvents ) throw std::runtime_error( "ReducedSample::addTriggerColumns - the original sample has more events than are left in the ReducedSample" );
+
+	// Triggers that were already in the sample are skipped. The only ones that are calculated are the new
+	// ones, or the ones an earlier call added that still need the rest of the events.
+	std::vector<size_t> triggerNumbers; // The positions in triggerMenu of the triggers to calculate
+	std::vector<const l1menu::ITrigger*> newTriggers;
+	for( size_t triggerNumber=0; triggerNumber<triggers.numberOfTriggers(); ++triggerNumber )
+	{
+		const l1menu::ITrigger& trigger=triggers.getTrigger(triggerNumber);
+		if( !thisObject.containsTrigger( trigger ) ) newTriggers.push_back( &trigger );
+		else
+		{
+			for( const auto incompleteTriggerNumber : incompleteTriggerNumbers )
+			{
+				const l1menu::ITrigger& incompleteTrigger=triggerMenu.getTrigger(incompleteTriggerNumber);
+				if( incompleteTrigger.name()==trigger.name() && incompleteTrigger.version()==trigger.version() ) triggerNumbers.push_back( incompleteTriggerNumber );
+			}
+		}
+	}
+	if( newTriggers.empty() && triggerNumbers.empty() ) return;
+	if( firstEventNumber!=numberOfEventsWithNewTriggers ) throw std::runtime_error( "ReducedSample::addTriggerColumns - the original samples have to be given in order, so the first event should be number "+std::to_string(numberOfEventsWithNewTriggers) );
+	if( !newTriggers.empty() && !incompleteTriggerNumbers.empty() ) throw std::runtime_error( "ReducedSample::addTriggerColumns - new triggers can't be added until the ones from the earlier calls have been done for every event" );
+	if( triggerNumbers.size()!=incompleteTriggerNumbers.size() ) throw std::runtime_error( "ReducedSample::addTriggerColumns - every trigger added by the earlier calls has to be given, until all of the events have been done" );
+
+	// If the sample is memory mapped it can't be changed, so copy it into memory first
+	makeColumnsWritable();
+
+	// Up to two of the triggers that were already in the sample are recalculated and compared to the
+	// thresholds recorded, to check that the events really are the ones the sample was made from. The
+	// files don't record the run, lumi section or event numbers, and matching the weights doesn't prove
+	// anything when they're all the same.
+	std::vector<l1menu::tools::ThresholdExtractor> checkExtractors;
+	std::vector< std::vector<size_t> > checkColumns;
+	std::vector<std::string> checkTriggerNames;
+	std::vector<bool> checkBisected;
+	for( size_t triggerNumber=0; triggerNumber<triggerMenu.numberOfTriggers() && checkExtractors.size()<2; ++triggerNumber )
+	{
+		if( std::find( incompleteTriggerNumbers.begin(), incompleteTriggerNumbers.end(), triggerNumber )!=incompleteTriggerNumbers.end() ) continue;
+		checkExtractors.push_back( l1menu::tools::ThresholdExtractor( triggerMenu.getTrigger(triggerNumber), 0.001, thresholdMethod(triggerNumber) ) );
+		checkTriggerNames.push_back( triggerMenu.getTrigger(triggerNumber).name() );
+		checkBisected.push_back( thresholdMethod(triggerNumber)==l1menu::tools::ThresholdExtractor::Method::BISECTION );
+		const auto parameterIdentifiers=thisObject.getTriggerParameterIdentifiers( triggerMenu.getTrigger(triggerNumber) );
+		checkColumns.push_back( std::vector<size_t>() );
+		for( const auto& thresholdName : checkExtractors.back().thresholdNames() ) checkColumns.back().push_back( parameterIdentifiers.at(thresholdName) );
+	}
+
+	// Add new columns at the end for the new triggers. These start off as -1 ("never passes") for every
+	// event, until they're filled by this and subsequent calls.
+	for( const auto pTrigger : newTriggers )
+	{
+		addEmptyTrigger( *pTrigger );
+		triggerNumbers.push_back( triggerMenu.numberOfTriggers()-1 );
+	}
+	incompleteTriggerNumbers=triggerNumbers;
+
+	std::vector<l1menu::tools::ThresholdExtractor> extractors;
+	std::vector< std::vector<size_t> > columns;
+	size_t maximumNumberOfThresholds=0;
+	for( const auto triggerNumber : triggerNumbers )
+	{
+		extractors.push_back( l1menu::tools::ThresholdExtractor( triggerMenu.getTrigger(triggerNumber), 0.001, thresholdMethod(triggerNumber) ) );
+		const auto parameterIdentifiers=thisObject.getTriggerParameterIdentifiers( triggerMenu.getTrigger(triggerNumber) );
+		columns.push_back( std::vector<size_t>() );
+		for( const auto& thresholdName : extractors.back().thresholdNames() ) columns.back().push_back( parameterIdentifiers.at(thresholdName) );
+		maximumNumberOfThresholds=std::max( maximumNumberOfThresholds, extractors.back().numberOfThresholds() );
+	}
+	for( const auto& extractor : checkExtractors ) maximumNumberOfThresholds=std::max( maximumNumberOfThresholds, extractor.numberOfThresholds() );
+
+	std::vector<float> thresholds( maximumNumberOfThresholds );
+	size_t reducedEventNumber=firstEventNumber;
+	originalSample.forEachFullEvent( 0, numberOfOriginalEvents, [&]( const l1menu::L1TriggerDPGEvent& event )
+	{
+		if( event.weight()!=ownedWeights[reducedEventNumber] ) throw std::runtime_error( "ReducedSample::addTriggerColumns - the weight of an event doesn't match, so the original sample isn't the one the ReducedSample was made from (or the files are in a different order)" );
+		for( size_t checkNumber=0; checkNumber<checkExtractors.size(); ++checkNumber )
+		{
+			checkExtractors[checkNumber].extract( event, thresholds.data() );
+			for( size_t index=0; index<checkColumns[checkNumber].size(); ++index )
+			{
+				const l1menu::tools::ThresholdExtractor& extractor=checkExtractors[checkNumber];
+				const float recordedThreshold=ownedColumns[checkColumns[checkNumber][index]][reducedEventNumber];
+				if( !thresholdsAgree( recordedThreshold, thresholds[index], checkBisected[checkNumber], extractor.bisectionTolerance(index), extractor.searchLimit(index) ) )
+				{
+					throw std::runtime_error( "ReducedSample::addTriggerColumns - the thresholds of "+checkTriggerNames[checkNumber]+" for event "+std::to_string(reducedEventNumber)+" don't match, so the original sample isn't the one the ReducedSample was made from (or the files are in a different order)" );
+				}
+			}
+		}
+
+		for( size_t triggerNumber=0; triggerNumber<extractors.size(); ++triggerNumber )
+		{
+			extractors[triggerNumber].extract( event, thresholds.data() );
+			for( size_t index=0; index<columns[triggerNumber].size(); ++index ) ownedColumns[columns[triggerNumber][index]][reducedEventNumber]=thresholds[index];
+		}
+		++reducedEventNumber;
+	} );
+	l1menu::tools::Profiler::instance().addProcessedEvents( numberOfOriginalEvents );
+
+	numberOfEventsWithNewTriggers=firstEventNumber+numberOfOriginalEvents;
+	if( numberOfEventsWithNewTriggers==numberOfEvents )
+	{
+		incompleteTriggerNumbers.clear();
+		numberOfEventsWithNewTriggers=0;
+	}
+}
+
+void l1menu::ReducedSamplePrivateMembers::checkNewTriggersAreComplete( const std::string& functionName ) const
+{
+	if( !incompleteTriggerNumbers.empty() )
+	{
+		throw std::runtime_error( "ReducedSample::"+functionName+" - addTriggerColumns has only calculated the new triggers for "+std::to_string(numberOfEventsWithNewTriggers)
+				+" of the "+std::to_string(numberOfEvents)+" events, so the rest of the original samples need adding first" );
+	}
 }
 
 l1menu::ReducedSample::ReducedSample( const l1menu::FullSample& originalSample, const l1menu::TriggerMenu& triggerMenu )
@@ -271,14 +1210,27 @@ l1menu::ReducedSample::ReducedSample( const l1menu::FullSample& originalSample,
 	setEventRate( originalSample.eventRate() );
 }
 
+l1menu::ReducedSample::ReducedSample( const l1menu::ObjectCacheSample& originalSample, const l1menu::TriggerMenu& triggerMenu )
+	: pImple_( new l1menu::ReducedSamplePrivateMembers( *this, triggerMenu ) )
+{
+	addSample( originalSample );
+	setEventRate( originalSample.eventRate() );
+}
+
 l1menu::ReducedSample::ReducedSample( const l1menu::TriggerMenu& triggerMenu )
 	: pImple_( new l1menu::ReducedSamplePrivateMembers( *this, triggerMenu ) )
 {
 	// No operation besides the initialiser list
 }
 
-l1menu::ReducedSample::ReducedSample( const std::string& filename )
-	: pImple_( new l1menu::ReducedSamplePrivateMembers( *this, filename ) )
+l1menu::ReducedSample::ReducedSample( const std::string& filename, size_t numberOfThreads )
+	: pImple_( new l1menu::ReducedSamplePrivateMembers( *this, filename, nullptr, numberOfThreads ) )
+{
+	// No operation except the initialiser list
+}
+
+l1menu::ReducedSample::ReducedSample( const std::string& filename, const l1menu::TriggerMenu& projection, size_t numberOfThreads )
+	: pImple_( new l1menu::ReducedSamplePrivateMembers( *this, filename, &projection, numberOfThreads ) )
 {
 	// No operation except the initialiser list
 }
@@ -292,99 +1244,233 @@ l1menu::ReducedSample::~ReducedSample()
 
 void l1menu::ReducedSample::addSample( const l1menu::FullSample& originalSample )
 {
-	l1menuprotobuf::Run* pCurrentRun=pImple_->protobufRuns.back().get();
+	addSample( originalSample, 0, originalSample.numberOfEvents() );
+}
 
-	for( size_t eventNumber=0; eventNumber<originalSample.numberOfEvents(); ++eventNumber )
+void l1menu::ReducedSample::addSample( const l1menu::FullSample& originalSample, size_t firstEventNumber, size_t lastEventNumber )
+{
+	if( lastEventNumber>originalSample.numberOfEvents() || firstEventNumber>lastEventNumber ) throw std::runtime_error( "ReducedSample::addSample - the range of events requested is not in the FullSample" );
+	pImple_->addEvents( originalSample, firstEventNumber, lastEventNumber );
+}
+
+void l1menu::ReducedSample::addSample( const l1menu::ObjectCacheSample& originalSample )
+{
+	addSample( originalSample, 0, originalSample.numberOfEvents() );
+}
+
+void l1menu::ReducedSample::addSample( const l1menu::ObjectCacheSample& originalSample, size_t firstEventNumber, size_t lastEventNumber )
+{
+	if( lastEventNumber>originalSample.numberOfEvents() || firstEventNumber>lastEventNumber ) throw std::runtime_error( "ReducedSample::addSample - the range of events requested is not in the ObjectCacheSample" );
+	pImple_->addEvents( originalSample, firstEventNumber, lastEventNumber );
+}
+
+void l1menu::ReducedSample::addTriggerColumns( const l1menu::FullSample& originalSample, const l1menu::TriggerMenu& triggers, size_t firstEventNumber )
+{
+	pImple_->addTriggerColumns( *this, originalSample, triggers, firstEventNumber );
+}
+
+void l1menu::ReducedSample::addTriggerColumns( const l1menu::ObjectCacheSample& originalSample, const l1menu::TriggerMenu& triggers, size_t firstEventNumber )
+{
+	pImple_->addTriggerColumns( *this, originalSample, triggers, firstEventNumber );
+}
+
+void l1menu::ReducedSample::addSample( const l1menu::ReducedSample& otherSample )
+{
+	if( &otherSample==this ) throw std::runtime_error( "ReducedSample::addSample - can't add a sample to itself" );
+	const l1menu::ReducedSamplePrivateMembers& other=*otherSample.pImple_;
+	pImple_->checkNewTriggersAreComplete( "addSample" );
+	other.checkNewTriggersAreComplete( "addSample" );
+	if( !l1menu::implementation::thresholdMethodsMatch( other.protobufSampleHeader, pImple_->protobufSampleHeader ) ) throw std::runtime_error( "ReducedSample::addSample - one of the samples has exact thresholds and the other was made by an older version using bisection, so they can't be mixed" );
+	if( !l1menu::implementation::headersMatch( other.protobufSampleHeader, pImple_->protobufSampleHeader ) ) throw std::runtime_error( "ReducedSample::addSample - the samples were made with different triggers" );
+
+	// If the sample is memory mapped it can't be changed, so copy it into memory first
+	pImple_->makeColumnsWritable();
+
+	auto& ownedColumns=pImple_->ownedColumns;
+	auto& ownedWeights=pImple_->ownedWeights;
+
+	// The other sample could be packed, so floatColumn decodes it into the buffer if required
+	std::vector<float> buffer;
+	for( size_t columnNumber=0; columnNumber<ownedColumns.size(); ++columnNumber )
 	{
-		// Split the events up into groups in arbitrary numbers. This is to get around
-		// a protobuf aversion to long messages.
-		if( pCurrentRun->event_size() >= pImple_->EVENTS_PER_RUN )
+		const float* pColumn=other.floatColumn( columnNumber, buffer );
+		ownedColumns[columnNumber].insert( ownedColumns[columnNumber].end(), pColumn, pColumn+other.numberOfEvents );
+	}
+	const float* pOtherWeights=other.floatColumn( ownedColumns.size(), buffer );
+	ownedWeights.insert( ownedWeights.end(), pOtherWeights, pOtherWeights+other.numberOfEvents );
+
+	// Add the weights one at a time rather than adding other.sumOfWeights, so that the result
+	// is exactly the same as if the events had all been added to this sample in the first place.
+	for( size_t eventNumber=0; eventNumber<other.numberOfEvents; ++eventNumber ) pImple_->sumOfWeights+=pOtherWeights[eventNumber];
+	pImple_->numberOfEvents=ownedWeights.size();
+	pImple_->refreshColumnPointers();
+}
+
+bool l1menu::ReducedSample::codecIsAvailable( Codec codec )
+{
+	return l1menu::implementation::compressionCodecIsAvailable( codec );
+}
+
+void l1menu::ReducedSample::mergeFiles( const std::vector<std::string>& inputFilenames, const std::string& outputFilename, Codec codec, size_t numberOfThreads )
+{
+	if( inputFilenames.empty() ) throw std::runtime_error( "ReducedSample merge files - no input files were given" );
+	if( std::find( inputFilenames.begin(), inputFilenames.end(), outputFilename )!=inputFilenames.end() ) throw std::runtime_error( "ReducedSample merge files - the output file can't also be one of the inputs" );
+	// Throws if the codec wasn't compiled in, before the output file is overwritten
+	l1menu::implementation::getCompressionCodec( codec );
+
+	int outputFileDescriptor = open( outputFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if( outputFileDescriptor<0 ) throw std::runtime_error( "ReducedSample merge files - couldn't open the output file" );
+	l1menu::implementation::UnixFileSentry outputFileSentry( outputFileDescriptor );
+	google::protobuf::io::FileOutputStream fileOutput( outputFileDescriptor );
+
+	// The output is always the chunked format. See ReducedSamplePrivateMembers::loadChunkedFormat
+	// for a description of the layout.
+	{ // Block to make sure codedOutput is destructed before anything else is written
+		google::protobuf::io::CodedOutputStream codedOutput( &fileOutput );
+		codedOutput.WriteString( l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER );
+		codedOutput.WriteVarint32( 3 );
+		codedOutput.WriteVarint32( static_cast<google::protobuf::uint32>(codec) );
+	}
+	const google::protobuf::int64 payloadStart=fileOutput.ByteCount();
+
+	l1menu::implementation::ReducedSampleFooter footer;
+	auto writeToFile=[&]( const std::string& compressedFrame, size_t numberOfEventsInFrame )
+	{
+		l1menu::implementation::ReducedSampleFooter::Frame frame;
+		frame.offset=fileOutput.ByteCount();
+		frame.size=compressedFrame.size();
+		frame.numberOfEvents=numberOfEventsInFrame;
+		footer.frames.push_back( frame );
+
+		google::protobuf::io::CodedOutputStream codedOutput( &fileOutput );
+		codedOutput.WriteRaw( compressedFrame.data(), compressedFrame.size() );
+	};
+
+	// The header of the first file is written to the output, and every other file has to match it
+	l1menuprotobuf::SampleHeader firstHeader;
+	bool headerWritten=false;
+	auto checkHeader=[&]( const l1menuprotobuf::SampleHeader& header, const std::string& inputFilename )
+	{
+		if( !headerWritten )
 		{
-			// Gone over the arbitrary limit, so create a new protobuf Run and start
-			// using that instead.
-			std::unique_ptr<l1menuprotobuf::Run> pNewRun( new l1menuprotobuf::Run );
-			pImple_->protobufRuns.push_back( std::move( pNewRun ) );
-			pCurrentRun=pImple_->protobufRuns.back().get();
+			headerWritten=true;
+			firstHeader=header;
+			std::string compressedHeader;
+			l1menu::implementation::writeFrame( header, codec, compressedHeader );
+			writeToFile( compressedHeader, 0 );
 		}
+		else if( !l1menu::implementation::thresholdMethodsMatch( header, firstHeader ) ) throw std::runtime_error( "ReducedSample merge files - "+inputFilename+" and "+inputFilenames.front()+" found the thresholds in different ways (exact or bisection by an older version), so they can't be mixed" );
+		else if( !l1menu::implementation::headersMatch( header, firstHeader ) ) throw std::runtime_error( "ReducedSample merge files - "+inputFilename+" was made with different triggers to "+inputFilenames.front() );
+	};
 
-		const l1menu::L1TriggerDPGEvent& event=originalSample.getFullEvent( eventNumber );
-		l1menuprotobuf::Event* pProtobufEvent=pCurrentRun->add_event();
-		if( event.weight()!=1 ) pProtobufEvent->set_weight( event.weight() );
+	for( const auto& inputFilename : inputFilenames )
+	{
+		int inputFileDescriptor = open( inputFilename.c_str(), O_RDONLY );
+		if( inputFileDescriptor<0 ) throw std::runtime_error( "ReducedSample merge files - couldn't open "+inputFilename );
+		l1menu::implementation::UnixFileSentry inputFileSentry( inputFileDescriptor );
 
-		// Loop over all of the triggers
-		for( size_t triggerNumber=0; triggerNumber<pImple_->triggerMenu.numberOfTriggers(); ++triggerNumber )
-		{
-			std::unique_ptr<l1menu::ITrigger> pTrigger=pImple_->triggerMenu.getTriggerCopy(triggerNumber);
-			std::vector<std::string> thresholdNames=l1menu::tools::getThresholdNames(*pTrigger);
+		google::protobuf::uint32 fileformatVersion;
+		Codec inputCodec=Codec::GZIP;
+		{ // Block to make sure the streams are destructed before the file is used for anything else
+			google::protobuf::io::FileInputStream fileInput( inputFileDescriptor );
+			google::protobuf::io::CodedInputStream codedInput( &fileInput );
+			std::string readMagicNumber;
+			if( !codedInput.ReadString( &readMagicNumber, l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER.size() ) || readMagicNumber!=l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER ) throw std::runtime_error( "ReducedSample merge files - "+inputFilename+" is not a ReducedSample" );
+			if( !codedInput.ReadVarint32( &fileformatVersion ) ) throw std::runtime_error( "ReducedSample merge files - error reading the file format version of "+inputFilename );
+			if( fileformatVersion==3 ) inputCodec=l1menu::implementation::readCodecTag( codedInput );
+		}
 
-			try
+		if( fileformatVersion==3 && inputCodec==codec )
+		{
+			// The frames are already compressed the right way, so they can be copied across
+			// as they are. Only the header needs to be decompressed, to check it matches.
+			l1menu::implementation::ReducedSampleFooter inputFooter;
+			if( !inputFooter.read( inputFileDescriptor ) || inputFooter.frames.empty() ) throw std::runtime_error( "ReducedSample merge files - "+inputFilename+" doesn't have a frame index" );
+
+			l1menuprotobuf::SampleHeader header;
+			l1menu::implementation::readFrame( inputFileDescriptor, inputFooter.frames.front(), inputCodec, header );
+			checkHeader( header, inputFilename );
+
+			std::string compressedFrame;
+			size_t numberOfEventsInFile=0;
+			for( size_t frameNumber=1; frameNumber<inputFooter.frames.size(); ++frameNumber )
 			{
-				l1menu::tools::setTriggerThresholdsAsTightAsPossible( event, *pTrigger, 0.001 );
-				// Set all of the parameters to match the thresholds in the trigger
-				for( const auto& thresholdName : thresholdNames )
-				{
-					pProtobufEvent->add_threshold( pTrigger->parameter(thresholdName) );
-				}
+				l1menu::implementation::readCompressedFrame( inputFileDescriptor, inputFooter.frames[frameNumber], compressedFrame );
+				writeToFile( compressedFrame, inputFooter.frames[frameNumber].numberOfEvents );
+				numberOfEventsInFile+=inputFooter.frames[frameNumber].numberOfEvents;
 			}
-			catch( std::exception& error )
-			{
-				// setTriggerThresholdsAsTightAsPossible() couldn't find thresholds so record
-				// -1 for everything.
-				// Range based for loop gives me a warning because I don't use the thresholdName.
-				for( size_t index=0; index<thresholdNames.size(); ++index ) pProtobufEvent->add_threshold(-1);
-			} // end of try block that sets the trigger thresholds
+			if( numberOfEventsInFile!=inputFooter.numberOfEvents ) throw std::runtime_error( "ReducedSample merge files - the frame index of "+inputFilename+" doesn't match the number of events" );
 
-		} // end of loop over triggers
+			footer.numberOfEvents+=inputFooter.numberOfEvents;
+			footer.sumOfWeights+=inputFooter.sumOfWeights;
+		}
+		else
+		{
+			// Anything else has to be decoded and compressed again
+			l1menu::ReducedSample inputSample( inputFilename, numberOfThreads );
+			checkHeader( inputSample.pImple_->protobufSampleHeader, inputFilename );
+			inputSample.pImple_->compressRuns( codec, numberOfThreads, writeToFile );
+
+			footer.numberOfEvents+=inputSample.pImple_->numberOfEvents;
+			footer.sumOfWeights+=inputSample.pImple_->sumOfWeights;
+		}
+	}
 
-		pImple_->sumOfWeights+=event.weight();
-	} // end of loop over events
+	footer.payloadSize=fileOutput.ByteCount()-payloadStart;
+	footer.write( fileOutput );
 }
 
-void l1menu::ReducedSample::saveToFile( const std::string& filename ) const
+void l1menu::ReducedSample::saveToFile( const std::string& filename, unsigned int fileFormatVersion, size_t numberOfThreads, Codec codec ) const
 {
+	if( fileFormatVersion<1 || fileFormatVersion>4 ) throw std::runtime_error( "ReducedSample save to file - unknown file format version requested" );
+	if( fileFormatVersion!=3 && codec!=Codec::GZIP ) throw std::runtime_error( "ReducedSample save to file - the compression codec can only be chosen for file format version 3" );
+	// Throws if the codec wasn't compiled in, before the file is overwritten
+	l1menu::implementation::getCompressionCodec( codec );
+	pImple_->checkNewTriggersAreComplete( "saveToFile" );
+
 	// Open the file. Parameters are filename, write ability and create, rw-r--r-- permissions.
-	int fileDescriptor = open( filename.c_str(), O_WRONLY | O_CREAT, 0644 );
-	if( fileDescriptor==0 ) throw std::runtime_error( "ReducedSample save to file - couldn't open file" );
-	::UnixFileSentry fileSentry( fileDescriptor ); // Use this as an exception safe way of closing the output file
+	int fileDescriptor = open( filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if( fileDescriptor<0 ) throw std::runtime_error( "ReducedSample save to file - couldn't open file" );
+	l1menu::implementation::UnixFileSentry fileSentry( fileDescriptor ); // Use this as an exception safe way of closing the output file
 
 	// Setup the protobuf file handlers
 	google::protobuf::io::FileOutputStream fileOutput( fileDescriptor );
 
+	// The columnar format writes its own preamble because it needs to know
+	// the size of it to align the columns.
+	if( fileFormatVersion==2 )
+	{
+		pImple_->saveColumnarFormat( fileOutput );
+		return;
+	}
+	else if( fileFormatVersion==3 )
+	{
+		pImple_->saveChunkedFormat( fileOutput, codec, numberOfThreads );
+		return;
+	}
+	else if( fileFormatVersion==4 )
+	{
+		pImple_->savePackedColumnarFormat( fileOutput, numberOfThreads );
+		return;
+	}
+
 	// I want the magic number and file format identifier uncompressed, so
 	// I'll write those before switching to using gzipped output.
 	{ // Block to make sure codedOutput is destructed before the gzip version is created
 		google::protobuf::io::CodedOutputStream codedOutput( &fileOutput );
 
 		// Write a magic number at the start of all files
-		codedOutput.WriteString( pImple_->FILE_FORMAT_MAGIC_NUMBER );
-		// Write an integer that specifies what version of the file format I'm using. I
-		// have no intention of changing the format but I might as well keep the option
-		// open.
+		codedOutput.WriteString( l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER );
+		// Write an integer that specifies what version of the file format I'm using.
 		codedOutput.WriteVarint32( 1 );
 	}
 
-	google::protobuf::io::GzipOutputStream gzipOutput( &fileOutput );
-	google::protobuf::io::CodedOutputStream codedOutput( &gzipOutput );
-
-	// Write the size of the header message into the file...
-	codedOutput.WriteVarint64( pImple_->protobufSampleHeader.ByteSize() );
-	// ...and then write the header
-	pImple_->protobufSampleHeader.SerializeToCodedStream( &codedOutput );
-
-	// Now go through each of the runs and do the same for those
-	for( const auto& pRun : pImple_->protobufRuns )
-	{
-		codedOutput.WriteVarint64( pRun->ByteSize() );
-		pRun->SerializeToCodedStream( &codedOutput );
-	}
-
+	pImple_->saveProtobufFormat( fileOutput );
 }
 
 size_t l1menu::ReducedSample::numberOfEvents() const
 {
-	size_t numberOfEvents=0;
-	for( const auto& pRun : pImple_->protobufRuns ) numberOfEvents+=pRun->event_size();
-	return numberOfEvents;
+	return pImple_->numberOfEvents;
 }
 
 const l1menu::TriggerMenu& l1menu::ReducedSample::getTriggerMenu() const
@@ -431,87 +1517,21 @@ bool l1menu::ReducedSample::containsTrigger( const l1menu::ITrigger& trigger, bo
 
 const std::map<std::string,size_t> l1menu::ReducedSample::getTriggerParameterIdentifiers( const l1menu::ITrigger& trigger, bool allowOlderVersion ) const
 {
-	std::map<std::string,size_t> returnValue;
-
-	// Need to find out how many parameters there are for each event. Basically the sum
-	// of the number of thresholds for all triggers.
-	size_t parameterNumber=0;
-	bool triggerWasFound=true;
-	for( size_t triggerNumber=0; triggerNumber<pImple_->triggerMenu.numberOfTriggers(); ++triggerNumber )
-	{
-		const l1menu::ITrigger& triggerInMenu=pImple_->triggerMenu.getTrigger(triggerNumber);
-
-		triggerWasFound=true; // Set to true, then back to false if any of the tests fail
-		// See if this trigger in the menu is the same as the one passed as a parameter
-		if( triggerInMenu.name()!=trigger.name() ) triggerWasFound=false;
-		if( allowOlderVersion )
-		{
-			if( triggerInMenu.version()>trigger.version() ) triggerWasFound=false;
-		}
-		else
-		{
-			if( triggerInMenu.version()!=trigger.version() ) triggerWasFound=false;
-		}
-
-		// If control got this far then there is a trigger with the required name
-		// and sufficient version. I now need to check all of the non threshold parameters
-		// to make sure they match, i.e. make sure the ReducedSample was made with the same
-		// eta cuts or whatever.
-		// I don't care if the thresholds don't match because that's what's stored in the
-		// ReducedSample.
-		if( triggerWasFound ) // Trigger can still fail, but no point doing this check if it already has
-		{
-			std::vector<std::string> parameterNames=l1menu::tools::getNonThresholdParameterNames( trigger );
-			for( const auto& parameterName : parameterNames )
-			{
-				if( trigger.parameter(parameterName)!=triggerInMenu.parameter(parameterName) ) triggerWasFound=false;
-			}
-		}
-
-		std::vector<std::string> thresholdNames=l1menu::tools::getThresholdNames(triggerInMenu);
-		if( triggerWasFound )
-		{
-			for( const auto& thresholdName : thresholdNames )
-			{
-				returnValue[thresholdName]=parameterNumber;
-				++parameterNumber;
-			}
-			break;
-		}
-		else parameterNumber+=thresholdNames.size();
-	}
-
-	// There could conceivably be a trigger that was found but has no thresholds
-	// (I guess - it would be a pretty pointless trigger though). To indicate the
-	// difference between that and a trigger that wasn't found I'll respectively
-	// return the empty vector or throw an exception.
-	if( !triggerWasFound ) throw std::runtime_error( "l1menu::ReducedSample::getTriggerParameterIdentifiers() called for a trigger that was not used to create the sample - "+trigger.name() );
-
-	return returnValue;
+	return l1menu::implementation::getTriggerParameterIdentifiers( pImple_->triggerMenu, trigger, allowOlderVersion );
 }
 
 const l1menu::IEvent& l1menu::ReducedSample::getEvent( size_t eventNumber ) const
 {
-	for( const auto& pRun : pImple_->protobufRuns )
-	{
-		if( eventNumber<static_cast<size_t>(pRun->event_size()) )
-		{
-			pImple_->event.pProtobufEvent_=pRun->mutable_event(eventNumber);
-			return pImple_->event;
-		}
-		// Event must be in a later run, so reduce the number by how many events
-		// were in this run and look again.
-		eventNumber-=pRun->event_size();
-	}
+	if( eventNumber>=pImple_->numberOfEvents ) throw std::runtime_error( "ReducedSample::getEvent(eventNumber) was asked for an invalid eventNumber" );
 
-	// Should always find the event before getting to this point, so throw an
-	// exception if this happens.
-	throw std::runtime_error( "ReducedSample::getEvent(eventNumber) was asked for an invalid eventNumber" );
+	// The event already points at the columns, so all it needs is the index
+	pImple_->event.eventIndex_=eventNumber;
+	return pImple_->event;
 }
 
 std::unique_ptr<l1menu::ICachedTrigger> l1menu::ReducedSample::createCachedTrigger( const l1menu::ITrigger& trigger ) const
 {
-	return std::unique_ptr<l1menu::ICachedTrigger>( new CachedTriggerImplementation(*this,trigger) );
+	return std::unique_ptr<l1menu::ICachedTrigger>( new CachedTriggerImplementation(*pImple_,trigger) );
 }
 
 float l1menu::ReducedSample::eventRate() const
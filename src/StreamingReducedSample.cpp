@@ -0,0 +1,347 @@
+#include "l1menu/StreamingReducedSample.h"
+
+#include <vector>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include "l1menu/TriggerMenu.h"
+#include "l1menu/ITrigger.h"
+#include "l1menu/ICachedTrigger.h"
+#include "l1menu/IEvent.h"
+#include "l1menu/IMenuRate.h"
+#include "./implementation/MenuRateImplementation.h"
+#include "./implementation/ReducedSampleFileFormat.h"
+#include "protobuf/l1menu.pb.h"
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/io/gzip_stream.h>
+
+namespace // unnamed namespace
+{
+	/** @brief The event returned by StreamingReducedSample. Points to an event in the Run currently in memory.
+	 */
+	class StreamedEvent : public l1menu::IEvent
+	{
+	public:
+		StreamedEvent( const l1menu::StreamingReducedSample& sample ) : pProtobufEvent(nullptr), sample_(sample) {}
+		float parameterValue( size_t parameterNumber ) const { return pProtobufEvent->threshold(parameterNumber); }
+
+		virtual bool passesTrigger( const l1menu::ITrigger& trigger ) const
+		{
+			const auto& parameterIdentifiers=sample_.getTriggerParameterIdentifiers(trigger);
+
+			for( const auto& identifier : parameterIdentifiers )
+			{
+				if( trigger.parameter(identifier.first)>parameterValue(identifier.second) ) return false;
+			}
+
+			// If control got this far, all of the thresholds passed.
+			return true;
+		}
+		virtual float weight() const
+		{
+			if( pProtobufEvent->has_weight() ) return pProtobufEvent->weight();
+			else return 1;
+		}
+		virtual const l1menu::ISample& sample() const { return sample_; }
+
+		const l1menuprotobuf::Event* pProtobufEvent;
+	private:
+		const l1menu::StreamingReducedSample& sample_;
+	};
+
+	/** @brief Stores the thresholds of a trigger as indices into the events, to avoid costly string comparisons.
+	 *
+	 * Same as the one for ReducedSample, but for the StreamedEvent event type.
+	 */
+	class CachedTriggerImplementation : public l1menu::ICachedTrigger
+	{
+	public:
+		CachedTriggerImplementation( const l1menu::StreamingReducedSample& sample, const l1menu::ITrigger& trigger )
+		{
+			const auto& parameterIdentifiers=sample.getTriggerParameterIdentifiers(trigger);
+
+			for( const auto& identifier : parameterIdentifiers )
+			{
+				identifiers_.push_back( std::make_pair( identifier.second, &trigger.parameter(identifier.first) ) );
+			}
+		}
+		virtual bool apply( const l1menu::IEvent& event )
+		{
+			// The sample only ever hands out StreamedEvents, so I'll save the time of a dynamic_cast
+			const StreamedEvent* pEvent=static_cast<const StreamedEvent*>(&event);
+			for( const auto& identifier : identifiers_ )
+			{
+				if( pEvent->parameterValue(identifier.first) < *identifier.second ) return false;
+			}
+
+			// If control got this far then all of the thresholds passed, and
+			// I can pass the event.
+			return true;
+		}
+	protected:
+		std::vector< std::pair<size_t,const float*> > identifiers_;
+	};
+}
+
+namespace l1menu
+{
+	/** @brief Private members for the StreamingReducedSample class
+	 */
+	class StreamingReducedSamplePrivateMembers
+	{
+	public:
+		StreamingReducedSamplePrivateMembers( const l1menu::StreamingReducedSample& thisObject, const std::string& filename );
+		~StreamingReducedSamplePrivateMembers();
+		/** @brief Positions the input streams at the first Run in the file, ready for a new pass. Also reads protobufSampleHeader. */
+		void startPass();
+		/** @brief Reads the next Run into currentRun, replacing whatever was there. Returns false if there are no more. */
+		bool readNextRun();
+		/** @brief Whether startPass has been called and the end of the file not reached yet. */
+		bool passInProgress() const;
+		/** @brief Goes through the whole file counting events and weights, for files that don't have a footer. */
+		void countEvents();
+
+		int fileDescriptor;
+		off_t payloadStart; ///< @brief Position in the file of the start of the gzipped data
+		google::protobuf::uint64 payloadSize; ///< @brief Size of the gzipped data, or zero if it continues to the end of the file
+		// The input stream stack. Only valid during a pass.
+		std::unique_ptr<google::protobuf::io::FileInputStream> pFileInput;
+		std::unique_ptr<google::protobuf::io::LimitingInputStream> pPayloadInput;
+		std::unique_ptr<google::protobuf::io::GzipInputStream> pGzipInput;
+		// For the chunked format (version 3) the streams aren't used, each Run is read from its frame instead
+		std::vector<l1menu::implementation::ReducedSampleFooter::Frame> frames;
+		size_t nextFrame; ///< @brief Index in frames of the Run that readNextRun will read, or frames.size() if no pass is in progress
+		l1menu::ReducedSample::Codec codec; ///< @brief How the frames are compressed
+
+		l1menuprotobuf::SampleHeader protobufSampleHeader;
+		l1menu::TriggerMenu triggerMenu;
+		size_t numberOfEvents;
+		float sumOfWeights;
+		float eventRate;
+		l1menuprotobuf::Run currentRun;
+		size_t currentRunFirstEvent; ///< @brief The event number of the first event in currentRun
+		StreamedEvent event;
+	};
+}
+
+l1menu::StreamingReducedSamplePrivateMembers::StreamingReducedSamplePrivateMembers( const l1menu::StreamingReducedSample& thisObject, const std::string& filename )
+	: fileDescriptor(-1), payloadStart(0), payloadSize(0), nextFrame(0), codec(l1menu::ReducedSample::Codec::GZIP), numberOfEvents(0), sumOfWeights(0), eventRate(1), currentRunFirstEvent(0), event(thisObject)
+{
+	GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+	fileDescriptor=open( filename.c_str(), O_RDONLY );
+	if( fileDescriptor<0 ) throw std::runtime_error( "StreamingReducedSample initialise from file - couldn't open file" );
+	// The destructor won't be called if the constructor throws, so make sure the file is closed
+	try
+	{
+		google::protobuf::uint32 fileformatVersion;
+		{ // Block to make sure the streams are destructed before startPass() creates its own
+			google::protobuf::io::FileInputStream fileInput( fileDescriptor );
+			google::protobuf::io::CodedInputStream codedInput( &fileInput );
+
+			std::string readMagicNumber;
+			if( !codedInput.ReadString( &readMagicNumber, l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER.size() ) ) throw std::runtime_error( "StreamingReducedSample initialise from file - error reading magic number" );
+			if( readMagicNumber!=l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER ) throw std::runtime_error( "StreamingReducedSample - tried to initialise with a file that is not the correct format" );
+
+			if( !codedInput.ReadVarint32( &fileformatVersion ) ) throw std::runtime_error( "StreamingReducedSample initialise from file - error reading file format version" );
+			if( fileformatVersion!=1 && fileformatVersion!=3 ) throw std::runtime_error( "StreamingReducedSample can only read version 1 and version 3 files. Use ReducedSample for other versions." );
+			if( fileformatVersion==3 ) codec=l1menu::implementation::readCodecTag( codedInput );
+
+			payloadStart=codedInput.CurrentPosition();
+		}
+
+		l1menu::implementation::ReducedSampleFooter footer;
+		const bool fileHasFooter=footer.read( fileDescriptor );
+		if( fileHasFooter ) payloadSize=footer.payloadSize;
+		frames.swap( footer.frames );
+		if( fileformatVersion==3 && frames.empty() ) throw std::runtime_error( "StreamingReducedSample initialise from file - the file doesn't have a frame index" );
+
+		// Starting a pass reads the header, so I can copy the trigger information out of it
+		startPass();
+		l1menu::implementation::copyHeaderToTriggerMenu( protobufSampleHeader, triggerMenu );
+
+		if( fileHasFooter )
+		{
+			numberOfEvents=footer.numberOfEvents;
+			sumOfWeights=footer.sumOfWeights;
+		}
+		else countEvents();
+	}
+	catch( ... )
+	{
+		pGzipInput.reset();
+		pPayloadInput.reset();
+		pFileInput.reset();
+		close( fileDescriptor );
+		throw;
+	}
+}
+
+l1menu::StreamingReducedSamplePrivateMembers::~StreamingReducedSamplePrivateMembers()
+{
+	// Make sure the streams are destroyed before the file is closed
+	pGzipInput.reset();
+	pPayloadInput.reset();
+	pFileInput.reset();
+	close( fileDescriptor );
+}
+
+void l1menu::StreamingReducedSamplePrivateMembers::startPass()
+{
+	// Destroy in the reverse order of creation, since each one refers to the previous
+	pGzipInput.reset();
+	pPayloadInput.reset();
+	pFileInput.reset();
+
+	currentRun.Clear();
+	currentRunFirstEvent=0;
+
+	if( !frames.empty() )
+	{
+		// The first frame is always the header
+		l1menu::implementation::readFrame( fileDescriptor, frames.front(), codec, protobufSampleHeader );
+		nextFrame=1;
+		return;
+	}
+
+	if( lseek( fileDescriptor, payloadStart, SEEK_SET )<0 ) throw std::runtime_error( "StreamingReducedSample - couldn't seek in the file" );
+	pFileInput.reset( new google::protobuf::io::FileInputStream( fileDescriptor ) );
+	if( payloadSize!=0 )
+	{
+		// Make sure the gzip stream doesn't try and decompress the footer
+		pPayloadInput.reset( new google::protobuf::io::LimitingInputStream( pFileInput.get(), payloadSize ) );
+		pGzipInput.reset( new google::protobuf::io::GzipInputStream( pPayloadInput.get() ) );
+	}
+	else pGzipInput.reset( new google::protobuf::io::GzipInputStream( pFileInput.get() ) );
+
+	// The first message is always the header
+	if( !l1menu::implementation::readDelimitedMessage( *pGzipInput, protobufSampleHeader ) ) throw std::runtime_error( "StreamingReducedSample - error reading header" );
+}
+
+bool l1menu::StreamingReducedSamplePrivateMembers::readNextRun()
+{
+	if( !frames.empty() )
+	{
+		if( nextFrame<frames.size() )
+		{
+			l1menu::implementation::readFrame( fileDescriptor, frames[nextFrame], codec, currentRun );
+			++nextFrame;
+			return true;
+		}
+		currentRun.Clear();
+		return false;
+	}
+
+	if( !pGzipInput ) return false;
+	if( l1menu::implementation::readDelimitedMessage( *pGzipInput, currentRun ) ) return true;
+
+	// Reached the end of the file, so clear everything until the next pass starts
+	currentRun.Clear();
+	pGzipInput.reset();
+	pPayloadInput.reset();
+	pFileInput.reset();
+	return false;
+}
+
+bool l1menu::StreamingReducedSamplePrivateMembers::passInProgress() const
+{
+	if( !frames.empty() ) return nextFrame<frames.size() || currentRun.event_size()!=0;
+	else return pGzipInput!=nullptr;
+}
+
+void l1menu::StreamingReducedSamplePrivateMembers::countEvents()
+{
+	startPass();
+	numberOfEvents=0;
+	sumOfWeights=0;
+	while( readNextRun() )
+	{
+		numberOfEvents+=currentRun.event_size();
+		for( const auto& protobufEvent : currentRun.event() )
+		{
+			if( protobufEvent.has_weight() ) sumOfWeights+=protobufEvent.weight();
+			else sumOfWeights+=1;
+		}
+	}
+}
+
+l1menu::StreamingReducedSample::StreamingReducedSample( const std::string& filename )
+	: pImple_( new l1menu::StreamingReducedSamplePrivateMembers( *this, filename ) )
+{
+	// No operation besides the initialiser list
+}
+
+l1menu::StreamingReducedSample::~StreamingReducedSample()
+{
+	// No operation. Just need one defined otherwise the default one messes up
+	// the unique_ptr deletion because StreamingReducedSamplePrivateMembers isn't
+	// defined elsewhere.
+}
+
+const l1menu::TriggerMenu& l1menu::StreamingReducedSample::getTriggerMenu() const
+{
+	return pImple_->triggerMenu;
+}
+
+const std::map<std::string,size_t> l1menu::StreamingReducedSample::getTriggerParameterIdentifiers( const l1menu::ITrigger& trigger, bool allowOlderVersion ) const
+{
+	return l1menu::implementation::getTriggerParameterIdentifiers( pImple_->triggerMenu, trigger, allowOlderVersion );
+}
+
+size_t l1menu::StreamingReducedSample::numberOfEvents() const
+{
+	return pImple_->numberOfEvents;
+}
+
+const l1menu::IEvent& l1menu::StreamingReducedSample::getEvent( size_t eventNumber ) const
+{
+	if( eventNumber>=pImple_->numberOfEvents ) throw std::runtime_error( "StreamingReducedSample::getEvent(eventNumber) was asked for an invalid eventNumber" );
+
+	// If the event is before the current Run, or there's no pass in progress, I
+	// need to go back to the start of the file.
+	if( eventNumber<pImple_->currentRunFirstEvent || !pImple_->passInProgress() ) pImple_->startPass();
+
+	// With a frame index the Runs that aren't needed can be skipped without decompressing them
+	const auto& frames=pImple_->frames;
+	size_t& nextFrame=pImple_->nextFrame;
+	while( nextFrame<frames.size() && eventNumber>=pImple_->currentRunFirstEvent+pImple_->currentRun.event_size()+frames[nextFrame].numberOfEvents )
+	{
+		pImple_->currentRunFirstEvent+=pImple_->currentRun.event_size()+frames[nextFrame].numberOfEvents;
+		pImple_->currentRun.Clear();
+		++nextFrame;
+	}
+
+	while( eventNumber>=pImple_->currentRunFirstEvent+pImple_->currentRun.event_size() )
+	{
+		pImple_->currentRunFirstEvent+=pImple_->currentRun.event_size();
+		if( !pImple_->readNextRun() ) throw std::runtime_error( "StreamingReducedSample::getEvent(eventNumber) - the file has fewer events than expected" );
+	}
+
+	pImple_->event.pProtobufEvent=&pImple_->currentRun.event( eventNumber-pImple_->currentRunFirstEvent );
+	return pImple_->event;
+}
+
+std::unique_ptr<l1menu::ICachedTrigger> l1menu::StreamingReducedSample::createCachedTrigger( const l1menu::ITrigger& trigger ) const
+{
+	return std::unique_ptr<l1menu::ICachedTrigger>( new CachedTriggerImplementation(*this,trigger) );
+}
+
+float l1menu::StreamingReducedSample::eventRate() const
+{
+	return pImple_->eventRate;
+}
+
+void l1menu::StreamingReducedSample::setEventRate( float rate )
+{
+	pImple_->eventRate=rate;
+}
+
+float l1menu::StreamingReducedSample::sumOfWeights() const
+{
+	return pImple_->sumOfWeights;
+}
+
+std::shared_ptr<const l1menu::IMenuRate> l1menu::StreamingReducedSample::rate( const l1menu::TriggerMenu& menu ) const
+{
+	return std::shared_ptr<const l1menu::IMenuRate>( new l1menu::implementation::MenuRateImplementation( menu, *this ) );
+}
@@ -0,0 +1,198 @@
+#include "l1menu/SubSample.h"
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <stdexcept>
+#include "l1menu/IEvent.h"
+#include "l1menu/ITrigger.h"
+#include "l1menu/ICachedTrigger.h"
+#include "l1menu/IMenuRate.h"
+#include "./implementation/MenuRateImplementation.h"
+
+namespace // unnamed namespace
+{
+	/** @brief An event from the original sample, with the weight scaled and the SubSample as its sample. */
+	class SubSampleEvent : public l1menu::IEvent
+	{
+	public:
+		SubSampleEvent( const l1menu::ISample& sample ) : sample_(sample), pOriginalEvent_(nullptr), weightScale_(1) {}
+		void setOriginalEvent( const l1menu::IEvent& originalEvent ) { pOriginalEvent_=&originalEvent; }
+		void setWeightScale( float weightScale ) { weightScale_=weightScale; }
+		const l1menu::IEvent& originalEvent() const { return *pOriginalEvent_; }
+		virtual bool passesTrigger( const l1menu::ITrigger& trigger ) const { return pOriginalEvent_->passesTrigger( trigger ); }
+		virtual float weight() const { return pOriginalEvent_->weight()*weightScale_; }
+		virtual const l1menu::ISample& sample() const { return sample_; }
+	protected:
+		const l1menu::ISample& sample_;
+		const l1menu::IEvent* pOriginalEvent_;
+		float weightScale_;
+	}; // end of class SubSampleEvent
+
+	/** @brief Wraps the cached trigger of the original sample, so that whatever speed up that gives is kept. */
+	class CachedTriggerImplementation : public l1menu::ICachedTrigger
+	{
+	public:
+		CachedTriggerImplementation( std::unique_ptr<l1menu::ICachedTrigger> pOriginalCachedTrigger ) : pOriginalCachedTrigger_( std::move(pOriginalCachedTrigger) ) {}
+		virtual bool apply( const l1menu::IEvent& event )
+		{
+			// Like the ReducedSample cached trigger, this relies on only being given events
+			// from the sample that created it.
+			return pOriginalCachedTrigger_->apply( static_cast<const SubSampleEvent&>(event).originalEvent() );
+		}
+	protected:
+		std::unique_ptr<l1menu::ICachedTrigger> pOriginalCachedTrigger_;
+	}; // end of class CachedTriggerImplementation
+
+} // end of the unnamed namespace
+
+namespace l1menu
+{
+	/** @brief Private members for the SubSample class
+	 */
+	class SubSamplePrivateMembers
+	{
+	public:
+		SubSamplePrivateMembers( const l1menu::SubSample& thisObject, const l1menu::ISample& originalSample )
+			: originalSample(originalSample), currentEvent(thisObject), eventRate(originalSample.eventRate()), weightScale(1) {}
+		/** @brief Points currentEvent at the original event for the event number in this sample. */
+		const l1menu::IEvent& setCurrentEvent( size_t eventNumber );
+
+		const l1menu::ISample& originalSample;
+		std::vector<size_t> originalEventNumbers;
+		SubSampleEvent currentEvent;
+		float eventRate;
+		float weightScale;
+	};
+}
+
+const l1menu::IEvent& l1menu::SubSamplePrivateMembers::setCurrentEvent( size_t eventNumber )
+{
+	currentEvent.setOriginalEvent( originalSample.getEvent( originalEventNumbers[eventNumber] ) );
+	return currentEvent;
+}
+
+l1menu::SubSample::SubSample( const l1menu::ISample& originalSample, float fraction, l1menu::SubSample::Method method, unsigned int seed )
+	: pImple_( new SubSamplePrivateMembers( *this, originalSample ) )
+{
+	if( !(fraction>0 && fraction<=1) ) throw std::runtime_error( "SubSample - the fraction of events must be greater than zero and no more than one" );
+
+	const size_t originalNumberOfEvents=originalSample.numberOfEvents();
+	std::vector<size_t>& originalEventNumbers=pImple_->originalEventNumbers;
+	originalEventNumbers.reserve( static_cast<size_t>( originalNumberOfEvents*fraction )+1 );
+
+	if( method==Method::STRIDE )
+	{
+		for( size_t index=0; ; ++index )
+		{
+			const size_t originalEventNumber=static_cast<size_t>( index/static_cast<double>(fraction) );
+			if( originalEventNumber>=originalNumberOfEvents ) break;
+			originalEventNumbers.push_back( originalEventNumber );
+		}
+	}
+	else
+	{
+		// The output of mt19937 is the same on every platform, but the standard distributions aren't
+		// required to be, so compare the raw output to keep the selection for a given seed reproducible.
+		std::mt19937 generator( seed );
+		const double threshold=static_cast<double>(fraction)*( static_cast<double>(std::mt19937::max())+1.0 );
+		for( size_t originalEventNumber=0; originalEventNumber<originalNumberOfEvents; ++originalEventNumber )
+		{
+			if( generator()<threshold ) originalEventNumbers.push_back( originalEventNumber );
+		}
+	}
+
+	if( originalEventNumbers.empty() ) throw std::runtime_error( "SubSample - none of the events were selected, the fraction is too small for this sample" );
+
+	// Scale the weights so that the sum of weights is the same as the original sample's. Some
+	// ISample implementations only give the sum of weights (e.g. FullSample reads them from the
+	// ntuples) so this has to be recalculated for the selected events.
+	double sumOfSelectedWeights=0;
+	for( const auto originalEventNumber : originalEventNumbers ) sumOfSelectedWeights+=originalSample.getEvent( originalEventNumber ).weight();
+
+	if( sumOfSelectedWeights!=0 ) pImple_->weightScale=originalSample.sumOfWeights()/sumOfSelectedWeights;
+	pImple_->currentEvent.setWeightScale( pImple_->weightScale );
+}
+
+l1menu::SubSample::~SubSample()
+{
+	// No operation. Just need one defined otherwise the default one messes up
+	// the unique_ptr deletion because SubSamplePrivateMembers isn't
+	// defined elsewhere.
+}
+
+const l1menu::ISample& l1menu::SubSample::originalSample() const
+{
+	return pImple_->originalSample;
+}
+
+size_t l1menu::SubSample::originalEventNumber( size_t eventNumber ) const
+{
+	if( eventNumber>=pImple_->originalEventNumbers.size() ) throw std::runtime_error( "SubSample::originalEventNumber - requested event number is out of range" );
+	return pImple_->originalEventNumbers[eventNumber];
+}
+
+float l1menu::SubSample::fractionOfEvents() const
+{
+	return static_cast<double>( pImple_->originalEventNumbers.size() )/pImple_->originalSample.numberOfEvents();
+}
+
+float l1menu::SubSample::weightScale() const
+{
+	return pImple_->weightScale;
+}
+
+float l1menu::SubSample::statisticalErrorScale() const
+{
+	return std::sqrt( pImple_->weightScale );
+}
+
+size_t l1menu::SubSample::numberOfEvents() const
+{
+	return pImple_->originalEventNumbers.size();
+}
+
+const l1menu::IEvent& l1menu::SubSample::getEvent( size_t eventNumber ) const
+{
+	if( eventNumber>=pImple_->originalEventNumbers.size() ) throw std::runtime_error( "SubSample::getEvent - requested event number is out of range" );
+
+	return pImple_->setCurrentEvent( eventNumber );
+}
+
+void l1menu::SubSample::forEachEvent( size_t firstEventNumber, size_t lastEventNumber, const std::function<void(const l1menu::IEvent&)>& function ) const
+{
+	if( lastEventNumber>numberOfEvents() || firstEventNumber>lastEventNumber ) throw std::runtime_error( "SubSample::forEachEvent - the range of events requested is not in the sample" );
+
+	// The original sample's forEachEvent isn't used because it would go through all of the events
+	// in between, e.g. FullSample would read and convert every one of them. The selected event numbers
+	// are in increasing order, so samples that prefer sequential access still only make one pass.
+	for( size_t eventNumber=firstEventNumber; eventNumber<lastEventNumber; ++eventNumber )
+	{
+		function( pImple_->setCurrentEvent( eventNumber ) );
+	}
+}
+
+std::unique_ptr<l1menu::ICachedTrigger> l1menu::SubSample::createCachedTrigger( const l1menu::ITrigger& trigger ) const
+{
+	return std::unique_ptr<l1menu::ICachedTrigger>( new CachedTriggerImplementation( pImple_->originalSample.createCachedTrigger(trigger) ) );
+}
+
+float l1menu::SubSample::eventRate() const
+{
+	return pImple_->eventRate;
+}
+
+void l1menu::SubSample::setEventRate( float rate )
+{
+	pImple_->eventRate=rate;
+}
+
+float l1menu::SubSample::sumOfWeights() const
+{
+	return pImple_->originalSample.sumOfWeights();
+}
+
+std::shared_ptr<const l1menu::IMenuRate> l1menu::SubSample::rate( const l1menu::TriggerMenu& menu ) const
+{
+	return std::shared_ptr<const l1menu::IMenuRate>( new l1menu::implementation::MenuRateImplementation( menu, *this ) );
+}
@@ -5,6 +5,7 @@
 #include "l1menu/L1TriggerDPGEvent.h"
 #include "l1menu/IEvent.h"
 #include "l1menu/ISample.h"
+#include "l1menu/FullSample.h"
 #include "l1menu/TriggerTable.h"
 #include "l1menu/tools/miscellaneous.h"
 #include "l1menu/tools/stringManipulation.h"
@@ -226,10 +227,10 @@ void l1menu::TriggerRatePlot::addSample( const l1menu::ISample& sample )
 	// may or may not significantly increase the speed at which this next loop happens.
 	std::unique_ptr<l1menu::ICachedTrigger> pCachedTrigger=sample.createCachedTrigger( *pTrigger_ );
 
-	for( size_t eventNumber=0; eventNumber<sample.numberOfEvents(); ++eventNumber )
+	sample.forEachEvent( 0, sample.numberOfEvents(), [&]( const l1menu::IEvent& event )
 	{
-		addEvent( sample.getEvent(eventNumber), pCachedTrigger, weightPerEvent );
-	} // end of loop over events
+		addEvent( event, pCachedTrigger, weightPerEvent );
+	} ); // end of loop over events
 
 }
 
@@ -458,21 +459,53 @@ void l1menu::TriggerRatePlot::addSample( const l1menu::ISample& sample, std::vec
 	std::vector< std::unique_ptr<l1menu::ICachedTrigger> > cachedTriggers;
 	for( const auto& ratePlot : ratePlots ) cachedTriggers.push_back( sample.createCachedTrigger( *ratePlot.pTrigger_ ) );
 
+	// A FullSample spends most of its time reading the ntuples, so spread that over several threads.
+	// addEvent changes the thresholds of the trigger, so each thread needs its own copies of the plots,
+	// which are added onto the originals at the end. The copies are made here because ROOT doesn't like
+	// histograms being created in other threads.
+	const l1menu::FullSample* pFullSample=dynamic_cast<const l1menu::FullSample*>( &sample );
+	if( pFullSample!=nullptr && pFullSample->numberOfThreads()>1 && !ratePlots.empty() )
+	{
+		std::vector< std::vector<TriggerRatePlot> > threadRatePlots( pFullSample->numberOfThreads() );
+		std::vector< std::vector< std::unique_ptr<l1menu::ICachedTrigger> > > threadCachedTriggers( pFullSample->numberOfThreads() );
+		for( size_t threadNumber=0; threadNumber<threadRatePlots.size(); ++threadNumber )
+		{
+			for( const auto& ratePlot : ratePlots )
+			{
+				threadRatePlots[threadNumber].push_back( TriggerRatePlot( ratePlot ) );
+				threadRatePlots[threadNumber].back().pHistogram_->Reset();
+				threadCachedTriggers[threadNumber].push_back( sample.createCachedTrigger( *threadRatePlots[threadNumber].back().pTrigger_ ) );
+			}
+		}
+
+		pFullSample->forEachFullEventInParallel( [&]( size_t threadNumber, const l1menu::L1TriggerDPGEvent& event )
+		{
+			for( size_t plotNumber=0; plotNumber<ratePlots.size(); ++plotNumber )
+			{
+				threadRatePlots[threadNumber][plotNumber].addEvent( event, threadCachedTriggers[threadNumber][plotNumber], weightPerEvent );
+			}
+		} );
+
+		for( const auto& ratePlotsForThread : threadRatePlots )
+		{
+			for( size_t plotNumber=0; plotNumber<ratePlots.size(); ++plotNumber ) ratePlots[plotNumber].pHistogram_->Add( ratePlotsForThread[plotNumber].pHistogram_.get() );
+		}
+		return;
+	}
+
 	// Now instead of calling addSample() for each TriggerRatePlot individually, get each IEvent from the sample
 	// and pass that to each rate plot. This is because (depending on the ISample concrete type) getting the
 	// IEvent can be computationally expensive.
 	std::vector< std::unique_ptr<l1menu::ICachedTrigger> >::const_iterator iTrigger;
 	std::vector<TriggerRatePlot>::iterator iRatePlot;
-	for( size_t eventNumber=0; eventNumber<sample.numberOfEvents(); ++eventNumber )
+	sample.forEachEvent( 0, sample.numberOfEvents(), [&]( const l1menu::IEvent& event )
 	{
-		const l1menu::IEvent& event=sample.getEvent(eventNumber);
-
 		for( iTrigger=cachedTriggers.begin(), iRatePlot=ratePlots.begin();
 			iTrigger!=cachedTriggers.end() && iRatePlot!=ratePlots.end();
 			++iTrigger, ++iRatePlot )
 		{
 			iRatePlot->addEvent( event, *iTrigger, weightPerEvent );
 		}
-	} // end of loop over events
+	} ); // end of loop over events
 
 }
@@ -0,0 +1,197 @@
+#include "CompressionCodecs.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/io/gzip_stream.h>
+
+// zstd and lz4 are optional, because they aren't available in older CMSSW releases. Define
+// L1MENU_HAVE_ZSTD and/or L1MENU_HAVE_LZ4 to build with them (see README.md).
+#ifdef L1MENU_HAVE_ZSTD
+#include <zstd.h>
+#if ZSTD_VERSION_NUMBER<10300
+#error "zstd 1.3.0 or newer is required for ZSTD_getFrameContentSize. Build without L1MENU_HAVE_ZSTD to leave zstd out."
+#endif
+#endif
+#ifdef L1MENU_HAVE_LZ4
+#include <lz4.h>
+#if LZ4_VERSION_NUMBER<10700
+#error "lz4 1.7.0 or newer is required for LZ4_compress_default. Build without L1MENU_HAVE_LZ4 to leave lz4 out."
+#endif
+#endif
+
+namespace // unnamed namespace
+{
+	class GzipCodec : public l1menu::implementation::ICompressionCodec
+	{
+	public:
+		virtual void compress( const std::string& input, std::string& output ) const
+		{
+			google::protobuf::io::StringOutputStream stringOutput( &output );
+			google::protobuf::io::GzipOutputStream gzipOutput( &stringOutput );
+
+			void* pBuffer;
+			int bufferSize;
+			size_t bytesWritten=0;
+			while( bytesWritten<input.size() )
+			{
+				if( !gzipOutput.Next( &pBuffer, &bufferSize ) ) throw std::runtime_error( "GzipCodec - error while compressing" );
+				size_t bytesToCopy=std::min<size_t>( bufferSize, input.size()-bytesWritten );
+				std::memcpy( pBuffer, input.data()+bytesWritten, bytesToCopy );
+				bytesWritten+=bytesToCopy;
+				if( bytesToCopy<static_cast<size_t>(bufferSize) ) gzipOutput.BackUp( bufferSize-bytesToCopy );
+			}
+			if( !gzipOutput.Close() ) throw std::runtime_error( "GzipCodec - error while compressing" );
+		}
+
+		virtual void decompress( const char* input, size_t inputSize, std::string& output ) const
+		{
+			google::protobuf::io::ArrayInputStream arrayInput( input, inputSize );
+			google::protobuf::io::GzipInputStream gzipInput( &arrayInput );
+
+			output.clear();
+			const void* pBuffer;
+			int bufferSize;
+			while( gzipInput.Next( &pBuffer, &bufferSize ) ) output.append( static_cast<const char*>(pBuffer), bufferSize );
+			if( gzipInput.ZlibErrorMessage()!=nullptr ) throw std::runtime_error( std::string("GzipCodec - error while decompressing: ")+gzipInput.ZlibErrorMessage() );
+		}
+	};
+
+	class UncompressedCodec : public l1menu::implementation::ICompressionCodec
+	{
+	public:
+		virtual void compress( const std::string& input, std::string& output ) const
+		{
+			output.append( input );
+		}
+
+		virtual void decompress( const char* input, size_t inputSize, std::string& output ) const
+		{
+			output.assign( input, inputSize );
+		}
+	};
+
+#ifdef L1MENU_HAVE_ZSTD
+	/** @brief Uses the zstd frame format, which records the uncompressed size itself. */
+	class ZstdCodec : public l1menu::implementation::ICompressionCodec
+	{
+	public:
+		/// Low levels are nearly as fast to compress as lz4, and decompression speed barely depends on the level
+		static const int COMPRESSION_LEVEL=3;
+
+		virtual void compress( const std::string& input, std::string& output ) const
+		{
+			const size_t originalSize=output.size();
+			output.resize( originalSize+ZSTD_compressBound( input.size() ) );
+			size_t result=ZSTD_compress( &output[originalSize], output.size()-originalSize, input.data(), input.size(), COMPRESSION_LEVEL );
+			if( ZSTD_isError( result ) ) throw std::runtime_error( std::string("ZstdCodec - error while compressing: ")+ZSTD_getErrorName( result ) );
+			output.resize( originalSize+result );
+		}
+
+		virtual void decompress( const char* input, size_t inputSize, std::string& output ) const
+		{
+			unsigned long long uncompressedSize=ZSTD_getFrameContentSize( input, inputSize );
+			if( uncompressedSize==ZSTD_CONTENTSIZE_UNKNOWN || uncompressedSize==ZSTD_CONTENTSIZE_ERROR ) throw std::runtime_error( "ZstdCodec - the compressed data is corrupt" );
+
+			output.resize( uncompressedSize );
+			size_t result=ZSTD_decompress( &output[0], output.size(), input, inputSize );
+			if( ZSTD_isError( result ) ) throw std::runtime_error( std::string("ZstdCodec - error while decompressing: ")+ZSTD_getErrorName( result ) );
+			if( result!=uncompressedSize ) throw std::runtime_error( "ZstdCodec - the compressed data is corrupt" );
+		}
+	};
+#endif
+
+#ifdef L1MENU_HAVE_LZ4
+	/** @brief Uses the lz4 block format, preceded by the uncompressed size as a little endian uint64. */
+	class Lz4Codec : public l1menu::implementation::ICompressionCodec
+	{
+	public:
+		virtual void compress( const std::string& input, std::string& output ) const
+		{
+			if( input.size()>LZ4_MAX_INPUT_SIZE ) throw std::runtime_error( "Lz4Codec - the input is too large" );
+
+			unsigned char sizeBytes[8];
+			for( size_t index=0; index<sizeof(sizeBytes); ++index ) sizeBytes[index]=static_cast<unsigned long long>( input.size() ) >> (8*index);
+
+			const size_t originalSize=output.size();
+			output.append( reinterpret_cast<const char*>(sizeBytes), sizeof(sizeBytes) );
+			output.resize( originalSize+sizeof(sizeBytes)+LZ4_compressBound( input.size() ) );
+			int result=LZ4_compress_default( input.data(), &output[originalSize+sizeof(sizeBytes)], input.size(), output.size()-originalSize-sizeof(sizeBytes) );
+			if( result<=0 && !input.empty() ) throw std::runtime_error( "Lz4Codec - error while compressing" );
+			output.resize( originalSize+sizeof(sizeBytes)+result );
+		}
+
+		virtual void decompress( const char* input, size_t inputSize, std::string& output ) const
+		{
+			const size_t sizeBytes=8;
+			if( inputSize<sizeBytes ) throw std::runtime_error( "Lz4Codec - the compressed data is corrupt" );
+			unsigned long long uncompressedSize=0;
+			for( size_t index=0; index<sizeBytes; ++index ) uncompressedSize|=static_cast<unsigned long long>( static_cast<unsigned char>(input[index]) ) << (8*index);
+			if( uncompressedSize>LZ4_MAX_INPUT_SIZE ) throw std::runtime_error( "Lz4Codec - the compressed data is corrupt" );
+
+			output.resize( uncompressedSize );
+			if( uncompressedSize==0 ) return;
+			int result=LZ4_decompress_safe( input+sizeBytes, &output[0], inputSize-sizeBytes, uncompressedSize );
+			if( result<0 || static_cast<unsigned long long>(result)!=uncompressedSize ) throw std::runtime_error( "Lz4Codec - the compressed data is corrupt" );
+		}
+	};
+#endif
+
+	/** @brief Throws the exception for a codec that the code knows about, but that wasn't compiled in. */
+	[[noreturn]] void throwUnavailable( const std::string& codecName, const std::string& macroName )
+	{
+		throw std::runtime_error( "ReducedSample - "+codecName+" compression isn't available because this build was compiled without it. "
+				"Rebuild with "+macroName+" defined and the "+codecName+" library available (see README.md), or use a gzip or uncompressed file." );
+	}
+
+} // end of the unnamed namespace
+
+const l1menu::implementation::ICompressionCodec& l1menu::implementation::getCompressionCodec( l1menu::ReducedSample::Codec codec )
+{
+	static const GzipCodec gzipCodec;
+	static const UncompressedCodec uncompressedCodec;
+#ifdef L1MENU_HAVE_ZSTD
+	static const ZstdCodec zstdCodec;
+#endif
+#ifdef L1MENU_HAVE_LZ4
+	static const Lz4Codec lz4Codec;
+#endif
+
+	switch( codec )
+	{
+		case l1menu::ReducedSample::Codec::GZIP : return gzipCodec;
+		case l1menu::ReducedSample::Codec::NONE : return uncompressedCodec;
+#ifdef L1MENU_HAVE_ZSTD
+		case l1menu::ReducedSample::Codec::ZSTD : return zstdCodec;
+#else
+		case l1menu::ReducedSample::Codec::ZSTD : throwUnavailable( "zstd", "L1MENU_HAVE_ZSTD" );
+#endif
+#ifdef L1MENU_HAVE_LZ4
+		case l1menu::ReducedSample::Codec::LZ4 : return lz4Codec;
+#else
+		case l1menu::ReducedSample::Codec::LZ4 : throwUnavailable( "lz4", "L1MENU_HAVE_LZ4" );
+#endif
+	}
+
+	throw std::runtime_error( "Unknown compression codec. Is your code up to date?" );
+}
+
+bool l1menu::implementation::compressionCodecIsAvailable( l1menu::ReducedSample::Codec codec )
+{
+	switch( codec )
+	{
+		case l1menu::ReducedSample::Codec::GZIP : return true;
+		case l1menu::ReducedSample::Codec::NONE : return true;
+#ifdef L1MENU_HAVE_ZSTD
+		case l1menu::ReducedSample::Codec::ZSTD : return true;
+#else
+		case l1menu::ReducedSample::Codec::ZSTD : return false;
+#endif
+#ifdef L1MENU_HAVE_LZ4
+		case l1menu::ReducedSample::Codec::LZ4 : return true;
+#else
+		case l1menu::ReducedSample::Codec::LZ4 : return false;
+#endif
+	}
+	return false;
+}
@@ -0,0 +1,39 @@
+#ifndef l1menu_implementation_CompressionCodecs_h
+#define l1menu_implementation_CompressionCodecs_h
+
+#include <string>
+#include <stddef.h> // required for size_t
+#include "l1menu/ReducedSample.h"
+
+namespace l1menu
+{
+	namespace implementation
+	{
+		/** @brief Interface for the different ways the frames of a chunked ReducedSample file can be compressed.
+		 *
+		 * Implementations have no state, so the same instance can be used from several threads at once.
+		 */
+		class ICompressionCodec
+		{
+		public:
+			virtual ~ICompressionCodec() {}
+			/** @brief Compresses the whole of input and appends the result to output. */
+			virtual void compress( const std::string& input, std::string& output ) const = 0;
+			/** @brief Decompresses something that was written with compress, replacing the contents of output.
+			 * @throw std::runtime_error If the data is corrupt.
+			 */
+			virtual void decompress( const char* input, size_t inputSize, std::string& output ) const = 0;
+		};
+
+		/** @brief Returns the implementation for the codec.
+		 * @throw std::runtime_error If the codec is not known, e.g. the tag read from a file is from a newer version of the code,
+		 *                           or if it's zstd or lz4 and this was built without them.
+		 */
+		const ICompressionCodec& getCompressionCodec( l1menu::ReducedSample::Codec codec );
+
+		/** @brief Whether the codec was compiled in. gzip and uncompressed always are, zstd and lz4 are optional. */
+		bool compressionCodecIsAvailable( l1menu::ReducedSample::Codec codec );
+
+	} // end of the implementation namespace
+} // end of the l1menu namespace
+#endif
@@ -0,0 +1,138 @@
+#include "DerivedQuantities.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <limits>
+
+namespace // unnamed namespace
+{
+	const float noValue=std::numeric_limits<float>::quiet_NaN();
+
+	/** @brief Whether the muon passes the cuts, written the same way as SingleMuEta so that NaN eta is treated the same. */
+	inline bool passesMuonCuts( const l1menu::implementation::TriggerObjects::Muons& muons, size_t index, float etaCut, float muonQuality )
+	{
+		return !( muons.quality[index]<muonQuality || std::fabs(muons.eta[index])>etaCut );
+	}
+
+} // end of the unnamed namespace
+
+void l1menu::implementation::DerivedQuantities::PassingObjects::fill( const l1menu::implementation::TriggerObjects::CaloObjects& objects, float regionCut )
+{
+	pCaloObjects_=&objects;
+	pMuons_=nullptr;
+	cut_=regionCut;
+	muonQuality_=0;
+	numberOfValues_=0;
+	highestIsolated_=noValue;
+	for( size_t index=l1menu::implementation::nextInRegion( objects, regionCut ); index<objects.size(); index=l1menu::implementation::nextInRegion( objects, regionCut, index+1 ) )
+	{
+		const float et=objects.et[index];
+		if( et!=et ) break;
+		if( numberOfValues_<capacity ) values_[numberOfValues_]=et;
+		++numberOfValues_;
+		// The objects are sorted, so the first isolated one is the highest
+		if( objects.isolated[index] && highestIsolated_!=highestIsolated_ ) highestIsolated_=et;
+	}
+}
+
+void l1menu::implementation::DerivedQuantities::PassingObjects::fill( const l1menu::implementation::TriggerObjects::Muons& muons, float etaCut, float muonQuality )
+{
+	pCaloObjects_=nullptr;
+	pMuons_=&muons;
+	cut_=etaCut;
+	muonQuality_=muonQuality;
+	numberOfValues_=0;
+	highestIsolated_=noValue;
+	for( size_t index=0; index<muons.size(); ++index )
+	{
+		if( !passesMuonCuts( muons, index, etaCut, muonQuality ) ) continue;
+		const float pt=muons.pt[index];
+		if( pt!=pt ) break;
+		if( numberOfValues_<capacity ) values_[numberOfValues_]=pt;
+		++numberOfValues_;
+		if( muons.isolated[index] && highestIsolated_!=highestIsolated_ ) highestIsolated_=pt;
+	}
+}
+
+float l1menu::implementation::DerivedQuantities::PassingObjects::findHighest( size_t n ) const
+{
+	if( n==0 || n>numberOfValues_ ) return noValue;
+
+	// There are enough objects, they just weren't kept. Anything with a NaN Et is after all of these.
+	size_t numberFound=0;
+	if( pCaloObjects_!=nullptr )
+	{
+		const l1menu::implementation::TriggerObjects::CaloObjects& objects=*pCaloObjects_;
+		for( size_t index=l1menu::implementation::nextInRegion( objects, cut_ ); index<objects.size(); index=l1menu::implementation::nextInRegion( objects, cut_, index+1 ) )
+		{
+			if( ++numberFound==n ) return objects.et[index];
+		}
+	}
+	else
+	{
+		const l1menu::implementation::TriggerObjects::Muons& muons=*pMuons_;
+		for( size_t index=0; index<muons.size(); ++index )
+		{
+			if( passesMuonCuts( muons, index, cut_, muonQuality_ ) && ++numberFound==n ) return muons.pt[index];
+		}
+	}
+	return noValue;
+}
+
+l1menu::implementation::DerivedQuantities::DerivedQuantities( const l1menu::implementation::TriggerObjects& objects )
+	: pObjects_(&objects), generation_(1), numberOfEntries_(0)
+{
+	// No operation besides the initialiser list
+}
+
+l1menu::implementation::DerivedQuantities& l1menu::implementation::DerivedQuantities::operator=( const DerivedQuantities& otherQuantities )
+{
+	clear();
+	return *this;
+}
+
+void l1menu::implementation::DerivedQuantities::clear()
+{
+	if( ++generation_==0 )
+	{
+		// Wrapped around, so some of the table could look up to date. Entries start at zero so use one.
+		for( auto& entry : caloTable_ ) entry.generation_=0;
+		generation_=1;
+	}
+	numberOfEntries_=0;
+}
+
+const l1menu::implementation::TriggerObjects::CaloObjects& l1menu::implementation::DerivedQuantities::caloObjects( CaloCollection collection ) const
+{
+	switch( collection )
+	{
+		case CaloCollection::EG : return pObjects_->eg;
+		case CaloCollection::ISOLATED_EG : return pObjects_->isolatedEG;
+		case CaloCollection::CENTRAL_JETS : return pObjects_->centralJets;
+		case CaloCollection::FORWARD_JETS : return pObjects_->forwardJets;
+		case CaloCollection::TAU_JETS : return pObjects_->tauJets;
+		case CaloCollection::ISOLATED_TAU_JETS : return pObjects_->isolatedTauJets;
+	}
+	throw std::logic_error( "Unimplemented value for l1menu::implementation::DerivedQuantities::CaloCollection" );
+}
+
+const l1menu::implementation::DerivedQuantities::PassingObjects& l1menu::implementation::DerivedQuantities::searchFor( CaloCollection collection, float regionCut )
+{
+	const l1menu::implementation::TriggerObjects::CaloObjects& objects=caloObjects( collection );
+	for( size_t entryNumber=0; entryNumber<numberOfEntries_; ++entryNumber )
+	{
+		const PassingObjects& entry=entries_[entryNumber];
+		// Compare the bits so that NaN cuts are found as well
+		if( entry.pCaloObjects_==&objects && std::memcmp( &entry.cut_, &regionCut, sizeof(float) )==0 ) return entry;
+	}
+	PassingObjects& entry=newEntry();
+	entry.fill( objects, regionCut );
+	return entry;
+}
+
+l1menu::implementation::DerivedQuantities::PassingObjects& l1menu::implementation::DerivedQuantities::newEntry()
+{
+	if( numberOfEntries_==entries_.size() ) entries_.resize( numberOfEntries_+1 );
+	return entries_[numberOfEntries_++];
+}
@@ -0,0 +1,136 @@
+#ifndef l1menu_implementation_DerivedQuantities_h
+#define l1menu_implementation_DerivedQuantities_h
+
+#include <vector>
+#include <stddef.h> // required for size_t
+#include "TriggerObjects.h"
+
+
+namespace l1menu
+{
+	namespace implementation
+	{
+		/** @brief Quantities worked out from the TriggerObjects of an event that several triggers need, remembered for that event.
+		 *
+		 * Most of the built in triggers only depend on things like the highest Et in a collection within
+		 * their region cut, the n'th highest jet Et, or the highest isolated object. A menu has lots of
+		 * triggers with the same cuts, and a TriggerRatePlot applies the same trigger several times to each
+		 * event as it bisects for the threshold, so the objects passing each set of cuts are found the first
+		 * time they're asked for and looked up after that. Held by L1TriggerDPGEvent (see
+		 * L1TriggerDPGEvent::derivedQuantities) and cleared whenever the trigger objects are worked out again.
+		 *
+		 * The calorimeter eta is a whole region number, so the objects passing a region cut only depend on the
+		 * cut rounded up. Those are looked up directly from a table, rather than searched for, since this is
+		 * called for every trigger on every event. There's no copy constructor, because a copy has to be
+		 * given the objects of the event it's in.
+		 */
+		class DerivedQuantities
+		{
+		public:
+			/** @brief The calorimeter collections in TriggerObjects, for looking them up in a table. */
+			enum class CaloCollection : char { EG, ISOLATED_EG, CENTRAL_JETS, FORWARD_JETS, TAU_JETS, ISOLATED_TAU_JETS };
+
+			/** @brief The Et (or pt) of the objects that pass a set of cuts, highest first.
+			 *
+			 * Everything is NaN if there's no object it applies to, so that it fails any threshold. Objects
+			 * after one with a NaN Et are ignored, the same as the loops in the triggers that stop at the
+			 * first object below their thresholds.
+			 */
+			class PassingObjects
+			{
+			public:
+				PassingObjects() : generation_(0) {}
+				/** @brief The n'th highest value, counting from one. */
+				float highest( size_t n=1 ) const
+				{
+					if( n-1<numberOfValues_ && n<=capacity ) return values_[n-1];
+					return findHighest( n );
+				}
+				/** @brief The highest value of the objects flagged as isolated. */
+				float highestIsolated() const { return highestIsolated_; }
+			private:
+				friend class DerivedQuantities;
+				/** @brief How many of the highest values are kept. Anything past that is looked for again each time. */
+				static const size_t capacity=8;
+
+				void fill( const l1menu::implementation::TriggerObjects::CaloObjects& objects, float regionCut );
+				void fill( const l1menu::implementation::TriggerObjects::Muons& muons, float etaCut, float muonQuality );
+				/** @brief Looks through the objects again, for anything that isn't kept. */
+				float findHighest( size_t n ) const;
+
+				unsigned int generation_; ///< @brief DerivedQuantities::generation_ when this was filled, so that clearing doesn't have to touch it
+				const l1menu::implementation::TriggerObjects::CaloObjects* pCaloObjects_; ///< @brief Null for muons
+				const l1menu::implementation::TriggerObjects::Muons* pMuons_; ///< @brief Null for calorimeter objects
+				float cut_; ///< @brief The region cut or muon eta cut
+				float muonQuality_;
+				size_t numberOfValues_; ///< @brief The total number of objects passing, even if that's more than capacity
+				float values_[capacity];
+				float highestIsolated_;
+			}; // end of class PassingObjects
+
+		public:
+			/** @brief The objects have to stay at the same address for as long as this is used. */
+			explicit DerivedQuantities( const l1menu::implementation::TriggerObjects& objects );
+			DerivedQuantities( const DerivedQuantities& otherQuantities ) = delete;
+			/** @brief Just calls clear(), and keeps using the same objects. */
+			DerivedQuantities& operator=( const DerivedQuantities& otherQuantities );
+
+			/** @brief Forgets everything, without releasing the memory. Has to be called whenever the objects change. */
+			void clear();
+
+			/** @brief The objects in the collection that pass the region cut (see passesRegionCut).
+			 *
+			 * The reference is only valid until the next call to passing() or clear().
+			 */
+			const PassingObjects& passing( CaloCollection collection, float regionCut )
+			{
+				// Only cuts that round up to between -1 and 11 are in the table. Anything else, including NaN,
+				// is searched for.
+				if( !(regionCut>-2 && regionCut<=numberOfRegionCuts-2) ) return searchFor( collection, regionCut );
+				int roundedCut=static_cast<int>(regionCut);
+				if( roundedCut<regionCut ) ++roundedCut;
+
+				PassingObjects& entry=caloTable_[static_cast<size_t>(collection)*numberOfRegionCuts+roundedCut+1];
+				if( entry.generation_!=generation_ )
+				{
+					entry.fill( caloObjects(collection), regionCut );
+					entry.generation_=generation_;
+				}
+				return entry;
+			}
+
+			/** @brief The muons that have at least the given quality and |eta| no more than etaCut. Only valid until the next call. */
+			const PassingObjects& passingMuons( float etaCut, float muonQuality )
+			{
+				for( size_t entryNumber=0; entryNumber<numberOfEntries_; ++entryNumber )
+				{
+					const PassingObjects& entry=entries_[entryNumber];
+					if( entry.pMuons_!=nullptr && entry.cut_==etaCut && entry.muonQuality_==muonQuality ) return entry;
+				}
+				PassingObjects& entry=newEntry();
+				entry.fill( pObjects_->muons, etaCut, muonQuality );
+				return entry;
+			}
+		private:
+			/** @brief Whole number region cuts from -1 to 11, which is more than enough to remove every region. */
+			static const int numberOfRegionCuts=13;
+			/** @brief The number of values in CaloCollection. */
+			static const size_t numberOfCollections=6;
+
+			const l1menu::implementation::TriggerObjects::CaloObjects& caloObjects( CaloCollection collection ) const;
+			const PassingObjects& searchFor( CaloCollection collection, float regionCut );
+			PassingObjects& newEntry();
+
+			const l1menu::implementation::TriggerObjects* pObjects_;
+			unsigned int generation_; ///< @brief Changed by clear(), so that everything in caloTable_ is out of date
+			PassingObjects caloTable_[numberOfCollections*numberOfRegionCuts]; ///< @brief Indexed by collection, then region cut rounded up
+			/** @brief Muons and unusual region cuts, which have to be searched for.
+			 *
+			 * The entries in use are the first numberOfEntries_, the rest are kept so that their memory can be reused. */
+			std::vector<PassingObjects> entries_;
+			size_t numberOfEntries_;
+		}; // end of class DerivedQuantities
+
+	} // end of the implementation namespace
+} // end of the l1menu namespace
+#endif
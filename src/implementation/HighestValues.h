@@ -0,0 +1,48 @@
+#ifndef l1menu_implementation_HighestValues_h
+#define l1menu_implementation_HighestValues_h
+
+#include <stddef.h> // required for size_t
+
+namespace l1menu
+{
+	namespace implementation
+	{
+		/** @brief Keeps the N highest of the values it's given, in descending order, without allocating any memory.
+		 *
+		 * Used by the triggers to work out their tightest thresholds, e.g. the threshold on the 3rd jet of a
+		 * multi-jet trigger is the 3rd highest jet Et. N is expected to be small, so a simple insertion
+		 * is quicker than anything more clever.
+		 */
+		template<size_t N>
+		class HighestValues
+		{
+		public:
+			static const size_t capacity=N;
+
+			HighestValues() : size_(0) {}
+
+			void add( float value )
+			{
+				size_t position=size_;
+				if( size_<N ) ++size_;
+				else if( value<=values_[N-1] ) return;
+				else position=N-1;
+
+				// Shuffle everything smaller down to make room
+				for( ; position>0 && values_[position-1]<value; --position ) values_[position]=values_[position-1];
+				values_[position]=value;
+			}
+
+			/** @brief How many values are held, which is the number added up to a maximum of N. */
+			size_t size() const { return size_; }
+
+			/** @brief The value of the given rank, where 0 is the highest. Must be less than size(). */
+			float operator[]( size_t rank ) const { return values_[rank]; }
+		private:
+			float values_[N];
+			size_t size_;
+		};
+
+	} // end of the implementation namespace
+} // end of the l1menu namespace
+#endif
@@ -12,28 +12,92 @@
 #include "l1menu/TriggerMenu.h"
 #include "l1menu/ISample.h"
 #include "l1menu/IEvent.h"
+#include "l1menu/FullSample.h"
+#include "l1menu/L1TriggerDPGEvent.h"
 #include "TriggerRateImplementation.h"
 #include "l1menu/tools/XMLFile.h"
 #include "l1menu/tools/XMLElement.h"
 #include "l1menu/tools/fileIO.h"
 
 
-l1menu::implementation::MenuRateImplementation::MenuRateImplementation( const l1menu::TriggerMenu& menu, const l1menu::ISample& sample )
+namespace // Use the unnamed namespace for things only used in this file
 {
+	/** @brief The sums of weights needed to work out the rates, so that separate parts of a sample can be added up separately.
+	 */
+	struct RateCounts
+	{
+		RateCounts( size_t numberOfTriggers )
+			: weightOfEventsPassed(numberOfTriggers), weightSquaredOfEventsPassed(numberOfTriggers),
+			  weightOfEventsPure(numberOfTriggers), weightSquaredOfEventsPure(numberOfTriggers),
+			  weightOfEventsPassingAnyTrigger(0), weightSquaredOfEventsPassingAnyTrigger(0), weightOfAllEvents(0)
+		{
+		}
+
+		void addEvent( const l1menu::IEvent& event, const std::vector< std::unique_ptr<l1menu::ICachedTrigger> >& cachedTriggers )
+		{
+			float weight=event.weight();
+			weightOfAllEvents+=weight;
+
+			size_t numberOfTriggersPassed=0;
+			size_t numberOfLastPassedTrigger=0; // This is just so I can work out the pure rate
+
+			for( size_t triggerNumber=0; triggerNumber<cachedTriggers.size(); ++triggerNumber )
+			{
+				if( cachedTriggers[triggerNumber]->apply(event) )
+				{
+					// If the event passes the trigger, increment the counters
+					++numberOfTriggersPassed;
+					weightOfEventsPassed[triggerNumber]+=weight;
+					weightSquaredOfEventsPassed[triggerNumber]+=(weight*weight);
+					numberOfLastPassedTrigger=triggerNumber; // If only one event passes, this is used to increment the pure counter
+				}
+			}
+
+			// See if I should increment any of the pure or total counters
+			if( numberOfTriggersPassed==1 )
+			{
+				weightOfEventsPure[numberOfLastPassedTrigger]+=weight;
+				weightSquaredOfEventsPure[numberOfLastPassedTrigger]+=(weight*weight);
+			}
+			if( numberOfTriggersPassed>0 )
+			{
+				weightOfEventsPassingAnyTrigger+=weight;
+				weightSquaredOfEventsPassingAnyTrigger+=(weight*weight);
+			}
+		}
+
+		void add( const RateCounts& other )
+		{
+			for( size_t triggerNumber=0; triggerNumber<weightOfEventsPassed.size(); ++triggerNumber )
+			{
+				weightOfEventsPassed[triggerNumber]+=other.weightOfEventsPassed[triggerNumber];
+				weightSquaredOfEventsPassed[triggerNumber]+=other.weightSquaredOfEventsPassed[triggerNumber];
+				weightOfEventsPure[triggerNumber]+=other.weightOfEventsPure[triggerNumber];
+				weightSquaredOfEventsPure[triggerNumber]+=other.weightSquaredOfEventsPure[triggerNumber];
+			}
+			weightOfEventsPassingAnyTrigger+=other.weightOfEventsPassingAnyTrigger;
+			weightSquaredOfEventsPassingAnyTrigger+=other.weightSquaredOfEventsPassingAnyTrigger;
+			weightOfAllEvents+=other.weightOfAllEvents;
+		}
 
-	// The sum of event weights that pass each trigger
-	std::vector<float> weightOfEventsPassed( menu.numberOfTriggers() );
-	// The sume of weights squared that pass each trigger. Used to calculate the error.
-	std::vector<float> weightSquaredOfEventsPassed( menu.numberOfTriggers() );
+		// The sum of event weights that pass each trigger
+		std::vector<float> weightOfEventsPassed;
+		// The sume of weights squared that pass each trigger. Used to calculate the error.
+		std::vector<float> weightSquaredOfEventsPassed;
 
-	// The number of events that only pass the given trigger
-	std::vector<float> weightOfEventsPure( menu.numberOfTriggers() );
-	std::vector<float> weightSquaredOfEventsPure( menu.numberOfTriggers() );
+		// The number of events that only pass the given trigger
+		std::vector<float> weightOfEventsPure;
+		std::vector<float> weightSquaredOfEventsPure;
 
-	float weightOfEventsPassingAnyTrigger=0;
-	float weightSquaredOfEventsPassingAnyTrigger=0;
-	float weightOfAllEvents=0;
+		float weightOfEventsPassingAnyTrigger;
+		float weightSquaredOfEventsPassingAnyTrigger;
+		float weightOfAllEvents;
+	};
 
+} // end of the unnamed namespace
+
+l1menu::implementation::MenuRateImplementation::MenuRateImplementation( const l1menu::TriggerMenu& menu, const l1menu::ISample& sample )
+{
 	// Using cached triggers significantly increases speed for ReducedSample
 	// because it cuts out expensive string comparisons when querying the trigger
 	// parameters.
@@ -43,41 +107,35 @@ l1menu::implementation::MenuRateImplementation::MenuRateImplementation( const l1
 		cachedTriggers.push_back( sample.createCachedTrigger( menu.getTrigger( triggerNumber ) ) );
 	}
 
-	size_t numberOfLastPassedTrigger=0; // This is just so I can work out the pure rate
+	RateCounts counts( menu.numberOfTriggers() );
 
-	for( size_t eventNumber=0; eventNumber<sample.numberOfEvents(); ++eventNumber )
+	// A FullSample spends most of its time reading the ntuples, so spread that over several threads
+	// with separate counts for each. The cached triggers for a FullSample keep everything they work out
+	// in the events, and each event is only used by one thread, so they can be shared.
+	const l1menu::FullSample* pFullSample=dynamic_cast<const l1menu::FullSample*>( &sample );
+	if( pFullSample!=nullptr && pFullSample->numberOfThreads()>1 )
 	{
-		const l1menu::IEvent& event=sample.getEvent(eventNumber);
-		float weight=event.weight();
-		weightOfAllEvents+=weight;
-
-		size_t numberOfTriggersPassed=0;
-
-		for( size_t triggerNumber=0; triggerNumber<cachedTriggers.size(); ++triggerNumber )
-		{
-			if( cachedTriggers[triggerNumber]->apply(event) )
-			{
-				// If the event passes the trigger, increment the counters
-				++numberOfTriggersPassed;
-				weightOfEventsPassed[triggerNumber]+=weight;
-				weightSquaredOfEventsPassed[triggerNumber]+=(weight*weight);
-				numberOfLastPassedTrigger=triggerNumber; // If only one event passes, this is used to increment the pure counter
-			}
-		}
-
-		// See if I should increment any of the pure or total counters
-		if( numberOfTriggersPassed==1 )
+		std::vector<RateCounts> threadCounts( pFullSample->numberOfThreads(), counts );
+		pFullSample->forEachFullEventInParallel( [&]( size_t threadNumber, const l1menu::L1TriggerDPGEvent& event )
 		{
-			weightOfEventsPure[numberOfLastPassedTrigger]+=weight;
-			weightSquaredOfEventsPure[numberOfLastPassedTrigger]+=(weight*weight);
-		}
-		if( numberOfTriggersPassed>0 )
+			threadCounts[threadNumber].addEvent( event, cachedTriggers );
+		} );
+		for( const auto& countsForThread : threadCounts ) counts.add( countsForThread );
+	}
+	else
+	{
+		sample.forEachEvent( 0, sample.numberOfEvents(), [&]( const l1menu::IEvent& event )
 		{
-			weightOfEventsPassingAnyTrigger+=weight;
-			weightSquaredOfEventsPassingAnyTrigger+=(weight*weight);
-		}
+			counts.addEvent( event, cachedTriggers );
+		} );
 	}
 
+	const std::vector<float>& weightOfEventsPassed=counts.weightOfEventsPassed;
+	const std::vector<float>& weightSquaredOfEventsPassed=counts.weightSquaredOfEventsPassed;
+	const std::vector<float>& weightOfEventsPure=counts.weightOfEventsPure;
+	const std::vector<float>& weightSquaredOfEventsPure=counts.weightSquaredOfEventsPure;
+	const float weightOfAllEvents=counts.weightOfAllEvents;
+
 	float scaling=sample.eventRate();
 
 	for( size_t triggerNumber=0; triggerNumber<cachedTriggers.size(); ++triggerNumber )
@@ -93,8 +151,8 @@ l1menu::implementation::MenuRateImplementation::MenuRateImplementation( const l1
 	//
 	// Now I have everything I need to calculate all of the values required by the interface
 	//
-	totalFraction_=weightOfEventsPassingAnyTrigger/weightOfAllEvents;
-	totalFractionError_=std::sqrt(weightSquaredOfEventsPassingAnyTrigger)/weightOfAllEvents;
+	totalFraction_=counts.weightOfEventsPassingAnyTrigger/weightOfAllEvents;
+	totalFractionError_=std::sqrt(counts.weightSquaredOfEventsPassingAnyTrigger)/weightOfAllEvents;
 	totalRate_=totalFraction_*scaling;
 	totalRateError_=totalFractionError_*scaling;
 }
@@ -0,0 +1,299 @@
+#include "ReducedSampleFileFormat.h"
+
+#include <vector>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <climits>
+#include <sys/stat.h>
+#include "l1menu/ITrigger.h"
+#include "l1menu/TriggerMenu.h"
+#include "l1menu/tools/miscellaneous.h"
+#include "CompressionCodecs.h"
+#include "protobuf/l1menu.pb.h"
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+const std::string l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER="l1menuReducedSample";
+const std::string l1menu::implementation::ReducedSampleFooter::FOOTER_MAGIC_NUMBER="l1mfootr";
+const size_t l1menu::implementation::ReducedSampleFooter::FOOTER_SIZE=40;
+
+l1menu::implementation::ReducedSampleFooter::ReducedSampleFooter()
+	: numberOfEvents(0), sumOfWeights(0), payloadSize(0)
+{
+	// No operation besides the initialiser list
+}
+
+void l1menu::implementation::ReducedSampleFooter::write( google::protobuf::io::ZeroCopyOutputStream& output ) const
+{
+	google::protobuf::uint64 sumOfWeightsBits;
+	std::memcpy( &sumOfWeightsBits, &sumOfWeights, sizeof(sumOfWeightsBits) );
+
+	google::protobuf::io::CodedOutputStream codedOutput( &output );
+	// The frame index is only written if there are frames, in which case it's a version 2 footer
+	for( const auto& frame : frames )
+	{
+		codedOutput.WriteLittleEndian64( frame.offset );
+		codedOutput.WriteLittleEndian64( frame.size );
+		codedOutput.WriteLittleEndian64( frame.numberOfEvents );
+	}
+	if( !frames.empty() ) codedOutput.WriteLittleEndian64( frames.size() );
+
+	codedOutput.WriteLittleEndian64( numberOfEvents );
+	codedOutput.WriteLittleEndian64( sumOfWeightsBits );
+	codedOutput.WriteLittleEndian64( payloadSize );
+	if( frames.empty() )
+	{
+		codedOutput.WriteLittleEndian32( 1 ); // footer version
+		codedOutput.WriteLittleEndian32( FOOTER_SIZE );
+	}
+	else
+	{
+		codedOutput.WriteLittleEndian32( 2 );
+		codedOutput.WriteLittleEndian32( FOOTER_SIZE+sizeof(google::protobuf::uint64)*(3*frames.size()+1) );
+	}
+	codedOutput.WriteRaw( FOOTER_MAGIC_NUMBER.data(), FOOTER_MAGIC_NUMBER.size() );
+}
+
+bool l1menu::implementation::ReducedSampleFooter::read( int fileDescriptor )
+{
+	struct stat fileStatus;
+	if( fstat( fileDescriptor, &fileStatus )!=0 ) return false;
+	if( static_cast<size_t>(fileStatus.st_size)<FOOTER_SIZE ) return false;
+
+	// Read the fixed size part of the footer first. I use pread so that the file
+	// position is left where it was.
+	std::vector<google::protobuf::uint8> buffer( FOOTER_SIZE );
+	if( pread( fileDescriptor, buffer.data(), FOOTER_SIZE, fileStatus.st_size-FOOTER_SIZE )!=static_cast<ssize_t>(FOOTER_SIZE) ) return false;
+	if( std::memcmp( buffer.data()+FOOTER_SIZE-FOOTER_MAGIC_NUMBER.size(), FOOTER_MAGIC_NUMBER.data(), FOOTER_MAGIC_NUMBER.size() )!=0 ) return false;
+
+	google::protobuf::io::CodedInputStream codedInput( buffer.data(), buffer.size() );
+	google::protobuf::uint64 sumOfWeightsBits;
+	google::protobuf::uint32 footerVersion, footerSize;
+	codedInput.ReadLittleEndian64( &numberOfEvents );
+	codedInput.ReadLittleEndian64( &sumOfWeightsBits );
+	codedInput.ReadLittleEndian64( &payloadSize );
+	codedInput.ReadLittleEndian32( &footerVersion );
+	codedInput.ReadLittleEndian32( &footerSize );
+	std::memcpy( &sumOfWeights, &sumOfWeightsBits, sizeof(sumOfWeights) );
+
+	frames.clear();
+	if( footerVersion==1 && footerSize==FOOTER_SIZE ) return true;
+	else if( footerVersion!=2 || footerSize<FOOTER_SIZE+sizeof(google::protobuf::uint64) || footerSize>static_cast<size_t>(fileStatus.st_size) )
+	{
+		throw std::runtime_error( "ReducedSampleFooter - the file has a footer version this code doesn't understand" );
+	}
+
+	// Version 2 footers also have the frame index before the fixed part
+	const size_t indexSize=footerSize-FOOTER_SIZE;
+	buffer.resize( indexSize );
+	if( pread( fileDescriptor, buffer.data(), indexSize, fileStatus.st_size-footerSize )!=static_cast<ssize_t>(indexSize) ) throw std::runtime_error( "ReducedSampleFooter - couldn't read the frame index" );
+
+	google::protobuf::uint64 numberOfFrames;
+	std::memcpy( &numberOfFrames, buffer.data()+indexSize-sizeof(numberOfFrames), sizeof(numberOfFrames) );
+	if( indexSize!=sizeof(google::protobuf::uint64)*(3*numberOfFrames+1) ) throw std::runtime_error( "ReducedSampleFooter - the frame index is the wrong size" );
+
+	google::protobuf::io::CodedInputStream indexInput( buffer.data(), buffer.size() );
+	frames.resize( numberOfFrames );
+	for( auto& frame : frames )
+	{
+		indexInput.ReadLittleEndian64( &frame.offset );
+		indexInput.ReadLittleEndian64( &frame.size );
+		indexInput.ReadLittleEndian64( &frame.numberOfEvents );
+		if( frame.offset+frame.size > static_cast<size_t>(fileStatus.st_size) ) throw std::runtime_error( "ReducedSampleFooter - the frame index points past the end of the file" );
+	}
+
+	return true;
+}
+
+bool l1menu::implementation::readDelimitedMessage( google::protobuf::io::ZeroCopyInputStream& input, google::protobuf::MessageLite& message )
+{
+	google::protobuf::io::CodedInputStream codedInput( &input );
+
+	google::protobuf::uint64 messageSize;
+	if( !codedInput.ReadVarint64( &messageSize ) ) return false;
+	// The limits below are ints, so a corrupt length could otherwise wrap round to something small
+	if( messageSize>static_cast<google::protobuf::uint64>(INT_MAX-16) ) throw std::runtime_error( "ReducedSample file - a message says it's "+std::to_string(messageSize)+" bytes long, which is too big to read. The file is probably corrupt." );
+
+	// The default limit is 64Mb which will be fine unless this particular message is
+	// huge. Setting the warning threshold to -1 disables the warnings.
+	int totalBytesLimit=std::max<google::protobuf::uint64>( messageSize+16, 67108864 );
+	codedInput.SetTotalBytesLimit( totalBytesLimit, -1 );
+
+	google::protobuf::io::CodedInputStream::Limit readLimit=codedInput.PushLimit(messageSize);
+	if( !message.ParseFromCodedStream( &codedInput ) ) throw std::runtime_error( "ReducedSample file - some unknown error while reading a message" );
+	codedInput.PopLimit(readLimit);
+
+	return true;
+}
+
+void l1menu::implementation::writeFrame( const google::protobuf::MessageLite& message, l1menu::ReducedSample::Codec codec, std::string& output )
+{
+	std::string uncompressedFrame;
+	{ // Block to make sure codedOutput has flushed everything before it's compressed
+		google::protobuf::io::StringOutputStream stringOutput( &uncompressedFrame );
+		google::protobuf::io::CodedOutputStream codedOutput( &stringOutput );
+
+		codedOutput.WriteVarint64( message.ByteSize() );
+		message.SerializeToCodedStream( &codedOutput );
+	}
+
+	l1menu::implementation::getCompressionCodec( codec ).compress( uncompressedFrame, output );
+}
+
+void l1menu::implementation::readCompressedFrame( int fileDescriptor, const ReducedSampleFooter::Frame& frame, std::string& buffer )
+{
+	buffer.resize( frame.size );
+	size_t bytesRead=0;
+	while( bytesRead<frame.size )
+	{
+		ssize_t result=pread( fileDescriptor, &buffer[bytesRead], frame.size-bytesRead, frame.offset+bytesRead );
+		if( result<=0 ) throw std::runtime_error( "ReducedSample file - couldn't read a frame from the file" );
+		bytesRead+=result;
+	}
+}
+
+void l1menu::implementation::readFrame( int fileDescriptor, const ReducedSampleFooter::Frame& frame, l1menu::ReducedSample::Codec codec, google::protobuf::MessageLite& message )
+{
+	std::string buffer;
+	readCompressedFrame( fileDescriptor, frame, buffer );
+
+	std::string uncompressedFrame;
+	l1menu::implementation::getCompressionCodec( codec ).decompress( buffer.data(), buffer.size(), uncompressedFrame );
+
+	google::protobuf::io::ArrayInputStream arrayInput( uncompressedFrame.data(), uncompressedFrame.size() );
+	if( !readDelimitedMessage( arrayInput, message ) ) throw std::runtime_error( "ReducedSample file - a frame is empty" );
+}
+
+l1menu::ReducedSample::Codec l1menu::implementation::readCodecTag( google::protobuf::io::CodedInputStream& input )
+{
+	google::protobuf::uint32 codecTag;
+	if( !input.ReadVarint32( &codecTag ) ) throw std::runtime_error( "ReducedSample file - error reading the compression codec" );
+	if( codecTag>static_cast<google::protobuf::uint32>(l1menu::ReducedSample::Codec::LZ4) ) throw std::runtime_error( "ReducedSample file - the file uses a compression codec this code doesn't know about. Is your code up to date?" );
+	const l1menu::ReducedSample::Codec codec=static_cast<l1menu::ReducedSample::Codec>( codecTag );
+	// Check the codec was compiled in now, so that the error is clear rather than coming from the first frame
+	getCompressionCodec( codec );
+	return codec;
+}
+
+bool l1menu::implementation::headersMatch( const l1menuprotobuf::SampleHeader& firstHeader, const l1menuprotobuf::SampleHeader& secondHeader )
+{
+	if( firstHeader.trigger_size()!=secondHeader.trigger_size() ) return false;
+	if( !thresholdMethodsMatch( firstHeader, secondHeader ) ) return false;
+
+	for( int triggerNumber=0; triggerNumber<firstHeader.trigger_size(); ++triggerNumber )
+	{
+		const l1menuprotobuf::Trigger& firstTrigger=firstHeader.trigger(triggerNumber);
+		const l1menuprotobuf::Trigger& secondTrigger=secondHeader.trigger(triggerNumber);
+		if( firstTrigger.name()!=secondTrigger.name() || firstTrigger.version()!=secondTrigger.version() ) return false;
+
+		if( firstTrigger.parameter_size()!=secondTrigger.parameter_size() ) return false;
+		for( int parameterNumber=0; parameterNumber<firstTrigger.parameter_size(); ++parameterNumber )
+		{
+			const l1menuprotobuf::Trigger_TriggerParameter& firstParameter=firstTrigger.parameter(parameterNumber);
+			const l1menuprotobuf::Trigger_TriggerParameter& secondParameter=secondTrigger.parameter(parameterNumber);
+			if( firstParameter.name()!=secondParameter.name() ) return false;
+			// NaN isn't equal to itself, but two NaN parameters are still the same
+			if( firstParameter.value()!=secondParameter.value() && !( firstParameter.value()!=firstParameter.value() && secondParameter.value()!=secondParameter.value() ) ) return false;
+		}
+
+		if( firstTrigger.varying_parameter_size()!=secondTrigger.varying_parameter_size() ) return false;
+		for( int parameterNumber=0; parameterNumber<firstTrigger.varying_parameter_size(); ++parameterNumber )
+		{
+			if( firstTrigger.varying_parameter(parameterNumber)!=secondTrigger.varying_parameter(parameterNumber) ) return false;
+		}
+	}
+
+	return true;
+}
+
+bool l1menu::implementation::thresholdMethodsMatch( const l1menuprotobuf::SampleHeader& firstHeader, const l1menuprotobuf::SampleHeader& secondHeader )
+{
+	for( int triggerNumber=0; triggerNumber<firstHeader.trigger_size() && triggerNumber<secondHeader.trigger_size(); ++triggerNumber )
+	{
+		if( firstHeader.trigger(triggerNumber).exact_thresholds()!=secondHeader.trigger(triggerNumber).exact_thresholds() ) return false;
+	}
+	return true;
+}
+
+void l1menu::implementation::copyHeaderToTriggerMenu( const l1menuprotobuf::SampleHeader& header, l1menu::TriggerMenu& menu )
+{
+	for( int triggerNumber=0; triggerNumber<header.trigger_size(); ++triggerNumber )
+	{
+		const l1menuprotobuf::Trigger& inputTrigger=header.trigger(triggerNumber);
+
+		// Get a reference to the trigger as it is created
+		l1menu::ITrigger& trigger=menu.addTrigger( inputTrigger.name(), inputTrigger.version() );
+
+		// Run through all of the parameters and set them to what they were
+		// when the sample was made.
+		for( int parameterNumber=0; parameterNumber<inputTrigger.parameter_size(); ++parameterNumber )
+		{
+			const auto& inputParameter=inputTrigger.parameter(parameterNumber);
+			trigger.parameter(inputParameter.name())=inputParameter.value();
+		}
+
+		// I should probably check the threshold names exist. I'll do it another time.
+	}
+}
+
+const std::map<std::string,size_t> l1menu::implementation::getTriggerParameterIdentifiers( const l1menu::TriggerMenu& menu, const l1menu::ITrigger& trigger, bool allowOlderVersion )
+{
+	std::map<std::string,size_t> returnValue;
+
+	// Need to find out how many parameters there are for each event. Basically the sum
+	// of the number of thresholds for all triggers.
+	size_t parameterNumber=0;
+	bool triggerWasFound=true;
+	for( size_t triggerNumber=0; triggerNumber<menu.numberOfTriggers(); ++triggerNumber )
+	{
+		const l1menu::ITrigger& triggerInMenu=menu.getTrigger(triggerNumber);
+
+		triggerWasFound=true; // Set to true, then back to false if any of the tests fail
+		// See if this trigger in the menu is the same as the one passed as a parameter
+		if( triggerInMenu.name()!=trigger.name() ) triggerWasFound=false;
+		if( allowOlderVersion )
+		{
+			if( triggerInMenu.version()>trigger.version() ) triggerWasFound=false;
+		}
+		else
+		{
+			if( triggerInMenu.version()!=trigger.version() ) triggerWasFound=false;
+		}
+
+		// If control got this far then there is a trigger with the required name
+		// and sufficient version. I now need to check all of the non threshold parameters
+		// to make sure they match, i.e. make sure the ReducedSample was made with the same
+		// eta cuts or whatever.
+		// I don't care if the thresholds don't match because that's what's stored in the
+		// ReducedSample.
+		if( triggerWasFound ) // Trigger can still fail, but no point doing this check if it already has
+		{
+			std::vector<std::string> parameterNames=l1menu::tools::getNonThresholdParameterNames( trigger );
+			for( const auto& parameterName : parameterNames )
+			{
+				if( trigger.parameter(parameterName)!=triggerInMenu.parameter(parameterName) ) triggerWasFound=false;
+			}
+		}
+
+		std::vector<std::string> thresholdNames=l1menu::tools::getThresholdNames(triggerInMenu);
+		if( triggerWasFound )
+		{
+			for( const auto& thresholdName : thresholdNames )
+			{
+				returnValue[thresholdName]=parameterNumber;
+				++parameterNumber;
+			}
+			break;
+		}
+		else parameterNumber+=thresholdNames.size();
+	}
+
+	// There could conceivably be a trigger that was found but has no thresholds
+	// (I guess - it would be a pretty pointless trigger though). To indicate the
+	// difference between that and a trigger that wasn't found I'll respectively
+	// return the empty vector or throw an exception.
+	if( !triggerWasFound ) throw std::runtime_error( "l1menu::ReducedSample::getTriggerParameterIdentifiers() called for a trigger that was not used to create the sample - "+trigger.name() );
+
+	return returnValue;
+}
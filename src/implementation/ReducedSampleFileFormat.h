@@ -0,0 +1,187 @@
+#ifndef l1menu_implementation_ReducedSampleFileFormat_h
+#define l1menu_implementation_ReducedSampleFileFormat_h
+
+#include <string>
+#include <map>
+#include <vector>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <google/protobuf/stubs/common.h>
+#include "l1menu/ReducedSample.h"
+
+//
+// Forward declarations
+//
+namespace l1menu
+{
+	class ITrigger;
+	class TriggerMenu;
+}
+namespace l1menuprotobuf
+{
+	class SampleHeader;
+}
+namespace google
+{
+	namespace protobuf
+	{
+		class MessageLite;
+		namespace io
+		{
+			class ZeroCopyInputStream;
+			class ZeroCopyOutputStream;
+			class CodedInputStream;
+		}
+	}
+}
+
+
+namespace l1menu
+{
+	namespace implementation
+	{
+		/** @brief Sentry that closes a Unix file descriptor when it goes out of scope.
+		 * @author Mark Grimes (mark.grimes@bristol.ac.uk)
+		 * @date 07/Jun/2013
+		 */
+		class UnixFileSentry
+		{
+		public:
+			UnixFileSentry( int fileDescriptor ) : fileDescriptor_(fileDescriptor) {}
+			~UnixFileSentry() { close(fileDescriptor_); }
+		private:
+			int fileDescriptor_;
+		};
+
+		/** @brief Sentry that maps a whole file into memory read only, and unmaps it when it goes out of scope.
+		 *
+		 * The file descriptor is not required to stay open once the file has been mapped.
+		 */
+		class MemoryMappedFile
+		{
+		public:
+			MemoryMappedFile( int fileDescriptor ) : pData_(nullptr), size_(0)
+			{
+				struct stat fileStatus;
+				if( fstat( fileDescriptor, &fileStatus )!=0 ) throw std::runtime_error( "MemoryMappedFile - couldn't get the size of the file" );
+				size_=fileStatus.st_size;
+				if( size_==0 ) throw std::runtime_error( "MemoryMappedFile - the file is empty" );
+				void* pMapped=mmap( nullptr, size_, PROT_READ, MAP_PRIVATE, fileDescriptor, 0 );
+				if( pMapped==MAP_FAILED ) throw std::runtime_error( "MemoryMappedFile - couldn't map the file into memory" );
+				pData_=static_cast<const char*>(pMapped);
+			}
+			~MemoryMappedFile() { munmap( const_cast<char*>(pData_), size_ ); }
+			const char* data() const { return pData_; }
+			size_t size() const { return size_; }
+		private:
+			const char* pData_;
+			size_t size_;
+		};
+
+		/** @brief Summary information appended to the end of version 1 and version 3 ReducedSample files.
+		 *
+		 * This lets readers find out how many events there are, and what they add up to, without
+		 * decompressing the whole file first. Files written before the footer was introduced don't
+		 * have one, so readers have to be prepared to fall back to counting. Older readers stop when
+		 * the gzip stream finishes so they never see the footer.
+		 *
+		 * The layout is little endian uint64 number of events, uint64 sum of weights (bit pattern of
+		 * a double), uint64 size of the compressed payload, uint32 footer version, uint32 total size
+		 * of the footer, then the 8 character FOOTER_MAGIC_NUMBER. The footer is found by reading the
+		 * last 16 bytes of the file.
+		 *
+		 * Version 2 footers are written for the chunked file format (version 3), where every message
+		 * is compressed as a separate frame. Before the fields above they have the offset from the start
+		 * of the file, compressed size and number of events of each frame as uint64s, followed by the
+		 * number of frames as a uint64.
+		 */
+		struct ReducedSampleFooter
+		{
+			/** @brief Where a separately compressed message is in the file. */
+			struct Frame
+			{
+				google::protobuf::uint64 offset; ///< @brief Position of the start of the frame from the start of the file
+				google::protobuf::uint64 size; ///< @brief Compressed size in bytes
+				google::protobuf::uint64 numberOfEvents; ///< @brief Zero for the header frame
+			};
+
+			ReducedSampleFooter();
+			/** @brief Writes the footer to the end of the stream. */
+			void write( google::protobuf::io::ZeroCopyOutputStream& output ) const;
+			/** @brief Tries to read the footer from the end of the file. Returns false if the file doesn't have a valid footer. */
+			bool read( int fileDescriptor );
+
+			google::protobuf::uint64 numberOfEvents;
+			double sumOfWeights;
+			google::protobuf::uint64 payloadSize; ///< @brief Bytes between the end of the uncompressed preamble and the start of the footer
+			std::vector<Frame> frames; ///< @brief Only used for the chunked file format, in which case the first frame is the header
+
+			static const std::string FOOTER_MAGIC_NUMBER;
+			static const size_t FOOTER_SIZE; ///< @brief Size of a version 1 footer, and of the fixed part of a version 2 footer
+		};
+
+		/** @brief The string written at the start of every ReducedSample file. */
+		extern const std::string REDUCED_SAMPLE_MAGIC_NUMBER;
+
+		/** @brief Reads a message that was written preceded by its size as a varint64.
+		 *
+		 * A new CodedInputStream is used for each message, so there is no need to keep raising the
+		 * protobuf total bytes limit however many messages are read from the stream.
+		 * @return False if the stream has ended cleanly, i.e. there was no message to read.
+		 * @throw std::runtime_error If the message could not be parsed.
+		 */
+		bool readDelimitedMessage( google::protobuf::io::ZeroCopyInputStream& input, google::protobuf::MessageLite& message );
+
+		/** @brief Compresses the message, preceded by its size, on its own with the given codec and appends it to the output. */
+		void writeFrame( const google::protobuf::MessageLite& message, l1menu::ReducedSample::Codec codec, std::string& output );
+
+		/** @brief Reads the still compressed bytes of a frame into the buffer.
+		 *
+		 * Uses pread, so can be called from several threads at once on the same file descriptor.
+		 * @throw std::runtime_error If the frame could not be read.
+		 */
+		void readCompressedFrame( int fileDescriptor, const ReducedSampleFooter::Frame& frame, std::string& buffer );
+
+		/** @brief Reads and decompresses a frame written with writeFrame.
+		 *
+		 * Uses pread, so can be called from several threads at once on the same file descriptor.
+		 * @throw std::runtime_error If the frame could not be read or parsed.
+		 */
+		void readFrame( int fileDescriptor, const ReducedSampleFooter::Frame& frame, l1menu::ReducedSample::Codec codec, google::protobuf::MessageLite& message );
+
+		/** @brief Reads the codec tag that follows the file format version in chunked (version 3) files.
+		 * @throw std::runtime_error If the tag couldn't be read or is for an unknown codec.
+		 */
+		l1menu::ReducedSample::Codec readCodecTag( google::protobuf::io::CodedInputStream& input );
+
+		/** @brief Adds the triggers described in the protobuf header to the menu, with all of their parameters set. */
+		void copyHeaderToTriggerMenu( const l1menuprotobuf::SampleHeader& header, l1menu::TriggerMenu& menu );
+
+		/** @brief Whether the headers have the same triggers in the same order, with the same versions and parameters.
+		 *
+		 * The fields are compared one by one, because protobuf doesn't guarantee that the same message always
+		 * serialises to the same bytes. The order matters because it's the order of the thresholds in the events.
+		 * The thresholds also have to have been found the same way (see thresholdMethodsMatch).
+		 */
+		bool headersMatch( const l1menuprotobuf::SampleHeader& firstHeader, const l1menuprotobuf::SampleHeader& secondHeader );
+
+		/** @brief Whether each trigger's thresholds were found the same way in both headers, i.e. exactly or by bisection.
+		 *
+		 * Samples from before the method was recorded always used bisection. Only compares as many triggers as
+		 * the shorter header has, so this is just to give a better message when headersMatch fails.
+		 */
+		bool thresholdMethodsMatch( const l1menuprotobuf::SampleHeader& firstHeader, const l1menuprotobuf::SampleHeader& secondHeader );
+
+		/** @brief Finds the index of each of the trigger's thresholds in the events of a sample made with the given menu.
+		 *
+		 * Each event in a ReducedSample stores the thresholds for all of the triggers in the menu in order. This
+		 * works out which of those belong to the given trigger.
+		 * @throw std::runtime_error If the trigger (with the same non threshold parameters) is not in the menu.
+		 */
+		const std::map<std::string,size_t> getTriggerParameterIdentifiers( const l1menu::TriggerMenu& menu, const l1menu::ITrigger& trigger, bool allowOlderVersion );
+
+	} // end of the implementation namespace
+} // end of the l1menu namespace
+#endif
@@ -0,0 +1,104 @@
+#include "TriggerObjects.h"
+
+#include <algorithm>
+#include <cmath>
+#include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
+
+namespace // unnamed namespace
+{
+	/** @brief Converts a calorimeter eta or phi to the nearest whole region number.
+	 *
+	 * Events from the ntuples always have whole region numbers, but hand made events might not. Anything
+	 * out of the range of a short is clamped, and NaN is put at -1 which is outside every region cut.
+	 */
+	short toRegionNumber( float value )
+	{
+		if( value!=value ) return -1;
+		if( value<=-32768 ) return -32768;
+		if( value>=32767 ) return 32767;
+		return static_cast<short>( std::lround(value) );
+	}
+
+	/** @brief Sets sortedIndices to the objects up to numberOfObjects that have a bunch crossing of zero, highest Et first. */
+	void sortInTimeObjects( int numberOfObjects, const std::vector<int>& bunchCrossings, const std::vector<float>& et, std::vector<size_t>& sortedIndices )
+	{
+		sortedIndices.clear();
+		for( int index=0; index<numberOfObjects; ++index )
+		{
+			if( bunchCrossings[index]==0 ) sortedIndices.push_back( index );
+		}
+		std::stable_sort( sortedIndices.begin(), sortedIndices.end(), [&et]( size_t first, size_t second ){ return et[first]>et[second]; } );
+	}
+
+	void addCaloObject( l1menu::implementation::TriggerObjects::CaloObjects& objects, float et, short etaRegion, short phiRegion, bool isolated )
+	{
+		objects.et.push_back( et );
+		objects.etaRegion.push_back( etaRegion );
+		objects.phiRegion.push_back( phiRegion );
+		objects.isolated.push_back( isolated );
+	}
+
+} // end of the unnamed namespace
+
+void l1menu::implementation::TriggerObjects::CaloObjects::clear()
+{
+	et.clear();
+	etaRegion.clear();
+	phiRegion.clear();
+	isolated.clear();
+}
+
+void l1menu::implementation::TriggerObjects::Muons::clear()
+{
+	pt.clear();
+	eta.clear();
+	phi.clear();
+	quality.clear();
+	isolated.clear();
+}
+
+void l1menu::implementation::TriggerObjects::fill( const L1Analysis::L1AnalysisDataFormat& rawEvent )
+{
+	eg.clear();
+	isolatedEG.clear();
+	centralJets.clear();
+	forwardJets.clear();
+	tauJets.clear();
+	isolatedTauJets.clear();
+	muons.clear();
+
+	// Everything is sorted once per object type, then split up into the collections in
+	// that order so that they're all sorted.
+	sortInTimeObjects( rawEvent.Nele, rawEvent.Bxel, rawEvent.Etel, sortedIndices_ );
+	for( const auto index : sortedIndices_ )
+	{
+		const short etaRegion=toRegionNumber( rawEvent.Etael[index] );
+		const short phiRegion=toRegionNumber( rawEvent.Phiel[index] );
+		const bool isolated=rawEvent.Isoel[index];
+		addCaloObject( eg, rawEvent.Etel[index], etaRegion, phiRegion, isolated );
+		if( isolated ) addCaloObject( isolatedEG, rawEvent.Etel[index], etaRegion, phiRegion, isolated );
+	}
+
+	sortInTimeObjects( rawEvent.Njet, rawEvent.Bxjet, rawEvent.Etjet, sortedIndices_ );
+	for( const auto index : sortedIndices_ )
+	{
+		const short etaRegion=toRegionNumber( rawEvent.Etajet[index] );
+		const short phiRegion=toRegionNumber( rawEvent.Phijet[index] );
+		const bool isolated=rawEvent.isoTaujet[index];
+		if( rawEvent.Taujet[index] ) addCaloObject( tauJets, rawEvent.Etjet[index], etaRegion, phiRegion, isolated );
+		else if( rawEvent.Fwdjet[index] ) addCaloObject( forwardJets, rawEvent.Etjet[index], etaRegion, phiRegion, isolated );
+		else addCaloObject( centralJets, rawEvent.Etjet[index], etaRegion, phiRegion, isolated );
+		// The isolated tau triggers have never checked the Taujet flag, so keep these separately
+		if( isolated ) addCaloObject( isolatedTauJets, rawEvent.Etjet[index], etaRegion, phiRegion, isolated );
+	}
+
+	sortInTimeObjects( rawEvent.Nmu, rawEvent.Bxmu, rawEvent.Ptmu, sortedIndices_ );
+	for( const auto index : sortedIndices_ )
+	{
+		muons.pt.push_back( rawEvent.Ptmu[index] );
+		muons.eta.push_back( rawEvent.Etamu[index] );
+		muons.phi.push_back( rawEvent.Phimu[index] );
+		muons.quality.push_back( rawEvent.Qualmu[index] );
+		muons.isolated.push_back( rawEvent.Isomu[index] );
+	}
+}
@@ -0,0 +1,94 @@
+#ifndef l1menu_implementation_TriggerObjects_h
+#define l1menu_implementation_TriggerObjects_h
+
+#include <vector>
+#include <stddef.h> // required for size_t
+
+// Forward declarations
+namespace L1Analysis
+{
+	class L1AnalysisDataFormat;
+}
+
+
+namespace l1menu
+{
+	namespace implementation
+	{
+		/** @brief The in-time L1 objects of an event, split into the collections the triggers use and sorted by Et.
+		 *
+		 * Every trigger used to loop over all of the objects in L1AnalysisDataFormat and check the bunch crossing,
+		 * forward and tau flags itself. This is filled once per event instead (see L1TriggerDPGEvent::triggerObjects),
+		 * and only has objects with a bunch crossing of zero. Each collection is a set of arrays (one per quantity)
+		 * sorted with the highest Et first, so a trigger can stop looking as soon as an object is below its
+		 * threshold, and a single object trigger only has to look at the first object that passes its eta cut.
+		 * Objects with the same Et are kept in the same order as they were in L1AnalysisDataFormat.
+		 *
+		 * The calorimeter eta and phi are region numbers, so they're stored as small integers. Values that aren't
+		 * whole numbers are rounded to the nearest region. The muon eta and phi are kept as they are.
+		 */
+		class TriggerObjects
+		{
+		public:
+			/** @brief EG or jets, highest Et first. */
+			struct CaloObjects
+			{
+				std::vector<float> et;
+				std::vector<short> etaRegion;
+				std::vector<short> phiRegion;
+				std::vector<char> isolated; ///< @brief Isoel for EG and isoTaujet for jets
+
+				size_t size() const { return et.size(); }
+				void clear();
+			};
+
+			/** @brief Muons, highest pt first. */
+			struct Muons
+			{
+				std::vector<float> pt;
+				std::vector<float> eta;
+				std::vector<float> phi;
+				std::vector<short> quality;
+				std::vector<char> isolated;
+
+				size_t size() const { return pt.size(); }
+				void clear();
+			};
+
+		public:
+			/** @brief Replaces the contents with the in-time objects from the event. */
+			void fill( const L1Analysis::L1AnalysisDataFormat& rawEvent );
+
+			CaloObjects eg;
+			CaloObjects isolatedEG;
+			CaloObjects centralJets; ///< @brief Jets that are neither forward nor tau jets
+			CaloObjects forwardJets; ///< @brief Forward jets that aren't tau jets
+			CaloObjects tauJets; ///< @brief All tau jets, including forward ones
+			CaloObjects isolatedTauJets; ///< @brief All jets with the isoTaujet flag
+			Muons muons;
+		private:
+			std::vector<size_t> sortedIndices_; ///< @brief Kept between events to save reallocating it
+		}; // end of class TriggerObjects
+
+		/** @brief Whether the eta region passes a trigger's "regionCut" parameter, i.e. regionCut<=eta<=21-regionCut. */
+		inline bool passesRegionCut( short etaRegion, float regionCut )
+		{
+			return !( etaRegion<regionCut || etaRegion>21.-regionCut );
+		}
+
+		/** @brief The index of the first object from firstIndex onwards that passes the region cut, or objects.size() if there isn't one.
+		 *
+		 * Because the objects are sorted, with the default firstIndex this is the highest Et object in the region.
+		 */
+		inline size_t nextInRegion( const l1menu::implementation::TriggerObjects::CaloObjects& objects, float regionCut, size_t firstIndex=0 )
+		{
+			for( ; firstIndex<objects.size(); ++firstIndex )
+			{
+				if( passesRegionCut( objects.etaRegion[firstIndex], regionCut ) ) break;
+			}
+			return firstIndex;
+		}
+
+	} // end of the implementation namespace
+} // end of the l1menu namespace
+#endif
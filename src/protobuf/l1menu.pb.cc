@@ -43,11 +43,12 @@ void protobuf_AssignDesc_l1menu_2eproto() {
       "l1menu.proto");
   GOOGLE_CHECK(file != NULL);
   Trigger_descriptor_ = file->message_type(0);
-  static const int Trigger_offsets_[4] = {
+  static const int Trigger_offsets_[5] = {
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(Trigger, name_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(Trigger, version_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(Trigger, parameter_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(Trigger, varying_parameter_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(Trigger, exact_thresholds_),
   };
   Trigger_reflection_ =
     new ::google::protobuf::internal::GeneratedMessageReflection(
@@ -168,15 +169,16 @@ void protobuf_AddDesc_l1menu_2eproto() {
   GOOGLE_PROTOBUF_VERIFY_VERSION;
 
   ::google::protobuf::DescriptorPool::InternalAddGeneratedFile(
-    "\n\014l1menu.proto\022\016l1menuprotobuf\"\261\001\n\007Trigg"
+    "\n\014l1menu.proto\022\016l1menuprotobuf\"\322\001\n\007Trigg"
     "er\022\014\n\004name\030\001 \002(\t\022\017\n\007version\030\002 \002(\005\022;\n\tpar"
     "ameter\030\003 \003(\0132(.l1menuprotobuf.Trigger.Tr"
     "iggerParameter\022\031\n\021varying_parameter\030\004 \003("
-    "\t\032/\n\020TriggerParameter\022\014\n\004name\030\001 \002(\t\022\r\n\005v"
-    "alue\030\002 \002(\002\"*\n\005Event\022\021\n\tthreshold\030\001 \003(\002\022\016"
-    "\n\006weight\030\002 \001(\002\"+\n\003Run\022$\n\005event\030\001 \003(\0132\025.l"
-    "1menuprotobuf.Event\"8\n\014SampleHeader\022(\n\007t"
-    "rigger\030\001 \003(\0132\027.l1menuprotobuf.Trigger", 357);
+    "\t\022\037\n\020exact_thresholds\030\005 \001(\010:\005false\032/\n\020Tr"
+    "iggerParameter\022\014\n\004name\030\001 \002(\t\022\r\n\005value\030\002 "
+    "\002(\002\"*\n\005Event\022\021\n\tthreshold\030\001 \003(\002\022\016\n\006weigh"
+    "t\030\002 \001(\002\"+\n\003Run\022$\n\005event\030\001 \003(\0132\025.l1menupr"
+    "otobuf.Event\"8\n\014SampleHeader\022(\n\007trigger\030"
+    "\001 \003(\0132\027.l1menuprotobuf.Trigger", 390);
   ::google::protobuf::MessageFactory::InternalRegisterGeneratedFile(
     "l1menu.proto", &protobuf_RegisterTypes);
   Trigger::default_instance_ = new Trigger();
@@ -470,6 +472,7 @@ const int Trigger::kNameFieldNumber;
 const int Trigger::kVersionFieldNumber;
 const int Trigger::kParameterFieldNumber;
 const int Trigger::kVaryingParameterFieldNumber;
+const int Trigger::kExactThresholdsFieldNumber;
 #endif  // !_MSC_VER
 
 Trigger::Trigger()
@@ -490,6 +493,7 @@ void Trigger::SharedCtor() {
   _cached_size_ = 0;
   name_ = const_cast< ::std::string*>(&::google::protobuf::internal::kEmptyString);
   version_ = 0;
+  exact_thresholds_ = false;
   ::memset(_has_bits_, 0, sizeof(_has_bits_));
 }
 
@@ -533,6 +537,7 @@ void Trigger::Clear() {
       }
     }
     version_ = 0;
+    exact_thresholds_ = false;
   }
   parameter_.Clear();
   varying_parameter_.Clear();
@@ -607,6 +612,22 @@ bool Trigger::MergePartialFromCodedStream(
           goto handle_uninterpreted;
         }
         if (input->ExpectTag(34)) goto parse_varying_parameter;
+        if (input->ExpectTag(40)) goto parse_exact_thresholds;
+        break;
+      }
+      
+      // optional bool exact_thresholds = 5 [default = false];
+      case 5: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_exact_thresholds:
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &exact_thresholds_)));
+          set_has_exact_thresholds();
+        } else {
+          goto handle_uninterpreted;
+        }
         if (input->ExpectAtEnd()) return true;
         break;
       }
@@ -658,6 +679,11 @@ void Trigger::SerializeWithCachedSizes(
       4, this->varying_parameter(i), output);
   }
   
+  // optional bool exact_thresholds = 5 [default = false];
+  if (has_exact_thresholds()) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(5, this->exact_thresholds(), output);
+  }
+  
   if (!unknown_fields().empty()) {
     ::google::protobuf::internal::WireFormat::SerializeUnknownFields(
         unknown_fields(), output);
@@ -697,6 +723,11 @@ void Trigger::SerializeWithCachedSizes(
       WriteStringToArray(4, this->varying_parameter(i), target);
   }
   
+  // optional bool exact_thresholds = 5 [default = false];
+  if (has_exact_thresholds()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteBoolToArray(5, this->exact_thresholds(), target);
+  }
+  
   if (!unknown_fields().empty()) {
     target = ::google::protobuf::internal::WireFormat::SerializeUnknownFieldsToArray(
         unknown_fields(), target);
@@ -722,6 +753,11 @@ int Trigger::ByteSize() const {
           this->version());
     }
     
+    // optional bool exact_thresholds = 5 [default = false];
+    if (has_exact_thresholds()) {
+      total_size += 1 + 1;
+    }
+    
   }
   // repeated .l1menuprotobuf.Trigger.TriggerParameter parameter = 3;
   total_size += 1 * this->parameter_size();
@@ -772,6 +808,9 @@ void Trigger::MergeFrom(const Trigger& from) {
     if (from.has_version()) {
       set_version(from.version());
     }
+    if (from.has_exact_thresholds()) {
+      set_exact_thresholds(from.exact_thresholds());
+    }
   }
   mutable_unknown_fields()->MergeFrom(from.unknown_fields());
 }
@@ -803,6 +842,7 @@ void Trigger::Swap(Trigger* other) {
     std::swap(version_, other->version_);
     parameter_.Swap(&other->parameter_);
     varying_parameter_.Swap(&other->varying_parameter_);
+    std::swap(exact_thresholds_, other->exact_thresholds_);
     std::swap(_has_bits_[0], other->_has_bits_[0]);
     _unknown_fields_.Swap(&other->_unknown_fields_);
     std::swap(_cached_size_, other->_cached_size_);
@@ -238,12 +238,21 @@ class Trigger : public ::google::protobuf::Message {
   inline const ::google::protobuf::RepeatedPtrField< ::std::string>& varying_parameter() const;
   inline ::google::protobuf::RepeatedPtrField< ::std::string>* mutable_varying_parameter();
   
+  // optional bool exact_thresholds = 5 [default = false];
+  inline bool has_exact_thresholds() const;
+  inline void clear_exact_thresholds();
+  static const int kExactThresholdsFieldNumber = 5;
+  inline bool exact_thresholds() const;
+  inline void set_exact_thresholds(bool value);
+  
   // @@protoc_insertion_point(class_scope:l1menuprotobuf.Trigger)
  private:
   inline void set_has_name();
   inline void clear_has_name();
   inline void set_has_version();
   inline void clear_has_version();
+  inline void set_has_exact_thresholds();
+  inline void clear_has_exact_thresholds();
   
   ::google::protobuf::UnknownFieldSet _unknown_fields_;
   
@@ -251,9 +260,10 @@ class Trigger : public ::google::protobuf::Message {
   ::google::protobuf::RepeatedPtrField< ::l1menuprotobuf::Trigger_TriggerParameter > parameter_;
   ::google::protobuf::RepeatedPtrField< ::std::string> varying_parameter_;
   ::google::protobuf::int32 version_;
+  bool exact_thresholds_;
   
   mutable int _cached_size_;
-  ::google::protobuf::uint32 _has_bits_[(4 + 31) / 32];
+  ::google::protobuf::uint32 _has_bits_[(5 + 31) / 32];
   
   friend void  protobuf_AddDesc_l1menu_2eproto();
   friend void protobuf_AssignDesc_l1menu_2eproto();
@@ -767,6 +777,28 @@ Trigger::mutable_varying_parameter() {
   return &varying_parameter_;
 }
 
+// optional bool exact_thresholds = 5 [default = false];
+inline bool Trigger::has_exact_thresholds() const {
+  return (_has_bits_[0] & 0x00000010u) != 0;
+}
+inline void Trigger::set_has_exact_thresholds() {
+  _has_bits_[0] |= 0x00000010u;
+}
+inline void Trigger::clear_has_exact_thresholds() {
+  _has_bits_[0] &= ~0x00000010u;
+}
+inline void Trigger::clear_exact_thresholds() {
+  exact_thresholds_ = false;
+  clear_has_exact_thresholds();
+}
+inline bool Trigger::exact_thresholds() const {
+  return exact_thresholds_;
+}
+inline void Trigger::set_exact_thresholds(bool value) {
+  set_has_exact_thresholds();
+  exact_thresholds_ = value;
+}
+
 // -------------------------------------------------------------------
 
 // Event
@@ -0,0 +1,180 @@
+#include "l1menu/tools/Profiler.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+l1menu::tools::Profiler& l1menu::tools::Profiler::instance()
+{
+	static Profiler onlyInstance;
+	return onlyInstance;
+}
+
+l1menu::tools::Profiler::Profiler()
+	: enabled_(false), numberOfProcessedEvents_(0), getEntryNanoseconds_(0), fillDataStructureNanoseconds_(0)
+{
+	// No operation besides the initialiser list
+}
+
+void l1menu::tools::Profiler::enable()
+{
+	enabled_=true;
+	startTime_=Clock::now();
+}
+
+unsigned long long* l1menu::tools::Profiler::getEntryNanoseconds()
+{
+	if( enabled_ ) return &getEntryNanoseconds_;
+	else return nullptr;
+}
+
+unsigned long long* l1menu::tools::Profiler::fillDataStructureNanoseconds()
+{
+	if( enabled_ ) return &fillDataStructureNanoseconds_;
+	else return nullptr;
+}
+
+l1menu::tools::Profiler::TriggerStatistics* l1menu::tools::Profiler::triggerStatistics( const std::string& triggerName )
+{
+	if( !enabled_ ) return nullptr;
+
+	// std::map doesn't move its elements around, so this pointer stays valid when more are added
+	auto iFindResult=triggerStatistics_.find( triggerName );
+	if( iFindResult==triggerStatistics_.end() ) iFindResult=triggerStatistics_.insert( std::make_pair( triggerName, TriggerStatistics{0,0,0} ) ).first;
+	return &iFindResult->second;
+}
+
+void l1menu::tools::Profiler::addProcessedEvents( size_t numberOfEvents )
+{
+	if( enabled_ ) numberOfProcessedEvents_+=numberOfEvents;
+}
+
+void l1menu::tools::Profiler::addBisection( size_t numberOfIterations )
+{
+	if( !enabled_ ) return;
+	if( bisectionIterations_.size()<=numberOfIterations ) bisectionIterations_.resize( numberOfIterations+1, 0 );
+	++bisectionIterations_[numberOfIterations];
+}
+
+double l1menu::tools::Profiler::wallTime() const
+{
+	return std::chrono::duration<double>( Clock::now()-startTime_ ).count();
+}
+
+void l1menu::tools::Profiler::printSummary( std::ostream& output ) const
+{
+	const double seconds=wallTime();
+
+	output << "Profile summary:" << "\n"
+			<< "\t" << "Events processed:           " << numberOfProcessedEvents_ << "\n"
+			<< "\t" << "Wall time:                  " << seconds << "s" << "\n"
+			<< "\t" << "Events per second:          " << (seconds>0 ? numberOfProcessedEvents_/seconds : 0) << "\n"
+			<< "\t" << "Time in GetEntry:           " << getEntryNanoseconds_*1e-9 << "s" << "\n"
+			<< "\t" << "Time in fillDataStructure:  " << fillDataStructureNanoseconds_*1e-9 << "s" << "\n"
+			<< "\n";
+
+	output << "\t" << std::left << std::setw(30) << "Trigger" << std::right << std::setw(12) << "Events" << std::setw(16) << "apply() calls" << std::setw(12) << "Time (s)" << std::setw(16) << "ns per event" << "\n";
+	for( const auto& nameStatisticsPair : triggerStatistics_ )
+	{
+		const TriggerStatistics& statistics=nameStatisticsPair.second;
+		output << "\t" << std::left << std::setw(30) << nameStatisticsPair.first << std::right
+				<< std::setw(12) << statistics.numberOfEvents
+				<< std::setw(16) << statistics.numberOfApplyCalls
+				<< std::setw(12) << statistics.nanoseconds*1e-9
+				<< std::setw(16) << (statistics.numberOfEvents>0 ? statistics.nanoseconds/statistics.numberOfEvents : 0) << "\n";
+	}
+
+	output << "\n" << "\t" << "Bisection iterations:" << "\n";
+	for( size_t numberOfIterations=0; numberOfIterations<bisectionIterations_.size(); ++numberOfIterations )
+	{
+		if( bisectionIterations_[numberOfIterations]==0 ) continue;
+		output << "\t\t" << std::setw(4) << numberOfIterations << std::setw(14) << bisectionIterations_[numberOfIterations] << "\n";
+	}
+	output << std::flush;
+}
+
+void l1menu::tools::Profiler::writeJSON( std::ostream& output ) const
+{
+	const double seconds=wallTime();
+
+	output << "{\n"
+			<< "  \"eventsProcessed\": " << numberOfProcessedEvents_ << ",\n"
+			<< "  \"wallTimeSeconds\": " << seconds << ",\n"
+			<< "  \"eventsPerSecond\": " << (seconds>0 ? numberOfProcessedEvents_/seconds : 0) << ",\n"
+			<< "  \"getEntryNanoseconds\": " << getEntryNanoseconds_ << ",\n"
+			<< "  \"fillDataStructureNanoseconds\": " << fillDataStructureNanoseconds_ << ",\n"
+			<< "  \"triggers\": {";
+	bool first=true;
+	for( const auto& nameStatisticsPair : triggerStatistics_ )
+	{
+		const TriggerStatistics& statistics=nameStatisticsPair.second;
+		// Trigger names are only ever letters, numbers and underscores so don't need escaping
+		output << (first ? "\n" : ",\n") << "    \"" << nameStatisticsPair.first << "\": { \"events\": " << statistics.numberOfEvents
+				<< ", \"applyCalls\": " << statistics.numberOfApplyCalls << ", \"nanoseconds\": " << statistics.nanoseconds << " }";
+		first=false;
+	}
+	output << "\n  },\n"
+			<< "  \"bisectionIterations\": {";
+	first=true;
+	for( size_t numberOfIterations=0; numberOfIterations<bisectionIterations_.size(); ++numberOfIterations )
+	{
+		if( bisectionIterations_[numberOfIterations]==0 ) continue;
+		output << (first ? " " : ", ") << "\"" << numberOfIterations << "\": " << bisectionIterations_[numberOfIterations];
+		first=false;
+	}
+	output << " }\n"
+			<< "}" << std::endl;
+}
+
+void l1menu::tools::Profiler::saveCounters( std::ostream& output ) const
+{
+	// One counter per line, with a keyword first. Trigger names don't have spaces so can go last.
+	output << "events " << numberOfProcessedEvents_ << "\n"
+			<< "getEntry " << getEntryNanoseconds_ << "\n"
+			<< "fillDataStructure " << fillDataStructureNanoseconds_ << "\n";
+	for( const auto& nameStatisticsPair : triggerStatistics_ )
+	{
+		const TriggerStatistics& statistics=nameStatisticsPair.second;
+		output << "trigger " << statistics.numberOfEvents << " " << statistics.numberOfApplyCalls << " " << statistics.nanoseconds << " " << nameStatisticsPair.first << "\n";
+	}
+	for( size_t numberOfIterations=0; numberOfIterations<bisectionIterations_.size(); ++numberOfIterations )
+	{
+		if( bisectionIterations_[numberOfIterations]!=0 ) output << "bisection " << numberOfIterations << " " << bisectionIterations_[numberOfIterations] << "\n";
+	}
+	output << std::flush;
+}
+
+void l1menu::tools::Profiler::mergeCounters( std::istream& input )
+{
+	std::string line;
+	while( std::getline( input, line ) )
+	{
+		std::istringstream lineStream( line );
+		std::string keyword;
+		if( !(lineStream >> keyword) ) continue; // blank line
+
+		unsigned long long value;
+		if( keyword=="events" && lineStream >> value ) numberOfProcessedEvents_+=value;
+		else if( keyword=="getEntry" && lineStream >> value ) getEntryNanoseconds_+=value;
+		else if( keyword=="fillDataStructure" && lineStream >> value ) fillDataStructureNanoseconds_+=value;
+		else if( keyword=="trigger" )
+		{
+			TriggerStatistics statistics;
+			std::string triggerName;
+			if( !(lineStream >> statistics.numberOfEvents >> statistics.numberOfApplyCalls >> statistics.nanoseconds >> triggerName) ) throw std::runtime_error( "Profiler::mergeCounters - couldn't read the line \""+line+"\"" );
+			TriggerStatistics& total=triggerStatistics_.insert( std::make_pair( triggerName, TriggerStatistics{0,0,0} ) ).first->second;
+			total.numberOfEvents+=statistics.numberOfEvents;
+			total.numberOfApplyCalls+=statistics.numberOfApplyCalls;
+			total.nanoseconds+=statistics.nanoseconds;
+		}
+		else if( keyword=="bisection" )
+		{
+			size_t numberOfIterations;
+			if( !(lineStream >> numberOfIterations >> value) ) throw std::runtime_error( "Profiler::mergeCounters - couldn't read the line \""+line+"\"" );
+			if( bisectionIterations_.size()<=numberOfIterations ) bisectionIterations_.resize( numberOfIterations+1, 0 );
+			bisectionIterations_[numberOfIterations]+=value;
+		}
+		else throw std::runtime_error( "Profiler::mergeCounters - couldn't read the line \""+line+"\"" );
+	}
+}
@@ -0,0 +1,178 @@
+#include "l1menu/tools/ThresholdExtractor.h"
+
+#include <stdexcept>
+#include "l1menu/ITrigger.h"
+#include "l1menu/L1TriggerDPGEvent.h"
+#include "l1menu/TriggerTable.h"
+#include "l1menu/tools/miscellaneous.h"
+
+l1menu::tools::ThresholdExtractor::ThresholdExtractor( const l1menu::ITrigger& trigger, float tolerance, Method method )
+	: pTrigger_( l1menu::TriggerTable::instance().copyTrigger(trigger) ),
+	  tolerance_(tolerance),
+	  method_(method),
+	  thresholdNames_( l1menu::tools::getThresholdNames(trigger) ),
+	  pStatistics_( l1menu::tools::Profiler::instance().triggerStatistics( trigger.name() ) )
+{
+	for( const auto& thresholdName : thresholdNames_ ) thresholds_.push_back( &pTrigger_->parameter(thresholdName) );
+
+	//
+	// If the thresholds are correlated, they can't be modified individually to see if an event
+	// will pass and have to be scaled together. This is done in the same way as in
+	// setTriggerThresholdsAsTightAsPossible, i.e. the first threshold is varied and all of the
+	// others are scaled against it.
+	//
+	numberOfVariedThresholds_=thresholds_.size();
+	if( pTrigger_->thresholdsAreCorrelated() && !thresholds_.empty() )
+	{
+		const float parameterValue=*thresholds_[0];
+		for( size_t index=1; index<thresholds_.size(); ++index )
+		{
+			otherParameterScalings_.push_back( std::make_pair( thresholds_[index], *thresholds_[index]/parameterValue ) );
+		}
+		numberOfVariedThresholds_=1;
+	}
+
+	for( size_t index=0; index<numberOfVariedThresholds_; ++index )
+	{
+		float lowThreshold=0;
+		float highThreshold=500;
+		// See if an indication of the range of the trigger has been set
+		try // These calls will throw an exception if no suggestion has been set
+		{
+			lowThreshold=l1menu::TriggerTable::instance().getSuggestedLowerEdge( pTrigger_->name(), thresholdNames_[index] );
+			highThreshold=l1menu::TriggerTable::instance().getSuggestedUpperEdge( pTrigger_->name(), thresholdNames_[index] );
+		}
+		catch( std::exception& error ) { /* No indication set. Do nothing and just use the defaults I set previously. */ }
+		highThreshold*=5; // Make sure the high threshold is very high, to catch all tails
+
+		searchRanges_.push_back( std::make_pair( lowThreshold, highThreshold ) );
+	}
+}
+
+l1menu::tools::ThresholdExtractor::ThresholdExtractor( ThresholdExtractor&& otherExtractor ) noexcept
+	: pTrigger_( std::move(otherExtractor.pTrigger_) ),
+	  tolerance_( otherExtractor.tolerance_ ),
+	  method_( otherExtractor.method_ ),
+	  thresholdNames_( std::move(otherExtractor.thresholdNames_) ),
+	  thresholds_( std::move(otherExtractor.thresholds_) ),
+	  numberOfVariedThresholds_( otherExtractor.numberOfVariedThresholds_ ),
+	  otherParameterScalings_( std::move(otherExtractor.otherParameterScalings_) ),
+	  searchRanges_( std::move(otherExtractor.searchRanges_) ),
+	  candidates_( std::move(otherExtractor.candidates_) ),
+	  pStatistics_( otherExtractor.pStatistics_ )
+{
+	// No operation besides the initialiser list
+}
+
+l1menu::tools::ThresholdExtractor::~ThresholdExtractor()
+{
+	// No operation. Just need this defined here where ITrigger is a complete type.
+}
+
+const std::vector<std::string>& l1menu::tools::ThresholdExtractor::thresholdNames() const
+{
+	return thresholdNames_;
+}
+
+size_t l1menu::tools::ThresholdExtractor::numberOfThresholds() const
+{
+	return thresholds_.size();
+}
+
+float l1menu::tools::ThresholdExtractor::searchLimit( size_t thresholdNumber ) const
+{
+	if( thresholdNumber<numberOfVariedThresholds_ ) return searchRanges_[thresholdNumber].second;
+	else return otherParameterScalings_.at(thresholdNumber-numberOfVariedThresholds_).second*searchRanges_.at(0).second;
+}
+
+float l1menu::tools::ThresholdExtractor::bisectionTolerance( size_t thresholdNumber ) const
+{
+	if( thresholdNumber<numberOfVariedThresholds_ ) return tolerance_;
+	else return otherParameterScalings_.at(thresholdNumber-numberOfVariedThresholds_).second*tolerance_;
+}
+
+l1menu::tools::ThresholdExtractor::Status l1menu::tools::ThresholdExtractor::extract( const l1menu::L1TriggerDPGEvent& event, float* pThresholds )
+{
+	l1menu::ITrigger& trigger=*pTrigger_;
+
+	// These only record anything if profiling was enabled when this instance was created
+	l1menu::tools::Profiler::ScopedTimer timer( pStatistics_ ? &pStatistics_->nanoseconds : nullptr );
+	unsigned long long* pNumberOfApplyCalls=( pStatistics_ ? &pStatistics_->numberOfApplyCalls : nullptr );
+	if( pStatistics_ ) ++pStatistics_->numberOfEvents;
+
+	// Most triggers can work the thresholds out directly, which is a lot quicker than the bisection.
+	// The copy of the trigger is never changed if they can, so any scalings use the original ratios.
+	if( method_==Method::EXACT && trigger.calculateTightestThresholds( event, pThresholds ) )
+	{
+		if( !thresholds_.empty() && pThresholds[0]==-1 ) return Status::NO_THRESHOLDS_FOUND;
+		else return Status::OK;
+	}
+
+	// First set all of the thresholds to zero. Any that are scaled get set before every test.
+	for( size_t index=0; index<numberOfVariedThresholds_; ++index ) *thresholds_[index]=0;
+
+	// The turn on is almost always at the Et of one of the objects in the event, so try those first.
+	// With no candidates every threshold is bisected.
+	if( method_==Method::EXACT ) l1menu::tools::getCandidateThresholds( event, otherParameterScalings_, candidates_ );
+	else candidates_.clear();
+
+	// Now run through each threshold at a time and figure out how low it can be and still
+	// pass the event. The result is put straight into pThresholds.
+	for( size_t index=0; index<numberOfVariedThresholds_; ++index )
+	{
+		float& threshold=*thresholds_[index];
+		float lowThreshold=searchRanges_[index].first;
+		float highThreshold=searchRanges_[index].second;
+
+		if( l1menu::tools::findTightestThresholdFromCandidates( event, trigger, threshold, otherParameterScalings_, candidates_, lowThreshold, pThresholds[index], pNumberOfApplyCalls ) )
+		{
+			threshold=0;
+			continue;
+		}
+
+		// Otherwise fall back to bisection over the search range
+
+		threshold=lowThreshold;
+		// Scale any other parameters required. There will only be something in this vector if the trigger thresholds are correlated.
+		for( const auto& parameterScalingPair : otherParameterScalings_ ) *(parameterScalingPair.first)=parameterScalingPair.second*threshold;
+		bool lowTest=trigger.apply( event );
+
+		threshold=highThreshold;
+		for( const auto& parameterScalingPair : otherParameterScalings_ ) *(parameterScalingPair.first)=parameterScalingPair.second*threshold;
+		bool highTest=trigger.apply( event );
+		if( pNumberOfApplyCalls ) *pNumberOfApplyCalls+=2;
+
+		if( lowTest==highTest )
+		{
+			for( size_t outputIndex=0; outputIndex<thresholds_.size(); ++outputIndex ) pThresholds[outputIndex]=-1;
+			return Status::NO_THRESHOLDS_FOUND;
+		}
+
+		// Find the turn on point by bisection. Since lowTest and highTest differ the middle
+		// test always agrees with exactly one of them.
+		size_t numberOfIterations=0;
+		while( highThreshold-lowThreshold > tolerance_ )
+		{
+			threshold=(highThreshold+lowThreshold)/2;
+			for( const auto& parameterScalingPair : otherParameterScalings_ ) *(parameterScalingPair.first)=parameterScalingPair.second*threshold;
+			if( trigger.apply(event)==lowTest ) lowThreshold=threshold;
+			else highThreshold=threshold;
+			++numberOfIterations;
+		}
+		if( pNumberOfApplyCalls )
+		{
+			*pNumberOfApplyCalls+=numberOfIterations;
+			l1menu::tools::Profiler::instance().addBisection( numberOfIterations );
+		}
+
+		pThresholds[index]=highThreshold;
+		// Then set back to zero ready to test the other thresholds
+		threshold=0;
+	}
+
+	// Fill in the scaled thresholds, if there are any
+	for( const auto& parameterScalingPair : otherParameterScalings_ ) *(parameterScalingPair.first)=parameterScalingPair.second*pThresholds[0];
+	for( size_t index=numberOfVariedThresholds_; index<thresholds_.size(); ++index ) pThresholds[index]=*thresholds_[index];
+
+	return Status::OK;
+}
@@ -16,6 +16,8 @@
 #include "l1menu/ITriggerRate.h"
 #include "l1menu/FullSample.h"
 #include "l1menu/ReducedSample.h"
+#include "l1menu/ObjectCacheSample.h"
+#include "l1menu/StreamingReducedSample.h"
 #include "l1menu/tools/XMLFile.h"
 #include "l1menu/tools/miscellaneous.h"
 #include "l1menu/tools/XMLElement.h"
@@ -177,6 +179,56 @@ namespace // Unnamed namespace for things only used in this file
 				<< " Total L1 Rate (pure triggers)    = " << delimeter << std::setw(8) << totalPure << delimeter << " kHz" << std::endl;
 
 	} // end of function dumpTriggerRatesInOldFormat
+
+	/** @brief The implementation of both versions of l1menu::tools::loadSample, with a null pointer for no projection. */
+	std::unique_ptr<l1menu::ISample> loadSampleWithProjection( const std::string& filename, const l1menu::TriggerMenu* pProjection, bool streamIfPossible )
+	{
+		// Open the file, read enough of the start to determine what kind of file
+		// it is, then close it.
+		std::ifstream inputFile( filename, std::ios_base::binary );
+		if( !inputFile.is_open() ) throw std::runtime_error( "The file does not exist or could not be opened" );
+
+		// Look at the first few characters and see if they match some of the file formats
+		const size_t bufferSize=20;
+		char buffer[bufferSize];
+		inputFile.get( buffer, bufferSize );
+		// For ReducedSamples the next byte is the file format version
+		const int fileFormatVersion=inputFile.get();
+		inputFile.close();
+
+		if( std::string(buffer)=="l1menuReducedSample" )
+		{
+			if( streamIfPossible && (fileFormatVersion==1 || fileFormatVersion==3) ) return std::unique_ptr<l1menu::ISample>( new l1menu::StreamingReducedSample(filename) );
+			else if( pProjection!=nullptr ) return std::unique_ptr<l1menu::ISample>( new l1menu::ReducedSample(filename,*pProjection) );
+			else return std::unique_ptr<l1menu::ISample>( new l1menu::ReducedSample(filename) );
+		}
+		else if( std::string(buffer)=="l1menuL1ObjectCache" )
+		{
+			// The triggers are calculated on the fly like for a FullSample, so the projection is ignored
+			return std::unique_ptr<l1menu::ISample>( new l1menu::ObjectCacheSample(filename) );
+		}
+		else
+		{
+			// If it's not a ReducedSample or an ObjectCacheSample then the only other ISample
+			// implementation at the moment is a FullSample.
+			std::unique_ptr<l1menu::FullSample> pReturnValue( new l1menu::FullSample );
+
+			if( std::string(buffer).substr(0,4)=="root" )
+			{
+				// File is a root file, so assume it is one of the L1 DPG ntuples and try and load it
+				// into the FullSample.
+				pReturnValue->loadFile( filename );
+				return std::unique_ptr<l1menu::ISample>( pReturnValue.release() );
+			}
+			else
+			{
+				// Assume the file is a list of filenames of L1 DPG ntuples.
+				// TODO Do some checking to see if the characters I've read so far are valid filepath characters.
+				pReturnValue->loadFilesFromList( filename );
+				return std::unique_ptr<l1menu::ISample>( pReturnValue.release() );
+			}
+		}
+	}
 }
 
 
@@ -308,41 +360,14 @@ void l1menu::tools::dumpTriggerMenu( std::ostream& output, const l1menu::Trigger
 	}
 }
 
-std::unique_ptr<l1menu::ISample> l1menu::tools::loadSample( const std::string& filename )
+std::unique_ptr<l1menu::ISample> l1menu::tools::loadSample( const std::string& filename, bool streamIfPossible )
 {
-	// Open the file, read enough of the start to determine what kind of file
-	// it is, then close it.
-	std::ifstream inputFile( filename, std::ios_base::binary );
-	if( !inputFile.is_open() ) throw std::runtime_error( "The file does not exist or could not be opened" );
-
-	// Look at the first few characters and see if they match some of the file formats
-	const size_t bufferSize=20;
-	char buffer[bufferSize];
-	inputFile.get( buffer, bufferSize );
-	inputFile.close();
-
-	if( std::string(buffer)=="l1menuReducedSample" ) return std::unique_ptr<l1menu::ISample>( new l1menu::ReducedSample(filename) );
-	else
-	{
-		// If it's not a ReducedSample then the only other ISample implementation at the
-		// moment is a FullSample.
-		std::unique_ptr<l1menu::FullSample> pReturnValue( new l1menu::FullSample );
+	return loadSampleWithProjection( filename, nullptr, streamIfPossible );
+}
 
-		if( std::string(buffer).substr(0,4)=="root" )
-		{
-			// File is a root file, so assume it is one of the L1 DPG ntuples and try and load it
-			// into the FullSample.
-			pReturnValue->loadFile( filename );
-			return std::unique_ptr<l1menu::ISample>( pReturnValue.release() );
-		}
-		else
-		{
-			// Assume the file is a list of filenames of L1 DPG ntuples.
-			// TODO Do some checking to see if the characters I've read so far are valid filepath characters.
-			pReturnValue->loadFilesFromList( filename );
-			return std::unique_ptr<l1menu::ISample>( pReturnValue.release() );
-		}
-	}
+std::unique_ptr<l1menu::ISample> l1menu::tools::loadSample( const std::string& filename, const l1menu::TriggerMenu& projection, bool streamIfPossible )
+{
+	return loadSampleWithProjection( filename, &projection, streamIfPossible );
 }
 
 std::unique_ptr<l1menu::TriggerMenu> l1menu::tools::loadMenu( const std::string& filename )
@@ -8,6 +8,8 @@
 #include <ostream>
 #include <fstream>
 #include <iomanip>
+#include <cmath>
+#include <limits>
 #include "l1menu/ITrigger.h"
 #include "l1menu/L1TriggerDPGEvent.h"
 #include "l1menu/TriggerTable.h"
@@ -16,6 +18,7 @@
 #include "l1menu/ITriggerRate.h"
 #include "l1menu/FullSample.h"
 #include "l1menu/ReducedSample.h"
+#include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
 
 
 std::vector<std::string> l1menu::tools::getThresholdNames( const l1menu::ITriggerDescription& trigger )
@@ -178,6 +181,64 @@ void l1menu::tools::setTriggerThresholdsAsTightAsPossible( const l1menu::L1Trigg
 	}
 }
 
+void l1menu::tools::getCandidateThresholds( const l1menu::L1TriggerDPGEvent& event, const std::vector< std::pair<float*,float> >& otherParameterScalings, std::vector<float>& candidates )
+{
+	const L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
+
+	candidates.clear();
+	candidates.insert( candidates.end(), analysisDataFormat.Etel.begin(), analysisDataFormat.Etel.end() );
+	candidates.insert( candidates.end(), analysisDataFormat.Etjet.begin(), analysisDataFormat.Etjet.end() );
+	candidates.insert( candidates.end(), analysisDataFormat.Ptmu.begin(), analysisDataFormat.Ptmu.end() );
+	candidates.push_back( analysisDataFormat.ETT );
+	candidates.push_back( analysisDataFormat.ETM );
+	candidates.push_back( analysisDataFormat.HTT );
+	candidates.push_back( analysisDataFormat.HTM );
+
+	// A scaled threshold turns on when the threshold being searched for is the value divided by the scaling
+	const size_t numberOfValues=candidates.size();
+	for( const auto& parameterScalingPair : otherParameterScalings )
+	{
+		if( parameterScalingPair.second<=0 ) continue;
+		for( size_t index=0; index<numberOfValues; ++index ) candidates.push_back( candidates[index]/parameterScalingPair.second );
+	}
+
+	std::sort( candidates.begin(), candidates.end() );
+	candidates.erase( std::unique( candidates.begin(), candidates.end() ), candidates.end() );
+}
+
+bool l1menu::tools::findTightestThresholdFromCandidates( const l1menu::L1TriggerDPGEvent& event, const l1menu::ITrigger& trigger, float& threshold,
+		const std::vector< std::pair<float*,float> >& otherParameterScalings, const std::vector<float>& candidates, float lowerLimit, float& result, unsigned long long* pNumberOfApplyCalls )
+{
+	auto passes=[&]( float value )->bool
+	{
+		if( pNumberOfApplyCalls ) ++(*pNumberOfApplyCalls);
+		threshold=value;
+		for( const auto& parameterScalingPair : otherParameterScalings ) *(parameterScalingPair.first)=parameterScalingPair.second*value;
+		return trigger.apply( event );
+	};
+
+	// Find the first candidate that fails. Everything before "low" is known to pass, and
+	// everything from "high" onwards is known to fail.
+	const size_t firstCandidate=std::lower_bound( candidates.begin(), candidates.end(), lowerLimit )-candidates.begin();
+	size_t low=firstCandidate;
+	size_t high=candidates.size();
+	while( low<high )
+	{
+		size_t middle=low+(high-low)/2;
+		if( passes(candidates[middle]) ) low=middle+1;
+		else high=middle;
+	}
+	if( low==firstCandidate ) return false; // None of the candidates pass
+
+	// Make sure the trigger really does turn on at this value, i.e. it fails for anything higher.
+	// If it doesn't the turn on isn't at one of the candidates.
+	const float tightestThreshold=candidates[low-1];
+	if( passes( std::nextafter( tightestThreshold, std::numeric_limits<float>::max() ) ) ) return false;
+
+	result=tightestThreshold;
+	return true;
+}
+
 std::pair<float,float> l1menu::tools::calorimeterRegionEtaBounds( size_t calorimeterRegion )
 {
 	if( calorimeterRegion==0 ) return std::make_pair( -5.0, -4.5 );
@@ -0,0 +1,131 @@
+#include "l1menu/tools/shardManifest.h"
+
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include "l1menu/ReducedSample.h"
+#include "l1menu/TriggerMenu.h"
+
+void l1menu::tools::saveShardManifestEntry( const l1menu::tools::ShardManifestEntry& entry, std::ostream& output )
+{
+	output << "# Manifest entry for one shard of a ReducedSample" << "\n"
+			<< "sample " << entry.sampleFilename << "\n"
+			<< "totalEvents " << entry.totalNumberOfEvents << "\n"
+			<< "firstEvent " << entry.firstEventNumber << "\n"
+			<< "lastEvent " << entry.lastEventNumber << "\n"
+			<< "events " << entry.numberOfEvents << "\n"
+			<< "sumOfWeights " << std::setprecision( std::numeric_limits<double>::digits10+2 ) << entry.sumOfWeights << "\n";
+	for( const auto& inputFilename : entry.inputFilenames ) output << "input " << inputFilename << "\n";
+	output << std::flush;
+}
+
+l1menu::tools::ShardManifestEntry l1menu::tools::loadShardManifestEntry( const std::string& filename )
+{
+	std::ifstream inputFile( filename );
+	if( !inputFile.is_open() ) throw std::runtime_error( "Couldn't open the shard manifest entry "+filename );
+
+	l1menu::tools::ShardManifestEntry entry;
+	bool hasSample=false, hasTotal=false, hasFirst=false, hasLast=false, hasEvents=false, hasWeights=false;
+
+	std::string line;
+	while( std::getline( inputFile, line ) )
+	{
+		if( line.empty() || line[0]=='#' ) continue;
+
+		// The value is everything after the first space, so filenames can have spaces in
+		const size_t spacePosition=line.find(' ');
+		if( spacePosition==std::string::npos ) throw std::runtime_error( "The line \""+line+"\" in the shard manifest entry "+filename+" has no value" );
+		const std::string key=line.substr( 0, spacePosition );
+		const std::string value=line.substr( spacePosition+1 );
+		std::istringstream valueStream( value );
+
+		bool valueOK=true;
+		if( key=="sample" ) { entry.sampleFilename=value; hasSample=true; }
+		else if( key=="input" ) entry.inputFilenames.push_back( value );
+		else if( key=="totalEvents" ) { valueOK=static_cast<bool>( valueStream >> entry.totalNumberOfEvents ); hasTotal=true; }
+		else if( key=="firstEvent" ) { valueOK=static_cast<bool>( valueStream >> entry.firstEventNumber ); hasFirst=true; }
+		else if( key=="lastEvent" ) { valueOK=static_cast<bool>( valueStream >> entry.lastEventNumber ); hasLast=true; }
+		else if( key=="events" ) { valueOK=static_cast<bool>( valueStream >> entry.numberOfEvents ); hasEvents=true; }
+		else if( key=="sumOfWeights" ) { valueOK=static_cast<bool>( valueStream >> entry.sumOfWeights ); hasWeights=true; }
+		else throw std::runtime_error( "Unknown key \""+key+"\" in the shard manifest entry "+filename );
+
+		if( !valueOK ) throw std::runtime_error( "Couldn't read the value in the line \""+line+"\" in the shard manifest entry "+filename );
+	}
+
+	if( !(hasSample && hasTotal && hasFirst && hasLast && hasEvents && hasWeights) || entry.inputFilenames.empty() )
+	{
+		throw std::runtime_error( "The shard manifest entry "+filename+" is incomplete" );
+	}
+
+	// The sample is saved next to the manifest entry, so make the path relative to where the entry is
+	const size_t slashPosition=filename.rfind('/');
+	if( slashPosition!=std::string::npos && !entry.sampleFilename.empty() && entry.sampleFilename[0]!='/' )
+	{
+		entry.sampleFilename=filename.substr( 0, slashPosition+1 )+entry.sampleFilename;
+	}
+
+	return entry;
+}
+
+void l1menu::tools::checkShardManifest( std::vector<l1menu::tools::ShardManifestEntry>& entries )
+{
+	if( entries.empty() ) throw std::runtime_error( "The shard manifest has no entries" );
+
+	std::stable_sort( entries.begin(), entries.end(), []( const ShardManifestEntry& first, const ShardManifestEntry& second ){ return first.firstEventNumber<second.firstEventNumber; } );
+
+	size_t nextEventNumber=0;
+	for( const auto& entry : entries )
+	{
+		if( entry.inputFilenames!=entries.front().inputFilenames || entry.totalNumberOfEvents!=entries.front().totalNumberOfEvents )
+		{
+			throw std::runtime_error( "The shards "+entry.sampleFilename+" and "+entries.front().sampleFilename+" were made from different input files" );
+		}
+		if( entry.lastEventNumber<entry.firstEventNumber || entry.lastEventNumber>entry.totalNumberOfEvents || entry.numberOfEvents!=entry.lastEventNumber-entry.firstEventNumber )
+		{
+			throw std::runtime_error( "The event range of the shard "+entry.sampleFilename+" doesn't make sense" );
+		}
+
+		// Shards with no events can't overlap or leave gaps, so don't need checking
+		if( entry.numberOfEvents==0 ) continue;
+
+		if( entry.firstEventNumber<nextEventNumber )
+		{
+			throw std::runtime_error( "Events "+std::to_string(entry.firstEventNumber)+" to "+std::to_string(std::min(nextEventNumber,entry.lastEventNumber)-1)
+					+" are in more than one shard, including "+entry.sampleFilename );
+		}
+		else if( entry.firstEventNumber>nextEventNumber )
+		{
+			throw std::runtime_error( "Events "+std::to_string(nextEventNumber)+" to "+std::to_string(entry.firstEventNumber-1)+" are not in any of the shards" );
+		}
+		nextEventNumber=entry.lastEventNumber;
+	}
+
+	if( nextEventNumber!=entries.front().totalNumberOfEvents )
+	{
+		throw std::runtime_error( "Events "+std::to_string(nextEventNumber)+" to "+std::to_string(entries.front().totalNumberOfEvents-1)+" are not in any of the shards" );
+	}
+}
+
+void l1menu::tools::checkShardSample( const l1menu::tools::ShardManifestEntry& entry )
+{
+	// Projecting onto an empty menu means only the weights get loaded
+	const l1menu::TriggerMenu noTriggers;
+	const l1menu::ReducedSample sample( entry.sampleFilename, noTriggers );
+
+	if( sample.numberOfEvents()!=entry.numberOfEvents )
+	{
+		throw std::runtime_error( "The shard "+entry.sampleFilename+" has "+std::to_string(sample.numberOfEvents())+" events but its manifest entry says "+std::to_string(entry.numberOfEvents) );
+	}
+
+	// The sum of weights is recalculated when the sample is loaded, so allow for rounding differences
+	if( std::fabs( sample.sumOfWeights()-entry.sumOfWeights ) > 1e-4*std::fabs(entry.sumOfWeights)+1e-6 )
+	{
+		std::stringstream message;
+		message << "The sum of weights in the shard " << entry.sampleFilename << " is " << sample.sumOfWeights() << " but its manifest entry says " << entry.sumOfWeights;
+		throw std::runtime_error( message.str() );
+	}
+}
@@ -0,0 +1,53 @@
+#include "l1menu/tools/threading.h"
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <exception>
+
+size_t l1menu::tools::defaultNumberOfThreads()
+{
+	size_t numberOfCores=std::thread::hardware_concurrency();
+	if( numberOfCores==0 ) return 1;
+	else return numberOfCores;
+}
+
+void l1menu::tools::parallelFor( size_t numberOfItems, size_t numberOfThreads, const std::function<void(size_t)>& function )
+{
+	if( numberOfThreads==0 ) numberOfThreads=defaultNumberOfThreads();
+	if( numberOfThreads>numberOfItems ) numberOfThreads=numberOfItems;
+
+	// No point in the overhead of starting threads if there's only going to be one
+	if( numberOfThreads<=1 )
+	{
+		for( size_t index=0; index<numberOfItems; ++index ) function(index);
+		return;
+	}
+
+	std::atomic<size_t> nextItem(0);
+	std::atomic<bool> failed(false);
+	std::exception_ptr pFirstException;
+	std::mutex exceptionMutex;
+
+	auto worker=[&]()
+	{
+		try
+		{
+			for( size_t index=nextItem++; index<numberOfItems && !failed; index=nextItem++ ) function(index);
+		}
+		catch( ... )
+		{
+			std::lock_guard<std::mutex> lock( exceptionMutex );
+			if( !failed ) pFirstException=std::current_exception();
+			failed=true;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for( size_t threadNumber=1; threadNumber<numberOfThreads; ++threadNumber ) threads.push_back( std::thread( worker ) );
+	worker(); // The calling thread might as well do some of the work too
+	for( auto& thread : threads ) thread.join();
+
+	if( pFirstException ) std::rethrow_exception( pFirstException );
+}
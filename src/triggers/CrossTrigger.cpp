@@ -1,17 +1,20 @@
 #include "CrossTrigger.h"
 
 #include <stdexcept>
+#include "l1menu/tools/miscellaneous.h"
 
 l1menu::triggers::CrossTrigger::CrossTrigger( std::unique_ptr<l1menu::ITrigger> pLeg1, std::unique_ptr<l1menu::ITrigger> pLeg2 )
 : pLeg1_( std::move(pLeg1) ), pLeg2_( std::move(pLeg2) )
 {
-	// No operation besides the initialiser list
+	numberOfLeg1Thresholds_=l1menu::tools::getThresholdNames( *pLeg1_ ).size();
+	numberOfLeg2Thresholds_=l1menu::tools::getThresholdNames( *pLeg2_ ).size();
 }
 
 l1menu::triggers::CrossTrigger::CrossTrigger( l1menu::ITrigger* pLeg1, l1menu::ITrigger* pLeg2 )
 : pLeg1_( pLeg1 ), pLeg2_( pLeg2 )
 {
-	// No operation besides the initialiser list
+	numberOfLeg1Thresholds_=l1menu::tools::getThresholdNames( *pLeg1_ ).size();
+	numberOfLeg2Thresholds_=l1menu::tools::getThresholdNames( *pLeg2_ ).size();
 }
 
 l1menu::triggers::CrossTrigger::~CrossTrigger()
@@ -62,3 +65,29 @@ bool l1menu::triggers::CrossTrigger::thresholdsAreCorrelated() const
 	// If any thresholds in either of the legs are correlated then the say the whole trigger is
 	return pLeg1_->thresholdsAreCorrelated() || pLeg2_->thresholdsAreCorrelated();
 }
+
+bool l1menu::triggers::CrossTrigger::applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const
+{
+	return pLeg1_->applyUsingDerivedQuantities(event) && pLeg2_->applyUsingDerivedQuantities(event);
+}
+
+bool l1menu::triggers::CrossTrigger::calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const
+{
+	// If either leg is correlated, all of the thresholds in the trigger would need to be scaled
+	// together. That's not something the legs can do on their own.
+	if( thresholdsAreCorrelated() ) return false;
+
+	// Both legs have to pass, so the thresholds of each leg are the same as for that leg on its own
+	// provided the other leg can pass with zero thresholds.
+	float* pLeg2Thresholds=pThresholds+numberOfLeg1Thresholds_;
+	if( !pLeg1_->calculateTightestThresholds( event, pThresholds ) ) return false;
+	if( !pLeg2_->calculateTightestThresholds( event, pLeg2Thresholds ) ) return false;
+
+	bool leg1CanPass=( numberOfLeg1Thresholds_==0 || pThresholds[0]!=-1 );
+	bool leg2CanPass=( numberOfLeg2Thresholds_==0 || pLeg2Thresholds[0]!=-1 );
+	if( !leg1CanPass || !leg2CanPass )
+	{
+		for( size_t index=0; index<numberOfLeg1Thresholds_+numberOfLeg2Thresholds_; ++index ) pThresholds[index]=-1;
+	}
+	return true;
+}
@@ -30,10 +30,14 @@ namespace l1menu
 			virtual float& parameter( const std::string& parameterName );
 			virtual const float& parameter( const std::string& parameterName ) const;
 			virtual bool apply( const l1menu::L1TriggerDPGEvent& event ) const;
+			virtual bool calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const;
+			virtual bool applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const;
 			virtual bool thresholdsAreCorrelated() const;
 		protected:
 			std::unique_ptr<l1menu::ITrigger> pLeg1_;
 			std::unique_ptr<l1menu::ITrigger> pLeg2_;
+			size_t numberOfLeg1Thresholds_; ///< @brief Worked out once, so that calculateTightestThresholds knows where leg 2 starts
+			size_t numberOfLeg2Thresholds_;
 		};
 
 	} // end of namespace triggers
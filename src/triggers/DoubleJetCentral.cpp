@@ -1,8 +1,10 @@
 #include "../implementation/RegisterTriggerMacro.h"
+#include "../implementation/HighestValues.h"
 #include "l1menu/L1TriggerDPGEvent.h"
 
 #include <stdexcept>
-#include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
+#include "../implementation/TriggerObjects.h"
+#include "../implementation/DerivedQuantities.h"
 
 #include "l1menu/ITrigger.h"
 
@@ -47,6 +49,8 @@ namespace l1menu
 		public:
 			virtual unsigned int version() const;
 			virtual bool apply( const l1menu::L1TriggerDPGEvent& event ) const;
+			virtual bool calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const;
+			virtual bool applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const;
 			virtual bool thresholdsAreCorrelated() const;
 		}; // end of version 0 class
 
@@ -85,35 +89,57 @@ namespace l1menu
 
 bool l1menu::triggers::DoubleJetCentral_v0::apply( const l1menu::L1TriggerDPGEvent& event ) const
 {
-	const L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
 	const bool* PhysicsBits=event.physicsBits();
 
 	bool raw=PhysicsBits[0]; // ZeroBias
 	if( !raw ) return false;
 
-	int n1=0;
-	int n2=0;
-	int Nj=analysisDataFormat.Njet;
-	for( int ue=0; ue<Nj; ue++ )
+	// The jets are sorted by Et, so this needs the highest jet in the eta range to pass threshold1
+	// and the second highest to pass threshold2.
+	const l1menu::implementation::TriggerObjects::CaloObjects& jets=event.triggerObjects().centralJets;
+	const size_t firstIndex=l1menu::implementation::nextInRegion( jets, regionCut_ );
+	if( firstIndex>=jets.size() || !(jets.et[firstIndex]>=threshold1_) ) return false;
+	const size_t secondIndex=l1menu::implementation::nextInRegion( jets, regionCut_, firstIndex+1 );
+
+	return secondIndex<jets.size() && jets.et[secondIndex]>=threshold2_;
+}
+
+bool l1menu::triggers::DoubleJetCentral_v0::applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const
+{
+	if( !event.physicsBits()[0] ) return false; // ZeroBias
+
+	const l1menu::implementation::DerivedQuantities::PassingObjects& jets=event.derivedQuantities().passing( l1menu::implementation::DerivedQuantities::CaloCollection::CENTRAL_JETS, regionCut_ );
+	return jets.highest(1)>=threshold1_ && jets.highest(2)>=threshold2_;
+}
+
+bool l1menu::triggers::DoubleJetCentral_v0::calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const
+{
+	const bool* PhysicsBits=event.physicsBits();
+
+	// With the other threshold at zero, threshold1 is the highest jet Et and threshold2 the second highest, and
+	// either way there need to be at least two jets. The jets are sorted so these are the first two in the eta range.
+	l1menu::implementation::HighestValues<2> highestPts;
+	if( PhysicsBits[0] )
 	{
-		int bx=analysisDataFormat.Bxjet[ue];
-		if( bx!=0 ) continue;
-		bool isFwdJet=analysisDataFormat.Fwdjet[ue];
-		if( isFwdJet ) continue;
-		bool isTauJet=analysisDataFormat.Taujet[ue];
-		if( isTauJet ) continue;
-
-		float eta = analysisDataFormat.Etajet[ue];
-		if (eta < regionCut_ || eta > 21.-regionCut_) continue;
-
-		float rank=analysisDataFormat.Etjet[ue];
-		float pt=rank; //CorrectedL1JetPtByGCTregions(analysisDataFormat.Etajet[ue],rank*4.,theL1JetCorrection);
-		if( pt>=threshold1_ ) n1++;
-		if( pt>=threshold2_ ) n2++;
+		const l1menu::implementation::TriggerObjects::CaloObjects& jets=event.triggerObjects().centralJets;
+		for( size_t index=l1menu::implementation::nextInRegion( jets, regionCut_ ); index<jets.size() && highestPts.size()<2; index=l1menu::implementation::nextInRegion( jets, regionCut_, index+1 ) )
+		{
+			if( jets.et[index]<0 ) break;
+			highestPts.add( jets.et[index] );
+		}
 	}
-	bool ok=(n1>=1&&n2>=2);
 
-	return ok;
+	if( highestPts.size()<2 )
+	{
+		pThresholds[0]=-1;
+		pThresholds[1]=-1;
+	}
+	else
+	{
+		pThresholds[0]=highestPts[0];
+		pThresholds[1]=highestPts[1];
+	}
+	return true;
 }
 
 bool l1menu::triggers::DoubleJetCentral_v0::thresholdsAreCorrelated() const
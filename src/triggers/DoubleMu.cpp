@@ -1,9 +1,12 @@
 #include "DoubleMu.h"
 
 #include <stdexcept>
+#include <limits>
 #include "../implementation/RegisterTriggerMacro.h"
+#include "../implementation/HighestValues.h"
 #include "l1menu/L1TriggerDPGEvent.h"
-#include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
+#include "../implementation/TriggerObjects.h"
+#include "../implementation/DerivedQuantities.h"
 
 
 namespace l1menu
@@ -36,30 +39,65 @@ namespace l1menu
 
 bool l1menu::triggers::DoubleMu_v0::apply( const l1menu::L1TriggerDPGEvent& event ) const
 {
-	const L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
 	const bool* PhysicsBits=event.physicsBits();
 
 	bool raw=PhysicsBits[0]; // ZeroBias
 	if( !raw ) return false;
 
-	int n1=0;
-	int n2=0;
-	int Nmu=analysisDataFormat.Nmu;
-	for( int imu=0; imu<Nmu; imu++ )
+	// The muons are sorted by pt, so this needs the highest muon passing the quality cut to pass
+	// threshold1 and the second highest to pass threshold2.
+	int numberFound=0;
+	const l1menu::implementation::TriggerObjects::Muons& muons=event.triggerObjects().muons;
+	for( size_t index=0; index<muons.size(); ++index )
 	{
-		int bx=analysisDataFormat.Bxmu.at( imu );
-		if( bx!=0 ) continue;
-		float pt=analysisDataFormat.Ptmu.at( imu );
-		//float eta=analysisDataFormat.Etamu.at( imu ); // Commented out to stop unused variable compile warning
-		int qual=analysisDataFormat.Qualmu.at( imu );
-		if( qual<muonQuality_ ) continue;
-
-		if( pt>=threshold1_ ) n1++;
-		if( pt>=threshold2_ ) n2++;
+		if( muons.quality[index]<muonQuality_ ) continue;
+
+		if( numberFound==0 && !(muons.pt[index]>=threshold1_) ) return false;
+		if( numberFound==1 ) return muons.pt[index]>=threshold2_;
+		++numberFound;
+	}
+
+	return false;
+}
+
+bool l1menu::triggers::DoubleMu_v0::applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const
+{
+	if( !event.physicsBits()[0] ) return false; // ZeroBias
+
+	// There's no eta cut, so use an infinite one
+	const l1menu::implementation::DerivedQuantities::PassingObjects& muons=event.derivedQuantities().passingMuons( std::numeric_limits<float>::infinity(), muonQuality_ );
+	return muons.highest(1)>=threshold1_ && muons.highest(2)>=threshold2_;
+}
+
+bool l1menu::triggers::DoubleMu_v0::calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const
+{
+	const bool* PhysicsBits=event.physicsBits();
+
+	// With the other threshold at zero, threshold1 is the highest muon pt and threshold2 the second highest, and
+	// either way there need to be at least two muons. The muons are sorted so these are the first two.
+	l1menu::implementation::HighestValues<2> highestPts;
+	if( PhysicsBits[0] )
+	{
+		const l1menu::implementation::TriggerObjects::Muons& muons=event.triggerObjects().muons;
+		for( size_t index=0; index<muons.size() && highestPts.size()<2; ++index )
+		{
+			if( muons.quality[index]<muonQuality_ ) continue;
+			if( muons.pt[index]<0 ) break;
+			highestPts.add( muons.pt[index] );
+		}
 	}
 
-	bool ok=( n1>=1 && n2>=2 );
-	return ok;
+	if( highestPts.size()<2 )
+	{
+		pThresholds[0]=-1;
+		pThresholds[1]=-1;
+	}
+	else
+	{
+		pThresholds[0]=highestPts[0];
+		pThresholds[1]=highestPts[1];
+	}
+	return true;
 }
 
 bool l1menu::triggers::DoubleMu_v0::thresholdsAreCorrelated() const
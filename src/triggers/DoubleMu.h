@@ -52,6 +52,8 @@ namespace l1menu
 		public:
 			virtual unsigned int version() const;
 			virtual bool apply( const l1menu::L1TriggerDPGEvent& event ) const;
+			virtual bool calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const;
+			virtual bool applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const;
 			virtual bool thresholdsAreCorrelated() const;
 		}; // end of version 0 class
 
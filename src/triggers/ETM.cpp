@@ -45,6 +45,7 @@ namespace l1menu
 		public:
 			virtual unsigned int version() const;
 			virtual bool apply( const l1menu::L1TriggerDPGEvent& event ) const;
+			virtual bool calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const;
 			virtual bool thresholdsAreCorrelated() const;
 		}; // end of version 0 class
 
@@ -95,6 +96,16 @@ bool l1menu::triggers::ETM_v0::apply( const l1menu::L1TriggerDPGEvent& event ) c
 	return true;
 }
 
+bool l1menu::triggers::ETM_v0::calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const
+{
+	const L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
+	const bool* PhysicsBits=event.physicsBits();
+
+	if( PhysicsBits[0] && analysisDataFormat.ETM>=0 ) pThresholds[0]=analysisDataFormat.ETM;
+	else pThresholds[0]=-1;
+	return true;
+}
+
 bool l1menu::triggers::ETM_v0::thresholdsAreCorrelated() const
 {
 	return false;
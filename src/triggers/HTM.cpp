@@ -56,6 +56,16 @@ bool l1menu::triggers::HTM_v0::apply( const l1menu::L1TriggerDPGEvent& event ) c
 	return true;
 }
 
+bool l1menu::triggers::HTM_v0::calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const
+{
+	const L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
+	const bool* PhysicsBits=event.physicsBits();
+
+	if( PhysicsBits[0] && analysisDataFormat.HTM>=0 ) pThresholds[0]=analysisDataFormat.HTM;
+	else pThresholds[0]=-1;
+	return true;
+}
+
 bool l1menu::triggers::HTM_v0::thresholdsAreCorrelated() const
 {
 	return false;
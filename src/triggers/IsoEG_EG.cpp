@@ -1,8 +1,10 @@
 #include "../implementation/RegisterTriggerMacro.h"
+#include "../implementation/HighestValues.h"
 #include "l1menu/L1TriggerDPGEvent.h"
 
 #include <stdexcept>
-#include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
+#include "../implementation/TriggerObjects.h"
+#include "../implementation/DerivedQuantities.h"
 
 #include "l1menu/ITrigger.h"
 
@@ -47,6 +49,8 @@ namespace l1menu
 		public:
 			virtual unsigned int version() const;
 			virtual bool apply( const l1menu::L1TriggerDPGEvent& event ) const;
+			virtual bool calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const;
+			virtual bool applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const;
 			virtual bool thresholdsAreCorrelated() const;
 		}; // end of version 0 class
 
@@ -85,7 +89,6 @@ namespace l1menu
 
 bool l1menu::triggers::IsoEG_EG_v0::apply( const l1menu::L1TriggerDPGEvent& event ) const
 {
-	const L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
 	const bool* PhysicsBits=event.physicsBits();
 
 	bool raw = PhysicsBits[0];   // ZeroBias
@@ -93,23 +96,64 @@ bool l1menu::triggers::IsoEG_EG_v0::apply( const l1menu::L1TriggerDPGEvent& even
 
 	int n1=0;
 	int n2=0;
-	int Nele = analysisDataFormat.Nele;
-	for (int ue=0; ue < Nele; ue++) {
-		int bx = analysisDataFormat.Bxel[ue];
-		if (bx != 0) continue;
-		float eta = analysisDataFormat.Etael[ue];
-		if (eta < regionCut_ || eta > 21.-regionCut_) continue;  // eta = 5 - 16
-		float rank = analysisDataFormat.Etel[ue];    // the rank of the electron
-		float pt = rank ;
-		if (pt >= leg1threshold1_ && analysisDataFormat.Isoel[ue]) n1++;
+	const l1menu::implementation::TriggerObjects::CaloObjects& objects=event.triggerObjects().eg;
+	for( size_t index=l1menu::implementation::nextInRegion( objects, regionCut_ ); index<objects.size(); index=l1menu::implementation::nextInRegion( objects, regionCut_, index+1 ) )
+	{
+		float pt=objects.et[index];
+		// The objects are sorted by Et, so once one is below both thresholds none of the rest can count
+		if( !(pt>=leg1threshold1_ || pt>=leg2threshold1_) ) break;
+		if (pt >= leg1threshold1_ && objects.isolated[index]) n1++;
 		if (pt >= leg2threshold1_) n2++;
-	}  // end loop over EM objects
+	}
 
-	bool ok = ( n1 >= 1 && n2 >= 2) ;
-	//if(ok) printf("Found doubleEG event Run %i Event %i \n",event_->run,event_->event);
+	bool ok = ( n1 >= 1 && n2 >= 2 );
 	return ok;
 }
 
+bool l1menu::triggers::IsoEG_EG_v0::applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const
+{
+	if( !event.physicsBits()[0] ) return false; // ZeroBias
+
+	// One isolated EG above the first threshold, and two EG of any kind (which can include that one) above the second
+	const l1menu::implementation::DerivedQuantities::PassingObjects& objects=event.derivedQuantities().passing( l1menu::implementation::DerivedQuantities::CaloCollection::EG, regionCut_ );
+	return objects.highestIsolated()>=leg1threshold1_ && objects.highest(2)>=leg2threshold1_;
+}
+
+bool l1menu::triggers::IsoEG_EG_v0::calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const
+{
+	const bool* PhysicsBits=event.physicsBits();
+
+	// The first leg is the highest isolated EG Et and the second leg the second highest of any EG. With the other
+	// threshold at zero, there need to be at least one isolated EG and at least two EGs. They're sorted
+	// by Et, so the first ones found are the highest.
+	float highestIsolatedPt=-1;
+	l1menu::implementation::HighestValues<2> highestPts;
+	if( PhysicsBits[0] )
+	{
+		const l1menu::implementation::TriggerObjects::CaloObjects& objects=event.triggerObjects().eg;
+		for( size_t index=l1menu::implementation::nextInRegion( objects, regionCut_ ); index<objects.size(); index=l1menu::implementation::nextInRegion( objects, regionCut_, index+1 ) )
+		{
+			float pt=objects.et[index];
+			if( pt<0 ) break;
+			if( objects.isolated[index] && highestIsolatedPt<0 ) highestIsolatedPt=pt;
+			highestPts.add( pt );
+			if( highestIsolatedPt>=0 && highestPts.size()==2 ) break;
+		}
+	}
+
+	if( highestIsolatedPt<0 || highestPts.size()<2 )
+	{
+		pThresholds[0]=-1;
+		pThresholds[1]=-1;
+	}
+	else
+	{
+		pThresholds[0]=highestIsolatedPt;
+		pThresholds[1]=highestPts[1];
+	}
+	return true;
+}
+
 bool l1menu::triggers::IsoEG_EG_v0::thresholdsAreCorrelated() const
 {
 	return false;
@@ -2,7 +2,8 @@
 #include "l1menu/L1TriggerDPGEvent.h"
 
 #include <stdexcept>
-#include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
+#include "../implementation/TriggerObjects.h"
+#include "../implementation/DerivedQuantities.h"
 
 #include "l1menu/ITrigger.h"
 
@@ -56,6 +57,8 @@ namespace l1menu
 		public:
 			virtual unsigned int version() const;
 			virtual bool apply( const l1menu::L1TriggerDPGEvent& event ) const;
+			virtual bool calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const;
+			virtual bool applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const;
 			virtual bool thresholdsAreCorrelated() const;
 		}; // end of version 0 class
 
@@ -69,6 +72,8 @@ namespace l1menu
 		public:
 			virtual unsigned int version() const;
 			virtual bool apply( const l1menu::L1TriggerDPGEvent& event ) const;
+			virtual bool calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const;
+			virtual bool applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const;
 			virtual bool thresholdsAreCorrelated() const;
 		}; // end of version 0 class
 
@@ -109,51 +114,91 @@ namespace l1menu
 
 bool l1menu::triggers::IsoEG_JetCentral_v1::apply( const l1menu::L1TriggerDPGEvent& event ) const
 {
-	const L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
 	const bool* PhysicsBits=event.physicsBits();
 
 	bool raw = PhysicsBits[0];   // ZeroBias
 	if (! raw) return false;
 
-	bool jet=false;
-	bool eg = false;
-	bool ok = false;
-
-	int Nj = analysisDataFormat.Njet ;
-
-	int Nele = analysisDataFormat.Nele;
-	for (int ue=0; ue < Nele; ue++) {
-		int bx = analysisDataFormat.Bxel[ue];
-		if (bx != 0 || !analysisDataFormat.Isoel[ue]) continue;
-		float eta = analysisDataFormat.Etael[ue];
-		if (eta < leg1regionCut_ || eta > 21.-leg1regionCut_) continue;  // eta = 5 - 16
-		float rank = analysisDataFormat.Etel[ue];    // the rank of the electron
-		float pt = rank ;
-		if (pt >= leg1threshold1_){
-
-			eg = true;
-
-			for (int uj=0; uj < Nj; uj++) {
-				int bxj = analysisDataFormat.Bxjet[uj];
-				if (bxj != 0) continue;
-				bool isFwdJet = analysisDataFormat.Fwdjet[uj];
-				if (isFwdJet) continue;
-				bool isTauJet = analysisDataFormat.Taujet[uj];
-				if (isTauJet) continue;
-				float rankj = analysisDataFormat.Etjet[uj];
-				float ptj = rankj; //CorrectedL1JetPtByGCTregions(analysisDataFormat.Etajet[uj],rank*4.,theL1JetCorrection);
-
-				if (analysisDataFormat.Etajet[uj] < leg2regionCut_ || analysisDataFormat.Etajet[uj] > 21.-leg2regionCut_) continue;
-				if (ptj >= leg2threshold1_ &&
-					!(analysisDataFormat.Etajet[uj]==analysisDataFormat.Etael[ue] &&
-					  analysisDataFormat.Phijet[uj]==analysisDataFormat.Phiel[ue]) ) jet = true;
-			}
+	// Both collections are sorted by Et, so each loop can stop as soon as an object is below its threshold
+	const l1menu::implementation::TriggerObjects& triggerObjects=event.triggerObjects();
+	const l1menu::implementation::TriggerObjects::CaloObjects& egs=triggerObjects.isolatedEG;
+	const l1menu::implementation::TriggerObjects::CaloObjects& jets=triggerObjects.centralJets;
+	for( size_t ue=l1menu::implementation::nextInRegion( egs, leg1regionCut_ ); ue<egs.size(); ue=l1menu::implementation::nextInRegion( egs, leg1regionCut_, ue+1 ) )
+	{
+		if( !(egs.et[ue]>=leg1threshold1_) ) break;
+
+		// Now look for a central jet that is not the same as this eg
+		for( size_t uj=l1menu::implementation::nextInRegion( jets, leg2regionCut_ ); uj<jets.size(); uj=l1menu::implementation::nextInRegion( jets, leg2regionCut_, uj+1 ) )
+		{
+			if( !(jets.et[uj]>=leg2threshold1_) ) break;
+			// Only one of eta and phi needs to be different for it to be a different object
+			if( jets.etaRegion[uj]==egs.etaRegion[ue] && jets.phiRegion[uj]==egs.phiRegion[ue] ) continue;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool l1menu::triggers::IsoEG_JetCentral_v1::applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const
+{
+	if( !event.physicsBits()[0] ) return false; // ZeroBias
+
+	// The object matching can't be looked up, but most events fail because one of the collections doesn't
+	// have anything above its threshold at all, which can.
+	l1menu::implementation::DerivedQuantities& quantities=event.derivedQuantities();
+	if( !(quantities.passing( l1menu::implementation::DerivedQuantities::CaloCollection::ISOLATED_EG, leg1regionCut_ ).highest()>=leg1threshold1_) ) return false;
+	if( !(quantities.passing( l1menu::implementation::DerivedQuantities::CaloCollection::CENTRAL_JETS, leg2regionCut_ ).highest()>=leg2threshold1_) ) return false;
+
+	return apply( event );
+}
+
+bool l1menu::triggers::IsoEG_JetCentral_v1::calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const
+{
+	const bool* PhysicsBits=event.physicsBits();
+
+	// The thresholds are correlated, so leg2threshold1 is scaled with leg1threshold1. The trigger
+	// passes at leg1threshold1=x if there's a pair where the EG passes x and the central jet passes
+	// scaling*x, so the tightest threshold is the highest over all pairs of the lower of the two.
+	if( leg1threshold1_<=0 || leg2threshold1_<0 ) return false; // Leave anything unusual to the bisection
+	const float scaling=leg2threshold1_/leg1threshold1_;
 
-			ok = eg && jet;
-		} // if good EG
-	}  // end loop over EM objects
+	float tightestThreshold=-1;
+	if( PhysicsBits[0] )
+	{
+		const l1menu::implementation::TriggerObjects& triggerObjects=event.triggerObjects();
+		const l1menu::implementation::TriggerObjects::CaloObjects& egs=triggerObjects.isolatedEG;
+		const l1menu::implementation::TriggerObjects::CaloObjects& jets=triggerObjects.centralJets;
+		for( size_t ue=l1menu::implementation::nextInRegion( egs, leg1regionCut_ ); ue<egs.size(); ue=l1menu::implementation::nextInRegion( egs, leg1regionCut_, ue+1 ) )
+		{
+			float pt=egs.et[ue];
+			if( pt<=tightestThreshold ) break; // The EGs are sorted, so none of the rest can improve on what's already been found
 
-	return ok;
+			for( size_t uj=l1menu::implementation::nextInRegion( jets, leg2regionCut_ ); uj<jets.size(); uj=l1menu::implementation::nextInRegion( jets, leg2regionCut_, uj+1 ) )
+			{
+				// Only one of eta and phi needs to be different for it to be a different object
+				if( jets.etaRegion[uj]==egs.etaRegion[ue] && jets.phiRegion[uj]==egs.phiRegion[ue] ) continue;
+				float jetPt=jets.et[uj];
+				if( jetPt<0 ) break;
+				float threshold=pt;
+				if( scaling>0 && jetPt/scaling<threshold ) threshold=jetPt/scaling;
+				if( threshold>tightestThreshold ) tightestThreshold=threshold;
+				break; // The first jet that isn't the same object has the highest Et, so gives the best threshold
+			}
+		}
+	}
+
+	if( tightestThreshold<0 )
+	{
+		pThresholds[0]=-1;
+		pThresholds[1]=-1;
+	}
+	else
+	{
+		pThresholds[0]=tightestThreshold;
+		pThresholds[1]=scaling*tightestThreshold;
+	}
+	return true;
 }
 
 bool l1menu::triggers::IsoEG_JetCentral_v1::thresholdsAreCorrelated() const
@@ -168,51 +213,91 @@ unsigned int l1menu::triggers::IsoEG_JetCentral_v1::version() const
 
 bool l1menu::triggers::IsoEG_JetCentral_v0::apply( const l1menu::L1TriggerDPGEvent& event ) const
 {
-	const L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
 	const bool* PhysicsBits=event.physicsBits();
 
 	bool raw = PhysicsBits[0];   // ZeroBias
 	if (! raw) return false;
 
-	bool jet=false;
-	bool eg = false;
-	bool ok = false;
-
-	int Nj = analysisDataFormat.Njet ;
-
-	int Nele = analysisDataFormat.Nele;
-	for (int ue=0; ue < Nele; ue++) {
-		int bx = analysisDataFormat.Bxel[ue];
-		if (bx != 0 || !analysisDataFormat.Isoel[ue]) continue;
-		float eta = analysisDataFormat.Etael[ue];
-		if (eta < leg1regionCut_ || eta > 21.-leg1regionCut_) continue;  // eta = 5 - 16
-		float rank = analysisDataFormat.Etel[ue];    // the rank of the electron
-		float pt = rank ;
-		if (pt >= leg1threshold1_){
-
-			eg = true;
-
-			for (int uj=0; uj < Nj; uj++) {
-				int bxj = analysisDataFormat.Bxjet[uj];
-				if (bxj != 0) continue;
-				bool isFwdJet = analysisDataFormat.Fwdjet[uj];
-				if (isFwdJet) continue;
-				bool isTauJet = analysisDataFormat.Taujet[uj];
-				if (isTauJet) continue;
-				float rankj = analysisDataFormat.Etjet[uj];
-				float ptj = rankj; //CorrectedL1JetPtByGCTregions(analysisDataFormat.Etajet[uj],rank*4.,theL1JetCorrection);
-
-				if (analysisDataFormat.Etajet[uj] < leg2regionCut_ || analysisDataFormat.Etajet[uj] > 21.-leg2regionCut_) continue;
-				if (ptj >= leg2threshold1_ &&
-					(analysisDataFormat.Etajet[uj]!=analysisDataFormat.Etael[ue]) &&
-					(analysisDataFormat.Phijet[uj]!=analysisDataFormat.Phiel[ue]) ) jet = true;
-			}
+	// Both collections are sorted by Et, so each loop can stop as soon as an object is below its threshold
+	const l1menu::implementation::TriggerObjects& triggerObjects=event.triggerObjects();
+	const l1menu::implementation::TriggerObjects::CaloObjects& egs=triggerObjects.isolatedEG;
+	const l1menu::implementation::TriggerObjects::CaloObjects& jets=triggerObjects.centralJets;
+	for( size_t ue=l1menu::implementation::nextInRegion( egs, leg1regionCut_ ); ue<egs.size(); ue=l1menu::implementation::nextInRegion( egs, leg1regionCut_, ue+1 ) )
+	{
+		if( !(egs.et[ue]>=leg1threshold1_) ) break;
+
+		// Now look for a central jet that is not the same as this eg
+		for( size_t uj=l1menu::implementation::nextInRegion( jets, leg2regionCut_ ); uj<jets.size(); uj=l1menu::implementation::nextInRegion( jets, leg2regionCut_, uj+1 ) )
+		{
+			if( !(jets.et[uj]>=leg2threshold1_) ) break;
+			// Version 0 requires both eta and phi to be different (see the IsoEG_JetCentral_v1 description)
+			if( jets.etaRegion[uj]==egs.etaRegion[ue] || jets.phiRegion[uj]==egs.phiRegion[ue] ) continue;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool l1menu::triggers::IsoEG_JetCentral_v0::applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const
+{
+	if( !event.physicsBits()[0] ) return false; // ZeroBias
+
+	// The object matching can't be looked up, but most events fail because one of the collections doesn't
+	// have anything above its threshold at all, which can.
+	l1menu::implementation::DerivedQuantities& quantities=event.derivedQuantities();
+	if( !(quantities.passing( l1menu::implementation::DerivedQuantities::CaloCollection::ISOLATED_EG, leg1regionCut_ ).highest()>=leg1threshold1_) ) return false;
+	if( !(quantities.passing( l1menu::implementation::DerivedQuantities::CaloCollection::CENTRAL_JETS, leg2regionCut_ ).highest()>=leg2threshold1_) ) return false;
+
+	return apply( event );
+}
+
+bool l1menu::triggers::IsoEG_JetCentral_v0::calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const
+{
+	const bool* PhysicsBits=event.physicsBits();
+
+	// The thresholds are correlated, so leg2threshold1 is scaled with leg1threshold1. The trigger
+	// passes at leg1threshold1=x if there's a pair where the EG passes x and the central jet passes
+	// scaling*x, so the tightest threshold is the highest over all pairs of the lower of the two.
+	if( leg1threshold1_<=0 || leg2threshold1_<0 ) return false; // Leave anything unusual to the bisection
+	const float scaling=leg2threshold1_/leg1threshold1_;
 
-			ok = eg && jet;
-		} // if good EG
-	}  // end loop over EM objects
+	float tightestThreshold=-1;
+	if( PhysicsBits[0] )
+	{
+		const l1menu::implementation::TriggerObjects& triggerObjects=event.triggerObjects();
+		const l1menu::implementation::TriggerObjects::CaloObjects& egs=triggerObjects.isolatedEG;
+		const l1menu::implementation::TriggerObjects::CaloObjects& jets=triggerObjects.centralJets;
+		for( size_t ue=l1menu::implementation::nextInRegion( egs, leg1regionCut_ ); ue<egs.size(); ue=l1menu::implementation::nextInRegion( egs, leg1regionCut_, ue+1 ) )
+		{
+			float pt=egs.et[ue];
+			if( pt<=tightestThreshold ) break; // The EGs are sorted, so none of the rest can improve on what's already been found
 
-	return ok;
+			for( size_t uj=l1menu::implementation::nextInRegion( jets, leg2regionCut_ ); uj<jets.size(); uj=l1menu::implementation::nextInRegion( jets, leg2regionCut_, uj+1 ) )
+			{
+				// Version 0 requires both eta and phi to be different (see the IsoEG_JetCentral_v1 description)
+				if( jets.etaRegion[uj]==egs.etaRegion[ue] || jets.phiRegion[uj]==egs.phiRegion[ue] ) continue;
+				float jetPt=jets.et[uj];
+				if( jetPt<0 ) break;
+				float threshold=pt;
+				if( scaling>0 && jetPt/scaling<threshold ) threshold=jetPt/scaling;
+				if( threshold>tightestThreshold ) tightestThreshold=threshold;
+				break; // The first jet that isn't the same object has the highest Et, so gives the best threshold
+			}
+		}
+	}
+
+	if( tightestThreshold<0 )
+	{
+		pThresholds[0]=-1;
+		pThresholds[1]=-1;
+	}
+	else
+	{
+		pThresholds[0]=tightestThreshold;
+		pThresholds[1]=scaling*tightestThreshold;
+	}
+	return true;
 }
 
 bool l1menu::triggers::IsoEG_JetCentral_v0::thresholdsAreCorrelated() const
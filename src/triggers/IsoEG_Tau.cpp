@@ -2,7 +2,8 @@
 #include "l1menu/L1TriggerDPGEvent.h"
 
 #include <stdexcept>
-#include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
+#include "../implementation/TriggerObjects.h"
+#include "../implementation/DerivedQuantities.h"
 
 #include "l1menu/ITrigger.h"
 
@@ -48,6 +49,8 @@ namespace l1menu
 		public:
 			virtual unsigned int version() const;
 			virtual bool apply( const l1menu::L1TriggerDPGEvent& event ) const;
+			virtual bool calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const;
+			virtual bool applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const;
 			virtual bool thresholdsAreCorrelated() const;
 		}; // end of version 0 class
 
@@ -86,47 +89,91 @@ namespace l1menu
 
 bool l1menu::triggers::IsoEG_Tau_v0::apply( const l1menu::L1TriggerDPGEvent& event ) const
 {
-	const L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
 	const bool* PhysicsBits=event.physicsBits();
 
-	bool raw = PhysicsBits[0];    // ZeroBias
+	bool raw = PhysicsBits[0];   // ZeroBias
 	if (! raw) return false;
 
+	// Both collections are sorted by Et, so each loop can stop as soon as an object is below its threshold
+	const l1menu::implementation::TriggerObjects& triggerObjects=event.triggerObjects();
+	const l1menu::implementation::TriggerObjects::CaloObjects& egs=triggerObjects.isolatedEG;
+	const l1menu::implementation::TriggerObjects::CaloObjects& jets=triggerObjects.tauJets;
+	for( size_t ue=l1menu::implementation::nextInRegion( egs, leg1regionCut_ ); ue<egs.size(); ue=l1menu::implementation::nextInRegion( egs, leg1regionCut_, ue+1 ) )
+	{
+		if( !(egs.et[ue]>=leg1threshold1_) ) break;
 
-	bool tau =false;
-	bool eg = false;
-
-	int Nele = analysisDataFormat.Nele;
-	for (int ue=0; ue < Nele; ue++) {
-		int bx = analysisDataFormat.Bxel[ue];
-		if (bx != 0 || !analysisDataFormat.Isoel[ue]) continue;
-		float eta = analysisDataFormat.Etael[ue];
-		if (eta < leg1regionCut_ || eta > 21.-leg1regionCut_) continue;  // eta = 5 - 16
-		float rank = analysisDataFormat.Etel[ue];    // the rank of the electron
-		float pt = rank ;
-		if (pt >= leg1threshold1_) {
-			eg = true;
-
-			// Now look for a tau that is not the same as this eg
-			int Nj = analysisDataFormat.Njet ;
-			for (int uj=0; uj < Nj; uj++) {
-				bx = analysisDataFormat.Bxjet[uj];
-				if (bx != 0) continue;
-				bool isTauJet = analysisDataFormat.Taujet[uj];
-				if (!isTauJet) continue;
-				float tauEta = analysisDataFormat.Etajet[uj];
-				if (tauEta < leg2regionCut_ || tauEta > 21.-leg2regionCut_) continue;  // tauEta = 5 - 16
-				if (analysisDataFormat.Etajet[uj] == analysisDataFormat.Etael[ue] && analysisDataFormat.Phijet[uj] == analysisDataFormat.Phiel[ue] ) continue;
-				float rankt = analysisDataFormat.Etjet[uj];
-				float ptt = rankt; //CorrectedL1JetPtByGCTregions(analysisDataFormat.Etajet[uj],rank*4.,theL1JetCorrection);
-				if (ptt >= leg2threshold1_) tau = true;
-			}
+		// Now look for a tau that is not the same as this eg
+		for( size_t uj=l1menu::implementation::nextInRegion( jets, leg2regionCut_ ); uj<jets.size(); uj=l1menu::implementation::nextInRegion( jets, leg2regionCut_, uj+1 ) )
+		{
+			if( !(jets.et[uj]>=leg2threshold1_) ) break;
+			// Only one of eta and phi needs to be different for it to be a different object
+			if( jets.etaRegion[uj]==egs.etaRegion[ue] && jets.phiRegion[uj]==egs.phiRegion[ue] ) continue;
+			return true;
+		}
+	}
+
+	return false;
+}
 
+bool l1menu::triggers::IsoEG_Tau_v0::applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const
+{
+	if( !event.physicsBits()[0] ) return false; // ZeroBias
+
+	// The object matching can't be looked up, but most events fail because one of the collections doesn't
+	// have anything above its threshold at all, which can.
+	l1menu::implementation::DerivedQuantities& quantities=event.derivedQuantities();
+	if( !(quantities.passing( l1menu::implementation::DerivedQuantities::CaloCollection::ISOLATED_EG, leg1regionCut_ ).highest()>=leg1threshold1_) ) return false;
+	if( !(quantities.passing( l1menu::implementation::DerivedQuantities::CaloCollection::TAU_JETS, leg2regionCut_ ).highest()>=leg2threshold1_) ) return false;
+
+	return apply( event );
+}
+
+bool l1menu::triggers::IsoEG_Tau_v0::calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const
+{
+	const bool* PhysicsBits=event.physicsBits();
+
+	// The thresholds are correlated, so leg2threshold1 is scaled with leg1threshold1. The trigger
+	// passes at leg1threshold1=x if there's a pair where the EG passes x and the tau passes
+	// scaling*x, so the tightest threshold is the highest over all pairs of the lower of the two.
+	if( leg1threshold1_<=0 || leg2threshold1_<0 ) return false; // Leave anything unusual to the bisection
+	const float scaling=leg2threshold1_/leg1threshold1_;
+
+	float tightestThreshold=-1;
+	if( PhysicsBits[0] )
+	{
+		const l1menu::implementation::TriggerObjects& triggerObjects=event.triggerObjects();
+		const l1menu::implementation::TriggerObjects::CaloObjects& egs=triggerObjects.isolatedEG;
+		const l1menu::implementation::TriggerObjects::CaloObjects& jets=triggerObjects.tauJets;
+		for( size_t ue=l1menu::implementation::nextInRegion( egs, leg1regionCut_ ); ue<egs.size(); ue=l1menu::implementation::nextInRegion( egs, leg1regionCut_, ue+1 ) )
+		{
+			float pt=egs.et[ue];
+			if( pt<=tightestThreshold ) break; // The EGs are sorted, so none of the rest can improve on what's already been found
+
+			for( size_t uj=l1menu::implementation::nextInRegion( jets, leg2regionCut_ ); uj<jets.size(); uj=l1menu::implementation::nextInRegion( jets, leg2regionCut_, uj+1 ) )
+			{
+				// Only one of eta and phi needs to be different for it to be a different object
+				if( jets.etaRegion[uj]==egs.etaRegion[ue] && jets.phiRegion[uj]==egs.phiRegion[ue] ) continue;
+				float jetPt=jets.et[uj];
+				if( jetPt<0 ) break;
+				float threshold=pt;
+				if( scaling>0 && jetPt/scaling<threshold ) threshold=jetPt/scaling;
+				if( threshold>tightestThreshold ) tightestThreshold=threshold;
+				break; // The first jet that isn't the same object has the highest Et, so gives the best threshold
+			}
 		}
-	}  // end loop over EM objects
+	}
 
-	bool ok = eg && tau;
-	return ok;
+	if( tightestThreshold<0 )
+	{
+		pThresholds[0]=-1;
+		pThresholds[1]=-1;
+	}
+	else
+	{
+		pThresholds[0]=tightestThreshold;
+		pThresholds[1]=scaling*tightestThreshold;
+	}
+	return true;
 }
 
 bool l1menu::triggers::IsoEG_Tau_v0::thresholdsAreCorrelated() const
@@ -2,9 +2,14 @@
 
 
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include "../implementation/RegisterTriggerMacro.h"
+#include "../implementation/HighestValues.h"
 #include "l1menu/L1TriggerDPGEvent.h"
-#include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
+#include "../implementation/TriggerObjects.h"
+#include "../implementation/DerivedQuantities.h"
 
 
 namespace l1menu
@@ -40,7 +45,6 @@ namespace l1menu
 
 bool l1menu::triggers::MultiJet_v0::apply( const l1menu::L1TriggerDPGEvent& event ) const
 {
-	const L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
 	const bool* PhysicsBits=event.physicsBits();
 
 	bool raw = PhysicsBits[0];   // ZeroBias
@@ -51,20 +55,12 @@ bool l1menu::triggers::MultiJet_v0::apply( const l1menu::L1TriggerDPGEvent& even
 	int n3=0;
 	int n4=0;
 
-	int Nj = analysisDataFormat.Njet ;
-	for (int ue=0; ue < Nj; ue++) {
-		int bx = analysisDataFormat.Bxjet[ue];
-		if (bx != 0) continue;
-		bool isFwdJet = analysisDataFormat.Fwdjet[ue];
-		if (isFwdJet) continue;
-		bool isTauJet = analysisDataFormat.Taujet[ue];
-		if (isTauJet) continue;
-
-		float eta = analysisDataFormat.Etajet[ue];
-		if (eta < regionCut_ || eta > 21.-regionCut_) continue;
-
-		float rank = analysisDataFormat.Etjet[ue];
-		float pt = rank; //CorrectedL1JetPtByGCTregions(analysisDataFormat.Etajet[ue],rank*4.,theL1JetCorrection);
+	const l1menu::implementation::TriggerObjects::CaloObjects& jets=event.triggerObjects().centralJets;
+	for( size_t index=l1menu::implementation::nextInRegion( jets, regionCut_ ); index<jets.size(); index=l1menu::implementation::nextInRegion( jets, regionCut_, index+1 ) )
+	{
+		float pt=jets.et[index];
+		// The jets are sorted by Et, so once one is below all of the thresholds none of the rest can count
+		if( !(pt>=threshold1_ || pt>=threshold2_ || pt>=threshold3_ || pt>=threshold4_) ) break;
 		if (pt >= threshold1_) n1++;
 		if (pt >= threshold2_) n2++;
 		if (pt >= threshold3_) n3++;
@@ -75,6 +71,51 @@ bool l1menu::triggers::MultiJet_v0::apply( const l1menu::L1TriggerDPGEvent& even
 	return ok;
 }
 
+bool l1menu::triggers::MultiJet_v0::applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const
+{
+	if( !event.physicsBits()[0] ) return false; // ZeroBias
+
+	// Needing at least k jets above a threshold is the same as the k'th highest jet being above it. The
+	// number of jets is a float, so round it up the same way the comparison with the count would.
+	if( !(numberOfJets_<=std::numeric_limits<int>::max()) ) return false; // Also catches NaN
+	const float lastJet=std::ceil( numberOfJets_ );
+
+	const l1menu::implementation::DerivedQuantities::PassingObjects& jets=event.derivedQuantities().passing( l1menu::implementation::DerivedQuantities::CaloCollection::CENTRAL_JETS, regionCut_ );
+	return jets.highest(1)>=threshold1_ && jets.highest(2)>=threshold2_ && jets.highest(3)>=threshold3_
+		&& ( lastJet<1 || jets.highest( static_cast<size_t>(lastJet) )>=threshold4_ );
+}
+
+bool l1menu::triggers::MultiJet_v0::calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const
+{
+	const bool* PhysicsBits=event.physicsBits();
+
+	// Threshold k needs k jets above it (numberOfJets for the last one), so it's the Et of the k'th highest
+	// jet. With the other thresholds at zero, there always need to be at least as many jets as the largest
+	// requirement.
+	typedef l1menu::implementation::HighestValues<8> HighestPts;
+	const float requiredJets[]={ 1, 2, 3, numberOfJets_ };
+	const float mostRequiredJets=std::max<float>( 3, numberOfJets_ );
+	if( mostRequiredJets>HighestPts::capacity || numberOfJets_<1 ) return false; // Leave anything unusual to the bisection
+
+	HighestPts highestPts;
+	if( PhysicsBits[0] )
+	{
+		const l1menu::implementation::TriggerObjects::CaloObjects& jets=event.triggerObjects().centralJets;
+		for( size_t index=l1menu::implementation::nextInRegion( jets, regionCut_ ); index<jets.size() && highestPts.size()<HighestPts::capacity; index=l1menu::implementation::nextInRegion( jets, regionCut_, index+1 ) )
+		{
+			if( jets.et[index]<0 ) break;
+			highestPts.add( jets.et[index] );
+		}
+	}
+
+	for( size_t index=0; index<4; ++index )
+	{
+		if( highestPts.size()<mostRequiredJets ) pThresholds[index]=-1;
+		else pThresholds[index]=highestPts[std::ceil(requiredJets[index])-1];
+	}
+	return true;
+}
+
 bool l1menu::triggers::MultiJet_v0::thresholdsAreCorrelated() const
 {
 	return false;
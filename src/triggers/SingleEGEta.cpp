@@ -3,7 +3,8 @@
 #include <stdexcept>
 #include "../implementation/RegisterTriggerMacro.h"
 #include "l1menu/L1TriggerDPGEvent.h"
-#include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
+#include "../implementation/TriggerObjects.h"
+#include "../implementation/DerivedQuantities.h"
 
 
 namespace l1menu
@@ -44,25 +45,41 @@ namespace l1menu
 
 bool l1menu::triggers::SingleEGEta_v0::apply( const l1menu::L1TriggerDPGEvent& event ) const
 {
-	const L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
 	const bool* PhysicsBits=event.physicsBits();
 
-	bool raw = PhysicsBits[0];   // ZeroBias
+	bool raw = PhysicsBits[0];  // ZeroBias
 	if (! raw) return false;
 
-	bool ok=false;
-	int Nele = analysisDataFormat.Nele;
-	for (int ue=0; ue < Nele; ue++) {
-		int bx = analysisDataFormat.Bxel[ue];
-		if (bx != 0) continue;
-		float eta = analysisDataFormat.Etael[ue];
-		if (eta < regionCut_ || eta > 21.-regionCut_) continue;  // eta = 5 - 16
-		float rank = analysisDataFormat.Etel[ue];    // the rank of the electron
-		float pt = rank ;
-		if (pt >= threshold1_) ok = true;
-	}  // end loop over EM objects
-
-	return ok;
+	// The EG objects are sorted by Et, so only the highest one in the eta range needs checking
+	const l1menu::implementation::TriggerObjects::CaloObjects& objects=event.triggerObjects().eg;
+	const size_t index=l1menu::implementation::nextInRegion( objects, regionCut_ );
+
+	return index<objects.size() && objects.et[index]>=threshold1_;
+}
+
+bool l1menu::triggers::SingleEGEta_v0::applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const
+{
+	if( !event.physicsBits()[0] ) return false; // ZeroBias
+
+	return event.derivedQuantities().passing( l1menu::implementation::DerivedQuantities::CaloCollection::EG, regionCut_ ).highest()>=threshold1_;
+}
+
+bool l1menu::triggers::SingleEGEta_v0::calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const
+{
+	const bool* PhysicsBits=event.physicsBits();
+
+	// The threshold passes if it's at or below the Et of any of the EG objects, and the first one in
+	// the eta range has the highest Et
+	float highestPt=-1;
+	if( PhysicsBits[0] )
+	{
+		const l1menu::implementation::TriggerObjects::CaloObjects& objects=event.triggerObjects().eg;
+		const size_t index=l1menu::implementation::nextInRegion( objects, regionCut_ );
+		if( index<objects.size() && objects.et[index]>highestPt ) highestPt=objects.et[index];
+	}
+
+	pThresholds[0]=highestPt;
+	return true;
 }
 
 bool l1menu::triggers::SingleEGEta_v0::thresholdsAreCorrelated() const
@@ -5,7 +5,8 @@
 
 #include "l1menu/L1TriggerDPGEvent.h"
 #include "../implementation/RegisterTriggerMacro.h"
-#include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
+#include "../implementation/TriggerObjects.h"
+#include "../implementation/DerivedQuantities.h"
 
 
 namespace l1menu
@@ -46,31 +47,41 @@ namespace l1menu
 
 bool l1menu::triggers::SingleJetCentral_v0::apply( const l1menu::L1TriggerDPGEvent& event ) const
 {
-	const L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
 	const bool* PhysicsBits=event.physicsBits();
 
 	bool raw = PhysicsBits[0];  // ZeroBias
 	if (! raw) return false;
 
-	bool ok=false;
-	int Nj = analysisDataFormat.Njet ;
-	for (int ue=0; ue < Nj; ue++) {
-		int bx = analysisDataFormat.Bxjet[ue];
-		if (bx != 0) continue;
-		bool isFwdJet = analysisDataFormat.Fwdjet[ue];
-		if (isFwdJet) continue;
-		bool isTauJet = analysisDataFormat.Taujet[ue];
-		if (isTauJet) continue;
-
-		float eta = analysisDataFormat.Etajet[ue];
-		if (eta < regionCut_ || eta > 21.-regionCut_) continue;  // eta = 5 - 16
-
-		float rank = analysisDataFormat.Etjet[ue];
-		float pt = rank; //CorrectedL1JetPtByGCTregions(analysisDataFormat.Etajet[ue],rank*4.,theL1JetCorrection);
-		if (pt >= threshold1_) ok = true;
+	// The central jets are sorted by Et, so only the highest one in the eta range needs checking
+	const l1menu::implementation::TriggerObjects::CaloObjects& jets=event.triggerObjects().centralJets;
+	const size_t index=l1menu::implementation::nextInRegion( jets, regionCut_ );
+
+	return index<jets.size() && jets.et[index]>=threshold1_;
+}
+
+bool l1menu::triggers::SingleJetCentral_v0::applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const
+{
+	if( !event.physicsBits()[0] ) return false; // ZeroBias
+
+	return event.derivedQuantities().passing( l1menu::implementation::DerivedQuantities::CaloCollection::CENTRAL_JETS, regionCut_ ).highest()>=threshold1_;
+}
+
+bool l1menu::triggers::SingleJetCentral_v0::calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const
+{
+	const bool* PhysicsBits=event.physicsBits();
+
+	// The threshold passes if it's at or below the Et of any of the central jets, and the first one in
+	// the eta range has the highest Et
+	float highestPt=-1;
+	if( PhysicsBits[0] )
+	{
+		const l1menu::implementation::TriggerObjects::CaloObjects& jets=event.triggerObjects().centralJets;
+		const size_t index=l1menu::implementation::nextInRegion( jets, regionCut_ );
+		if( index<jets.size() && jets.et[index]>highestPt ) highestPt=jets.et[index];
 	}
 
-	return ok;
+	pThresholds[0]=highestPt;
+	return true;
 }
 
 bool l1menu::triggers::SingleJetCentral_v0::thresholdsAreCorrelated() const
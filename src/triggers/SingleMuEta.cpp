@@ -5,7 +5,8 @@
 
 #include "l1menu/L1TriggerDPGEvent.h"
 #include "../implementation/RegisterTriggerMacro.h"
-#include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
+#include "../implementation/TriggerObjects.h"
+#include "../implementation/DerivedQuantities.h"
 
 
 namespace l1menu
@@ -45,34 +46,55 @@ namespace l1menu
 
 bool l1menu::triggers::SingleMuEta_v0::apply( const l1menu::L1TriggerDPGEvent& event ) const
 {
-	const L1Analysis::L1AnalysisDataFormat& analysisDataFormat=event.rawEvent();
 	const bool* PhysicsBits=event.physicsBits();
 
 	bool raw = PhysicsBits[0];   // ZeroBias
 	if (! raw) return false;
 
-	bool muon = false;
-
-	int Nmu = analysisDataFormat.Nmu;
-	for (int imu=0; imu < Nmu; imu++) {
-		int bx = analysisDataFormat.Bxmu.at(imu);
-		// This next comment line is copied from the original SingleIsoMuEta. It's commented out
-		// in that trigger which leaves SingleMuEta and SingleIsoMuEta the same. I've set up
-		// SingleIsoMuEta essentially as an alias for this trigger, but I'll leave this comment
-		// in for reference in case I ever have to add the functionality back. MG 05/Jun/2013.
-		//if (bx != 0 || !analysisDataFormat.Isomu.at(imu)) continue;
-		if (bx != 0) continue;
-		float pt = analysisDataFormat.Ptmu.at(imu);
-		int qual = analysisDataFormat.Qualmu.at(imu);
-		if ( qual < muonQuality_) continue;
-		float eta = analysisDataFormat.Etamu.at(imu);
-
-		if (std::fabs(eta) > etaCut_) continue;
-		if (pt >= threshold1_) muon = true;
+	// The original SingleIsoMuEta had a commented out requirement on the muon isolation, which left
+	// SingleMuEta and SingleIsoMuEta the same. I've set up SingleIsoMuEta essentially as an alias for
+	// this trigger, but I'll leave this comment in for reference in case I ever have to add the
+	// functionality back (with muons.isolated). MG 05/Jun/2013.
+	const l1menu::implementation::TriggerObjects::Muons& muons=event.triggerObjects().muons;
+	for( size_t index=0; index<muons.size(); ++index )
+	{
+		// The muons are sorted by pt, so the first one that passes the other cuts decides it
+		if( muons.quality[index]<muonQuality_ ) continue;
+		if( std::fabs(muons.eta[index])>etaCut_ ) continue;
+		return muons.pt[index]>=threshold1_;
+	}
+
+	return false;
+}
+
+bool l1menu::triggers::SingleMuEta_v0::applyUsingDerivedQuantities( const l1menu::L1TriggerDPGEvent& event ) const
+{
+	if( !event.physicsBits()[0] ) return false; // ZeroBias
+
+	return event.derivedQuantities().passingMuons( etaCut_, muonQuality_ ).highest()>=threshold1_;
+}
+
+bool l1menu::triggers::SingleMuEta_v0::calculateTightestThresholds( const l1menu::L1TriggerDPGEvent& event, float* pThresholds ) const
+{
+	const bool* PhysicsBits=event.physicsBits();
+
+	// The threshold passes if it's at or below the pt of any of the muons, and the first one that
+	// passes the other cuts has the highest pt
+	float highestPt=-1;
+	if( PhysicsBits[0] )
+	{
+		const l1menu::implementation::TriggerObjects::Muons& muons=event.triggerObjects().muons;
+		for( size_t index=0; index<muons.size(); ++index )
+		{
+			if( muons.quality[index]<muonQuality_ ) continue;
+			if( std::fabs(muons.eta[index])>etaCut_ ) continue;
+			highestPt=muons.pt[index];
+			break;
+		}
 	}
 
-	bool ok = muon;
-	return ok;
+	pThresholds[0]=highestPt;
+	return true;
 }
 
 bool l1menu::triggers::SingleMuEta_v0::thresholdsAreCorrelated() const
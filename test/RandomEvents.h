@@ -0,0 +1,90 @@
+#ifndef RandomEvents_h
+#define RandomEvents_h
+
+#include <random>
+#include "l1menu/L1TriggerDPGEvent.h"
+#include "UserCode/L1TriggerUpgrade/interface/L1AnalysisDataFormat.h"
+
+
+/** @brief Fills the event with a random number of random objects, for test suites that need events without an input file.
+ *
+ * Calorimeter Ets are on the jet and EG step sizes, objects are sometimes at the same position so that
+ * the cross triggers' checks for the same object get tested, and the occasional event fails ZeroBias.
+ * The weight is set to one.
+ */
+inline void randomiseEvent( l1menu::L1TriggerDPGEvent& event, std::mt19937& randomGenerator )
+{
+	std::uniform_int_distribution<int> numberOfObjects( 0, 8 );
+	std::uniform_int_distribution<int> bunchCrossing( -1, 1 );
+	std::uniform_int_distribution<int> region( 0, 21 );
+	std::uniform_int_distribution<int> phi( 0, 17 );
+	std::uniform_int_distribution<int> muonQuality( 0, 7 );
+	std::uniform_int_distribution<int> coinFlip( 0, 1 );
+	std::uniform_int_distribution<int> calorimeterEt( 0, 60 ); // In units of the jet and EG step sizes below
+	std::uniform_real_distribution<float> muonPt( 0, 140 );
+	std::uniform_real_distribution<float> muonEta( -2.5, 2.5 );
+	std::uniform_real_distribution<float> energySum( 0, 500 );
+
+	L1Analysis::L1AnalysisDataFormat& rawEvent=event.rawEvent();
+
+	rawEvent.Nele=numberOfObjects( randomGenerator );
+	rawEvent.Bxel.clear(); rawEvent.Etel.clear(); rawEvent.Phiel.clear(); rawEvent.Etael.clear(); rawEvent.Isoel.clear();
+	for( int index=0; index<rawEvent.Nele; ++index )
+	{
+		rawEvent.Bxel.push_back( bunchCrossing(randomGenerator) );
+		rawEvent.Etel.push_back( calorimeterEt(randomGenerator) );
+		rawEvent.Phiel.push_back( phi(randomGenerator) );
+		rawEvent.Etael.push_back( region(randomGenerator) );
+		rawEvent.Isoel.push_back( coinFlip(randomGenerator) );
+	}
+
+	rawEvent.Njet=numberOfObjects( randomGenerator )*2;
+	rawEvent.Bxjet.clear(); rawEvent.Etjet.clear(); rawEvent.Phijet.clear(); rawEvent.Etajet.clear();
+	rawEvent.Taujet.clear(); rawEvent.isoTaujet.clear(); rawEvent.Fwdjet.clear();
+	for( int index=0; index<rawEvent.Njet; ++index )
+	{
+		rawEvent.Bxjet.push_back( bunchCrossing(randomGenerator) );
+		rawEvent.Etjet.push_back( calorimeterEt(randomGenerator)*4 );
+		// Use the same positions as the EG objects some of the time, so that the checks
+		// for the same object in the cross triggers get tested.
+		if( index<rawEvent.Nele && coinFlip(randomGenerator) )
+		{
+			rawEvent.Phijet.push_back( rawEvent.Phiel[index] );
+			rawEvent.Etajet.push_back( rawEvent.Etael[index] );
+		}
+		else
+		{
+			rawEvent.Phijet.push_back( phi(randomGenerator) );
+			rawEvent.Etajet.push_back( region(randomGenerator) );
+		}
+		rawEvent.Taujet.push_back( coinFlip(randomGenerator) );
+		rawEvent.isoTaujet.push_back( rawEvent.Taujet.back() && coinFlip(randomGenerator) );
+		rawEvent.Fwdjet.push_back( !rawEvent.Taujet.back() && coinFlip(randomGenerator) && coinFlip(randomGenerator) );
+	}
+
+	rawEvent.Nmu=numberOfObjects( randomGenerator )/2;
+	rawEvent.Bxmu.clear(); rawEvent.Ptmu.clear(); rawEvent.Phimu.clear(); rawEvent.Etamu.clear(); rawEvent.Qualmu.clear(); rawEvent.Isomu.clear();
+	for( int index=0; index<rawEvent.Nmu; ++index )
+	{
+		rawEvent.Bxmu.push_back( bunchCrossing(randomGenerator) );
+		rawEvent.Ptmu.push_back( muonPt(randomGenerator) );
+		rawEvent.Phimu.push_back( phi(randomGenerator) );
+		rawEvent.Etamu.push_back( muonEta(randomGenerator) );
+		rawEvent.Qualmu.push_back( muonQuality(randomGenerator) );
+		rawEvent.Isomu.push_back( coinFlip(randomGenerator) );
+	}
+
+	rawEvent.ETT=energySum( randomGenerator );
+	rawEvent.ETM=energySum( randomGenerator );
+	rawEvent.HTT=energySum( randomGenerator );
+	rawEvent.HTM=energySum( randomGenerator );
+
+	// Everything is ZeroBias apart from the occasional event, so that failing that is tested too
+	bool* physicsBits=event.physicsBits();
+	for( size_t bitNumber=0; bitNumber<128; ++bitNumber ) physicsBits[bitNumber]=true;
+	physicsBits[0]=( std::uniform_int_distribution<int>(0,19)(randomGenerator)!=0 );
+
+	event.setWeight( 1 );
+}
+
+#endif
@@ -0,0 +1,752 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include <vector>
+#include <string>
+#include "l1menu/FullSample.h"
+#include "l1menu/L1TriggerDPGEvent.h"
+
+//
+// Forward definitions
+//
+namespace l1menu
+{
+	class TriggerMenu;
+	class ReducedSample;
+}
+
+/** @brief A cppunit TestFixture to test creating, saving, loading and extending ReducedSamples, and the other samples
+ * that they're made from or used with (ObjectCacheSample, StreamingReducedSample and SubSample).
+ *
+ * Uses randomly generated events saved as an ObjectCacheSample, so that no input files are needed.
+ */
+class ReducedSampleUnitTestSuite : public CPPUNIT_NS::TestFixture
+{
+	CPPUNIT_TEST_SUITE(ReducedSampleUnitTestSuite);
+	CPPUNIT_TEST(testObjectCacheRoundTrip);
+	CPPUNIT_TEST(testSaveAndLoadEveryFormat);
+	CPPUNIT_TEST(testPackingColumnsWithManyValues);
+	CPPUNIT_TEST(testLoadingProjection);
+	CPPUNIT_TEST(testMergingFiles);
+	CPPUNIT_TEST(testMismatchedSamplesRejected);
+	CPPUNIT_TEST(testMixingExactAndBisectionRejected);
+	CPPUNIT_TEST(testExtendingOldBisectionSample);
+	CPPUNIT_TEST(testStreamingMatchesLoadedSample);
+	CPPUNIT_TEST(testSubSampleWeights);
+	CPPUNIT_TEST_SUITE_END();
+
+protected:
+	l1menu::FullSample emptySample_; ///< @brief Only required because events need a parent sample
+	std::vector<l1menu::L1TriggerDPGEvent> events_;
+	std::string objectCacheFilename_; ///< @brief Where events_ are saved as an ObjectCacheSample
+	std::string weightedObjectCacheFilename_; ///< @brief The same events as objectCacheFilename_, but with random weights
+	std::vector<std::string> temporaryFilenames_; ///< @brief Everything in here is deleted by tearDown
+public:
+	ReducedSampleUnitTestSuite();
+	void setUp();
+	void tearDown();
+
+protected:
+	void testObjectCacheRoundTrip();
+	void testSaveAndLoadEveryFormat();
+	void testPackingColumnsWithManyValues();
+	void testLoadingProjection();
+	void testMergingFiles();
+	void testMismatchedSamplesRejected();
+	void testMixingExactAndBisectionRejected();
+	void testExtendingOldBisectionSample();
+	void testStreamingMatchesLoadedSample();
+	void testSubSampleWeights();
+
+	/** @brief A menu with a mixture of single object, multi object, energy sum and cross triggers. */
+	static l1menu::TriggerMenu testMenu();
+
+	/** @brief Adds weighted random events to the sample, for when more are needed than is sensible to keep in events_. */
+	void addRandomEvents( l1menu::ReducedSample& sample, size_t numberOfEvents, unsigned int seed );
+	/** @brief Gives a filename in the current directory, that will be deleted after the test. */
+	std::string temporaryFilename( const std::string& name );
+	/** @brief Writes events_ to a version 1 file the way samples were made before the exact thresholds, i.e. all by bisection. */
+	void writeOldBisectionSample( const l1menu::TriggerMenu& menu, const std::string& filename );
+	/** @brief Checks that the thresholds of every trigger in the menu are identical, bit for bit, in both samples. */
+	static void checkThresholdsMatch( const l1menu::TriggerMenu& menu, const l1menu::ReducedSample& sample, const l1menu::ReducedSample& expectedSample, const std::string& description="" );
+	/** @brief Checks that the samples have the same triggers, and exactly the same weights and thresholds for every event. */
+	static void checkSamplesIdentical( const l1menu::ReducedSample& sample, const l1menu::ReducedSample& expectedSample, const std::string& description );
+};
+
+
+
+
+
+#include <cppunit/config/SourcePrefix.h>
+#include <stdexcept>
+#include <random>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include "l1menu/ReducedSample.h"
+#include "l1menu/ReducedEvent.h"
+#include "l1menu/ObjectCacheSample.h"
+#include "l1menu/StreamingReducedSample.h"
+#include "l1menu/SubSample.h"
+#include "l1menu/ICachedTrigger.h"
+#include "l1menu/IMenuRate.h"
+#include "l1menu/ITriggerRate.h"
+#include "l1menu/TriggerMenu.h"
+#include "l1menu/ITrigger.h"
+#include "l1menu/tools/miscellaneous.h"
+#include "implementation/ReducedSampleFileFormat.h"
+#include "protobuf/l1menu.pb.h"
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/io/gzip_stream.h>
+#include <google/protobuf/io/coded_stream.h>
+#include "RandomEvents.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ReducedSampleUnitTestSuite);
+
+ReducedSampleUnitTestSuite::ReducedSampleUnitTestSuite()
+{
+	// No operation
+}
+
+void ReducedSampleUnitTestSuite::setUp()
+{
+	// Use a fixed seed so that the test is the same every time
+	std::mt19937 randomGenerator( 2013 );
+	l1menu::L1TriggerDPGEvent event( emptySample_ );
+	events_.clear();
+	for( size_t eventNumber=0; eventNumber<300; ++eventNumber )
+	{
+		randomiseEvent( event, randomGenerator );
+		events_.push_back( event );
+	}
+
+	objectCacheFilename_=temporaryFilename( "events.l1objects" );
+	l1menu::ObjectCacheSample::convert( events_, objectCacheFilename_ );
+
+	std::vector<l1menu::L1TriggerDPGEvent> weightedEvents( events_ );
+	std::uniform_real_distribution<float> weight( 0.5, 2 );
+	for( auto& event : weightedEvents ) event.setWeight( weight(randomGenerator) );
+	weightedObjectCacheFilename_=temporaryFilename( "weightedEvents.l1objects" );
+	l1menu::ObjectCacheSample::convert( weightedEvents, weightedObjectCacheFilename_ );
+}
+
+void ReducedSampleUnitTestSuite::tearDown()
+{
+	for( const auto& filename : temporaryFilenames_ ) std::remove( filename.c_str() );
+	temporaryFilenames_.clear();
+}
+
+void ReducedSampleUnitTestSuite::testObjectCacheRoundTrip()
+{
+	// Fill in the things randomiseEvent doesn't, so that every field in the file gets checked
+	std::mt19937 randomGenerator( 2016 );
+	std::uniform_int_distribution<int> coinFlip( 0, 1 );
+	std::uniform_real_distribution<float> phi( -3.2, 3.2 );
+	std::uniform_real_distribution<float> weight( 0.5, 2 );
+	std::vector<l1menu::L1TriggerDPGEvent> events( events_ );
+	double expectedSumOfWeights=0;
+	for( size_t eventNumber=0; eventNumber<events.size(); ++eventNumber )
+	{
+		l1menu::L1TriggerDPGEvent& event=events[eventNumber];
+		L1Analysis::L1AnalysisDataFormat& rawEvent=event.rawEvent();
+		rawEvent.Run=208307+eventNumber/100;
+		rawEvent.LS=eventNumber/10;
+		rawEvent.Event=123456789+eventNumber;
+		rawEvent.PhiETM=phi( randomGenerator );
+		rawEvent.PhiHTM=phi( randomGenerator );
+		rawEvent.OvETT=coinFlip( randomGenerator );
+		rawEvent.OvETM=coinFlip( randomGenerator );
+		rawEvent.OvHTT=coinFlip( randomGenerator );
+		rawEvent.OvHTM=coinFlip( randomGenerator );
+		for( size_t bitNumber=1; bitNumber<128; ++bitNumber ) event.physicsBits()[bitNumber]=coinFlip( randomGenerator );
+		event.setWeight( weight(randomGenerator) );
+		expectedSumOfWeights+=event.weight();
+	}
+
+	const std::string filename=temporaryFilename( "roundTrip.l1objects" );
+	l1menu::ObjectCacheSample::convert( events, filename );
+	CPPUNIT_ASSERT( l1menu::ObjectCacheSample::isObjectCacheFile( filename ) );
+	l1menu::ObjectCacheSample sample( filename );
+	CPPUNIT_ASSERT_EQUAL( events.size(), sample.numberOfEvents() );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( expectedSumOfWeights, sample.sumOfWeights(), expectedSumOfWeights*1e-6 );
+
+	auto checkEvent=[&]( size_t eventNumber, const l1menu::L1TriggerDPGEvent& event )
+	{
+		const std::string description="event "+std::to_string(eventNumber);
+		const l1menu::L1TriggerDPGEvent& expectedEvent=events[eventNumber];
+		const L1Analysis::L1AnalysisDataFormat& expected=expectedEvent.rawEvent();
+		const L1Analysis::L1AnalysisDataFormat& raw=event.rawEvent();
+		CPPUNIT_ASSERT_EQUAL_MESSAGE( description, expectedEvent.weight(), event.weight() );
+		CPPUNIT_ASSERT_MESSAGE( description+" run, lumi section and event", expected.Run==raw.Run && expected.LS==raw.LS && expected.Event==raw.Event );
+		CPPUNIT_ASSERT_MESSAGE( description+" energy sums", expected.ETT==raw.ETT && expected.ETM==raw.ETM && expected.PhiETM==raw.PhiETM
+				&& expected.HTT==raw.HTT && expected.HTM==raw.HTM && expected.PhiHTM==raw.PhiHTM );
+		CPPUNIT_ASSERT_MESSAGE( description+" overflow flags", expected.OvETT==raw.OvETT && expected.OvETM==raw.OvETM && expected.OvHTT==raw.OvHTT && expected.OvHTM==raw.OvHTM );
+		CPPUNIT_ASSERT_MESSAGE( description+" physics bits", std::equal( expectedEvent.physicsBits(), expectedEvent.physicsBits()+128, event.physicsBits() ) );
+		CPPUNIT_ASSERT_MESSAGE( description+" EG", expected.Nele==raw.Nele && expected.Etel==raw.Etel && expected.Etael==raw.Etael
+				&& expected.Phiel==raw.Phiel && expected.Bxel==raw.Bxel && expected.Isoel==raw.Isoel );
+		CPPUNIT_ASSERT_MESSAGE( description+" jets", expected.Njet==raw.Njet && expected.Etjet==raw.Etjet && expected.Etajet==raw.Etajet
+				&& expected.Phijet==raw.Phijet && expected.Bxjet==raw.Bxjet && expected.Taujet==raw.Taujet
+				&& expected.isoTaujet==raw.isoTaujet && expected.Fwdjet==raw.Fwdjet );
+		CPPUNIT_ASSERT_MESSAGE( description+" muons", expected.Nmu==raw.Nmu && expected.Ptmu==raw.Ptmu && expected.Etamu==raw.Etamu
+				&& expected.Phimu==raw.Phimu && expected.Bxmu==raw.Bxmu && expected.Qualmu==raw.Qualmu && expected.Isomu==raw.Isomu );
+	};
+
+	// Random access, including going backwards, and then a pass in order
+	for( const size_t eventNumber : { 150, 0, 299, 3 } ) checkEvent( eventNumber, sample.getFullEvent( eventNumber ) );
+	size_t eventNumber=0;
+	sample.forEachFullEvent( 0, sample.numberOfEvents(), [&]( const l1menu::L1TriggerDPGEvent& event ) { checkEvent( eventNumber++, event ); } );
+	CPPUNIT_ASSERT_EQUAL( events.size(), eventNumber );
+}
+
+void ReducedSampleUnitTestSuite::testSaveAndLoadEveryFormat()
+{
+	struct Format
+	{
+		std::string name;
+		unsigned int fileFormatVersion;
+		l1menu::ReducedSample::Codec codec;
+	};
+	const std::vector<Format> formats={
+		{ "v1 gzip", 1, l1menu::ReducedSample::Codec::GZIP },
+		{ "v2 columnar", 2, l1menu::ReducedSample::Codec::GZIP },
+		{ "v3 gzip", 3, l1menu::ReducedSample::Codec::GZIP },
+		{ "v3 none", 3, l1menu::ReducedSample::Codec::NONE },
+		{ "v3 zstd", 3, l1menu::ReducedSample::Codec::ZSTD },
+		{ "v3 lz4", 3, l1menu::ReducedSample::Codec::LZ4 },
+		{ "v4 packed", 4, l1menu::ReducedSample::Codec::GZIP } };
+
+	l1menu::ObjectCacheSample originalSample( weightedObjectCacheFilename_ );
+	l1menu::ReducedSample sample( originalSample, testMenu() );
+	const std::string filename=temporaryFilename( "saved.proto" );
+
+	for( const auto& format : formats )
+	{
+		// zstd and lz4 are optional, so builds without them should refuse to write them
+		if( !l1menu::ReducedSample::codecIsAvailable( format.codec ) )
+		{
+			CPPUNIT_ASSERT_THROW_MESSAGE( format.name, sample.saveToFile( filename, format.fileFormatVersion, 2, format.codec ), std::runtime_error );
+			continue;
+		}
+
+		sample.saveToFile( filename, format.fileFormatVersion, 2, format.codec );
+		checkSamplesIdentical( l1menu::ReducedSample( filename, 1 ), sample, format.name+" loaded with one thread" );
+		checkSamplesIdentical( l1menu::ReducedSample( filename, 3 ), sample, format.name+" loaded with three threads" );
+	}
+
+	// The codec can only be chosen for version 3
+	CPPUNIT_ASSERT_THROW( sample.saveToFile( filename, 4, 1, l1menu::ReducedSample::Codec::NONE ), std::runtime_error );
+}
+
+void ReducedSampleUnitTestSuite::testPackingColumnsWithManyValues()
+{
+	// The ETM threshold is just the ETM of the event, and the weights are random, so with this many events
+	// both columns have more values than a uint16 can index and have to be stored as floats. SingleEG only
+	// has a few values so is packed. Both have -1 ("never passes") for the events that fail ZeroBias.
+	l1menu::TriggerMenu menu;
+	menu.addTrigger( "L1_ETM" );
+	menu.addTrigger( "L1_SingleEG" );
+	l1menu::ReducedSample sample( menu );
+	addRandomEvents( sample, 70000, 2014 );
+
+	// Make sure the sample really does test what it's meant to
+	for( size_t triggerNumber=0; triggerNumber<menu.numberOfTriggers(); ++triggerNumber )
+	{
+		const l1menu::ITrigger& trigger=menu.getTrigger(triggerNumber);
+		const l1menu::ReducedEvent::ParameterID identifier=sample.getTriggerParameterIdentifiers( trigger ).at( "threshold1" );
+		std::vector<float> values;
+		size_t numberOfNeverPasses=0;
+		for( size_t eventNumber=0; eventNumber<sample.numberOfEvents(); ++eventNumber )
+		{
+			values.push_back( static_cast<const l1menu::ReducedEvent&>( sample.getEvent(eventNumber) ).parameterValue( identifier ) );
+			if( values.back()==-1 ) ++numberOfNeverPasses;
+		}
+		std::sort( values.begin(), values.end() );
+		const size_t numberOfValues=std::unique( values.begin(), values.end() )-values.begin();
+		CPPUNIT_ASSERT_MESSAGE( trigger.name()+" should have some events that never pass", numberOfNeverPasses>0 );
+		if( trigger.name()=="L1_ETM" ) CPPUNIT_ASSERT_MESSAGE( "L1_ETM should have too many values to pack", numberOfValues>65536 );
+		else CPPUNIT_ASSERT_MESSAGE( trigger.name()+" should have few enough values to pack", numberOfValues<=65536 );
+	}
+	std::vector<float> weights;
+	for( size_t eventNumber=0; eventNumber<sample.numberOfEvents(); ++eventNumber ) weights.push_back( sample.getEvent(eventNumber).weight() );
+	std::sort( weights.begin(), weights.end() );
+	CPPUNIT_ASSERT_MESSAGE( "The weights should have too many values to pack", std::unique( weights.begin(), weights.end() )-weights.begin()>65536 );
+
+	const std::string filename=temporaryFilename( "packed.proto" );
+	sample.saveToFile( filename, 4, 2 );
+	checkSamplesIdentical( l1menu::ReducedSample( filename ), sample, "v4 with too many values to pack" );
+
+	// Loading just one of the columns shouldn't make a difference either
+	l1menu::TriggerMenu projection;
+	projection.addTrigger( "L1_ETM" );
+	checkThresholdsMatch( projection, l1menu::ReducedSample( filename, projection ), sample, "v4 projected onto L1_ETM" );
+}
+
+void ReducedSampleUnitTestSuite::testLoadingProjection()
+{
+	l1menu::ObjectCacheSample originalSample( weightedObjectCacheFilename_ );
+	l1menu::ReducedSample sample( originalSample, testMenu() );
+
+	// Columns that aren't next to each other in the file, in a different order
+	l1menu::TriggerMenu submenu;
+	submenu.addTrigger( "L1_isoEG_EG" );
+	submenu.addTrigger( "L1_DoubleJet" );
+	std::shared_ptr<const l1menu::IMenuRate> expectedRate=sample.rate( submenu );
+
+	const std::string filename=temporaryFilename( "projected.proto" );
+	for( const unsigned int fileFormatVersion : { 1, 2, 3, 4 } )
+	{
+		const std::string description="file format version "+std::to_string(fileFormatVersion);
+		sample.saveToFile( filename, fileFormatVersion );
+		l1menu::ReducedSample projectedSample( filename, submenu );
+		CPPUNIT_ASSERT_EQUAL_MESSAGE( description, submenu.numberOfTriggers(), projectedSample.getTriggerMenu().numberOfTriggers() );
+		CPPUNIT_ASSERT_EQUAL_MESSAGE( description, sample.numberOfEvents(), projectedSample.numberOfEvents() );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( description, sample.sumOfWeights(), projectedSample.sumOfWeights(), sample.sumOfWeights()*1e-6 );
+		checkThresholdsMatch( submenu, projectedSample, sample, description );
+
+		// The rates of the submenu should be exactly the same as from the whole sample
+		std::shared_ptr<const l1menu::IMenuRate> rate=projectedSample.rate( submenu );
+		CPPUNIT_ASSERT_EQUAL_MESSAGE( description, expectedRate->totalFraction(), rate->totalFraction() );
+		for( size_t triggerNumber=0; triggerNumber<submenu.numberOfTriggers(); ++triggerNumber )
+		{
+			const std::string triggerDescription=description+", "+submenu.getTrigger(triggerNumber).name();
+			CPPUNIT_ASSERT_EQUAL_MESSAGE( triggerDescription, expectedRate->triggerRates()[triggerNumber]->fraction(), rate->triggerRates()[triggerNumber]->fraction() );
+			CPPUNIT_ASSERT_EQUAL_MESSAGE( triggerDescription, expectedRate->triggerRates()[triggerNumber]->pureFraction(), rate->triggerRates()[triggerNumber]->pureFraction() );
+		}
+
+		// Triggers that aren't in the file, or are but with different parameters, can't be projected onto
+		l1menu::TriggerMenu missingTrigger( submenu );
+		missingTrigger.addTrigger( "L1_ETM" );
+		CPPUNIT_ASSERT_THROW_MESSAGE( description, l1menu::ReducedSample( filename, missingTrigger ), std::runtime_error );
+		l1menu::TriggerMenu differentCuts( submenu );
+		differentCuts.getTrigger(1).parameter("regionCut")=2.5;
+		CPPUNIT_ASSERT_THROW_MESSAGE( description, l1menu::ReducedSample( filename, differentCuts ), std::runtime_error );
+	}
+}
+
+void ReducedSampleUnitTestSuite::testMergingFiles()
+{
+	const l1menu::TriggerMenu menu=testMenu();
+	l1menu::ObjectCacheSample originalSample( weightedObjectCacheFilename_ );
+	l1menu::ReducedSample wholeSample( originalSample, menu );
+
+	// Split the events into parts saved in different formats. The v3 gzip part can have its Runs copied
+	// straight into a gzip output, the others have to be loaded and compressed again.
+	struct Part
+	{
+		size_t firstEventNumber;
+		size_t lastEventNumber;
+		unsigned int fileFormatVersion;
+	};
+	const std::vector<Part> parts={ { 0, 100, 3 }, { 100, 220, 4 }, { 220, events_.size(), 1 } };
+	std::vector<std::string> partFilenames;
+	l1menu::ReducedSample expectedSample( menu );
+	for( const auto& part : parts )
+	{
+		l1menu::ReducedSample partSample( menu );
+		partSample.addSample( originalSample, part.firstEventNumber, part.lastEventNumber );
+		partFilenames.push_back( temporaryFilename( "part"+std::to_string(partFilenames.size())+".proto" ) );
+		partSample.saveToFile( partFilenames.back(), part.fileFormatVersion );
+		expectedSample.addSample( partSample );
+	}
+	// Putting the parts back together in memory should give the original
+	checkSamplesIdentical( expectedSample, wholeSample, "parts added together" );
+
+	const std::string mergedFilename=temporaryFilename( "merged.proto" );
+	for( const auto codec : { l1menu::ReducedSample::Codec::GZIP, l1menu::ReducedSample::Codec::NONE, l1menu::ReducedSample::Codec::ZSTD } )
+	{
+		const std::string description="merged with codec "+std::to_string(static_cast<int>(codec));
+		if( !l1menu::ReducedSample::codecIsAvailable( codec ) )
+		{
+			CPPUNIT_ASSERT_THROW_MESSAGE( description, l1menu::ReducedSample::mergeFiles( partFilenames, mergedFilename, codec ), std::runtime_error );
+			continue;
+		}
+		l1menu::ReducedSample::mergeFiles( partFilenames, mergedFilename, codec, 2 );
+		checkSamplesIdentical( l1menu::ReducedSample( mergedFilename ), expectedSample, description );
+	}
+}
+
+void ReducedSampleUnitTestSuite::testMismatchedSamplesRejected()
+{
+	const l1menu::TriggerMenu menu=testMenu();
+	l1menu::ObjectCacheSample originalSample( objectCacheFilename_ );
+	l1menu::ReducedSample sample( originalSample, menu );
+	const std::string filename=temporaryFilename( "sample.proto" );
+	sample.saveToFile( filename );
+
+	// One trigger fewer, and the same triggers with a different region cut
+	l1menu::TriggerMenu fewerTriggers;
+	for( size_t triggerNumber=0; triggerNumber+1<menu.numberOfTriggers(); ++triggerNumber ) fewerTriggers.addTrigger( menu.getTrigger(triggerNumber) );
+	l1menu::TriggerMenu differentCuts( menu );
+	differentCuts.getTrigger(0).parameter("regionCut")=2.5;
+
+	const std::string mergedFilename=temporaryFilename( "merged.proto" );
+	for( const auto& otherMenu : { fewerTriggers, differentCuts } )
+	{
+		l1menu::ReducedSample otherSample( originalSample, otherMenu );
+		const std::string otherFilename=temporaryFilename( "otherSample.proto" );
+		otherSample.saveToFile( otherFilename );
+
+		l1menu::ReducedSample copy( filename );
+		CPPUNIT_ASSERT_THROW( copy.addSample( otherSample ), std::runtime_error );
+		CPPUNIT_ASSERT_THROW( otherSample.addSample( copy ), std::runtime_error );
+		// A failed addSample shouldn't have changed anything
+		checkSamplesIdentical( copy, sample, "after a rejected addSample" );
+
+		const std::vector<std::string> inputFilenames={ filename, otherFilename };
+		CPPUNIT_ASSERT_THROW( l1menu::ReducedSample::mergeFiles( inputFilenames, mergedFilename ), std::runtime_error );
+		// The output isn't finished, so it shouldn't be possible to load it
+		CPPUNIT_ASSERT_THROW( l1menu::ReducedSample{ mergedFilename }, std::runtime_error );
+	}
+}
+
+void ReducedSampleUnitTestSuite::testMixingExactAndBisectionRejected()
+{
+	// Same triggers and events, but one has exact thresholds and the other is how older versions did it
+	l1menu::TriggerMenu menu;
+	menu.addTrigger( "L1_SingleEG" );
+	menu.addTrigger( "L1_DoubleJet" );
+	l1menu::ObjectCacheSample originalSample( objectCacheFilename_ );
+	const std::string exactFilename=temporaryFilename( "exact.proto" );
+	l1menu::ReducedSample( originalSample, menu ).saveToFile( exactFilename );
+	const std::string bisectionFilename=temporaryFilename( "oldBisection.proto" );
+	writeOldBisectionSample( menu, bisectionFilename );
+
+	l1menu::ReducedSample exactSample( exactFilename );
+	l1menu::ReducedSample bisectionSample( bisectionFilename );
+	CPPUNIT_ASSERT_THROW( exactSample.addSample( bisectionSample ), std::runtime_error );
+	CPPUNIT_ASSERT_THROW( bisectionSample.addSample( exactSample ), std::runtime_error );
+
+	const std::string mergedFilename=temporaryFilename( "merged.proto" );
+	const std::vector<std::string> exactFirst={ exactFilename, bisectionFilename };
+	const std::vector<std::string> bisectionFirst={ bisectionFilename, exactFilename };
+	CPPUNIT_ASSERT_THROW( l1menu::ReducedSample::mergeFiles( exactFirst, mergedFilename ), std::runtime_error );
+	CPPUNIT_ASSERT_THROW( l1menu::ReducedSample::mergeFiles( bisectionFirst, mergedFilename ), std::runtime_error );
+
+	// Samples made the same way can still be put together
+	l1menu::ReducedSample anotherBisectionSample( bisectionFilename );
+	CPPUNIT_ASSERT_NO_THROW( bisectionSample.addSample( anotherBisectionSample ) );
+	CPPUNIT_ASSERT_EQUAL( 2*events_.size(), bisectionSample.numberOfEvents() );
+}
+
+void ReducedSampleUnitTestSuite::testExtendingOldBisectionSample()
+{
+	l1menu::TriggerMenu oldMenu;
+	oldMenu.addTrigger( "L1_SingleEG" );
+	oldMenu.addTrigger( "L1_DoubleJet" );
+	const std::string oldSampleFilename=temporaryFilename( "oldBisection.proto" );
+	writeOldBisectionSample( oldMenu, oldSampleFilename );
+
+	l1menu::TriggerMenu newTriggers;
+	newTriggers.addTrigger( "L1_SingleMu" );
+	l1menu::ObjectCacheSample originalSample( objectCacheFilename_ );
+
+	// The triggers already in the sample are recalculated to check the events are the same. They're only
+	// within the tolerance of the bisection, so this used to fail on the first event.
+	l1menu::ReducedSample sample( oldSampleFilename );
+	CPPUNIT_ASSERT_NO_THROW( sample.addTriggerColumns( originalSample, newTriggers ) );
+	CPPUNIT_ASSERT_EQUAL( events_.size(), sample.numberOfEvents() );
+
+	// The new trigger should get the same thresholds as it would in a new sample, and the old
+	// ones shouldn't have changed.
+	l1menu::ReducedSample expectedNewSample( originalSample, newTriggers );
+	checkThresholdsMatch( newTriggers, sample, expectedNewSample );
+	l1menu::ReducedSample unchangedSample( oldSampleFilename );
+	checkThresholdsMatch( oldMenu, sample, unchangedSample );
+
+	// The same events in a different order aren't the ones the sample was made from. The weights
+	// are all the same, so only the thresholds can tell.
+	std::vector<l1menu::L1TriggerDPGEvent> reversedEvents( events_.rbegin(), events_.rend() );
+	const std::string reversedFilename=temporaryFilename( "reversedEvents.l1objects" );
+	l1menu::ObjectCacheSample::convert( reversedEvents, reversedFilename );
+	l1menu::ObjectCacheSample reversedSample( reversedFilename );
+	l1menu::ReducedSample anotherSample( oldSampleFilename );
+	CPPUNIT_ASSERT_THROW( anotherSample.addTriggerColumns( reversedSample, newTriggers ), std::runtime_error );
+}
+
+void ReducedSampleUnitTestSuite::testStreamingMatchesLoadedSample()
+{
+	// Enough events for more than one Run in the file, so that going backwards has to start a new pass
+	const l1menu::TriggerMenu menu=testMenu();
+	l1menu::ReducedSample sample( menu );
+	addRandomEvents( sample, 45000, 2015 );
+
+	for( const unsigned int fileFormatVersion : { 1, 3 } )
+	{
+		const std::string description="file format version "+std::to_string(fileFormatVersion);
+		const std::string filename=temporaryFilename( "streamed.proto" );
+		sample.saveToFile( filename, fileFormatVersion );
+		l1menu::StreamingReducedSample streamingSample( filename );
+		CPPUNIT_ASSERT_EQUAL_MESSAGE( description, sample.numberOfEvents(), streamingSample.numberOfEvents() );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( description, sample.sumOfWeights(), streamingSample.sumOfWeights(), sample.sumOfWeights()*1e-6 );
+
+		std::vector<std::unique_ptr<l1menu::ICachedTrigger> > cachedTriggers;
+		std::vector<std::unique_ptr<l1menu::ICachedTrigger> > streamingCachedTriggers;
+		for( size_t triggerNumber=0; triggerNumber<menu.numberOfTriggers(); ++triggerNumber )
+		{
+			cachedTriggers.push_back( sample.createCachedTrigger( menu.getTrigger(triggerNumber) ) );
+			streamingCachedTriggers.push_back( streamingSample.createCachedTrigger( menu.getTrigger(triggerNumber) ) );
+		}
+		auto checkEvent=[&]( size_t eventNumber )
+		{
+			const std::string eventDescription=description+", event "+std::to_string(eventNumber);
+			const l1menu::IEvent& event=sample.getEvent( eventNumber );
+			const l1menu::IEvent& streamedEvent=streamingSample.getEvent( eventNumber );
+			CPPUNIT_ASSERT_EQUAL_MESSAGE( eventDescription, event.weight(), streamedEvent.weight() );
+			for( size_t triggerNumber=0; triggerNumber<cachedTriggers.size(); ++triggerNumber )
+			{
+				CPPUNIT_ASSERT_EQUAL_MESSAGE( eventDescription+", "+menu.getTrigger(triggerNumber).name(), cachedTriggers[triggerNumber]->apply( event ), streamingCachedTriggers[triggerNumber]->apply( streamedEvent ) );
+			}
+		};
+
+		// Two passes in order, then jumping back to an earlier Run, back again within the same Run, and forwards past a Run
+		for( size_t pass=0; pass<2; ++pass )
+		{
+			for( size_t eventNumber=0; eventNumber<sample.numberOfEvents(); ++eventNumber ) checkEvent( eventNumber );
+		}
+		for( const size_t eventNumber : { 30000, 5, 25000, 24000, 24001, 44999, 0 } ) checkEvent( eventNumber );
+
+		// The rates are calculated the same way for both, so should be the same
+		std::shared_ptr<const l1menu::IMenuRate> rate=sample.rate( menu );
+		std::shared_ptr<const l1menu::IMenuRate> streamedRate=streamingSample.rate( menu );
+		CPPUNIT_ASSERT_EQUAL_MESSAGE( description, rate->totalFraction(), streamedRate->totalFraction() );
+		for( size_t triggerNumber=0; triggerNumber<rate->triggerRates().size(); ++triggerNumber )
+		{
+			CPPUNIT_ASSERT_EQUAL_MESSAGE( description, rate->triggerRates()[triggerNumber]->fraction(), streamedRate->triggerRates()[triggerNumber]->fraction() );
+		}
+	}
+}
+
+void ReducedSampleUnitTestSuite::testSubSampleWeights()
+{
+	const l1menu::TriggerMenu menu=testMenu();
+	l1menu::ReducedSample unweightedSample( l1menu::ObjectCacheSample( objectCacheFilename_ ), menu );
+	l1menu::ReducedSample weightedSample( l1menu::ObjectCacheSample( weightedObjectCacheFilename_ ), menu );
+
+	// With all the weights one, every fourth event has to be scaled up by exactly four
+	l1menu::SubSample everyFourth( unweightedSample, 0.25, l1menu::SubSample::Method::STRIDE );
+	CPPUNIT_ASSERT_EQUAL( unweightedSample.numberOfEvents()/4, everyFourth.numberOfEvents() );
+	for( size_t eventNumber=0; eventNumber<everyFourth.numberOfEvents(); ++eventNumber ) CPPUNIT_ASSERT_EQUAL( 4*eventNumber, everyFourth.originalEventNumber(eventNumber) );
+	CPPUNIT_ASSERT_EQUAL( 4.0f, everyFourth.weightScale() );
+	CPPUNIT_ASSERT_EQUAL( 2.0f, everyFourth.statisticalErrorScale() );
+	CPPUNIT_ASSERT_EQUAL( 4.0f, everyFourth.getEvent(0).weight() );
+
+	struct SubSampleSettings
+	{
+		std::string name;
+		float fraction;
+		l1menu::SubSample::Method method;
+		unsigned int seed;
+	};
+	const std::vector<SubSampleSettings> settings={
+		{ "stride 0.3", 0.3, l1menu::SubSample::Method::STRIDE, 0 },
+		{ "random 0.3", 0.3, l1menu::SubSample::Method::RANDOM, 7 },
+		{ "random 0.5", 0.5, l1menu::SubSample::Method::RANDOM, 8 },
+		{ "stride 1", 1, l1menu::SubSample::Method::STRIDE, 0 },
+		{ "random 1", 1, l1menu::SubSample::Method::RANDOM, 9 } };
+	for( const auto& setting : settings )
+	{
+		l1menu::SubSample subSample( weightedSample, setting.fraction, setting.method, setting.seed );
+		CPPUNIT_ASSERT_MESSAGE( setting.name, subSample.numberOfEvents()>0 && subSample.numberOfEvents()<=weightedSample.numberOfEvents() );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( setting.name, static_cast<double>(subSample.numberOfEvents())/weightedSample.numberOfEvents(), subSample.fractionOfEvents(), 1e-6 );
+
+		// The scale has to be worked out from the weights of the events that were actually picked
+		double sumOfSelectedWeights=0;
+		double sumOfScaledWeights=0;
+		for( size_t eventNumber=0; eventNumber<subSample.numberOfEvents(); ++eventNumber )
+		{
+			const size_t originalEventNumber=subSample.originalEventNumber( eventNumber );
+			if( eventNumber>0 ) CPPUNIT_ASSERT_MESSAGE( setting.name+" events should be in order", originalEventNumber>subSample.originalEventNumber(eventNumber-1) );
+			const float originalWeight=weightedSample.getEvent( originalEventNumber ).weight();
+			const float weight=subSample.getEvent( eventNumber ).weight();
+			CPPUNIT_ASSERT_EQUAL_MESSAGE( setting.name, originalWeight*subSample.weightScale(), weight );
+			sumOfSelectedWeights+=originalWeight;
+			sumOfScaledWeights+=weight;
+		}
+		const double expectedWeightScale=weightedSample.sumOfWeights()/sumOfSelectedWeights;
+		CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( setting.name, expectedWeightScale, subSample.weightScale(), expectedWeightScale*1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( setting.name, std::sqrt(expectedWeightScale), subSample.statisticalErrorScale(), expectedWeightScale*1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( setting.name, weightedSample.sumOfWeights(), subSample.sumOfWeights(), weightedSample.sumOfWeights()*1e-6 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( setting.name, weightedSample.sumOfWeights(), sumOfScaledWeights, weightedSample.sumOfWeights()*1e-5 );
+
+		// The same seed has to give the same events
+		l1menu::SubSample sameSeed( weightedSample, setting.fraction, setting.method, setting.seed );
+		CPPUNIT_ASSERT_EQUAL_MESSAGE( setting.name, subSample.numberOfEvents(), sameSeed.numberOfEvents() );
+		for( size_t eventNumber=0; eventNumber<subSample.numberOfEvents(); ++eventNumber )
+		{
+			CPPUNIT_ASSERT_EQUAL_MESSAGE( setting.name, subSample.originalEventNumber(eventNumber), sameSeed.originalEventNumber(eventNumber) );
+		}
+
+		// Keeping every event shouldn't change anything
+		if( setting.fraction==1 )
+		{
+			CPPUNIT_ASSERT_EQUAL_MESSAGE( setting.name, weightedSample.numberOfEvents(), subSample.numberOfEvents() );
+			std::shared_ptr<const l1menu::IMenuRate> expectedRate=weightedSample.rate( menu );
+			std::shared_ptr<const l1menu::IMenuRate> rate=subSample.rate( menu );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( setting.name, expectedRate->totalFraction(), rate->totalFraction(), 1e-6 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( setting.name, expectedRate->totalFractionError(), rate->totalFractionError(), 1e-6 );
+		}
+	}
+
+	// Different seeds should pick different events
+	l1menu::SubSample firstSeed( weightedSample, 0.5, l1menu::SubSample::Method::RANDOM, 1 );
+	l1menu::SubSample secondSeed( weightedSample, 0.5, l1menu::SubSample::Method::RANDOM, 2 );
+	bool differenceFound=firstSeed.numberOfEvents()!=secondSeed.numberOfEvents();
+	for( size_t eventNumber=0; eventNumber<firstSeed.numberOfEvents() && !differenceFound; ++eventNumber )
+	{
+		differenceFound=( firstSeed.originalEventNumber(eventNumber)!=secondSeed.originalEventNumber(eventNumber) );
+	}
+	CPPUNIT_ASSERT( differenceFound );
+
+	CPPUNIT_ASSERT_THROW( l1menu::SubSample( weightedSample, 0 ), std::runtime_error );
+	CPPUNIT_ASSERT_THROW( l1menu::SubSample( weightedSample, 1.5 ), std::runtime_error );
+	CPPUNIT_ASSERT_THROW( l1menu::SubSample( weightedSample, std::nanf("") ), std::runtime_error );
+}
+
+l1menu::TriggerMenu ReducedSampleUnitTestSuite::testMenu()
+{
+	l1menu::TriggerMenu menu;
+	menu.addTrigger( "L1_SingleEG" );
+	menu.addTrigger( "L1_DoubleJet" );
+	menu.addTrigger( "L1_SingleMu" );
+	menu.addTrigger( "L1_HTM" );
+	menu.addTrigger( "L1_isoEG_EG" );
+	return menu;
+}
+
+void ReducedSampleUnitTestSuite::addRandomEvents( l1menu::ReducedSample& sample, size_t numberOfEvents, unsigned int seed )
+{
+	// Copies of L1TriggerDPGEvent are quite large, so the events are made in batches that are added together
+	const size_t eventsPerBatch=5000;
+	std::mt19937 randomGenerator( seed );
+	std::uniform_real_distribution<float> weight( 0.5, 2 );
+	l1menu::L1TriggerDPGEvent event( emptySample_ );
+	const std::string batchFilename=temporaryFilename( "batch.l1objects" );
+	std::vector<l1menu::L1TriggerDPGEvent> batch;
+	for( size_t eventsAdded=0; eventsAdded<numberOfEvents; eventsAdded+=batch.size() )
+	{
+		batch.clear();
+		for( size_t eventNumber=0; eventNumber<eventsPerBatch && eventsAdded+eventNumber<numberOfEvents; ++eventNumber )
+		{
+			randomiseEvent( event, randomGenerator );
+			event.setWeight( weight(randomGenerator) );
+			batch.push_back( event );
+		}
+		l1menu::ObjectCacheSample::convert( batch, batchFilename );
+		sample.addSample( l1menu::ReducedSample( l1menu::ObjectCacheSample( batchFilename ), sample.getTriggerMenu() ) );
+	}
+}
+
+std::string ReducedSampleUnitTestSuite::temporaryFilename( const std::string& name )
+{
+	temporaryFilenames_.push_back( "ReducedSampleUnitTestSuite_"+name+".tmp" );
+	return temporaryFilenames_.back();
+}
+
+void ReducedSampleUnitTestSuite::writeOldBisectionSample( const l1menu::TriggerMenu& menu, const std::string& filename )
+{
+	// The header is the same as now, except that exact_thresholds isn't set
+	l1menuprotobuf::SampleHeader header;
+	for( size_t triggerNumber=0; triggerNumber<menu.numberOfTriggers(); ++triggerNumber )
+	{
+		const l1menu::ITrigger& trigger=menu.getTrigger(triggerNumber);
+		l1menuprotobuf::Trigger* pProtobufTrigger=header.add_trigger();
+		pProtobufTrigger->set_name( trigger.name() );
+		pProtobufTrigger->set_version( trigger.version() );
+		for( const auto& parameterName : trigger.parameterNames() )
+		{
+			l1menuprotobuf::Trigger_TriggerParameter* pProtobufParameter=pProtobufTrigger->add_parameter();
+			pProtobufParameter->set_name( parameterName );
+			pProtobufParameter->set_value( trigger.parameter(parameterName) );
+		}
+		for( const auto& thresholdName : l1menu::tools::getThresholdNames(trigger) ) pProtobufTrigger->add_varying_parameter( thresholdName );
+	}
+
+	// Find every threshold by bisection on a fresh copy of the trigger, with -1 if it fails
+	l1menuprotobuf::Run run;
+	for( const auto& event : events_ )
+	{
+		l1menuprotobuf::Event* pProtobufEvent=run.add_event();
+		if( event.weight()!=1 ) pProtobufEvent->set_weight( event.weight() );
+		for( size_t triggerNumber=0; triggerNumber<menu.numberOfTriggers(); ++triggerNumber )
+		{
+			std::unique_ptr<l1menu::ITrigger> pTrigger=menu.getTriggerCopy(triggerNumber);
+			const std::vector<std::string> thresholdNames=l1menu::tools::getThresholdNames(*pTrigger);
+			try
+			{
+				l1menu::tools::setTriggerThresholdsAsTightAsPossible( event, *pTrigger, 0.001 );
+				for( const auto& thresholdName : thresholdNames ) pProtobufEvent->add_threshold( pTrigger->parameter(thresholdName) );
+			}
+			catch( std::exception& error )
+			{
+				for( size_t index=0; index<thresholdNames.size(); ++index ) pProtobufEvent->add_threshold( -1 );
+			}
+		}
+	}
+
+	// Version 1 files are the magic number and version uncompressed, then the gzipped header and runs,
+	// each preceded by its size. The oldest ones didn't have a footer.
+	int fileDescriptor=open( filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	CPPUNIT_ASSERT_MESSAGE( "Couldn't open "+filename+" for writing", fileDescriptor>=0 );
+	l1menu::implementation::UnixFileSentry fileSentry( fileDescriptor );
+	google::protobuf::io::FileOutputStream fileOutput( fileDescriptor );
+	{
+		google::protobuf::io::CodedOutputStream codedOutput( &fileOutput );
+		codedOutput.WriteString( l1menu::implementation::REDUCED_SAMPLE_MAGIC_NUMBER );
+		codedOutput.WriteVarint32( 1 );
+	}
+	{
+		google::protobuf::io::GzipOutputStream gzipOutput( &fileOutput );
+		google::protobuf::io::CodedOutputStream codedOutput( &gzipOutput );
+		codedOutput.WriteVarint64( header.ByteSize() );
+		header.SerializeToCodedStream( &codedOutput );
+		codedOutput.WriteVarint64( run.ByteSize() );
+		run.SerializeToCodedStream( &codedOutput );
+	}
+	CPPUNIT_ASSERT_MESSAGE( "Couldn't write "+filename, fileOutput.Flush() );
+}
+
+void ReducedSampleUnitTestSuite::checkThresholdsMatch( const l1menu::TriggerMenu& menu, const l1menu::ReducedSample& sample, const l1menu::ReducedSample& expectedSample, const std::string& description )
+{
+	CPPUNIT_ASSERT_EQUAL_MESSAGE( description, expectedSample.numberOfEvents(), sample.numberOfEvents() );
+	for( size_t triggerNumber=0; triggerNumber<menu.numberOfTriggers(); ++triggerNumber )
+	{
+		const l1menu::ITrigger& trigger=menu.getTrigger(triggerNumber);
+		const auto identifiers=sample.getTriggerParameterIdentifiers( trigger );
+		const auto expectedIdentifiers=expectedSample.getTriggerParameterIdentifiers( trigger );
+		for( size_t eventNumber=0; eventNumber<sample.numberOfEvents(); ++eventNumber )
+		{
+			for( const auto& thresholdName : l1menu::tools::getThresholdNames(trigger) )
+			{
+				// Get the expected value first, because the sample might reuse the same event
+				const float expectedValue=static_cast<const l1menu::ReducedEvent&>( expectedSample.getEvent(eventNumber) ).parameterValue( expectedIdentifiers.at(thresholdName) );
+				const float value=static_cast<const l1menu::ReducedEvent&>( sample.getEvent(eventNumber) ).parameterValue( identifiers.at(thresholdName) );
+				CPPUNIT_ASSERT_MESSAGE( description+" "+trigger.name()+" "+thresholdName+" for event "+std::to_string(eventNumber)+" should be "+std::to_string(expectedValue)+" but is "+std::to_string(value),
+						std::memcmp( &expectedValue, &value, sizeof(float) )==0 );
+			}
+		}
+	}
+}
+
+void ReducedSampleUnitTestSuite::checkSamplesIdentical( const l1menu::ReducedSample& sample, const l1menu::ReducedSample& expectedSample, const std::string& description )
+{
+	const l1menu::TriggerMenu& expectedMenu=expectedSample.getTriggerMenu();
+	CPPUNIT_ASSERT_EQUAL_MESSAGE( description, expectedMenu.numberOfTriggers(), sample.getTriggerMenu().numberOfTriggers() );
+	for( size_t triggerNumber=0; triggerNumber<expectedMenu.numberOfTriggers(); ++triggerNumber )
+	{
+		CPPUNIT_ASSERT_MESSAGE( description+" doesn't have "+expectedMenu.getTrigger(triggerNumber).name(), sample.containsTrigger( expectedMenu.getTrigger(triggerNumber) ) );
+	}
+
+	CPPUNIT_ASSERT_EQUAL_MESSAGE( description, expectedSample.numberOfEvents(), sample.numberOfEvents() );
+	// The sums can be added up in a different order, so they're only checked to the precision of the float
+	CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( description, expectedSample.sumOfWeights(), sample.sumOfWeights(), 1e-6*std::fabs(expectedSample.sumOfWeights()) );
+	for( size_t eventNumber=0; eventNumber<sample.numberOfEvents(); ++eventNumber )
+	{
+		const float expectedWeight=expectedSample.getEvent(eventNumber).weight();
+		const float weight=sample.getEvent(eventNumber).weight();
+		CPPUNIT_ASSERT_MESSAGE( description+" weight of event "+std::to_string(eventNumber)+" should be "+std::to_string(expectedWeight)+" but is "+std::to_string(weight),
+				std::memcmp( &expectedWeight, &weight, sizeof(float) )==0 );
+	}
+
+	checkThresholdsMatch( expectedMenu, sample, expectedSample, description );
+}
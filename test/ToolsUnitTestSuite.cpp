@@ -11,6 +11,7 @@ class ToolsUnitTestSuite : public CPPUNIT_NS::TestFixture
 	CPPUNIT_TEST_SUITE(ToolsUnitTestSuite);
 	CPPUNIT_TEST(testLinearFitInputCheck);
 	CPPUNIT_TEST(testLinearFitResult);
+	CPPUNIT_TEST(testShardManifestCheck);
 	CPPUNIT_TEST_SUITE_END();
 
 protected:
@@ -21,6 +22,7 @@ public:
 protected:
 	void testLinearFitInputCheck();
 	void testLinearFitResult();
+	void testShardManifestCheck();
 };
 
 
@@ -31,6 +33,7 @@ protected:
 #include <iostream>
 #include <stdexcept>
 #include "l1menu/tools/miscellaneous.h"
+#include "l1menu/tools/shardManifest.h"
 
 CPPUNIT_TEST_SUITE_REGISTRATION(ToolsUnitTestSuite);
 
@@ -70,3 +73,44 @@ void ToolsUnitTestSuite::testLinearFitResult()
 	CPPUNIT_ASSERT_DOUBLES_EQUAL( slope, slopeInterceptPair.first, delta );
 	CPPUNIT_ASSERT_DOUBLES_EQUAL( intercept, slopeInterceptPair.second, delta );
 }
+
+void ToolsUnitTestSuite::testShardManifestCheck()
+{
+	const std::vector<std::string> inputFilenames{ "first.root", "second.root" };
+	auto makeEntry=[&]( size_t firstEventNumber, size_t lastEventNumber )
+	{
+		return l1menu::tools::ShardManifestEntry{ "shard"+std::to_string(firstEventNumber), inputFilenames, 100, firstEventNumber, lastEventNumber, lastEventNumber-firstEventNumber, 1.0 };
+	};
+
+	// Complete, but given out of order. Empty shards are allowed anywhere.
+	std::vector<l1menu::tools::ShardManifestEntry> manifest{ makeEntry(50,100), makeEntry(0,25), makeEntry(25,25), makeEntry(25,50) };
+	CPPUNIT_ASSERT_NO_THROW( l1menu::tools::checkShardManifest( manifest ) );
+	CPPUNIT_ASSERT_EQUAL( size_t(0), manifest[0].firstEventNumber );
+	CPPUNIT_ASSERT_EQUAL( size_t(50), manifest.back().firstEventNumber );
+
+	// A shard missing at the start, in the middle and at the end
+	manifest={ makeEntry(25,50), makeEntry(50,100) };
+	CPPUNIT_ASSERT_THROW( l1menu::tools::checkShardManifest( manifest ), std::runtime_error );
+	manifest={ makeEntry(0,25), makeEntry(50,100) };
+	CPPUNIT_ASSERT_THROW( l1menu::tools::checkShardManifest( manifest ), std::runtime_error );
+	manifest={ makeEntry(0,25), makeEntry(25,50) };
+	CPPUNIT_ASSERT_THROW( l1menu::tools::checkShardManifest( manifest ), std::runtime_error );
+
+	// The same shard twice, and shards that overlap
+	manifest={ makeEntry(0,50), makeEntry(0,50), makeEntry(50,100) };
+	CPPUNIT_ASSERT_THROW( l1menu::tools::checkShardManifest( manifest ), std::runtime_error );
+	manifest={ makeEntry(0,60), makeEntry(50,100) };
+	CPPUNIT_ASSERT_THROW( l1menu::tools::checkShardManifest( manifest ), std::runtime_error );
+
+	// Shards made from different input files
+	manifest={ makeEntry(0,50), makeEntry(50,100) };
+	manifest[1].inputFilenames.pop_back();
+	CPPUNIT_ASSERT_THROW( l1menu::tools::checkShardManifest( manifest ), std::runtime_error );
+
+	// An event count that doesn't match the range
+	manifest={ makeEntry(0,50), makeEntry(50,100) };
+	manifest[1].numberOfEvents=49;
+	CPPUNIT_ASSERT_THROW( l1menu::tools::checkShardManifest( manifest ), std::runtime_error );
+
+	CPPUNIT_ASSERT_THROW( l1menu::tools::checkShardManifest( manifest={} ), std::runtime_error );
+}
@@ -0,0 +1,254 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include <vector>
+#include <random>
+#include "l1menu/FullSample.h"
+#include "l1menu/L1TriggerDPGEvent.h"
+#include "RandomEvents.h"
+
+
+/** @brief A cppunit TestFixture to check that the different ways of finding the tightest
+ * thresholds that pass an event agree with each other.
+ *
+ * ITrigger::calculateTightestThresholds, l1menu::tools::findTightestThresholdFromCandidates and
+ * l1menu::tools::ThresholdExtractor are checked against
+ * l1menu::tools::setTriggerThresholdsAsTightAsPossible (i.e. bisection), for every trigger in the
+ * TriggerTable, on randomly generated events. Also checks that ITrigger::applyUsingDerivedQuantities
+ * always agrees with ITrigger::apply.
+ */
+class TriggerThresholdsUnitTestSuite : public CPPUNIT_NS::TestFixture
+{
+	CPPUNIT_TEST_SUITE(TriggerThresholdsUnitTestSuite);
+	CPPUNIT_TEST(testCalculatedThresholdsMatchBisection);
+	CPPUNIT_TEST(testCandidateSearchMatchesBisection);
+	CPPUNIT_TEST(testThresholdExtractorMatchesBisection);
+	CPPUNIT_TEST(testDerivedQuantitiesMatchApply);
+	CPPUNIT_TEST_SUITE_END();
+
+protected:
+	std::ostream* pVerboseOutput_;
+	l1menu::FullSample emptySample_; ///< @brief Only required because events need a parent sample
+	std::vector<l1menu::L1TriggerDPGEvent> events_;
+	float tolerance_;
+public:
+	TriggerThresholdsUnitTestSuite();
+	void setUp();
+
+protected:
+	void testCalculatedThresholdsMatchBisection();
+	void testCandidateSearchMatchesBisection();
+	void testThresholdExtractorMatchesBisection();
+	void testDerivedQuantitiesMatchApply();
+
+	/** @brief Finds the thresholds with setTriggerThresholdsAsTightAsPossible on a copy of the trigger. */
+	std::vector<float> thresholdsFromBisection( const l1menu::ITrigger& trigger, const l1menu::L1TriggerDPGEvent& event );
+	/** @brief Checks the thresholds against the result of the bisection, allowing for its tolerance and search range. */
+	void checkAgainstBisection( const l1menu::ITrigger& trigger, const l1menu::L1TriggerDPGEvent& event, const std::vector<float>& thresholds );
+};
+
+
+
+
+
+#include <cppunit/config/SourcePrefix.h>
+#include <stdexcept>
+#include <sstream>
+#include "l1menu/TriggerTable.h"
+#include "l1menu/ITrigger.h"
+#include "l1menu/tools/miscellaneous.h"
+#include "l1menu/tools/ThresholdExtractor.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TriggerThresholdsUnitTestSuite);
+
+TriggerThresholdsUnitTestSuite::TriggerThresholdsUnitTestSuite() : tolerance_(0.001)
+{
+	pVerboseOutput_=nullptr;
+	//pVerboseOutput_=&std::cout;
+}
+
+void TriggerThresholdsUnitTestSuite::setUp()
+{
+	if( !events_.empty() ) return;
+
+	// Use a fixed seed so that the test is the same every time
+	std::mt19937 randomGenerator( 2013 );
+	l1menu::L1TriggerDPGEvent event( emptySample_ );
+	for( size_t eventNumber=0; eventNumber<500; ++eventNumber )
+	{
+		randomiseEvent( event, randomGenerator );
+		events_.push_back( event );
+	}
+}
+
+void TriggerThresholdsUnitTestSuite::testCalculatedThresholdsMatchBisection()
+{
+	const l1menu::TriggerTable& triggerTable=l1menu::TriggerTable::instance();
+
+	for( const auto& triggerDetails : triggerTable.listTriggers() )
+	{
+		std::unique_ptr<l1menu::ITrigger> pTrigger=triggerTable.getTrigger( triggerDetails );
+		std::vector<float> thresholds( l1menu::tools::getThresholdNames(*pTrigger).size() );
+
+		size_t numberOfEventsChecked=0;
+		for( const auto& event : events_ )
+		{
+			// This is optional, so it's fine for a trigger not to implement it
+			if( !pTrigger->calculateTightestThresholds( event, thresholds.data() ) ) continue;
+			checkAgainstBisection( *pTrigger, event, thresholds );
+			++numberOfEventsChecked;
+		}
+		if( pVerboseOutput_!=nullptr ) *pVerboseOutput_ << triggerDetails.name << " v" << triggerDetails.version << " calculated thresholds checked for " << numberOfEventsChecked << " events" << std::endl;
+	}
+}
+
+void TriggerThresholdsUnitTestSuite::testCandidateSearchMatchesBisection()
+{
+	const l1menu::TriggerTable& triggerTable=l1menu::TriggerTable::instance();
+	std::vector<float> candidates;
+
+	for( const auto& triggerDetails : triggerTable.listTriggers() )
+	{
+		std::unique_ptr<l1menu::ITrigger> pTrigger=triggerTable.getTrigger( triggerDetails );
+		const std::vector<std::string> thresholdNames=l1menu::tools::getThresholdNames( *pTrigger );
+
+		// Use a copy for the search so that the original thresholds can be used for the
+		// bisection. Set up the scalings the same way as setTriggerThresholdsAsTightAsPossible.
+		std::unique_ptr<l1menu::ITrigger> pTriggerCopy=triggerTable.copyTrigger( *pTrigger );
+		std::vector< std::pair<float*,float> > otherParameterScalings;
+		size_t numberOfSearchedThresholds=thresholdNames.size();
+		if( pTrigger->thresholdsAreCorrelated() )
+		{
+			for( size_t index=1; index<thresholdNames.size(); ++index )
+			{
+				otherParameterScalings.push_back( std::make_pair( &pTriggerCopy->parameter(thresholdNames[index]), pTrigger->parameter(thresholdNames[index])/pTrigger->parameter(thresholdNames[0]) ) );
+			}
+			numberOfSearchedThresholds=1;
+		}
+
+		size_t numberFound=0;
+		for( const auto& event : events_ )
+		{
+			const std::vector<float> expectedThresholds=thresholdsFromBisection( *pTrigger, event );
+			l1menu::tools::getCandidateThresholds( event, otherParameterScalings, candidates );
+
+			for( size_t index=0; index<numberOfSearchedThresholds; ++index )
+			{
+				// Search for each threshold with the other ones set to zero, like the bisection does
+				for( size_t otherIndex=0; otherIndex<numberOfSearchedThresholds; ++otherIndex ) pTriggerCopy->parameter(thresholdNames[otherIndex])=0;
+
+				float result;
+				if( !l1menu::tools::findTightestThresholdFromCandidates( event, *pTriggerCopy, pTriggerCopy->parameter(thresholdNames[index]), otherParameterScalings, candidates, 0, result ) ) continue;
+				++numberFound;
+
+				std::stringstream message;
+				message << triggerDetails.name << " v" << triggerDetails.version << " " << thresholdNames[index] << " expected " << expectedThresholds[index] << " but got " << result;
+				CPPUNIT_ASSERT_MESSAGE( message.str(), expectedThresholds[index]!=-1 );
+				CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( message.str(), expectedThresholds[index], result, tolerance_+0.0001 );
+			}
+		}
+		if( pVerboseOutput_!=nullptr ) *pVerboseOutput_ << triggerDetails.name << " v" << triggerDetails.version << " candidate search found " << numberFound << " thresholds" << std::endl;
+	}
+}
+
+void TriggerThresholdsUnitTestSuite::testThresholdExtractorMatchesBisection()
+{
+	const l1menu::TriggerTable& triggerTable=l1menu::TriggerTable::instance();
+
+	for( const auto& triggerDetails : triggerTable.listTriggers() )
+	{
+		std::unique_ptr<l1menu::ITrigger> pTrigger=triggerTable.getTrigger( triggerDetails );
+		l1menu::tools::ThresholdExtractor extractor( *pTrigger, tolerance_ );
+		std::vector<float> thresholds( extractor.numberOfThresholds() );
+
+		for( const auto& event : events_ )
+		{
+			l1menu::tools::ThresholdExtractor::Status status=extractor.extract( event, thresholds.data() );
+			if( !thresholds.empty() ) CPPUNIT_ASSERT( (status==l1menu::tools::ThresholdExtractor::Status::OK)==(thresholds[0]!=-1) );
+			checkAgainstBisection( *pTrigger, event, thresholds );
+		}
+	}
+}
+
+void TriggerThresholdsUnitTestSuite::testDerivedQuantitiesMatchApply()
+{
+	const l1menu::TriggerTable& triggerTable=l1menu::TriggerTable::instance();
+
+	// One copy of each trigger for each threshold, applied one after the other to each event like a
+	// menu would be. That way the quantities worked out for one trigger are used by the others.
+	std::vector< std::unique_ptr<l1menu::ITrigger> > triggers;
+	for( const auto& triggerDetails : triggerTable.listTriggers() )
+	{
+		for( int step=0; step<12; ++step )
+		{
+			triggers.push_back( triggerTable.getTrigger( triggerDetails ) );
+			// The calorimeter Et values are multiples of 4 for the jets, so steps of 4 land right on some of them
+			for( const auto& thresholdName : l1menu::tools::getThresholdNames(*triggers.back()) ) triggers.back()->parameter(thresholdName)=step*4;
+		}
+	}
+
+	for( size_t eventNumber=0; eventNumber<events_.size(); ++eventNumber )
+	{
+		l1menu::L1TriggerDPGEvent event( events_[eventNumber] ); // Copy so that nothing has been worked out yet
+		for( const auto& pTrigger : triggers )
+		{
+			std::stringstream message;
+			message << pTrigger->name() << " v" << pTrigger->version() << " on event " << eventNumber;
+			CPPUNIT_ASSERT_EQUAL_MESSAGE( message.str(), pTrigger->apply(event), pTrigger->applyUsingDerivedQuantities(event) );
+		}
+	}
+}
+
+std::vector<float> TriggerThresholdsUnitTestSuite::thresholdsFromBisection( const l1menu::ITrigger& trigger, const l1menu::L1TriggerDPGEvent& event )
+{
+	std::unique_ptr<l1menu::ITrigger> pTriggerCopy=l1menu::TriggerTable::instance().copyTrigger( trigger );
+	const std::vector<std::string> thresholdNames=l1menu::tools::getThresholdNames( trigger );
+	std::vector<float> thresholds;
+
+	try
+	{
+		l1menu::tools::setTriggerThresholdsAsTightAsPossible( event, *pTriggerCopy, tolerance_ );
+		for( const auto& thresholdName : thresholdNames ) thresholds.push_back( pTriggerCopy->parameter(thresholdName) );
+	}
+	catch( std::exception& error )
+	{
+		thresholds.assign( thresholdNames.size(), -1 );
+	}
+	return thresholds;
+}
+
+void TriggerThresholdsUnitTestSuite::checkAgainstBisection( const l1menu::ITrigger& trigger, const l1menu::L1TriggerDPGEvent& event, const std::vector<float>& thresholds )
+{
+	const l1menu::TriggerTable& triggerTable=l1menu::TriggerTable::instance();
+	const std::vector<float> expectedThresholds=thresholdsFromBisection( trigger, event );
+	const std::vector<std::string> thresholdNames=l1menu::tools::getThresholdNames( trigger );
+	CPPUNIT_ASSERT_EQUAL( expectedThresholds.size(), thresholds.size() );
+	if( thresholds.empty() ) return;
+
+	// The bisection only searches up to 5 times the suggested upper edge, so gives up on anything higher. If the
+	// thresholds are correlated only the first one is searched for, and the others are scaled with it.
+	const size_t numberOfSearchedThresholds=( trigger.thresholdsAreCorrelated() ? 1 : thresholds.size() );
+	bool outsideSearchRange=false;
+	for( size_t index=0; index<numberOfSearchedThresholds; ++index )
+	{
+		float upperEdge=100; // Gives the bisection's default search limit of 500 if there's no suggestion
+		try{ upperEdge=triggerTable.getSuggestedUpperEdge( trigger.name(), thresholdNames[index] ); }
+		catch( std::exception& error ) { /* No suggestion has been set, so keep the default */ }
+		if( thresholds[index]>=upperEdge*5 ) outsideSearchRange=true;
+	}
+
+	for( size_t index=0; index<thresholds.size(); ++index )
+	{
+		std::stringstream message;
+		message << trigger.name() << " v" << trigger.version() << " " << thresholdNames[index] << " expected " << expectedThresholds[index] << " but got " << thresholds[index];
+
+		if( expectedThresholds[index]==-1 ) CPPUNIT_ASSERT_MESSAGE( message.str(), thresholds[index]==-1 || outsideSearchRange );
+		else
+		{
+			// The bisection always gives a value within its tolerance of the turn on. Scaled thresholds are
+			// within the scaled tolerance. Allow a little extra for rounding.
+			float allowedDifference=tolerance_;
+			if( index>=numberOfSearchedThresholds ) allowedDifference*=trigger.parameter(thresholdNames[index])/trigger.parameter(thresholdNames[0]);
+			CPPUNIT_ASSERT_MESSAGE( message.str(), thresholds[index]!=-1 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( message.str(), expectedThresholds[index], thresholds[index], allowedDifference+0.0001 );
+		}
+	}
+}